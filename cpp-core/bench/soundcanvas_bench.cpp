@@ -0,0 +1,482 @@
+// Microbenchmarks for the generation pipeline stages.
+//
+//   ./soundcanvas_bench --benchmark_out=bench.json --benchmark_out_format=json
+//
+// Every benchmark reports items/sec and "allocs_per_call" (global operator
+// new calls per iteration, counted by the replacement below). Compare two
+// JSON runs with Google Benchmark's tools/compare.py to catch regressions.
+
+#include <benchmark/benchmark.h>
+
+#include "AudioEngine.hpp"
+#include "Composer.hpp"
+#include "DenseKernels.hpp"
+#include "GenreTemplate.hpp"
+#include "ImageFeatures.hpp"
+#include "MidiWriter.hpp"
+#include "MusicMapping.hpp"
+#include "PatternTransform.hpp"
+#include "RequestArena.hpp"
+#include "SectionPlanner.hpp"
+#include "SongSpec.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// ---------------------------------------------------------------------------
+// Allocation counting
+// ---------------------------------------------------------------------------
+
+static std::atomic<uint64_t> g_allocations{0};
+
+// Every replaced operator new goes through one of these two and every
+// operator delete through free(), matching the C allocator that produced
+// the pointer. None of them reach the library's default operator delete.
+static void* countedAlloc(std::size_t size) noexcept {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+// std::pmr::new_delete_resource() (the default memory resource) allocates
+// through the aligned forms, so they are counted too
+static void* countedAlignedAlloc(std::size_t size, std::align_val_t align) noexcept {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t alignment = static_cast<std::size_t>(align);
+    std::size_t rounded = (size + alignment - 1) / alignment * alignment;
+    return std::aligned_alloc(alignment, rounded ? rounded : alignment);
+}
+
+static void* orThrow(void* p) {
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size) { return orThrow(countedAlloc(size)); }
+void* operator new[](std::size_t size) { return orThrow(countedAlloc(size)); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+
+void* operator new(std::size_t size, std::align_val_t align) { return orThrow(countedAlignedAlloc(size, align)); }
+void* operator new[](std::size_t size, std::align_val_t align) { return orThrow(countedAlignedAlloc(size, align)); }
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+static uint64_t allocationCount() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+static void reportAllocations(benchmark::State& state, uint64_t allocations) {
+    state.counters["allocs_per_call"] =
+        benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+// ---------------------------------------------------------------------------
+// Fixtures
+// ---------------------------------------------------------------------------
+
+// Binary PPM with a colour gradient and some noise, decoded by stb like any
+// upload
+static std::string makeImage(int width, int height) {
+    std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    std::string bytes = header;
+    bytes.resize(header.size() + static_cast<size_t>(width) * height * 3);
+    uint32_t noise = 12345;
+    char* px = &bytes[header.size()];
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            noise = noise * 1664525u + 1013904223u;
+            *px++ = static_cast<char>((x * 255 / width + (noise >> 28)) & 0xFF);
+            *px++ = static_cast<char>((y * 255 / height + (noise >> 24)) & 0xFF);
+            *px++ = static_cast<char>(((x + y) * 127 / (width + height) + 64) & 0xFF);
+        }
+    }
+    return bytes;
+}
+
+static const ImageFeatures& sampleFeatures() {
+    static const ImageFeatures features = [] {
+        std::string image = makeImage(256, 256);
+        return extractImageFeaturesFromMemory(
+            reinterpret_cast<const unsigned char*>(image.data()), image.size());
+    }();
+    return features;
+}
+
+static const MusicParameters& sampleParams() {
+    static const MusicParameters params = mapFeaturesToMusicHeuristic(sampleFeatures());
+    return params;
+}
+
+static SongPlan samplePlan(GenreType genre) {
+    return planSong(sampleFeatures(), sampleParams(), getGenreTemplate(genre));
+}
+
+// Dense enough that per-call overhead doesn't dominate
+static const MidiPattern& samplePattern() {
+    static const MidiPattern pattern = [] {
+        MidiPattern p = createHiHatPattern(256, true);
+        MidiPattern bass = createBassPattern(256, 36, 1, 0.8f);
+        p.notes.insert(p.notes.end(), bass.notes.begin(), bass.notes.end());
+        return p;
+    }();
+    return pattern;
+}
+
+// Refill without reallocating, so the transform's own allocations are
+// what gets counted
+static void resetPattern(MidiPattern& work, const MidiPattern& source) {
+    work.notes.assign(source.notes.begin(), source.notes.end());
+    work.lengthInTicks = source.lengthInTicks;
+    work.lengthInBars = source.lengthInBars;
+}
+
+static void resetColumns(MidiPatternColumns& work, const MidiPatternColumns& source) {
+    work.note.assign(source.note.begin(), source.note.end());
+    work.velocity.assign(source.velocity.begin(), source.velocity.end());
+    work.startTick.assign(source.startTick.begin(), source.startTick.end());
+    work.duration.assign(source.duration.begin(), source.duration.end());
+    work.channel.assign(source.channel.begin(), source.channel.end());
+    work.lengthInTicks = source.lengthInTicks;
+    work.lengthInBars = source.lengthInBars;
+}
+
+static fs::path benchDir() {
+    static const fs::path dir = [] {
+        fs::path d = fs::temp_directory_path() / "soundcanvas_bench";
+        fs::create_directories(d);
+        return d;
+    }();
+    return dir;
+}
+
+// ---------------------------------------------------------------------------
+// Image features
+// ---------------------------------------------------------------------------
+
+// Args: square image side in pixels, fast_features
+static void BM_ExtractImageFeatures(benchmark::State& state) {
+    const int side = static_cast<int>(state.range(0));
+    FeatureOptions options;
+    options.fast = state.range(1) != 0;
+    std::string image = makeImage(side, side);
+
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        ImageFeatures features = extractImageFeaturesFromMemory(
+            reinterpret_cast<const unsigned char*>(image.data()), image.size(), options);
+        benchmark::DoNotOptimize(features);
+    }
+    reportAllocations(state, allocationCount() - before);
+    state.SetItemsProcessed(state.iterations() * side * side);  // pixels
+}
+BENCHMARK(BM_ExtractImageFeatures)
+    ->ArgsProduct({{256, 1024, 2048}, {0, 1}})
+    ->ArgNames({"side", "fast"})
+    ->Unit(benchmark::kMicrosecond);
+
+// ---------------------------------------------------------------------------
+// Embedded model
+// ---------------------------------------------------------------------------
+
+// Args: batch rows, int8 weights. One 8 -> 64 -> 64 -> 7 relu MLP, the
+// embedded model's shape, through the dense kernels.
+static void BM_DenseMlp(benchmark::State& state) {
+    const size_t rows = static_cast<size_t>(state.range(0));
+    const bool int8 = state.range(1) != 0;
+    const size_t dims[] = {8, 64, 64, 7};
+
+    std::mt19937 rng(7);
+    std::normal_distribution<float> normal(0.0f, 0.3f);
+    std::vector<std::vector<float>> weights, scales, biases;
+    std::vector<std::vector<int8_t>> quantized;
+    for (size_t l = 0; l < 3; ++l) {
+        weights.emplace_back(dims[l] * dims[l + 1]);
+        for (float& w : weights.back()) w = normal(rng);
+        biases.emplace_back(dims[l + 1], 0.1f);
+        scales.emplace_back(dims[l + 1], 0.01f);
+        quantized.emplace_back(weights.back().size());
+        for (size_t i = 0; i < quantized.back().size(); ++i) {
+            quantized.back()[i] = static_cast<int8_t>(std::clamp(weights.back()[i] * 100.0f, -127.0f, 127.0f));
+        }
+    }
+
+    std::vector<float> a(rows * 64, 0.5f), b(rows * 64);
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        float* cur = a.data();
+        float* next = b.data();
+        for (size_t l = 0; l < 3; ++l) {
+            if (int8) {
+                denseLayerInt8(cur, rows, dims[l], quantized[l].data(), scales[l].data(),
+                               biases[l].data(), dims[l + 1], l < 2, next);
+            } else {
+                denseLayer(cur, rows, dims[l], weights[l].data(), biases[l].data(), dims[l + 1],
+                           l < 2, next);
+            }
+            std::swap(cur, next);
+        }
+        benchmark::DoNotOptimize(cur[0]);
+    }
+    reportAllocations(state, allocationCount() - before);
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_DenseMlp)->ArgsProduct({{1, 8, 64}, {0, 1}})->ArgNames({"rows", "int8"});
+
+// ---------------------------------------------------------------------------
+// Ambient synth
+// ---------------------------------------------------------------------------
+
+// Arg: patternType (0=pad, 1=arp, 2=chords); streamed to a counting sink
+static void BM_GenerateAmbientTrack(benchmark::State& state) {
+    MusicParameters params = sampleParams();
+    params.patternType = static_cast<int>(state.range(0));
+
+    size_t bytes = 0;
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        streamAmbientTrack([&bytes](const char*, std::size_t size) {
+            bytes += size;
+            return true;
+        }, params);
+    }
+    reportAllocations(state, allocationCount() - before);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_GenerateAmbientTrack)->DenseRange(0, 2)->ArgName("pattern")->Unit(benchmark::kMillisecond);
+
+// ---------------------------------------------------------------------------
+// Song planning
+// ---------------------------------------------------------------------------
+
+static void BM_MakeSongSpec(benchmark::State& state) {
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        SongSpec spec = makeSongSpec(sampleFeatures(), sampleParams());
+        benchmark::DoNotOptimize(spec);
+    }
+    reportAllocations(state, allocationCount() - before);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MakeSongSpec);
+
+// Arg: GenreType
+static void BM_PlanSong(benchmark::State& state) {
+    const GenreTemplate& genre = getGenreTemplate(static_cast<GenreType>(state.range(0)));
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        SongPlan plan = planSong(sampleFeatures(), sampleParams(), genre);
+        benchmark::DoNotOptimize(plan);
+    }
+    reportAllocations(state, allocationCount() - before);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PlanSong)->DenseRange(0, 3)->ArgName("genre");
+
+// ---------------------------------------------------------------------------
+// Composition and MIDI output
+// ---------------------------------------------------------------------------
+
+// Arg: GenreType. Composition into the in-memory model, which is what
+// composeSongToMidi does before writing
+static void BM_ComposeSong(benchmark::State& state) {
+    SongSpec spec = songPlanToSpec(samplePlan(static_cast<GenreType>(state.range(0))));
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        MidiWriter midi = composeSong(spec);
+        benchmark::DoNotOptimize(midi);
+    }
+    reportAllocations(state, allocationCount() - before);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ComposeSong)->DenseRange(0, 3)->ArgName("genre")->Unit(benchmark::kMicrosecond);
+
+// Args: GenreType, arena. One /generate request's planning and composition,
+// from the global heap (arena:0) or with everything but the returned bytes
+// allocated from a per-request RequestArena (arena:1)
+static void BM_ComposeRequest(benchmark::State& state) {
+    const GenreTemplate& genre = getGenreTemplate(static_cast<GenreType>(state.range(0)));
+    bool useArena = state.range(1) != 0;
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        RequestArena arena;
+        std::pmr::memory_resource* resource =
+            useArena ? &arena : std::pmr::get_default_resource();
+        SongPlan plan = planSong(sampleFeatures(), sampleParams(), genre, resource);
+        MidiWriter midi = composeSong(songPlanToSpec(plan, resource), resource);
+        std::vector<uint8_t> bytes = midi.toBytes();
+        benchmark::DoNotOptimize(bytes);
+    }
+    reportAllocations(state, allocationCount() - before);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ComposeRequest)
+    ->ArgsProduct({{0, 1, 2, 3}, {0, 1}})
+    ->ArgNames({"genre", "arena"})
+    ->Unit(benchmark::kMicrosecond);
+
+// Arg: GenreType. Compose + encode + write the file, end to end
+static void BM_ComposeSongToMidi(benchmark::State& state) {
+    SongSpec spec = songPlanToSpec(samplePlan(static_cast<GenreType>(state.range(0))));
+    std::string path = (benchDir() / "compose.mid").string();
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        composeSongToMidi(spec, path);
+    }
+    reportAllocations(state, allocationCount() - before);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ComposeSongToMidi)->DenseRange(0, 3)->ArgName("genre")->Unit(benchmark::kMicrosecond);
+
+// Each iteration writes a freshly composed copy, so encoding is measured
+// too (a writer caches its encoded tracks after the first write)
+static const MidiWriter& sampleSong() {
+    static const MidiWriter midi = composeSong(songPlanToSpec(samplePlan(GenreType::EDM_DROP)));
+    return midi;
+}
+
+static void BM_MidiWriterWrite(benchmark::State& state) {
+    std::string path = (benchDir() / "mix.mid").string();
+    uint64_t allocations = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        MidiWriter midi = sampleSong();
+        uint64_t before = allocationCount();
+        state.ResumeTiming();
+
+        midi.write(path);
+        allocations += allocationCount() - before;
+    }
+    reportAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MidiWriterWrite)->Unit(benchmark::kMicrosecond);
+
+static void BM_MidiWriterWriteSeparateStems(benchmark::State& state) {
+    fs::path dir = benchDir() / "stems";
+    fs::create_directories(dir);
+    uint64_t allocations = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        MidiWriter midi = sampleSong();
+        uint64_t before = allocationCount();
+        state.ResumeTiming();
+
+        auto stems = midi.writeSeparateStems(dir.string());
+        benchmark::DoNotOptimize(stems);
+        allocations += allocationCount() - before;
+    }
+    reportAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MidiWriterWriteSeparateStems)->Unit(benchmark::kMicrosecond);
+
+// ---------------------------------------------------------------------------
+// Pattern transforms (items = notes; each iteration includes refilling the
+// working copy from the source pattern, without allocating)
+// ---------------------------------------------------------------------------
+
+template <typename Transform>
+static void runPatternBenchmark(benchmark::State& state, Transform transform) {
+    const MidiPattern& source = samplePattern();
+    MidiPattern work = source;
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        resetPattern(work, source);
+        transform(work);
+        benchmark::DoNotOptimize(work.notes.data());
+    }
+    reportAllocations(state, allocationCount() - before);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(source.notes.size()));
+}
+
+template <typename Transform>
+static void runColumnsBenchmark(benchmark::State& state, Transform transform) {
+    const MidiPatternColumns source = toColumns(samplePattern());
+    MidiPatternColumns work = source;
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        resetColumns(work, source);
+        transform(work);
+        benchmark::DoNotOptimize(work.note.data());
+    }
+    reportAllocations(state, allocationCount() - before);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(source.size()));
+}
+
+static void BM_TransposePattern(benchmark::State& state) {
+    runPatternBenchmark(state, [](MidiPattern& p) { transposePattern(p, 5); });
+}
+BENCHMARK(BM_TransposePattern);
+
+static void BM_ScaleVelocity(benchmark::State& state) {
+    runPatternBenchmark(state, [](MidiPattern& p) { scaleVelocity(p, 0.8f); });
+}
+BENCHMARK(BM_ScaleVelocity);
+
+static void BM_ThinNotes(benchmark::State& state) {
+    runPatternBenchmark(state, [](MidiPattern& p) { thinNotes(p, 0.6f); });
+}
+BENCHMARK(BM_ThinNotes);
+
+static void BM_Humanize(benchmark::State& state) {
+    runPatternBenchmark(state, [](MidiPattern& p) { humanize(p, 10, 8); });
+}
+BENCHMARK(BM_Humanize);
+
+static void BM_TransposeColumns(benchmark::State& state) {
+    runColumnsBenchmark(state, [](MidiPatternColumns& p) { transposePattern(p, 5); });
+}
+BENCHMARK(BM_TransposeColumns);
+
+static void BM_ScaleVelocityColumns(benchmark::State& state) {
+    runColumnsBenchmark(state, [](MidiPatternColumns& p) { scaleVelocity(p, 0.8f); });
+}
+BENCHMARK(BM_ScaleVelocityColumns);
+
+static void BM_ThinNotesColumns(benchmark::State& state) {
+    runColumnsBenchmark(state, [](MidiPatternColumns& p) { thinNotes(p, 0.6f, 7); });
+}
+BENCHMARK(BM_ThinNotesColumns);
+
+static void BM_HumanizeColumns(benchmark::State& state) {
+    runColumnsBenchmark(state, [](MidiPatternColumns& p) { humanize(p, 10, 8, 7); });
+}
+BENCHMARK(BM_HumanizeColumns);
+
+// All four in one fused pass
+static void BM_ApplyTransforms(benchmark::State& state) {
+    PatternTransformChain chain = PatternTransformChain()
+        .thin(0.6f).transpose(5).scaleVelocity(0.8f).humanize(10, 8).withSeed(7);
+    runColumnsBenchmark(state, [&chain](MidiPatternColumns& p) { applyTransforms(p, chain); });
+}
+BENCHMARK(BM_ApplyTransforms);
+
+BENCHMARK_MAIN();
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <functional>
 #include <string>
 
 struct MusicParameters {
@@ -18,4 +20,11 @@ struct StyleParameters;
 // Phase 7: Added optional styleParams for ambience, instrument presets, mood
 void generateAmbientTrack(const std::string& outputPath,
                           const MusicParameters& params,
-                          const StyleParameters* styleParams = nullptr);
\ No newline at end of file
+                          const StyleParameters* styleParams = nullptr);
+
+// Streams the same WAV bytes (header first) to a sink instead of a file,
+// e.g. an httplib chunked response. The sink returns false to abort, in
+// which case std::runtime_error is thrown.
+void streamAmbientTrack(const std::function<bool(const char* data, std::size_t size)>& sink,
+                        const MusicParameters& params,
+                        const StyleParameters* styleParams = nullptr);
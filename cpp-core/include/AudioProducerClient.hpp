@@ -1,22 +1,64 @@
 #ifndef AUDIO_PRODUCER_CLIENT_HPP
 #define AUDIO_PRODUCER_CLIENT_HPP
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+namespace httplib {
+class Client;
+}
+
 /**
  * Client for calling the audio-producer microservice
  * Handles multi-stem mixing and mastering
+ *
+ * Long-lived and thread-safe: keep-alive connections are pooled (one per
+ * in-flight request), and the service's health is cached. Requests keep
+ * the cache current, and an optional background thread refreshes it, so
+ * callers check healthy() instead of probing before every job.
  */
 class AudioProducerClient {
  public:
+  struct Options {
+    int connectTimeoutMs = 2000;
+    int produceTimeoutSec = 120;   // mixing/mastering can take minutes
+    int renderTimeoutSec = 60;     // one stem
+    size_t maxIdleConnections = 8;  // kept open between requests
+    int healthIntervalMs = 0;      // background /health refresh; 0 = off
+  };
+
+  // Options from SC_PRODUCER_CONNECT_TIMEOUT_MS, SC_PRODUCER_TIMEOUT_SECONDS,
+  // SC_PRODUCER_POOL_SIZE and SC_PRODUCER_HEALTH_INTERVAL_MS
+  static Options optionsFromEnv();
+
+  /**
+   * Progress reported while /produce runs: fraction in [0, 1] and the
+   * service's stage name (e.g. "mixing", "mastering")
+   */
+  using ProgressCallback =
+      std::function<void(double fraction, const std::string& stage)>;
+
   /**
    * Constructor
    * @param baseUrl URL of the audio-producer service (e.g.,
    * "http://audio-producer:9001")
    */
-  explicit AudioProducerClient(const std::string& baseUrl);
+  explicit AudioProducerClient(const std::string& baseUrl,
+                               const Options& options = optionsFromEnv());
+  ~AudioProducerClient();
+
+  AudioProducerClient(const AudioProducerClient&) = delete;
+  AudioProducerClient& operator=(const AudioProducerClient&) = delete;
 
   /**
    * Produce final mixed and mastered track from MIDI stems
@@ -30,6 +72,10 @@ class AudioProducerClient {
    * @param applySidechain Whether to apply sidechain compression
    * @param sidechainTargets List of stems to apply sidechain to (e.g., {"bass",
    * "lead", "pad"})
+   * @param progress If set, the response is requested as an NDJSON stream
+   *                 ({"progress": 0.4, "stage": "mixing"} lines, then the
+   *                 result) and each progress line is passed on. A service
+   *                 that answers with plain JSON just reports no progress.
    * @return true if successful, false otherwise
    */
   bool produceTrack(const std::map<std::string, std::string>& stems,
@@ -37,7 +83,19 @@ class AudioProducerClient {
                     const std::string& genre = "EDM_Drop",
                     bool applyMastering = true, bool applySidechain = true,
                     const std::vector<std::string>& sidechainTargets = {
-                        "bass", "lead", "pad"});
+                        "bass", "lead", "pad"},
+                    ProgressCallback progress = nullptr);
+
+  /**
+   * produceTrack() on its own thread, so the caller is not blocked while
+   * the service mixes and masters. The client must outlive the future.
+   */
+  std::future<bool> produceTrackAsync(
+      std::map<std::string, std::string> stems, std::string outputPath,
+      std::string genre = "EDM_Drop", bool applyMastering = true,
+      bool applySidechain = true,
+      std::vector<std::string> sidechainTargets = {"bass", "lead", "pad"},
+      ProgressCallback progress = nullptr);
 
   /**
    * Render single MIDI stem to WAV (no mixing/mastering)
@@ -49,17 +107,98 @@ class AudioProducerClient {
   bool renderStem(const std::string& midiPath, const std::string& outputPath);
 
   /**
-   * Health check
+   * Render one stem from MIDI bytes sent in the request body (multipart:
+   * file part "midi", text fields "name" and "output_path"), so the input
+   * never goes through a shared filesystem
+   *
+   * @param name Stem name (e.g. "bass")
+   * @param midi Complete single-track MIDI file
+   * @param outputPath Output WAV file path
+   * @return true if successful
+   */
+  bool renderStem(const std::string& name, const std::vector<uint8_t>& midi,
+                  const std::string& outputPath);
+
+  /**
+   * Render stems concurrently, at most maxInFlight /render-stem requests at
+   * a time, each on its own connection
+   *
+   * @param stems Map of stem name -> MIDI bytes (MidiWriter::separateStemBytes)
+   * @param outputDir Directory for the rendered <name>.wav files
+   * @return Map of stem name -> WAV path for every stem that rendered
+   */
+  std::map<std::string, std::string> renderStems(
+      const std::map<std::string, std::vector<uint8_t>>& stems,
+      const std::string& outputDir, size_t maxInFlight = 6);
+
+  /**
+   * Mix and master stems that are already rendered. Sends "stem_audio"
+   * (stem name -> WAV path) instead of "stems", so the service skips its
+   * own render pass. Other parameters as for produceTrack().
+   */
+  bool produceFromRenderedStems(
+      const std::map<std::string, std::string>& stemAudio,
+      const std::string& outputPath, const std::string& genre = "EDM_Drop",
+      bool applyMastering = true, bool applySidechain = true,
+      const std::vector<std::string>& sidechainTargets = {"bass", "lead",
+                                                          "pad"},
+      ProgressCallback progress = nullptr);
+
+  /**
+   * renderStems() followed by produceFromRenderedStems(): stems render in
+   * parallel and the mix starts as soon as the last one finishes.
+   * Fails if any stem fails to render.
+   */
+  bool produceTrackParallel(
+      const std::map<std::string, std::vector<uint8_t>>& stems,
+      const std::string& stemsDir, const std::string& outputPath,
+      const std::string& genre = "EDM_Drop", bool applyMastering = true,
+      bool applySidechain = true,
+      const std::vector<std::string>& sidechainTargets = {"bass", "lead",
+                                                          "pad"},
+      size_t maxInFlight = 6, ProgressCallback progress = nullptr);
+
+  /**
+   * Health check: probes /health now and updates the cached state
    * @return true if service is healthy
    */
   bool healthCheck();
 
+  /**
+   * Last known health, without a request. Optimistic until the first
+   * probe or request says otherwise.
+   */
+  bool healthy() const { return healthy_.load(); }
+
  private:
   std::string baseUrl_;
   std::string host_;
   int port_;
+  Options options_;
+
+  std::mutex poolMutex_;
+  std::vector<std::unique_ptr<httplib::Client>> idle_;
+
+  std::atomic<bool> healthy_{true};
+  std::mutex healthMutex_;
+  std::condition_variable healthCv_;
+  bool stopping_ = false;
+  std::thread healthThread_;
 
   void parseUrl();
+
+  std::unique_ptr<httplib::Client> acquireConnection();
+  void releaseConnection(std::unique_ptr<httplib::Client> client);
+
+  void healthLoop();
+
+  // POST /produce with the stems under stemsKey plus the mix options
+  bool postProduce(const char* stemsKey,
+                   const std::map<std::string, std::string>& stems,
+                   const std::string& outputPath, const std::string& genre,
+                   bool applyMastering, bool applySidechain,
+                   const std::vector<std::string>& sidechainTargets,
+                   const ProgressCallback& progress);
 };
 
 #endif  // AUDIO_PRODUCER_CLIENT_HPP
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <map>
+#include <memory_resource>
 #include <string>
 
+#include "MidiWriter.hpp"
 #include "SectionPlanner.hpp"
 #include "SongSpec.hpp"
 
@@ -11,6 +13,25 @@
  * Generates complete multi-track MIDI files from SongSpec
  */
 
+/**
+ * Compose a song into an in-memory MIDI model, one track per spec track.
+ * The mix (write) and the stems (writeSeparateStems) are both serialized
+ * from it, so they always contain the same notes.
+ *
+ * The writer's tracks and the per-track event lists are allocated from
+ * resource, which must outlive the writer. Tracks are composed in
+ * parallel, so the resource must be thread-safe (RequestArena is).
+ */
+MidiWriter composeSong(const SongSpec& spec,
+                       std::pmr::memory_resource* resource =
+                           std::pmr::get_default_resource());
+
+/**
+ * Build the drum pattern banks composition otherwise compiles on first
+ * use, so the first request doesn't pay for them. Idempotent.
+ */
+void warmComposer();
+
 /**
  * Compose a complete song to MIDI file based on SongSpec
  * Includes: drums, bass, chords, melody, pads with musical progressions
@@ -20,9 +41,27 @@ void composeSongToMidi(const SongSpec& spec, const std::string& midiPath);
 /**
  * Phase 8: Genre-aware composition with structured sections
  * Uses SongPlan to create EDM-style tracks with build/drop/break structure
+ * (allocating from resource, as composeSong())
+ */
+MidiWriter composeGenreSong(const SongPlan& plan,
+                            std::pmr::memory_resource* resource =
+                                std::pmr::get_default_resource());
+
+/**
+ * composeGenreSong() written to a MIDI file. Served from the shared
+ * composition cache when the same plan was composed before.
  */
 void composeGenreSongToMidi(const SongPlan& plan, const std::string& midiPath);
 
+/**
+ * composeGenreSongToMidi() plus one stem file per track in outputDir,
+ * also through the composition cache
+ * @return Map of stem name -> filepath
+ */
+std::map<std::string, std::string> composeGenreSongToMidiAndStems(
+    const SongPlan& plan, const std::string& midiPath,
+    const std::string& outputDir);
+
 /**
  * Compose and export separate MIDI stems for multi-track production
  * @param spec Song specification
@@ -31,3 +70,11 @@ void composeGenreSongToMidi(const SongPlan& plan, const std::string& midiPath);
  */
 std::map<std::string, std::string> composeSongToStems(
     const SongSpec& spec, const std::string& outputDir);
+
+/**
+ * Compose once and write both the full mix and the stems
+ * @return Map of stem name -> filepath
+ */
+std::map<std::string, std::string> composeSongToMidiAndStems(
+    const SongSpec& spec, const std::string& midiPath,
+    const std::string& outputDir);
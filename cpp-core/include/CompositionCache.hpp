@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SectionPlanner.hpp"
+
+/**
+ * A composed song, serialized: the Format 1 mix and, if it was asked for,
+ * the per-track stems. Immutable once cached.
+ */
+struct CachedComposition {
+    std::vector<uint8_t> midi;
+    std::map<std::string, std::vector<uint8_t>> stems;  // empty unless requested
+    bool hasStems = false;
+
+    size_t byteSize() const;
+};
+
+/**
+ * LRU cache of compositions keyed by the song plan.
+ *
+ * Composition is a pure function of the SongPlan and the humanization seed,
+ * and many images land on the same plan, so a hit serves the stored SMF
+ * bytes and skips the composer entirely. Memory is bounded by total bytes
+ * rather than entries, since songs differ in length. With a disk directory
+ * configured, entries are also written there (<key>.mid, stems under
+ * <key>.stems/) and reloaded on a memory miss, so workers sharing the
+ * directory compose each plan once. Thread-safe.
+ */
+class CompositionCache {
+public:
+    struct Config {
+        size_t maxBytes = 64 * 1024 * 1024;  // 0 disables the cache
+        std::string diskDir;                 // empty = memory only
+    };
+
+    struct Stats {
+        uint64_t hits = 0;        // served from memory or disk
+        uint64_t diskHits = 0;    // subset of hits that were reloaded from disk
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;         // serialized MIDI held in memory
+    };
+
+    explicit CompositionCache(const Config& config);
+
+    /**
+     * Config from SC_COMPOSITION_CACHE_BYTES and SC_COMPOSITION_CACHE_DIR
+     */
+    static Config configFromEnv();
+
+    /**
+     * Canonical key for a plan: every field the composer reads, floats by
+     * their exact bits, plus the seed and a format version.
+     */
+    static std::string planKey(const SongPlan& plan, uint32_t seed);
+
+    bool enabled() const { return config_.maxBytes > 0; }
+
+    /**
+     * The entry for key, or null (counting a miss) if it is absent or
+     * lacks the stems asked for.
+     */
+    std::shared_ptr<const CachedComposition> lookup(const std::string& key, bool withStems);
+
+    void store(const std::string& key, std::shared_ptr<const CachedComposition> value);
+
+    /**
+     * The composition for plan, composed with composeGenreSong() and
+     * stored on a miss. Always returns an entry, cache enabled or not.
+     * Composer temporaries come from resource; the entry itself does not.
+     */
+    std::shared_ptr<const CachedComposition> getOrCompose(
+        const SongPlan& plan, bool withStems,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const CachedComposition> value;
+    };
+
+    void insertLocked(const std::string& key, std::shared_ptr<const CachedComposition> value);
+    std::shared_ptr<const CachedComposition> loadFromDisk(const std::string& key, bool withStems) const;
+    void saveToDisk(const std::string& key, const CachedComposition& value) const;
+
+    Config config_;
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;  // front = most recently used
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    size_t bytes_ = 0;
+    Stats stats_;
+};
+
+/**
+ * Process-wide cache, configured from the environment on first use.
+ */
+CompositionCache& sharedCompositionCache();
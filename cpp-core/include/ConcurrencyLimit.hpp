@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * Non-blocking admission for a bounded number of concurrent activities,
+ * for work that can't go through the JobQueue (e.g. a response streamed
+ * from the connection thread). tryAcquire() hands out a slot or refuses
+ * at once, so callers answer 429 instead of queueing. A slot is released
+ * when the last copy of it is destroyed, so it can be captured by a
+ * callback that outlives the request handler. Thread-safe; the limit
+ * must outlive its slots.
+ */
+class ConcurrencyLimit {
+public:
+    using Slot = std::shared_ptr<void>;
+
+    explicit ConcurrencyLimit(size_t limit) : limit_(limit) {}
+
+    ConcurrencyLimit(const ConcurrencyLimit&) = delete;
+    ConcurrencyLimit& operator=(const ConcurrencyLimit&) = delete;
+
+    // A held slot, or an empty one when limit() are already taken
+    Slot tryAcquire() {
+        size_t current = active_.load();
+        do {
+            if (current >= limit_) return Slot();
+        } while (!active_.compare_exchange_weak(current, current + 1));
+        return Slot(this, [](void* self) { static_cast<ConcurrencyLimit*>(self)->active_--; });
+    }
+
+    size_t active() const { return active_.load(); }
+    size_t limit() const { return limit_; }
+
+private:
+    const size_t limit_;
+    std::atomic<size_t> active_{0};
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized fully connected layer for the embedded parameter model
+// (EmbeddedModel.cpp). Weights use the Keras kernel layout, input-major:
+// weights[i * outputs + j] connects input i to output j, so the kernels
+// vectorize across outputs. Each kernel dispatches on activeSimdLevel(), and
+// every path accumulates in the same order, so results are bit-identical.
+
+// out[r * outputs + j] = act(bias[j] + sum_i in[r * inputs + i] * weights[i * outputs + j])
+// for rows rows; act is max(0, x) with relu, the identity otherwise.
+void denseLayer(const float* in, std::size_t rows, std::size_t inputs,
+                const float* weights, const float* bias, std::size_t outputs,
+                bool relu, float* out);
+
+// As denseLayer() with weight-only int8 quantization: output j's weights
+// are weights[i * outputs + j] * scales[j]. Activations stay float.
+void denseLayerInt8(const float* in, std::size_t rows, std::size_t inputs,
+                    const int8_t* weights, const float* scales, const float* bias,
+                    std::size_t outputs, bool relu, float* out);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * In-process evaluation of the feature -> music parameter regressor, a
+ * stack of dense layers, from a flat weight file exported by
+ * ml/export_embedded_model.py. The file is mmap'd read-only and the layers
+ * run straight from the mapping (DenseKernels), so loading costs no copy
+ * and the pages are shared between processes.
+ *
+ * File format (little-endian, every section 4-byte aligned):
+ *
+ *   char     magic[4] = "SCNN"
+ *   uint32   version = 1, inputs, outputs, layers, reserved = 0
+ *   float32  inputMean[inputs], inputScale[inputs]      x' = (x - mean) * scale
+ *   float32  outputMean[outputs], outputScale[outputs]  y = y' * scale + mean
+ *   per layer:
+ *     uint32   inputs, outputs, activation (0 linear, 1 relu),
+ *              dtype (0 float32, 1 int8)
+ *     float32: float32 weights[inputs * outputs]
+ *     int8:    float32 scales[outputs], int8 weights[inputs * outputs],
+ *              zero padding to a multiple of 4 bytes
+ *     float32  bias[outputs]
+ *
+ * Weights are input-major (the Keras Dense kernel layout). Immutable after
+ * loading, so evaluate() is thread-safe.
+ */
+class EmbeddedModel {
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    // Maps and validates the file; throws std::runtime_error if it can't be
+    // read or isn't a well-formed model
+    explicit EmbeddedModel(const std::string& path);
+    ~EmbeddedModel();
+
+    EmbeddedModel(const EmbeddedModel&) = delete;
+    EmbeddedModel& operator=(const EmbeddedModel&) = delete;
+
+    /**
+     * Run rows input rows (rows * inputs() floats) through the network into
+     * rows * outputs() floats.
+     */
+    void evaluate(const float* in, size_t rows, float* out) const;
+
+    size_t inputs() const { return inputs_; }
+    size_t outputs() const { return outputs_; }
+    size_t layerCount() const { return layers_.size(); }
+    bool quantized() const;  // any int8 layer
+    size_t fileBytes() const { return size_; }
+    const std::string& path() const { return path_; }
+
+private:
+    struct Layer {
+        size_t inputs;
+        size_t outputs;
+        bool relu;
+        const float* weights;      // float32 layers
+        const int8_t* weightsInt8; // int8 layers
+        const float* scales;       // int8 layers
+        const float* bias;
+    };
+
+    std::string path_;
+    void* map_ = nullptr;
+    size_t size_ = 0;
+
+    size_t inputs_ = 0;
+    size_t outputs_ = 0;
+    size_t maxWidth_ = 0;  // widest layer output, for the scratch buffers
+    const float* inputMean_ = nullptr;
+    const float* inputScale_ = nullptr;
+    const float* outputMean_ = nullptr;
+    const float* outputScale_ = nullptr;
+    std::vector<Layer> layers_;
+};
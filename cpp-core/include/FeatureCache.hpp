@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "AudioEngine.hpp"   // MusicParameters
+#include "ImageFeatures.hpp"
+
+/**
+ * Result of analysing one image: what /generate needs before composing.
+ */
+struct CachedAnalysis {
+    ImageFeatures features;
+    MusicParameters params;
+};
+
+/**
+ * Content-addressed LRU cache of image analyses for the HTTP server.
+ *
+ * Keys come from contentKey() (hash of the encoded image bytes plus the
+ * mapping mode and feature options), so re-submitting the same photo skips
+ * decoding, feature extraction and the TF Serving round trip. Entries
+ * expire after a TTL. With a disk directory configured, stored entries are
+ * also written there as small JSON files and reloaded on a memory miss
+ * (e.g. after a restart). Thread-safe.
+ */
+class FeatureCache {
+public:
+    struct Config {
+        size_t maxEntries = 1024;                 // 0 disables the cache
+        std::chrono::seconds ttl{3600};
+        std::string diskDir;                      // empty = memory only
+    };
+
+    struct Stats {
+        uint64_t hits = 0;        // served from memory or disk
+        uint64_t diskHits = 0;    // subset of hits that were reloaded from disk
+        uint64_t misses = 0;
+        uint64_t evictions = 0;   // LRU or TTL removals
+        size_t entries = 0;
+    };
+
+    explicit FeatureCache(const Config& config);
+
+    /**
+     * Config from SC_CACHE_ENTRIES, SC_CACHE_TTL_SECONDS and SC_CACHE_DIR
+     */
+    static Config configFromEnv();
+
+    /**
+     * Key for encoded image bytes; variant distinguishes the mode and
+     * feature options that produced the analysis.
+     */
+    static std::string contentKey(const void* data, size_t size, const std::string& variant);
+
+    /**
+     * The variant string for an analysis made with this mapping mode and
+     * these feature options.
+     */
+    static std::string variantFor(const std::string& mode, const FeatureOptions& options);
+
+    bool enabled() const { return config_.maxEntries > 0; }
+
+    /**
+     * Copy the entry for key into out. Returns false (and counts a miss)
+     * if it is absent or expired.
+     */
+    bool lookup(const std::string& key, CachedAnalysis& out);
+
+    void store(const std::string& key, const CachedAnalysis& value);
+
+    Stats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string key;
+        CachedAnalysis value;
+        Clock::time_point expires;
+    };
+
+    void insertLocked(const std::string& key, const CachedAnalysis& value, Clock::time_point expires);
+    bool loadFromDisk(const std::string& key, CachedAnalysis& out, std::chrono::seconds& age) const;
+    void saveToDisk(const std::string& key, const CachedAnalysis& value) const;
+
+    Config config_;
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;  // front = most recently used
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    Stats stats_;
+};
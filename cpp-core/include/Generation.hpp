@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+#include "FeatureCache.hpp"
+#include "ImageFeatures.hpp"
+#include "ModelClient.hpp"
+
+/**
+ * The image → MIDI generation steps shared by the HTTP server and the CLI.
+ */
+
+/**
+ * Read an encoded image file. Throws std::runtime_error if it can't be read.
+ */
+std::string readImageFile(const std::string& path);
+
+/**
+ * Optional "fast_features" (bool) and "pixel_budget" (int) request fields,
+ * on top of defaults.
+ */
+FeatureOptions featureOptionsFromJson(const nlohmann::json& body,
+                                      FeatureOptions defaults = FeatureOptions());
+
+/**
+ * Genre selection, song planning and MIDI composition for one analysed
+ * image, written under outputDir. Returns the /generate response JSON.
+ * Output names carry a per-process sequence number as well as the time,
+ * so concurrent calls never write the same file.
+ */
+nlohmann::json composeAnalysis(const CachedAnalysis& analysis, const std::string& outputDir);
+
+/**
+ * Same as composeAnalysis(), but the MIDI file is serialized into midi
+ * instead of being written anywhere. The response has "midi_bytes" in
+ * place of "midi_path"/"audio_path".
+ */
+nlohmann::json composeAnalysisToMemory(const CachedAnalysis& analysis, std::vector<uint8_t>& midi);
+
+struct BatchItem {
+    std::string imagePath;
+    std::string mode;             // "heuristic" or "model"
+    FeatureOptions featureOptions;
+};
+
+/**
+ * A batch entry: a bare path string, or an object with "image_path" and
+ * optional "mode"/"fast_features"/"pixel_budget" overriding defaults.
+ * Throws std::invalid_argument for anything else.
+ */
+BatchItem batchItemFromJson(const nlohmann::json& entry, const BatchItem& defaults);
+
+/**
+ * Pipelined generation for many images (backfills).
+ *
+ * Items are processed in windows. For each window, images are decoded and
+ * analysed in parallel on the shared worker pool, every model-mode image
+ * that missed the cache goes to TF Serving in one predictBatch() request,
+ * then songs are planned and composed in parallel. Each item's result line
+ * is emitted as soon as it is composed, so output order is completion
+ * order; lines carry the item's index.
+ */
+class BatchGenerator {
+public:
+    struct Options {
+        size_t window = 32;  // images analysed / predicted together
+    };
+
+    // Options from SC_BATCH_WINDOW
+    static Options optionsFromEnv();
+
+    // model and cache may be null: model-mode items then use the heuristic,
+    // and nothing is cached. Both must outlive the generator.
+    BatchGenerator(const std::string& outputDir, const ModelClient* model,
+                   FeatureCache* cache, const Options& options = optionsFromEnv());
+
+    // Receives one result line; returning false stops the batch (e.g. the
+    // client went away). Calls are serialized.
+    using Emit = std::function<bool(const nlohmann::json& line)>;
+
+    /**
+     * Run every item, emitting {"index", "image_path", "status": "ok",
+     * "result"} or {"index", "image_path", "status": "error", "error",
+     * "error_status"} per item. Returns how many succeeded.
+     */
+    size_t run(const std::vector<BatchItem>& items, const Emit& emit);
+
+private:
+    std::string outputDir_;
+    const ModelClient* model_;
+    FeatureCache* cache_;
+    Options options_;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+// Per-pixel statistics kernels for feature extraction (ImageFeatures.cpp).
+// accumulatePixels dispatches on activeSimdLevel(): AVX2 and NEON convert
+// 8 pixels per iteration with branchless HSV math; SSE2 (no byte shuffles
+// for the RGB de-interleave) and other targets use the scalar loop. Vector
+// paths keep short float partial sums per lane, so they agree with the
+// scalar path to ~1e-6 relative rather than bit-for-bit.
+
+// Running sums for every statistic the image features need. One pass over
+// the decoded pixels fills these; no per-pixel buffer is kept.
+struct PixelMoments {
+    // RGB for averages (raw 0-255 values)
+    long long sumR = 0, sumG = 0, sumB = 0;
+
+    // HSV for averages (H in [0, 360], S in [0, 1])
+    double sumHue = 0.0, sumSat = 0.0;
+
+    // Colorfulness metric (opponent channels rg = R - G, yb = (R + G) / 2 - B)
+    double sumRG = 0.0, sumYB = 0.0;
+    double sumRG_sq = 0.0, sumYB_sq = 0.0;
+
+    // Contrast (grayscale moments)
+    double sumGray = 0.0, sumGray_sq = 0.0;
+};
+
+// Add numPixels interleaved 8-bit RGB pixels to m.
+void accumulatePixels(const unsigned char* rgb, std::size_t numPixels, PixelMoments& m);
+
+// total += part, field by field (used to combine per-tile partial sums).
+void mergePixelMoments(PixelMoments& total, const PixelMoments& part);
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+
+/**
+ * Error a job (or a request handler) raises to pick its HTTP status,
+ * e.g. 400 for a bad request body. Anything else counts as 500.
+ */
+class RequestError : public std::runtime_error {
+public:
+    RequestError(int status, const std::string& message)
+        : std::runtime_error(message), status_(status) {}
+
+    int status() const { return status_; }
+
+private:
+    int status_;
+};
+
+/**
+ * Bounded compute pool for generation jobs.
+ *
+ * Work runs on a fixed set of dedicated threads, never on the HTTP
+ * connection threads, so slow requests cannot starve the server. At most
+ * maxQueued jobs wait for a thread; submit() refuses more (the caller
+ * answers 429). Finished jobs stay queryable for the retention period,
+ * at most maxRetained of them (the oldest go first). Thread-safe.
+ */
+class JobQueue {
+public:
+    struct Options {
+        size_t workers = std::max(1u, std::thread::hardware_concurrency());
+        size_t maxQueued = 64;            // waiting jobs, not counting running ones
+        std::chrono::seconds retention{600};  // how long finished jobs are kept
+        size_t maxRetained = 1024;        // finished jobs kept at most
+    };
+
+    // Options from SC_JOB_WORKERS, SC_JOB_QUEUE_DEPTH, SC_JOB_RETENTION_SECONDS
+    // and SC_JOB_MAX_RETAINED
+    static Options optionsFromEnv();
+
+    enum class State { QUEUED, RUNNING, DONE, FAILED };
+
+    struct Snapshot {
+        std::string id;
+        State state = State::QUEUED;
+        nlohmann::json result;     // DONE: what the work returned
+        int errorStatus = 0;       // FAILED: HTTP status for the error
+        std::string error;         // FAILED: message
+    };
+
+    using Work = std::function<nlohmann::json()>;
+
+    explicit JobQueue(const Options& options = optionsFromEnv());
+    ~JobQueue();  // finishes running jobs, drops queued ones
+
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+
+    /**
+     * Queue work and return its job id, or an empty string when the queue
+     * is full. A pinned job is for a caller that waits for it and then
+     * calls erase(): it is kept until then whatever the retention, and
+     * doesn't count toward maxRetained.
+     */
+    std::string submit(Work work, bool pinned = false);
+
+    /**
+     * Current state of a job; false for unknown (or expired) ids.
+     */
+    bool get(const std::string& id, Snapshot& out);
+
+    /**
+     * Like get(), but first waits up to timeout for the job to finish
+     * (long-poll). out.state tells whether it did.
+     */
+    bool waitFor(const std::string& id, std::chrono::milliseconds timeout, Snapshot& out);
+
+    /**
+     * Drop a finished job before its retention ends, e.g. once a
+     * synchronous caller has its result. Queued or running jobs are
+     * left alone; returns whether the job was dropped.
+     */
+    bool erase(const std::string& id);
+
+    size_t queued() const;
+    size_t running() const;
+    size_t retained() const;  // finished jobs still queryable
+    const Options& options() const { return options_; }
+
+    static const char* stateName(State state);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        Snapshot snapshot;
+        Work work;
+        Clock::time_point finished{};
+        bool pinned = false;       // kept until erase(), never pruned
+    };
+
+    void workerLoop();
+    void pruneLocked(Clock::time_point now);
+
+    Options options_;
+    uint64_t idPrefix_;
+    uint64_t nextId_ = 1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable workCv_;   // workers: a job was queued
+    std::condition_variable doneCv_;   // waiters: a job finished
+    std::deque<std::string> pending_;  // ids in submission order
+    std::map<std::string, Job> jobs_;
+    std::deque<std::string> finishedOrder_;  // unpinned, for retention pruning
+    size_t running_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
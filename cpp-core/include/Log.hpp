@@ -0,0 +1,216 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Structured logging for the request path.
+ *
+ * A line is a level, a component ("HTTP", "Generate", ...), a message and
+ * key=value fields. In async mode (the server) callers copy the raw parts
+ * into a fixed-size slot of a lock-free ring and return; a background
+ * thread formats and writes whole batches, so handler threads never take a
+ * stream lock or wait on a flush. Lines that don't fit the ring are
+ * dropped and counted rather than blocking. In sync mode (the CLI) lines
+ * are formatted and written at once, in order with std::cout.
+ *
+ * Output is logfmt text (INFO and DEBUG to stdout, WARN and ERROR to
+ * stderr) or one JSON object per line.
+ */
+
+enum class LogLevel {
+    DEBUG = 0,  // per-request detail
+    INFO = 1,
+    WARN = 2,
+    ERROR = 3,
+    OFF = 4
+};
+
+/**
+ * One key=value field. Strings are referenced, so they must outlive the
+ * log call; numbers and booleans are formatted into the field.
+ */
+class LogField {
+public:
+    LogField(std::string_view key, std::string_view value)
+        : key_(key), text_(value.data()), size_(value.size()) {}
+    LogField(std::string_view key, const char* value) : LogField(key, std::string_view(value)) {}
+    LogField(std::string_view key, const std::string& value)
+        : LogField(key, std::string_view(value)) {}
+
+    template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+    LogField(std::string_view key, T value) : key_(key), numeric_(true) {
+        if constexpr (std::is_same_v<T, bool>) {
+            set(value ? "true" : "false");
+        } else if constexpr (std::is_integral_v<T>) {
+            formatInteger(static_cast<long long>(value));
+        } else {
+            formatFloat(static_cast<double>(value));
+        }
+    }
+
+    LogField(const LogField& other) { *this = other; }
+    LogField& operator=(const LogField& other);
+
+    std::string_view key() const { return key_; }
+    std::string_view value() const {
+        return {text_ ? text_ : buffer_, size_};
+    }
+    bool numeric() const { return numeric_; }  // number or bool: unquoted in JSON
+
+private:
+    void set(std::string_view text);
+    void formatInteger(long long value);
+    void formatFloat(double value);
+
+    std::string_view key_;
+    const char* text_ = nullptr;  // referenced string, or null for buffer_
+    size_t size_ = 0;
+    bool numeric_ = false;
+    char buffer_[32] = {};
+};
+
+class Logger {
+public:
+    struct Options {
+        LogLevel level = LogLevel::DEBUG;
+        bool async = false;
+        bool json = false;
+        bool timestamps = false;  // text format; JSON always has "ts"
+        size_t capacity = 4096;   // ring slots (rounded up to a power of two)
+    };
+
+    // defaults overridden by SC_LOG_LEVEL (debug/info/warn/error/off),
+    // SC_LOG_FORMAT (text/json) and SC_LOG_ASYNC (0/1)
+    static Options optionsFromEnv(Options defaults);
+
+    Logger();
+    ~Logger();  // writes whatever is still queued
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /**
+     * Switch options, flushing first. Call at startup, before other
+     * threads log.
+     */
+    void configure(const Options& options);
+
+    bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+    }
+
+    void log(LogLevel level, std::string_view component, std::string_view message,
+             const LogField* fields, size_t count);
+    void log(LogLevel level, std::string_view component, std::string_view message,
+             std::initializer_list<LogField> fields = {}) {
+        log(level, component, message, fields.begin(), fields.size());
+    }
+
+    // Block until every line logged so far is written
+    void flush();
+
+    // Lines lost to a full ring
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    const Options& options() const { return options_; }
+
+private:
+    struct Record;
+    struct Slot;
+
+    void encode(Record& record, LogLevel level, std::string_view component,
+                std::string_view message, const LogField* fields, size_t count) const;
+    void writerLoop();
+    size_t drain(std::string& out, std::string& err);
+    void format(const Record& record, std::string& out) const;
+    void write(std::string& out, std::string& err);
+    void startWriter();
+    void stopWriter();
+
+    Options options_;
+    std::atomic<int> level_{static_cast<int>(LogLevel::DEBUG)};
+    std::atomic<uint64_t> dropped_{0};
+
+    // Ring (Vyukov bounded queue; many producers, the writer consumes)
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    std::atomic<uint64_t> enqueuePos_{0};
+    uint64_t dequeuePos_ = 0;
+
+    std::mutex mutex_;                  // writer sleep/flush, sync writes
+    std::condition_variable wakeCv_;
+    std::condition_variable flushedCv_;
+    std::atomic<bool> writerWaiting_{false};
+    uint64_t written_ = 0;              // ring positions written out
+    bool stopping_ = false;
+    std::thread writer_;
+};
+
+/**
+ * The process-wide logger: synchronous, DEBUG, text until configured.
+ */
+Logger& logger();
+
+inline void logDebug(std::string_view component, std::string_view message,
+                     std::initializer_list<LogField> fields = {}) {
+    if (logger().enabled(LogLevel::DEBUG)) logger().log(LogLevel::DEBUG, component, message, fields);
+}
+inline void logInfo(std::string_view component, std::string_view message,
+                    std::initializer_list<LogField> fields = {}) {
+    if (logger().enabled(LogLevel::INFO)) logger().log(LogLevel::INFO, component, message, fields);
+}
+inline void logWarn(std::string_view component, std::string_view message,
+                    std::initializer_list<LogField> fields = {}) {
+    if (logger().enabled(LogLevel::WARN)) logger().log(LogLevel::WARN, component, message, fields);
+}
+inline void logError(std::string_view component, std::string_view message,
+                     std::initializer_list<LogField> fields = {}) {
+    if (logger().enabled(LogLevel::ERROR)) logger().log(LogLevel::ERROR, component, message, fields);
+}
+
+/**
+ * Tags the current thread's log lines with a request id and collects its
+ * StageTimer timings for a summary line. Scoped; nests by shadowing.
+ */
+class LogContext {
+public:
+    static constexpr size_t MAX_TIMINGS = 12;
+
+    explicit LogContext(std::string_view requestId);
+    ~LogContext();
+
+    LogContext(const LogContext&) = delete;
+    LogContext& operator=(const LogContext&) = delete;
+
+    // The innermost context on this thread, or null
+    static LogContext* current();
+
+    std::string_view requestId() const { return {id_, idSize_}; }
+
+    // Accumulates time under name (a string literal or other static name)
+    void addTiming(const char* name, std::chrono::nanoseconds elapsed);
+
+    // Append one "<name>_ms" field per recorded timing
+    void appendTimingFields(std::vector<LogField>& fields) const;
+
+private:
+    char id_[40];
+    size_t idSize_ = 0;
+    const char* timingNames_[MAX_TIMINGS];
+    char timingKeys_[MAX_TIMINGS][32];
+    int64_t timingNanos_[MAX_TIMINGS];
+    size_t timings_ = 0;
+    LogContext* previous_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+/**
+ * Thrown when work can't be admitted under a MemoryBudget: it needs more
+ * than the whole budget (fits() false; retrying won't help), or the wait
+ * for room timed out.
+ */
+class MemoryBudgetExceeded : public std::runtime_error {
+public:
+    MemoryBudgetExceeded(const std::string& message, bool fits)
+        : std::runtime_error(message), fits_(fits) {}
+
+    bool fits() const { return fits_; }
+
+private:
+    bool fits_;
+};
+
+/**
+ * Global budget for transient memory, such as decoded images.
+ *
+ * Callers reserve their estimated peak before allocating and release it
+ * when done. Reservations that don't fit wait in FIFO order, so one large
+ * image can't be starved by a stream of small ones. They give up after
+ * maxWait. With a budget of 0, everything is admitted at once. The point
+ * is a predictable peak RSS whatever images arrive. Thread-safe.
+ */
+class MemoryBudget {
+public:
+    struct Options {
+        size_t budgetBytes = 0;                      // 0 = unlimited
+        std::chrono::milliseconds maxWait{10000};    // queueing limit per reservation
+    };
+
+    struct Stats {
+        size_t budgetBytes = 0;
+        size_t reservedBytes = 0;
+        size_t waiting = 0;
+        uint64_t waited = 0;      // reservations that had to queue
+        uint64_t rejected = 0;    // larger than the whole budget
+        uint64_t timedOut = 0;
+    };
+
+    /**
+     * Releases its bytes when destroyed. Move-only.
+     */
+    class Reservation {
+    public:
+        Reservation() = default;
+        Reservation(Reservation&& other) noexcept;
+        Reservation& operator=(Reservation&& other) noexcept;
+        ~Reservation();
+
+        Reservation(const Reservation&) = delete;
+        Reservation& operator=(const Reservation&) = delete;
+
+        size_t bytes() const { return bytes_; }
+
+    private:
+        friend class MemoryBudget;
+        Reservation(MemoryBudget* budget, size_t bytes) : budget_(budget), bytes_(bytes) {}
+
+        MemoryBudget* budget_ = nullptr;
+        size_t bytes_ = 0;
+    };
+
+    // Options from SC_MEMORY_BUDGET_BYTES and SC_MEMORY_BUDGET_WAIT_MS
+    static Options optionsFromEnv();
+
+    explicit MemoryBudget(const Options& options);
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    bool enabled() const { return options_.budgetBytes > 0; }
+
+    /**
+     * Reserve bytes, waiting for room if needed. what names the work in
+     * error messages. Throws MemoryBudgetExceeded.
+     */
+    Reservation acquire(size_t bytes, const std::string& what);
+
+    Stats stats() const;
+
+private:
+    void release(size_t bytes);
+
+    Options options_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::list<size_t> queue_;  // waiting reservations, oldest first
+    size_t reserved_ = 0;
+    Stats stats_;
+};
+
+/**
+ * Process-wide budget, configured from the environment on first use.
+ */
+MemoryBudget& sharedMemoryBudget();
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Log.hpp"
+
+/**
+ * Process-wide counters and latency histograms, exported in Prometheus
+ * text format by GET /metrics.
+ *
+ * Recording is a handful of relaxed atomic adds with no locks or
+ * allocation, so it stays on in the hot path. Stages are timed where the
+ * work happens (the feature extractor, the mapping, the composer), which
+ * covers the HTTP server, batches and the CLI alike.
+ */
+
+enum class Stage {
+    IMAGE_LOAD,     // reading the encoded image file
+    MEMORY_WAIT,    // admission to the memory budget before a decode
+    FEATURES,       // decode + feature extraction
+    MAP_MODEL,      // TF Serving mapping, fallback included
+    MAP_HEURISTIC,  // heuristic mapping
+    PLAN,           // genre selection + planSong
+    COMPOSE,        // composing and encoding the MIDI (composition cache misses)
+    MIDI_WRITE,     // writing the MIDI file out (to disk or the response)
+    GENERATE,       // one whole generation job
+    COUNT
+};
+
+enum class Counter {
+    MODEL_REQUESTS,      // TF Serving calls attempted
+    MODEL_ERRORS,        // ... that failed (including circuit breaker rejections)
+    MODEL_FALLBACKS,     // rows answered by the heuristic instead of the model
+    BYTES_WRITTEN,       // MIDI bytes written to disk
+    GENERATE_COALESCED,  // /generate requests answered by an identical one in flight
+    COUNT
+};
+
+/**
+ * Fixed-bucket latency histogram. observe() is wait-free.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 16;
+    static const std::array<double, BUCKETS> kUpperBoundsSeconds;
+
+    void observe(std::chrono::nanoseconds elapsed);
+
+    // Append the _bucket/_sum/_count series, labels like: stage="plan"
+    void appendPrometheus(std::string& out, const char* name, const std::string& labels) const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS + 1> counts_{};  // per bucket; last is +Inf
+    std::atomic<uint64_t> sumNanos_{0};
+};
+
+class Metrics {
+public:
+    void observe(Stage stage, std::chrono::nanoseconds elapsed) {
+        stages_[static_cast<size_t>(stage)].observe(elapsed);
+    }
+
+    void add(Counter counter, uint64_t n = 1) {
+        counters_[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value(Counter counter) const {
+        return counters_[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    // HTTP requests currently being served
+    void requestStarted() { inFlight_.fetch_add(1, std::memory_order_relaxed); }
+    void requestFinished() { inFlight_.fetch_sub(1, std::memory_order_relaxed); }
+
+    // Every histogram and counter, in Prometheus text exposition format
+    void appendPrometheus(std::string& out) const;
+
+    static const char* stageName(Stage stage);
+
+private:
+    std::array<LatencyHistogram, static_cast<size_t>(Stage::COUNT)> stages_;
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::COUNT)> counters_{};
+    std::atomic<int64_t> inFlight_{0};
+};
+
+/**
+ * The process-wide instance.
+ */
+Metrics& metrics();
+
+/**
+ * Times the enclosing scope into a stage histogram, and into the
+ * thread's LogContext (if any) for its request summary line.
+ */
+class StageTimer {
+public:
+    explicit StageTimer(Stage stage)
+        : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+    ~StageTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        metrics().observe(stage_, elapsed);
+        if (LogContext* context = LogContext::current()) {
+            context->addTiming(Metrics::stageName(stage_), elapsed);
+        }
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Counts the enclosing scope as an in-flight request.
+ */
+class InFlightRequest {
+public:
+    InFlightRequest() { metrics().requestStarted(); }
+    ~InFlightRequest() { metrics().requestFinished(); }
+
+    InFlightRequest(const InFlightRequest&) = delete;
+    InFlightRequest& operator=(const InFlightRequest&) = delete;
+};
+
+/**
+ * Append one gauge (or, with type "counter", a counter) in Prometheus
+ * text format, for values owned elsewhere such as queue depths.
+ */
+void appendPrometheusMetric(std::string& out, const char* name, const char* type,
+                            const char* help, double value);
@@ -1,18 +1,31 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <map>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
 /**
  * Minimal Standard MIDI File (SMF) Format 1 writer
  * Supports multi-track MIDI with tempo, time signature, notes, program changes
+ * Channel events are written with running status.
+ *
+ * Track names, event lists and the encoded file are allocated from the
+ * memory resource given at construction (e.g. a per-request RequestArena),
+ * which must outlive the writer. Results handed out (toBytes(),
+ * separateStemBytes(), mergedEvents()) are ordinary heap containers.
  */
 
 class MidiWriter {
  public:
-  MidiWriter(int ticksPerQuarter = 480);
+  class TrackEvents;
+
+  MidiWriter(int ticksPerQuarter = 480,
+             std::pmr::memory_resource* resource =
+                 std::pmr::get_default_resource());
 
   /**
    * Set global tempo in BPM (applies to all tracks)
@@ -29,6 +42,12 @@ class MidiWriter {
    */
   int addTrack(const std::string& name = "");
 
+  /**
+   * Pre-size a track's event storage (e.g. from the song's bar count) so
+   * composing does not reallocate as events are added
+   */
+  void reserve(int track, size_t eventCount);
+
   /**
    * Add note on event
    * @param track Track index (from addTrack)
@@ -49,11 +68,35 @@ class MidiWriter {
    */
   void addProgramChange(int track, int tick, int channel, int program);
 
+  /**
+   * Merge events composed off to the side (e.g. on another thread) into a
+   * track. Existing events stay ahead of incoming ones on equal keys, so
+   * merging buffers in a fixed order gives the same file every time.
+   */
+  void mergeTrack(int track, TrackEvents&& events);
+
   /**
    * Write the complete MIDI file
    */
   void write(const std::string& filepath);
 
+  /**
+   * The complete MIDI file as bytes, for callers that send it on
+   * without touching the filesystem. Same bytes write() produces.
+   */
+  std::vector<uint8_t> toBytes();
+
+  /**
+   * Size in bytes of the file write() produces
+   */
+  size_t byteSize();
+
+  /**
+   * Write an already serialized MIDI file (e.g. toBytes() output)
+   */
+  static void writeBytes(const std::string& filepath,
+                         const std::vector<uint8_t>& bytes);
+
   /**
    * Write individual track to its own MIDI file
    * @param trackIndex Track to export
@@ -63,34 +106,130 @@ class MidiWriter {
 
   /**
    * Write all tracks as separate MIDI files
+   * Repeated track names get a numeric suffix (Drums, Drums_2, ...)
    * @param baseDir Directory to write files to
    * @return Map of track name -> filepath
    */
   std::map<std::string, std::string> writeSeparateStems(
       const std::string& baseDir);
 
+  /**
+   * The stems writeSeparateStems() would write, as bytes
+   * @return Map of track name -> MIDI file bytes
+   */
+  std::map<std::string, std::vector<uint8_t>> separateStemBytes();
+
+  /**
+   * One channel event, for consumers that play the song directly
+   * (e.g. an in-process synth) instead of reading a file
+   */
+  struct ChannelMessage {
+    int32_t tick;
+    uint8_t status;  // 0x80 / 0x90 / 0xC0 | channel
+    uint8_t data1;   // note or program
+    uint8_t data2;   // velocity (0 for program changes)
+  };
+
+  /**
+   * Every track's events merged into playback order. Events on the same
+   * tick keep track order, as a sequencer reading the file would see them.
+   */
+  std::vector<ChannelMessage> mergedEvents() const;
+
+  /**
+   * One track's events in playback order, e.g. to render it as a stem
+   */
+  std::vector<ChannelMessage> trackMessages(int track) const;
+
+  size_t trackCount() const { return tracks_.size(); }
+
+  int ticksPerQuarter() const { return ticksPerQuarter_; }
+
+  /**
+   * Tempo exactly as stored in the file's tempo meta event
+   */
+  uint32_t microsecondsPerQuarter() const;
+
  private:
+  // Packed channel event: absolute tick plus up to 3 inline bytes
+  // (status, data1, data2). 8 bytes, trivially copyable, no heap.
   struct MidiEvent {
-    int tick;
-    std::vector<uint8_t> data;
-
-    bool operator<(const MidiEvent& other) const { return tick < other.tick; }
+    int32_t tick;
+    uint8_t data[3];
+    uint8_t size;  // bytes used in data: 2 (program change) or 3 (notes)
+
+    // Order within a tick: note-offs, then program changes, then note-ons,
+    // so a note retriggered on the same tick is released before it restarts
+    int priority() const {
+      uint8_t kind = data[0] & 0xF0;
+      if (kind == 0x80 || (kind == 0x90 && data[2] == 0)) return 0;
+      return kind == 0x90 ? 2 : 1;
+    }
+
+    bool operator<(const MidiEvent& other) const {
+      if (tick != other.tick) return tick < other.tick;
+      return priority() < other.priority();
+    }
   };
 
   struct Track {
-    std::string name;
-    std::vector<MidiEvent> events;
+    std::pmr::string name;
+    std::pmr::vector<MidiEvent> events;  // always ordered (see insertOrdered)
   };
 
+  using ByteBuffer = std::pmr::vector<uint8_t>;
+
   int ticksPerQuarter_;
   float tempoBpm_;
   int timeSignatureNumerator_;
   int timeSignatureDenominator_;
-  std::vector<Track> tracks_;
+  std::pmr::vector<Track> tracks_;
+
+  // Every track's MTrk chunk, encoded once into one buffer and shared by
+  // write(), writeSingleTrack() and writeSeparateStems() until the song
+  // changes. chunkOffsets_[i] .. chunkOffsets_[i + 1] is track i.
+  ByteBuffer encoded_;
+  std::pmr::vector<size_t> chunkOffsets_;
+  bool encodedValid_ = false;
 
   // Internal helpers
-  void writeVarLen(std::vector<uint8_t>& out, uint32_t value);
-  void writeU16(std::vector<uint8_t>& out, uint16_t value);
-  void writeU32(std::vector<uint8_t>& out, uint32_t value);
-  std::vector<uint8_t> buildTrackData(int trackIndex);
+  static void insertOrdered(std::pmr::vector<MidiEvent>& events,
+                            const MidiEvent& event);
+  static MidiEvent noteOnEvent(int tick, int channel, int note, int velocity);
+  static MidiEvent noteOffEvent(int tick, int channel, int note);
+  static MidiEvent programChangeEvent(int tick, int channel, int program);
+  void insertEvent(int track, const MidiEvent& event);
+  void writeVarLen(ByteBuffer& out, uint32_t value);
+  void writeU32(ByteBuffer& out, uint32_t value);
+  void appendTrackChunk(ByteBuffer& out, int trackIndex);
+  void encodeTracks();
+  std::array<uint8_t, 14> fileHeader(uint16_t format, size_t trackCount) const;
+  std::vector<uint8_t> fileBytes(uint16_t format, size_t firstTrack,
+                                 size_t trackCount);
+  std::vector<std::string> stemNames() const;
+  void writeFile(const std::string& filepath, uint16_t format,
+                 size_t firstTrack, size_t trackCount);
+};
+
+/**
+ * Ordered event list for one track, filled independently of any
+ * MidiWriter and handed over with mergeTrack(). Lets several tracks be
+ * composed concurrently without sharing the writer.
+ */
+class MidiWriter::TrackEvents {
+ public:
+  explicit TrackEvents(std::pmr::memory_resource* resource =
+                           std::pmr::get_default_resource())
+      : events_(resource) {}
+
+  void reserve(size_t eventCount) { events_.reserve(eventCount); }
+  size_t size() const { return events_.size(); }
+
+  void addNoteOn(int tick, int channel, int note, int velocity);
+  void addNoteOff(int tick, int channel, int note);
+  void addProgramChange(int tick, int channel, int program);
+
+ private:
+  friend class MidiWriter;
+  std::pmr::vector<MidiEvent> events_;
 };
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "SectionPlanner.hpp"
+#include "SongSpec.hpp"
+
+/**
+ * One rendered track going into the mix
+ */
+struct MixStem {
+    std::string name;
+    const float* samples = nullptr;  // interleaved stereo at the engine's sample rate
+    size_t frames = 0;
+    float gain = 1.0f;               // linear, e.g. TrackSpec::baseVolume
+    bool sidechainKey = false;       // drives the ducking (the kick)
+    bool ducked = false;             // pumped by the key
+};
+
+struct MixResult {
+    std::vector<float> samples;  // interleaved stereo
+    double loudnessLufs;         // integrated loudness (-inf for silence)
+    float peak;                  // sample peak, linear
+};
+
+/**
+ * In-process mixdown and mastering, the step the audio-producer service
+ * otherwise runs over HTTP:
+ *
+ *   per-stem gain -> sidechain ducking keyed by the kick -> bus compressor
+ *   -> loudness normalization to targetLufs -> lookahead limiter at ceilingDb
+ *
+ * Loudness is ITU-R BS.1770 integrated loudness (K-weighted, gated). The
+ * mix and compressor run block by block with the MixKernels; only the
+ * envelope followers are per-frame scalar code. Stateless between calls
+ * and thread-safe.
+ */
+class MixEngine {
+public:
+    struct Options {
+        int sampleRate = 44100;
+        size_t blockFrames = 1024;
+
+        // Sidechain: ducked stems dip by up to duckDepthDb while the key's
+        // low end is above duckThresholdDb (relative to the key's peak)
+        float duckDepthDb = 8.0f;
+        float duckThresholdDb = -30.0f;
+        float duckAttackMs = 1.0f;
+        float duckReleaseMs = 150.0f;
+        float keyLowpassHz = 150.0f;  // the kick, not the snare and hats on the same stem
+
+        // Bus compressor (feed-forward, peak detecting), after the mix is
+        // gain-staged to targetLufs
+        float compThresholdDb = -10.0f;
+        float compRatio = 2.0f;
+        float compAttackMs = 10.0f;
+        float compReleaseMs = 120.0f;
+
+        // Mastering; with master = false the result is the ducked mix only
+        bool master = true;
+        float targetLufs = -14.0f;
+        float maxGainDb = 24.0f;  // cap on the normalization boost
+        float ceilingDb = -1.0f;
+        float lookaheadMs = 5.0f;
+        float limiterReleaseMs = 80.0f;
+    };
+
+    // Options from SC_RENDER_SAMPLE_RATE (shared with SoundFontRenderer),
+    // SC_MIX_TARGET_LUFS, SC_MIX_CEILING_DB and SC_MIX_DUCK_DB
+    static Options optionsFromEnv();
+
+    explicit MixEngine(const Options& options = optionsFromEnv());
+
+    /**
+     * Mix and master the stems into one stereo buffer as long as the
+     * longest stem. Without a key stem nothing is ducked.
+     */
+    MixResult mix(const std::vector<MixStem>& stems) const;
+
+    /**
+     * BS.1770 integrated loudness in LUFS of interleaved stereo samples;
+     * -inf if everything is below the absolute gate
+     */
+    static double integratedLoudness(const float* samples, size_t frames, int sampleRate);
+
+    const Options& options() const { return options_; }
+
+private:
+    void mixStems(const std::vector<MixStem>& stems, std::vector<float>& out) const;
+    void compress(std::vector<float>& out, float inputGain) const;
+    void limit(std::vector<float>& out, float inputGain) const;
+
+    Options options_;
+};
+
+/**
+ * One stem per spec track, as SoundFontRenderer::renderTracks() renders a
+ * composeSong(spec) writer: gain from TrackSpec::baseVolume, drum tracks
+ * key the sidechain, and bass, chords, lead and pad are ducked (the
+ * targets the CLI sends the audio-producer).
+ */
+std::vector<MixStem> specMixStems(const SongSpec& spec,
+                                  const std::vector<std::vector<float>>& tracks);
+
+/**
+ * As specMixStems() for a composed plan (spec = songPlanToSpec(plan)):
+ * the "kick" layer (or, failing that, every drum track) keys the
+ * sidechain, and the layers the genre template flags sidechainTarget are
+ * ducked.
+ */
+std::vector<MixStem> planMixStems(const SongPlan& plan, const SongSpec& spec,
+                                  const std::vector<std::vector<float>>& tracks);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+// Vectorized block kernels for the mix engine (MixEngine.cpp). All buffers
+// are interleaved stereo floats, as SoundFontRenderer renders them; a
+// "frame gain" is one gain per frame, applied to both channels. Each kernel
+// dispatches on activeSimdLevel(), and every path performs the same
+// operations in the same order, so the mix is bit-identical on all of them.
+
+// out[i] += in[i] * gain for count samples.
+void mixAccumulate(const float* in, float gain, float* out, std::size_t count);
+
+// out[2f + c] += in[2f + c] * frameGain[f] for frames stereo frames.
+void mixAccumulateFrameGain(const float* in, const float* frameGain, float* out,
+                            std::size_t frames);
+
+// samples[2f + c] *= frameGain[f], in place.
+void applyFrameGain(float* samples, const float* frameGain, std::size_t frames);
+
+// peaks[f] = max(|left|, |right|) of each frame.
+void framePeaks(const float* in, float* peaks, std::size_t frames);
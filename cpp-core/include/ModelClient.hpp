@@ -1,20 +1,108 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "ImageFeatures.hpp"
 #include "AudioEngine.hpp"  // for MusicParameters
 
-// Thin client around TensorFlow Serving's REST API.
+namespace httplib {
+class Client;
+}
+
+class EmbeddedModel;
+
+// Client around TensorFlow Serving's REST API.
+//
+// Long-lived and thread-safe: the URL is parsed once, and keep-alive
+// connections are pooled (one per in-flight request). A circuit breaker
+// stops calling TF Serving after repeated failures, so callers fall back
+// to the heuristic mapping immediately instead of waiting out a timeout.
+//
+// With an embedded model configured, predictions are computed in-process
+// (EmbeddedModel) and TF Serving is never contacted.
 class ModelClient {
 public:
+    static constexpr size_t kFeatureInputs = 8;     // features per input row
+    static constexpr size_t kParameterOutputs = 7;  // MusicParameters fields per output row
+
+    struct Options {
+        int connectTimeoutMs = 1000;
+        int readTimeoutMs = 5000;
+        size_t maxIdleConnections = 8;    // kept open between requests
+        int breakerFailureThreshold = 3;  // consecutive failures before opening
+        int breakerOpenMs = 10000;        // fail fast this long, then probe once
+        std::string embeddedModelPath;    // weight file to evaluate in-process
+    };
+
+    // Options from SC_TF_CONNECT_TIMEOUT_MS, SC_TF_READ_TIMEOUT_MS,
+    // SC_TF_POOL_SIZE, SC_TF_BREAKER_FAILURES, SC_TF_BREAKER_OPEN_MS and
+    // SC_EMBEDDED_MODEL.
+    static Options optionsFromEnv();
+
     // baseUrl should be the full predict URL, e.g.:
     // "http://localhost:8501/v1/models/soundcanvas:predict"
-    explicit ModelClient(const std::string& baseUrl);
+    // A URL that is not http://host[:port]/path makes every predict() throw.
+    // Throws std::runtime_error if the embedded model can't be loaded.
+    explicit ModelClient(const std::string& baseUrl, const Options& options = optionsFromEnv());
+    ~ModelClient();
+
+    ModelClient(const ModelClient&) = delete;
+    ModelClient& operator=(const ModelClient&) = delete;
 
     // Send features to TF Serving and get back music parameters.
-    // Throws std::runtime_error on failure.
+    // Throws std::runtime_error on failure, or immediately while the
+    // circuit breaker is open.
     MusicParameters predict(const ImageFeatures& features) const;
 
+    // One request with one "instances" row per input; results are in the
+    // same order. Throws like predict() (the whole batch fails together).
+    std::vector<MusicParameters> predictBatch(const std::vector<ImageFeatures>& batch) const;
+
+    // False while the breaker is open (TF Serving considered down).
+    bool available() const;
+
+    // Predictions come from the in-process model
+    bool embedded() const { return embedded_ != nullptr; }
+
+    // Open up to `connections` keep-alive connections ahead of traffic
+    // (capped at the idle pool size) with a GET of the model's status
+    // resource, and pool the ones that answer 200. Returns how many did
+    // (0 with an embedded model). Never throws and leaves the circuit
+    // breaker alone.
+    size_t warmup(size_t connections) const;
+
 private:
+    using Clock = std::chrono::steady_clock;
+
+    // POST a payload through a pooled connection, updating the breaker.
+    // Returns the response body.
+    std::string post(const std::string& payload) const;
+
+    std::unique_ptr<httplib::Client> acquireConnection() const;
+    void releaseConnection(std::unique_ptr<httplib::Client> client) const;
+
+    // Breaker: admit() claims the right to send (false = fail fast)
+    bool admit() const;
+    void recordSuccess() const;
+    void recordFailure() const;
+
     std::string baseUrl_;
+    std::string host_;
+    int port_ = 80;
+    std::string path_;
+    std::string urlError_;
+    Options options_;
+    std::unique_ptr<EmbeddedModel> embedded_;
+
+    mutable std::mutex poolMutex_;
+    mutable std::vector<std::unique_ptr<httplib::Client>> idle_;
+
+    mutable std::mutex breakerMutex_;
+    mutable int consecutiveFailures_ = 0;
+    mutable bool open_ = false;
+    mutable bool probeInFlight_ = false;
+    mutable Clock::time_point openUntil_{};
 };
@@ -1,15 +1,31 @@
 #pragma once
 
+#include <vector>
+
 #include "AudioEngine.hpp"
 #include "ImageFeatures.hpp"
 #include "ModelClient.hpp"
+#include "PredictionBatcher.hpp"
 
 // Heuristic mapping (Phase 1 logic) - fallback when model unavailable
 MusicParameters mapFeaturesToMusicHeuristic(const ImageFeatures& features);
 
-// Model-based mapping - calls TF Serving, falls back to heuristic on error
+// Model-based mapping - calls TF Serving, falls back to heuristic on error.
+// If usedModel is given it is set to false when the fallback was taken.
+MusicParameters mapFeaturesToMusicModel(const ImageFeatures& features,
+                                        const ModelClient& client,
+                                        bool* usedModel = nullptr);
+
+// Same, with the request queued into a micro-batch shared with other callers
 MusicParameters mapFeaturesToMusicModel(const ImageFeatures& features,
-                                        const ModelClient& client);
+                                        PredictionBatcher& batcher,
+                                        bool* usedModel = nullptr);
+
+// Many images in one predictBatch() request. If it fails, every row falls
+// back to the heuristic and usedModel (if given) is set to false.
+std::vector<MusicParameters> mapFeaturesToMusicModelBatch(
+    const std::vector<ImageFeatures>& features, const ModelClient& client,
+    bool* usedModel = nullptr);
 
 // Phase 7: Derive rich style parameters from image features and music
 // parameters
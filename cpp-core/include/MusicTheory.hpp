@@ -0,0 +1,253 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "SongSpec.hpp"  // Genre
+
+/**
+ * Compile-time music theory shared by the ambient synth, the composer and
+ * the pattern generators: scale intervals, chord tones, chord progressions
+ * and equal-tempered pitch. Everything is a constexpr table or a constexpr
+ * function over one, so hot paths index arrays instead of building vectors
+ * or calling pow/log2.
+ *
+ * Scale types are the model's indices: 0 = Major, 1 = Minor, 2 = Dorian,
+ * 3 = Lydian.
+ */
+
+constexpr int SCALE_TYPES = 4;
+constexpr int SCALE_DEGREES = 7;
+
+using ScaleIntervals = std::array<int, SCALE_DEGREES>;
+
+// Semitones of each degree above the root
+inline constexpr std::array<ScaleIntervals, SCALE_TYPES> kScaleIntervals = {{
+    {0, 2, 4, 5, 7, 9, 11},  // Major - bright, happy
+    {0, 2, 3, 5, 7, 8, 10},  // Minor - dark, sad
+    {0, 2, 3, 5, 7, 9, 10},  // Dorian - jazzy, modal
+    {0, 2, 4, 6, 7, 9, 11},  // Lydian - dreamy, ethereal
+}};
+
+/**
+ * Intervals for a scale type; out-of-range types get fallbackType
+ */
+constexpr const ScaleIntervals& scaleIntervals(int scaleType, int fallbackType = 0) {
+    return (scaleType >= 0 && scaleType < SCALE_TYPES) ? kScaleIntervals[scaleType]
+                                                       : kScaleIntervals[fallbackType];
+}
+
+template <int ScaleType>
+constexpr const ScaleIntervals& scaleIntervals() {
+    static_assert(ScaleType >= 0 && ScaleType < SCALE_TYPES, "unknown scale type");
+    return kScaleIntervals[ScaleType];
+}
+
+/**
+ * Semitones of a scale degree (>= 0) above the root, folded into one
+ * octave: degree 7 is the root again. This is how the composer voices
+ * chords and lines.
+ */
+constexpr int degreeSemitones(const ScaleIntervals& scale, int degree) {
+    return scale[degree % SCALE_DEGREES];
+}
+
+/**
+ * As degreeSemitones(), but continuing upwards: degree 7 is the octave.
+ */
+constexpr int degreeSemitonesAbove(const ScaleIntervals& scale, int degree) {
+    return scale[degree % SCALE_DEGREES] + 12 * (degree / SCALE_DEGREES);
+}
+
+// ---------------------------------------------------------------------------
+// Chords
+// ---------------------------------------------------------------------------
+
+// Chord tones as scale-degree offsets from the chord's root degree
+constexpr int CHORD_ROOT = 0;
+constexpr int CHORD_THIRD = 2;
+constexpr int CHORD_FIFTH = 4;
+constexpr int CHORD_SEVENTH = 6;
+constexpr int CHORD_NINTH = 1;     // voiced an octave up
+constexpr int CHORD_ELEVENTH = 3;  // voiced an octave up
+
+/**
+ * MIDI note of one chord tone: rootNote plus the scale degree chordDegree +
+ * tone, folded into the octave above rootNote
+ */
+constexpr int chordTone(const ScaleIntervals& scale, int rootNote, int chordDegree, int tone) {
+    return rootNote + degreeSemitones(scale, chordDegree + tone);
+}
+
+/**
+ * Up to six chord notes in a fixed-size array, so building a voicing per
+ * bar doesn't allocate
+ */
+struct ChordNotes {
+    std::array<int, 6> notes{};
+    size_t count = 0;
+
+    constexpr void add(int note) { notes[count++] = note; }
+    constexpr const int* begin() const { return notes.data(); }
+    constexpr const int* end() const { return notes.data() + count; }
+    constexpr size_t size() const { return count; }
+};
+
+/**
+ * Triad on chordDegree, plus the seventh if withSeventh
+ */
+constexpr ChordNotes triadNotes(const ScaleIntervals& scale, int rootNote, int chordDegree,
+                                bool withSeventh) {
+    ChordNotes chord;
+    chord.add(chordTone(scale, rootNote, chordDegree, CHORD_ROOT));
+    chord.add(chordTone(scale, rootNote, chordDegree, CHORD_THIRD));
+    chord.add(chordTone(scale, rootNote, chordDegree, CHORD_FIFTH));
+    if (withSeventh) {
+        chord.add(chordTone(scale, rootNote, chordDegree, CHORD_SEVENTH));
+    }
+    return chord;
+}
+
+// ---------------------------------------------------------------------------
+// Progressions
+// ---------------------------------------------------------------------------
+
+struct ChordProgression {
+    std::array<int, 4> degrees;  // Scale degrees (0-6), one per bar
+    const char* name;
+};
+
+struct ProgressionSet {
+    std::array<ChordProgression, 3> options;
+    size_t count;
+
+    constexpr const ChordProgression& operator[](size_t i) const { return options[i]; }
+    constexpr size_t size() const { return count; }
+};
+
+constexpr int GENRES = static_cast<int>(Genre::RNB) + 1;
+
+// Major/Lydian and Minor/Dorian progressions per genre
+inline constexpr ProgressionSet kEdmMajorProgressions = {{{
+    {{0, 5, 3, 4}, "I-vi-IV-V"}, {{0, 4, 0, 5}, "I-V-I-vi"}, {{0, 3, 4, 4}, "I-IV-V-V"}}}, 3};
+inline constexpr ProgressionSet kEdmMinorProgressions = {{{
+    {{0, 3, 5, 5}, "i-iv-VI-VI"}, {{0, 4, 3, 5}, "i-v-iv-VI"}, {{0, 5, 3, 3}, "i-VI-iv-iv"}}}, 3};
+
+// House: uplifting, repetitive
+inline constexpr ProgressionSet kHouseMajorProgressions = {{{
+    {{0, 5, 3, 4}, "I-vi-IV-V"}, {{3, 4, 0, 5}, "IV-V-I-vi"}, {{0, 4, 5, 3}, "I-V-vi-IV"}}}, 3};
+inline constexpr ProgressionSet kHouseMinorProgressions = {{{
+    {{0, 6, 3, 4}, "i-VII-iv-v"}, {{0, 3, 5, 5}, "i-iv-VI-VI"}}}, 2};
+
+// Rap/Trap: simple 2-4 chord loops
+inline constexpr ProgressionSet kRapMajorProgressions = {{{
+    {{0, 4, 3, 4}, "I-V-IV-V"}, {{0, 5, 3, 3}, "I-vi-IV-IV"}}}, 2};
+inline constexpr ProgressionSet kRapMinorProgressions = {{{
+    {{0, 5, 2, 6}, "i-VI-III-VII"}, {{0, 6, 5, 6}, "i-VII-VI-VII"}, {{0, 3, 5, 5}, "i-iv-VI-VI"}}}, 3};
+
+// R&B: extended chords, jazzy progressions
+inline constexpr ProgressionSet kRnbMajorProgressions = {{{
+    {{1, 4, 0, 0}, "ii7-V7-Imaj7-Imaj7"}, {{3, 2, 1, 4}, "IVmaj7-iii7-ii7-V7"},
+    {{0, 4, 5, 3}, "I-V-vi-IV"}}}, 3};
+inline constexpr ProgressionSet kRnbMinorProgressions = {{{
+    {{0, 3, 6, 5}, "i7-iv7-VII-VI"}, {{0, 5, 3, 4}, "i-VI-iv-v7"}}}, 2};
+
+// [genre][0 = major-like, 1 = minor-like]
+inline constexpr std::array<std::array<ProgressionSet, 2>, GENRES> kProgressions = {{
+    {{kEdmMajorProgressions, kEdmMinorProgressions}},      // EDM_CHILL
+    {{kEdmMajorProgressions, kEdmMinorProgressions}},      // EDM_DROP
+    {{kHouseMajorProgressions, kHouseMinorProgressions}},  // HOUSE
+    {{kRapMajorProgressions, kRapMinorProgressions}},      // RAP
+    {{kRnbMajorProgressions, kRnbMinorProgressions}},      // RNB
+}};
+
+/**
+ * Whether a genre plays its minor-like progressions over a scale type.
+ * Rap treats only Minor and Dorian as minor; the other genres treat every
+ * scale but Major and Lydian (including unknown ones) as minor.
+ */
+constexpr bool usesMinorProgressions(Genre genre, int scaleType) {
+    if (genre == Genre::RAP) return scaleType == 1 || scaleType == 2;
+    return !(scaleType == 0 || scaleType == 3);
+}
+
+constexpr const ProgressionSet& progressionSet(Genre genre, int scaleType) {
+    int g = static_cast<int>(genre);
+    if (g < 0 || g >= GENRES) g = static_cast<int>(Genre::EDM_DROP);
+    return kProgressions[g][usesMinorProgressions(static_cast<Genre>(g), scaleType) ? 1 : 0];
+}
+
+template <Genre G, int ScaleType>
+constexpr const ProgressionSet& progressionSet() {
+    static_assert(static_cast<int>(G) >= 0 && static_cast<int>(G) < GENRES, "unknown genre");
+    return kProgressions[static_cast<int>(G)][usesMinorProgressions(G, ScaleType) ? 1 : 0];
+}
+
+// ---------------------------------------------------------------------------
+// Pitch (12-TET, A4 = MIDI 69 = 440 Hz)
+// ---------------------------------------------------------------------------
+
+// 2^(k/12) for k = 0..11
+inline constexpr std::array<double, 12> kSemitoneRatios = {
+    1.0, 1.0594630943592953, 1.122462048309373, 1.189207115002721,
+    1.2599210498948732, 1.3348398541700344, 1.4142135623730951, 1.4983070768766815,
+    1.5874010519681994, 1.681792830507429, 1.7817974362806785, 1.8877486253633868
+};
+
+/**
+ * Frequency ratio of an interval, 2^(semitones/12): one table entry
+ * scaled by exact powers of two
+ */
+constexpr double semitoneRatio(int semitones) {
+    int octave = semitones >= 0 ? semitones / 12 : -((11 - semitones) / 12);
+    double ratio = kSemitoneRatios[semitones - 12 * octave];
+    for (; octave > 0; --octave) ratio *= 2.0;
+    for (; octave < 0; ++octave) ratio *= 0.5;
+    return ratio;
+}
+
+inline constexpr std::array<double, 128> kMidiNoteFrequencies = [] {
+    std::array<double, 128> table{};
+    for (int note = 0; note < 128; ++note) {
+        table[note] = 440.0 * semitoneRatio(note - 69);
+    }
+    return table;
+}();
+
+constexpr double midiNoteFrequency(int note) {
+    return kMidiNoteFrequencies[note < 0 ? 0 : (note > 127 ? 127 : note)];
+}
+
+// Lowest frequency that rounds to each note: a quarter tone below it
+inline constexpr std::array<double, 128> kMidiNoteLowerBounds = [] {
+    constexpr double quarterTone = 1.029302236643492;  // 2^(1/24)
+    std::array<double, 128> table{};
+    for (int note = 1; note < 128; ++note) {
+        table[note] = kMidiNoteFrequencies[note] / quarterTone;
+    }
+    return table;
+}();
+
+/**
+ * Nearest MIDI note to a frequency, clamped to 0..127: the table form of
+ * round(69 + 12 * log2(freq / 440))
+ */
+constexpr int nearestMidiNote(double freq) {
+    int lo = 0;
+    int hi = 127;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (freq >= kMidiNoteLowerBounds[mid]) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+static_assert(scaleIntervals<1>()[2] == 3, "minor third");
+static_assert(degreeSemitonesAbove(scaleIntervals<0>(), 7) == 12, "octave");
+static_assert(progressionSet<Genre::RAP, 1>()[0].degrees[1] == 5, "i-VI-III-VII");
+static_assert(midiNoteFrequency(69) == 440.0 && midiNoteFrequency(81) == 880.0, "A4, A5");
+static_assert(nearestMidiNote(440.0) == 69 && nearestMidiNote(261.63) == 60, "A4, C4");
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -44,6 +46,66 @@ void thinNotes(MidiPattern& pattern, float keepRatio);
  */
 void humanize(MidiPattern& pattern, int timingVariance, int velocityVariance);
 
+/**
+ * Structure-of-arrays form of MidiPattern: one contiguous column per
+ * MidiNote field, so whole-song transforms are straight loops over ints
+ * (SIMD kernels where available). All columns have size() elements.
+ */
+struct MidiPatternColumns {
+    std::vector<int> note;
+    std::vector<int> velocity;
+    std::vector<int> startTick;
+    std::vector<int> duration;
+    std::vector<int> channel;
+    int lengthInTicks = 0;
+    int lengthInBars = 0;
+
+    size_t size() const { return note.size(); }
+    void reserve(size_t count);
+    void resize(size_t count);
+};
+
+MidiPatternColumns toColumns(const MidiPattern& pattern);
+MidiPattern fromColumns(const MidiPatternColumns& columns);
+
+/**
+ * Column versions of the transforms above. thinNotes and humanize take a
+ * seed instead of std::random_device: the random draw for a note depends
+ * only on (seed, note index), so results are reproducible.
+ */
+void transposePattern(MidiPatternColumns& pattern, int semitones);
+void scaleVelocity(MidiPatternColumns& pattern, float factor);
+void thinNotes(MidiPatternColumns& pattern, float keepRatio, uint32_t seed);
+void humanize(MidiPatternColumns& pattern, int timingVariance, int velocityVariance,
+              uint32_t seed);
+
+/**
+ * Several transforms applied in one pass over the pattern. The result
+ * equals calling thinNotes, transposePattern, scaleVelocity and humanize
+ * (those the chain enables) in that order with the same seed. Repeated
+ * transpose/scaleVelocity calls combine into one step, clamped once.
+ */
+struct PatternTransformChain {
+    float keepRatio = 1.0f;
+    int semitones = 0;
+    float velocityFactor = 1.0f;
+    int timingVariance = 0;
+    int velocityVariance = 0;
+    uint32_t seed = 1;
+
+    PatternTransformChain& thin(float ratio) { keepRatio = ratio; return *this; }
+    PatternTransformChain& transpose(int s) { semitones += s; return *this; }
+    PatternTransformChain& scaleVelocity(float f) { velocityFactor *= f; return *this; }
+    PatternTransformChain& humanize(int timing, int velocity) {
+        timingVariance = timing;
+        velocityVariance = velocity;
+        return *this;
+    }
+    PatternTransformChain& withSeed(uint32_t s) { seed = s; return *this; }
+};
+
+void applyTransforms(MidiPatternColumns& pattern, const PatternTransformChain& chain);
+
 /**
  * Generate automation curve for filter cutoff sweep (build → drop)
  * Returns array of cutoff values (0-127) for each bar
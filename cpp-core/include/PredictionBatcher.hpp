@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ImageFeatures.hpp"
+#include "ModelClient.hpp"
+
+/**
+ * Micro-batching front end for ModelClient.
+ *
+ * Concurrent callers enqueue their features and get a future. Dispatcher
+ * threads flush the queue as one predictBatch() call once maxBatchSize
+ * rows are waiting or the oldest row has waited maxWait, and then hand each
+ * caller its own row. A failed batch fails every future in it. With an
+ * embedded model a row is evaluated at once on the caller's thread.
+ */
+class PredictionBatcher {
+public:
+    struct Options {
+        size_t maxBatchSize = 8;
+        std::chrono::microseconds maxWait{2000};
+        size_t dispatchers = 2;  // batches that can be in flight at once
+    };
+
+    // Options from SC_TF_BATCH_SIZE, SC_TF_BATCH_WAIT_US and SC_TF_BATCH_DISPATCHERS
+    static Options optionsFromEnv();
+
+    // client must outlive the batcher
+    PredictionBatcher(const ModelClient& client, const Options& options = optionsFromEnv());
+    ~PredictionBatcher();
+
+    PredictionBatcher(const PredictionBatcher&) = delete;
+    PredictionBatcher& operator=(const PredictionBatcher&) = delete;
+
+    std::future<MusicParameters> submit(const ImageFeatures& features);
+
+    // submit() and wait; throws what the batch threw
+    MusicParameters predict(const ImageFeatures& features);
+
+    const ModelClient& client() const { return client_; }
+
+private:
+    struct Pending {
+        ImageFeatures features;
+        std::promise<MusicParameters> result;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    void dispatchLoop();
+
+    const ModelClient& client_;
+    Options options_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Pending> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> dispatchers_;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/**
+ * Multi-process serve mode (soundcanvas_core --serve --workers=N).
+ *
+ * A supervisor process forks N workers. Each runs the whole HTTP server
+ * on the same port with SO_REUSEPORT, so the kernel spreads incoming
+ * connections across them. Workers share nothing in memory: a crash
+ * takes down one worker, and the supervisor restarts it (with a growing
+ * delay while a worker keeps dying right after start). SIGTERM or SIGINT
+ * to the supervisor stops every worker.
+ *
+ * Each worker gets a share of the CPUs:
+ *   - SC_WORKER_THREADS and SC_JOB_WORKERS default to CPUs / N;
+ *   - with pinning, worker i is bound to the i-th allowed CPU (modulo
+ *     the count), so its memory also stays on that CPU's NUMA node.
+ * Workers see SC_SERVE_WORKER=<index>.
+ *
+ * Workers share cached analyses and compositions only through the disk
+ * tiers (SC_CACHE_DIR, SC_COMPOSITION_CACHE_DIR). With
+ * SC_PREFORK_SHARED_CACHE=1, tiers left unset go to a private directory
+ * under /dev/shm, which is removed when the supervisor exits. That is
+ * tmpfs, i.e. RAM charged to the process or container, and the disk tiers
+ * have no size bound or eviction, so it grows with every distinct image
+ * and plan. Only enable it where the working set is known to be small.
+ *
+ * Jobs live in the worker that accepted them. Poll GET /jobs/{id} on the
+ * same keep-alive connection, or use synchronous /generate.
+ */
+struct PreforkOptions {
+    size_t workers = 0;         // 0 = one per allowed CPU
+    bool pinCpus = false;       // bind each worker to one CPU
+    bool sharedCache = false;   // default the disk caches to /dev/shm (unbounded)
+    std::chrono::milliseconds restartDelay{500};  // first delay for a crash-looping worker
+};
+
+// SC_SERVE_WORKERS, SC_PIN_WORKERS and SC_PREFORK_SHARED_CACHE
+PreforkOptions preforkOptionsFromEnv();
+
+// CPUs this process may run on
+size_t allowedCpuCount();
+
+/**
+ * Fork the workers, each calling serveWorker(index) and exiting with its
+ * result, then supervise them until SIGTERM or SIGINT. Returns the
+ * supervisor's exit code. Must be called before any threads are started,
+ * since fork() copies only the calling thread.
+ */
+int runPreforkServer(const PreforkOptions& options,
+                     const std::function<int(size_t worker)>& serveWorker);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+/**
+ * Monotonic arena for everything one generation request builds: the song
+ * plan and spec, the composer's per-track event lists and the MidiWriter's
+ * tracks and encoded file. Allocation bumps a pointer into buffers that
+ * grow geometrically; deallocate() is a no-op, and the whole request is
+ * released in one step when the arena goes out of scope.
+ *
+ * Thread-safe with one mutex per arena, so the tracks of one song composed
+ * in parallel can share it while separate requests never contend on it
+ * (or on the global heap for these structures).
+ *
+ * Anything allocated from the arena must not outlive it: copy results
+ * that are kept (e.g. MidiWriter::toBytes()) out into default-allocated
+ * containers.
+ */
+class RequestArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t DEFAULT_INITIAL_BYTES = 64 * 1024;
+
+    explicit RequestArena(size_t initialBytes = DEFAULT_INITIAL_BYTES);
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    // Bytes handed out so far (excluding alignment padding)
+    size_t bytesAllocated() const;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    mutable std::mutex mutex_;
+    std::pmr::monotonic_buffer_resource buffer_;
+    size_t allocated_ = 0;
+};
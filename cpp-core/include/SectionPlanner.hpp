@@ -5,6 +5,10 @@
 #include "ImageFeatures.hpp"
 #include "AudioEngine.hpp"
 
+#include <memory_resource>
+#include <string>
+#include <vector>
+
 /**
  * Phase 8: Section Planning Engine
  * Generates song structure (intro/build/drop/break/outro) based on genre templates
@@ -24,24 +28,32 @@ struct PlannedSection {
 };
 
 struct SongPlan {
+    explicit SongPlan(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : sections(resource), activeInstruments(resource) {}
+
     GenreType genre;
     int totalBars;
     int tempoBpm;
     int scaleType;
     int rootNote;
     
-    std::vector<PlannedSection> sections;
-    std::vector<std::string> activeInstruments;  // List of instrument roles to render
+    // Allocated from the resource the plan was built with (see planSong)
+    std::pmr::vector<PlannedSection> sections;
+    std::pmr::vector<std::pmr::string> activeInstruments;  // List of instrument roles to render
 };
 
 /**
- * Generate a complete song plan from image features and genre template
+ * Generate a complete song plan from image features and genre template.
+ * The plan's containers are allocated from resource, which must outlive it.
  */
 SongPlan planSong(const ImageFeatures& features, 
                   const MusicParameters& params,
-                  const GenreTemplate& genreTemplate);
+                  const GenreTemplate& genreTemplate,
+                  std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 /**
- * Convert SongPlan to SongSpec (for backward compatibility with existing renderer)
+ * Convert SongPlan to SongSpec (for backward compatibility with existing renderer),
+ * allocating the spec from resource
  */
-SongSpec songPlanToSpec(const SongPlan& plan);
+SongSpec songPlanToSpec(const SongPlan& plan,
+                        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
@@ -0,0 +1,25 @@
+#pragma once
+
+// Runtime selection of the vector instruction set used by the DSP and
+// image kernels. Every kernel keeps a scalar fallback that produces the
+// same output as its vector paths.
+
+enum class SimdLevel {
+    SCALAR = 0,
+    SSE2 = 1,    // x86-64 baseline (2 x double, 4 x float)
+    AVX2 = 2,    // 4 x double, 8 x float
+    NEON = 3     // aarch64 baseline (2 x double, 4 x float)
+};
+
+// Best level supported by this CPU and build.
+SimdLevel detectSimdLevel();
+
+// Level the kernels dispatch to. Defaults to detectSimdLevel(), can be
+// lowered with SC_SIMD=scalar|sse2|avx2|neon (never raised above what the
+// CPU supports).
+SimdLevel activeSimdLevel();
+
+// Force a level (clamped to detectSimdLevel()); used by tests and benchmarks.
+void setSimdLevel(SimdLevel level);
+
+const char* simdLevelName(SimdLevel level);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * Coalesces concurrent calls for the same key: the first caller (the
+ * leader) runs the work, callers arriving while it is in flight wait for
+ * it and receive the same result, or the same exception. Nothing is kept
+ * once the leader finishes, so this covers the window before a result
+ * cache has the entry rather than replacing one. T must be copyable.
+ * Thread-safe.
+ */
+template <typename T>
+class SingleFlight {
+public:
+    /**
+     * fn() for key, or the result of the identical call already in
+     * flight. joined (if non-null) is set to true when the result was
+     * another caller's.
+     */
+    template <typename Fn>
+    T run(const std::string& key, Fn&& fn, bool* joined = nullptr) {
+        std::promise<T> promise;
+        std::shared_future<T> result;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = calls_.find(key);
+            if (it != calls_.end()) {
+                result = it->second;
+            } else {
+                result = promise.get_future().share();
+                calls_.emplace(key, result);
+                leader = true;
+            }
+        }
+        if (joined) *joined = !leader;
+        if (!leader) return result.get();
+
+        // Retire the key first so later arrivals start a fresh call
+        // instead of taking a finished one
+        try {
+            T value = fn();
+            retire(key);
+            promise.set_value(std::move(value));
+        } catch (...) {
+            retire(key);
+            promise.set_exception(std::current_exception());
+        }
+        return result.get();
+    }
+
+    // Keys currently in flight
+    size_t inFlight() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return calls_.size();
+    }
+
+private:
+    void retire(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        calls_.erase(key);
+    }
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_future<T>> calls_;
+};
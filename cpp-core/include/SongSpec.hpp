@@ -1,5 +1,10 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory_resource>
 #include <vector>
 #include <string>
 #include "ImageFeatures.hpp"
@@ -40,15 +45,35 @@ enum class Genre {
     RNB = 4          // R&B/neo-soul
 };
 
-// Phase 9: Genre-specific musical characteristics
+// Up to four scale type indices, held inline so a profile never allocates
+struct ScaleTypeList {
+    int types[4] = {};
+    size_t count = 0;
+
+    ScaleTypeList() = default;
+    ScaleTypeList(std::initializer_list<int> list) {
+        for (int type : list) {
+            if (count < 4) types[count++] = type;
+        }
+    }
+
+    const int* begin() const { return types; }
+    const int* end() const { return types + count; }
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    int operator[](size_t i) const { return types[i]; }
+};
+
+// Phase 9: Genre-specific musical characteristics. Only string literals
+// and inline arrays, so copying a profile into a spec is allocation-free.
 struct GenreProfile {
     Genre genre;
-    std::string name;
+    const char* name;
     
     // Musical ranges
     float minTempo;
     float maxTempo;
-    std::vector<int> preferredScaleTypes;  // Indices: 0=Major, 1=Minor, 2=Dorian, 3=Lydian
+    ScaleTypeList preferredScaleTypes;  // Indices: 0=Major, 1=Minor, 2=Dorian, 3=Lydian
     
     // Groove & feel
     bool useSwing;           // Apply swing to off-beat notes
@@ -56,10 +81,10 @@ struct GenreProfile {
     bool heavySidechain;     // Strong pumping effect
     
     // Pattern selection hints
-    std::vector<std::string> drumPatternSets;
-    std::vector<std::string> chordProgressionSets;
-    std::vector<std::string> bassPatternSets;
-    std::vector<std::string> leadPatternSets;
+    std::array<const char*, 2> drumPatternSets;
+    std::array<const char*, 2> chordProgressionSets;
+    std::array<const char*, 2> bassPatternSets;
+    std::array<const char*, 2> leadPatternSets;
     
     // Arrangement tendencies
     int minBars;
@@ -102,6 +127,9 @@ struct SectionSpec {
 };
 
 struct SongSpec {
+    explicit SongSpec(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : sections(resource), tracks(resource) {}
+
     // Global song parameters
     float tempoBpm;           // 40-140 BPM
     int scaleType;            // 0=Major, 1=Minor, 2=Dorian, 3=Lydian
@@ -117,15 +145,23 @@ struct SongSpec {
     GenreProfile genreProfile;  // Genre characteristics and preferences
     
     // Song structure
-    std::vector<SectionSpec> sections;  // Intro, A, B, Outro, etc.
-    std::vector<TrackSpec> tracks;      // All instrument tracks
+    // Allocated from the resource the spec was built with (see makeSongSpec)
+    std::pmr::vector<SectionSpec> sections;  // Intro, A, B, Outro, etc.
+    std::pmr::vector<TrackSpec> tracks;      // All instrument tracks
+
+    // Humanization seed; each track's generator is split from it, so the
+    // same spec and seed always compose the same MIDI
+    uint32_t seed = 42;
 };
 
 /**
  * Convert image features + music parameters into a structured song spec.
  * This is the "music director" that decides arrangement, instrumentation, structure.
+ * The spec's sections and tracks are allocated from resource (e.g. a
+ * per-request RequestArena), which must outlive the spec.
  */
-SongSpec makeSongSpec(const ImageFeatures& features, const MusicParameters& params);
+SongSpec makeSongSpec(const ImageFeatures& features, const MusicParameters& params,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 /**
  * Utility: Convert frequency (Hz) to nearest MIDI note number
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MidiWriter.hpp"
+
+/**
+ * In-process General MIDI renderer on libfluidsynth.
+ *
+ * The SoundFont is loaded once per process; a small pool of synth
+ * instances (one per concurrent render, created on demand) shares its
+ * sample data through FluidSynth's sample cache. render() plays a
+ * MidiWriter's events straight into a float buffer, so no temporary MIDI
+ * file and no fluidsynth process are involved. Thread-safe.
+ *
+ * Only functional when built with libfluidsynth (SC_HAVE_FLUIDSYNTH, set
+ * by CMake when it is found); otherwise available() is false and the
+ * constructor throws.
+ */
+class SoundFontRenderer {
+public:
+    struct Options {
+        std::string soundFontPath = "/usr/share/sounds/sf2/FluidR3_GM.sf2";
+        int sampleRate = 44100;
+        float gain = 0.8f;               // same as `fluidsynth -g 0.8`
+        size_t synths = std::max(1u, std::thread::hardware_concurrency());
+        double tailSeconds = 2.0;        // rendered after the last event (release, reverb)
+    };
+
+    // Options from SC_SOUNDFONT, SC_RENDER_SAMPLE_RATE, SC_RENDER_GAIN and
+    // SC_RENDER_SYNTHS
+    static Options optionsFromEnv();
+
+    // Compiled with libfluidsynth
+    static bool available();
+
+    /**
+     * Loads the SoundFont into the first synth. Throws std::runtime_error
+     * if it can't be loaded or FluidSynth support is missing.
+     */
+    explicit SoundFontRenderer(const Options& options = optionsFromEnv());
+    ~SoundFontRenderer();
+
+    SoundFontRenderer(const SoundFontRenderer&) = delete;
+    SoundFontRenderer& operator=(const SoundFontRenderer&) = delete;
+
+    /**
+     * Render the song to interleaved stereo floats at options().sampleRate.
+     * Blocks while every synth is busy.
+     */
+    std::vector<float> render(const MidiWriter& midi);
+
+    /**
+     * Render every track on its own synth, concurrently, each as long as
+     * render() would be, so the buffers line up for MixEngine. Index i is
+     * track i.
+     */
+    std::vector<std::vector<float>> renderTracks(const MidiWriter& midi);
+
+    /**
+     * render() written as a 16-bit stereo WAV file
+     */
+    void renderToWav(const MidiWriter& midi, const std::string& wavPath);
+
+    const Options& options() const { return options_; }
+
+private:
+    struct Synth;
+
+    std::unique_ptr<Synth> createSynth();
+    std::unique_ptr<Synth> acquire();
+    void release(std::unique_ptr<Synth> synth);
+
+    // Play events on one pooled synth into a buffer of totalFrames frames
+    std::vector<float> renderEvents(const std::vector<MidiWriter::ChannelMessage>& events,
+                                    double framesPerTick, size_t totalFrames);
+
+    Options options_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::unique_ptr<Synth>> idle_;
+    size_t created_ = 0;
+};
+
+/**
+ * Process-wide renderer, created (and the SoundFont loaded) on first use.
+ */
+SoundFontRenderer& sharedSoundFontRenderer();
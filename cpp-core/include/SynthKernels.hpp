@@ -0,0 +1,28 @@
+#pragma once
+
+// Vectorized block kernels for the ambient synth (AudioEngine.cpp).
+// Each kernel dispatches on activeSimdLevel(); the SSE2, AVX2, NEON and
+// scalar paths perform the same operations in the same order, so every
+// path renders bit-identical samples.
+
+// Sine approximation used by the synth oscillator (phase in [0, 2pi]).
+double synthSine(double phase);
+
+// Closed-form triangle wave, equal to asin(sin(phase)) * 2/pi.
+double synthTriangle(double phase);
+
+// out[i] += osc(phase[i]) * gain[i] * gainScale, where osc blends sine and
+// triangle by brightness (0 = pure sine, 1 = 40% triangle).
+void accumulateOscillator(const double* phase, const double* gain, double gainScale,
+                          double brightness, double* out, int frames);
+
+// In-place one-pole low-pass: y[i] = y[i-1] * (1 - coeff) + x[i] * coeff.
+// state holds y[-1] on entry and the last output on return.
+void onePoleLowpass(double* samples, int frames, double coeff, double& state);
+
+// Feedback delay with dry/wet mix, in place:
+//   wet = x + delay[idx] * feedback;  delay[idx] = wet;  x = x * dryMix + wet * wetMix
+// frames must not exceed delayLength (the synth's delay is always longer
+// than one block), so no frame reads a value written in the same call.
+void feedbackDelayMix(double* samples, int frames, float* delayLine, int delayLength,
+                      int& delayIndex, double feedback, double dryMix, double wetMix);
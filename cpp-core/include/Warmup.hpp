@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+#include "ModelClient.hpp"
+
+/**
+ * Startup warmup for the HTTP server: everything the first requests would
+ * otherwise initialize lazily, done before the server reports ready.
+ *
+ *   init       server setup up to run() (caches, job workers, routes)
+ *   templates  genre templates and the compiled drum pattern banks
+ *   workers    the shared worker pool threads and the composition cache
+ *   model      keep-alive connections to TF Serving, or a first
+ *              evaluation of the embedded model
+ *   synthetic  optional: one generation end to end on a generated image
+ *
+ * Each stage's time is logged and kept for GET /ready. A failing stage is
+ * logged and reported, never fatal: an unreachable TF Serving still leaves
+ * the server ready, since "model" requests fall back to the heuristic.
+ * Thread-safe; status() may be called while run() is in progress.
+ */
+class Warmup {
+public:
+    struct Options {
+        bool enabled = true;           // false: ready as soon as run() is called
+        bool synthetic = false;        // run the synthetic generation stage
+        size_t modelConnections = 2;   // TF Serving connections to open (0 = skip)
+    };
+
+    // Options from SC_WARMUP, SC_WARMUP_SYNTHETIC and
+    // SC_WARMUP_MODEL_CONNECTIONS
+    static Options optionsFromEnv();
+
+    // The "init" stage is timed from construction
+    explicit Warmup(const Options& options = optionsFromEnv());
+
+    Warmup(const Warmup&) = delete;
+    Warmup& operator=(const Warmup&) = delete;
+
+    /**
+     * Run the stages in order, then mark the server ready. model may be
+     * null (no model stage). Never throws.
+     */
+    void run(const ModelClient* model);
+
+    bool ready() const { return ready_.load(std::memory_order_acquire); }
+
+    // Construction to ready; 0 until ready
+    double startupSeconds() const;
+
+    /**
+     * {"ready", "stage" (while warming), "startup_ms" (once ready),
+     *  "stages": [{"name", "ms", "ok", "detail"?}, ...]}
+     */
+    nlohmann::json status() const;
+
+    const Options& options() const { return options_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct StageResult {
+        std::string name;
+        double ms;
+        bool ok;
+        std::string detail;
+    };
+
+    // Time fn as a stage; it returns a detail for the log (or throws)
+    void stage(const char* name, const std::function<std::string()>& fn);
+    void record(StageResult result);
+
+    Options options_;
+    Clock::time_point start_;
+    std::atomic<bool> ready_{false};
+
+    mutable std::mutex mutex_;
+    std::vector<StageResult> stages_;
+    std::string current_;
+    double startupSeconds_ = 0.0;
+};
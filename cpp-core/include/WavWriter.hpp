@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Buffered 16-bit PCM WAV writer.
+ *
+ * Float blocks are converted to int16 straight into one large buffer that is
+ * flushed in big chunks: to a file via writev (the 44-byte header goes out in
+ * the same call as the first PCM chunk), or to a ChunkSink such as an httplib
+ * chunked response, so audio can be served without a temp file.
+ */
+class WavWriter {
+ public:
+  // Receives finished byte chunks in order (header first).
+  // Returning false aborts the stream (e.g. the HTTP client went away).
+  using ChunkSink = std::function<bool(const char* data, std::size_t size)>;
+
+  static constexpr std::size_t HEADER_BYTES = 44;
+  static constexpr std::size_t DEFAULT_BUFFER_BYTES = 64 * 1024;
+
+  /**
+   * Write to a file. Throws std::runtime_error if it cannot be created.
+   * @param totalFrames Frames that will be written (used for the header; a
+   *                    file header is corrected on finish() if it differs)
+   */
+  WavWriter(const std::string& path, int sampleRate, int numChannels,
+            std::uint32_t totalFrames,
+            std::size_t bufferBytes = DEFAULT_BUFFER_BYTES);
+
+  /**
+   * Stream to a sink. totalFrames must match what is written, since a
+   * streamed header cannot be patched afterwards.
+   */
+  WavWriter(ChunkSink sink, int sampleRate, int numChannels,
+            std::uint32_t totalFrames,
+            std::size_t bufferBytes = DEFAULT_BUFFER_BYTES);
+
+  ~WavWriter();
+
+  WavWriter(const WavWriter&) = delete;
+  WavWriter& operator=(const WavWriter&) = delete;
+
+  /**
+   * Enable TPDF dither (+/-1 LSB triangular noise, rounded to nearest).
+   * Off by default: samples are clamped to [-1, 1] and truncated.
+   */
+  void setDither(bool enabled, std::uint32_t seed = 1);
+
+  /**
+   * Append interleaved float samples (nominal range [-1, 1])
+   */
+  void writeSamples(const float* samples, std::size_t count);
+
+  /**
+   * Flush buffered PCM and close the output. Throws std::runtime_error on
+   * I/O failure or if the sink aborted. Called by the destructor if needed
+   * (errors are swallowed there).
+   */
+  void finish();
+
+  /**
+   * Build the canonical 44-byte PCM header
+   */
+  static void buildHeader(char* out, int sampleRate, int numChannels,
+                          std::uint32_t totalFrames);
+
+ private:
+  void convert(const float* samples, std::size_t count, char* out);
+  void flush();
+  void writeAll(const char* header, std::size_t headerSize, const char* data,
+                std::size_t dataSize);
+
+  std::string path_;
+  int fd_ = -1;
+  ChunkSink sink_;
+
+  int sampleRate_;
+  int numChannels_;
+  std::uint32_t totalFrames_;
+
+  char header_[HEADER_BYTES];
+  bool headerWritten_ = false;
+  bool finished_ = false;
+
+  std::vector<char> buffer_;
+  std::size_t used_ = 0;
+  std::uint64_t samplesWritten_ = 0;
+
+  bool dither_ = false;
+  std::uint32_t ditherState_ = 1;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed-size pool of worker threads shared by the CPU-heavy stages
+ * (feature extraction tiles, etc.), so requests never pay for thread
+ * creation and the total thread count stays bounded.
+ */
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t numThreads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t threadCount() const { return workers_.size(); }
+
+    /**
+     * Queue a task. Exceptions escaping the task are swallowed.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Run body(0) .. body(count - 1) on up to maxParallelism threads and wait
+     * for all of them. The calling thread works on the range too, so this is
+     * safe to call from inside a pool task. The first exception thrown by
+     * body is rethrown here after the remaining indices have finished.
+     */
+    void parallelFor(size_t count, size_t maxParallelism,
+                     const std::function<void(size_t)>& body);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+/**
+ * Process-wide pool. Sized on first use from SC_WORKER_THREADS, defaulting
+ * to std::thread::hardware_concurrency().
+ */
+WorkerPool& sharedWorkerPool();
@@ -1,9 +1,11 @@
 #define _USE_MATH_DEFINES
 #include "AudioEngine.hpp"
+#include "MusicTheory.hpp"
 #include "MusicalStyle.hpp"
+#include "SynthKernels.hpp"
+#include "WavWriter.hpp"
 #include <cmath>
 #include <cstdint>
-#include <fstream>
 #include <stdexcept>
 #include <vector>
 #include <algorithm>
@@ -16,235 +18,227 @@ namespace {
 
 constexpr int SAMPLE_RATE = 44100;
 
-// Write little-endian helper
-void writeLE(std::ofstream& out, std::uint32_t value, int bytes) {
-    for (int i = 0; i < bytes; ++i) {
-        out.put(static_cast<char>(value & 0xFF));
-        value >>= 8;
-    }
+// Frequency of a scale degree above the root, from the interval table:
+// baseFreq * 2^(semitones / 12) without going through MIDI numbers
+static double getScaleNoteFreq(double baseFreq, const ScaleIntervals& scale, int degree) {
+    return baseFreq * semitoneRatio(degreeSemitonesAbove(scale, degree));
 }
 
-// Musical scale intervals in semitones
-static std::vector<int> getScaleSemitones(int scaleType) {
-    // Intervals from root in semitones
-    switch (scaleType) {
-        case 0: // Major - bright, happy
-            return {0, 2, 4, 5, 7, 9, 11};
-        case 1: // Minor - dark, sad
-            return {0, 2, 3, 5, 7, 8, 10};
-        case 2: // Dorian - jazzy, modal
-            return {0, 2, 3, 5, 7, 9, 10};
-        case 3: // Lydian - dreamy, ethereal
-        default:
-            return {0, 2, 4, 6, 7, 9, 11};
-    }
-}
+// --- Block renderer ---
+// The synth renders BLOCK_SIZE frames at a time. Note frequencies only change
+// at chord/arp boundaries, so every voice carries a precomputed phase
+// increment and the per-sample loops do no pitch math and no allocation.
+// The oscillator (sine blended with triangle by brightness), filter and delay
+// run as vector kernels from SynthKernels.hpp.
 
-// MIDI conversion helpers
-static double baseFreqToMidi(double freq) {
-    return 69.0 + 12.0 * std::log2(freq / 440.0);
-}
+constexpr int BLOCK_SIZE = 512;
+constexpr int MAX_VOICES = 8;
+constexpr double TWO_PI = 2.0 * M_PI;
 
-static double midiToFreq(double midi) {
-    return 440.0 * std::pow(2.0, (midi - 69.0) / 12.0);
+struct Voice {
+    double phase = 0.0;      // Oscillator phase in radians (persistent)
+    double phaseStep = 0.0;  // Radians per sample for the current note
+};
+
+static double phaseStepForDegree(double baseFreq, const ScaleIntervals& scale, int degree) {
+    return TWO_PI * getScaleNoteFreq(baseFreq, scale, degree) / SAMPLE_RATE;
 }
 
-// Get frequency for a scale degree above the root
-static double getScaleNoteFreq(double baseFreq, const std::vector<int>& scale, int degree) {
-    double baseMidi = baseFreqToMidi(baseFreq);
-    int semitones = scale[degree % scale.size()];
-    int octaves = degree / static_cast<int>(scale.size());
-    double noteMidi = baseMidi + semitones + (octaves * 12);
-    return midiToFreq(noteMidi);
+// Fills phaseOut[0..frames) with the voice's phase per frame and advances it
+static void advanceVoice(Voice& voice, double* phaseOut, int frames) {
+    for (int i = 0; i < frames; ++i) {
+        phaseOut[i] = voice.phase;
+
+        voice.phase += voice.phaseStep;
+        if (voice.phase > TWO_PI) voice.phase -= TWO_PI;
+    }
 }
 
-// Simple oscillator with multiple waveforms blended by brightness
-static double oscillator(double phase, double brightness) {
-    // brightness = 0 → pure sine (dark, mellow)
-    // brightness = 1 → mix with triangle/saw (bright, rich harmonics)
-    
-    double sine = std::sin(phase);
-    
-    // Triangle wave (approximation)
-    double triangle = std::asin(std::sin(phase)) * (2.0 / M_PI);
-    
-    // Blend based on brightness
-    return sine * (1.0 - brightness * 0.4) + triangle * (brightness * 0.4);
+// Adds one voice into out[0..frames): out[i] += osc(phase) * gain[i] / numNotes
+static void accumulateVoice(Voice& voice, double brightness, const double* gain,
+                            double numNotes, double* phaseScratch, double* out, int frames) {
+    advanceVoice(voice, phaseScratch, frames);
+    accumulateOscillator(phaseScratch, gain, 1.0 / numNotes, brightness, out, frames);
 }
 
-// Context structure for pattern synthesis
-struct SynthContext {
-    double t;                           // Current time in seconds
+// Per-track synthesis state, set up once before the first block.
+struct SynthState {
     const MusicParameters& params;
-    const std::vector<int>& scale;
     double secondsPerBeat;
-    std::vector<double>& phases;        // Oscillator phases (persistent)
+    double t = 0.0;                    // Time of the next frame in seconds
+    Voice voices[MAX_VOICES] = {};
+
+    // Pattern 0: Pad
+    int padNotes = 1;
+    double lfoFreq = 0.0;
+
+    // Pattern 1: Arpeggio
+    double arpeggioRate = 0.0;
+    int arpDegrees = 5;
+    int arpCurrentDegree = -1;
+    double arpSteps[MAX_VOICES] = {};  // Phase increment per arp degree
+
+    // Pattern 2: Chords
+    int chordNotes = 2;
+    double beatsPerChord = 4.0;
+    double chordSteps[3][4] = {};      // Phase increment per voicing/voice
+
+    // Scratch buffers reused by every block
+    double env[BLOCK_SIZE] = {};
+    double phase[BLOCK_SIZE] = {};
+    int segment[BLOCK_SIZE] = {};
 };
 
+static void initSynthState(SynthState& st, const ScaleIntervals& scale) {
+    const MusicParameters& p = st.params;
+
+    // Pad: energy controls number of notes (0 = 1 note, 1 = 3 notes),
+    // playing root, third, fifth (or subset based on energy)
+    st.padNotes = std::min(1 + static_cast<int>(p.energy * 2.0), 3);
+    st.lfoFreq = p.tempoBpm / 240.0;  // ~0.2-0.4 Hz
+    const int padDegrees[3] = {0, 2, 4};
+    for (int i = 0; i < st.padNotes; ++i) {
+        st.voices[i].phaseStep = phaseStepForDegree(p.baseFrequency, scale, padDegrees[i]);
+    }
+
+    // Arp: energy controls speed multiplier (0.5x to 2x) and range (5-8 notes)
+    st.arpeggioRate = p.tempoBpm / 60.0;
+    st.arpeggioRate *= (0.5 + p.energy * 1.5);
+    st.arpDegrees = 5 + static_cast<int>(p.energy * 3.0);
+    st.arpDegrees = std::min(st.arpDegrees, static_cast<int>(scale.size() + 2));
+    for (int d = 0; d < st.arpDegrees; ++d) {
+        st.arpSteps[d] = phaseStepForDegree(p.baseFrequency, scale, d);
+    }
+
+    // Chords: energy controls complexity (2-4 notes) and change rate (2-4 beats)
+    st.chordNotes = std::min(2 + static_cast<int>(p.energy * 2.0), 4);
+    st.beatsPerChord = std::max(4.0 - p.energy * 2.0, 1.0);
+    const int chordDegrees[3][4] = {
+        {0, 2, 4, 6},  // I chord
+        {3, 5, 0, 2},  // IV chord
+        {4, 6, 1, 3},  // V chord
+    };
+    for (int c = 0; c < 3; ++c) {
+        for (int i = 0; i < st.chordNotes; ++i) {
+            st.chordSteps[c][i] = phaseStepForDegree(p.baseFrequency, scale, chordDegrees[c][i]);
+        }
+    }
+}
+
 // Pattern 0: Pad - sustained drone with 1-3 chord tones, slow LFO
-static double synthPadSample(SynthContext& ctx) {
-    // Energy controls number of notes (0 = 1 note, 1 = 3 notes)
-    int numNotes = 1 + static_cast<int>(ctx.params.energy * 2.0);
-    numNotes = std::min(numNotes, 3);
-    
-    // Very slow LFO for gentle amplitude modulation (based on tempo)
-    double lfoFreq = ctx.params.tempoBpm / 240.0;  // ~0.2-0.4 Hz
-    double lfo = 0.8 + 0.2 * std::sin(2.0 * M_PI * lfoFreq * ctx.t);
-    
-    double sample = 0.0;
-    
-    // Play root, third, fifth (or subset based on energy)
-    std::vector<int> degrees = {0, 2, 4};  // Scale degrees for triad
-    
-    for (int i = 0; i < numNotes; ++i) {
-        double freq = getScaleNoteFreq(ctx.params.baseFrequency, ctx.scale, degrees[i]);
-        double phaseStep = 2.0 * M_PI * freq / SAMPLE_RATE;
-        
-        double noteValue = oscillator(ctx.phases[i], ctx.params.brightness);
-        sample += noteValue * lfo / static_cast<double>(numNotes);
-        
-        ctx.phases[i] += phaseStep;
-        if (ctx.phases[i] > 2.0 * M_PI) ctx.phases[i] -= 2.0 * M_PI;
+static void renderPadBlock(SynthState& st, double* out, int frames) {
+    const double dt = 1.0 / SAMPLE_RATE;
+    for (int i = 0; i < frames; ++i) {
+        // Very slow LFO for gentle amplitude modulation (based on tempo)
+        st.env[i] = 0.8 + 0.2 * std::sin(2.0 * M_PI * st.lfoFreq * st.t);
+        st.t += dt;
     }
-    
-    return sample * 0.6;  // Pad is gentle
+
+    std::fill(out, out + frames, 0.0);
+    for (int v = 0; v < st.padNotes; ++v) {
+        accumulateVoice(st.voices[v], st.params.brightness, st.env,
+                        static_cast<double>(st.padNotes), st.phase, out, frames);
+    }
+
+    for (int i = 0; i < frames; ++i) out[i] *= 0.6;  // Pad is gentle
 }
 
 // Pattern 1: Arpeggio - step through scale notes rhythmically
-static double synthArpSample(SynthContext& ctx) {
-    // Energy controls arp speed multiplier and range
-    double arpeggioRate = ctx.params.tempoBpm / 60.0;  // Base: 1 note per beat
-    arpeggioRate *= (0.5 + ctx.params.energy * 1.5);   // Energy: 0.5x to 2x speed
-    
-    // Determine which scale degree to play based on time
-    int numDegrees = 5 + static_cast<int>(ctx.params.energy * 3.0);  // 5-8 notes
-    numDegrees = std::min(numDegrees, static_cast<int>(ctx.scale.size() + 2));
-    
-    double arpPosition = ctx.t * arpeggioRate;
-    int currentDegree = static_cast<int>(arpPosition) % numDegrees;
-    
-    // Envelope for each note (attack/decay)
-    double noteFraction = std::fmod(arpPosition, 1.0);
-    double envelope = 0.0;
-    if (noteFraction < 0.1) {
-        envelope = noteFraction / 0.1;  // Attack
-    } else if (noteFraction < 0.7) {
-        envelope = 1.0;  // Sustain
-    } else {
-        envelope = (1.0 - noteFraction) / 0.3;  // Decay
+static void renderArpBlock(SynthState& st, double* out, int frames) {
+    const double dt = 1.0 / SAMPLE_RATE;
+    Voice& voice = st.voices[0];
+
+    for (int i = 0; i < frames; ++i) {
+        // Determine which scale degree to play based on time
+        double arpPosition = st.t * st.arpeggioRate;
+        int currentDegree = static_cast<int>(arpPosition) % st.arpDegrees;
+        if (currentDegree != st.arpCurrentDegree) {
+            st.arpCurrentDegree = currentDegree;
+            voice.phaseStep = st.arpSteps[currentDegree];
+        }
+
+        // Envelope for each note (attack/decay)
+        double noteFraction = std::fmod(arpPosition, 1.0);
+        double envelope = 0.0;
+        if (noteFraction < 0.1) {
+            envelope = noteFraction / 0.1;  // Attack
+        } else if (noteFraction < 0.7) {
+            envelope = 1.0;  // Sustain
+        } else {
+            envelope = (1.0 - noteFraction) / 0.3;  // Decay
+        }
+
+        st.env[i] = envelope;
+        st.phase[i] = voice.phase;
+
+        voice.phase += voice.phaseStep;
+        if (voice.phase > TWO_PI) voice.phase -= TWO_PI;
+
+        st.t += dt;
     }
-    
-    double freq = getScaleNoteFreq(ctx.params.baseFrequency, ctx.scale, currentDegree);
-    double phaseStep = 2.0 * M_PI * freq / SAMPLE_RATE;
-    
-    double sample = oscillator(ctx.phases[0], ctx.params.brightness) * envelope;
-    
-    ctx.phases[0] += phaseStep;
-    if (ctx.phases[0] > 2.0 * M_PI) ctx.phases[0] -= 2.0 * M_PI;
-    
-    return sample * 0.5;  // Arp is crisp
+
+    std::fill(out, out + frames, 0.0);
+    accumulateOscillator(st.phase, st.env, 0.5, st.params.brightness, out, frames);  // Arp is crisp
 }
 
 // Pattern 2: Chords - block chords with rhythmic changes
-static double synthChordSample(SynthContext& ctx) {
-    // Energy controls chord complexity and change rate
-    int numNotes = 2 + static_cast<int>(ctx.params.energy * 2.0);  // 2-4 notes
-    numNotes = std::min(numNotes, 4);
-    
-    // Change chord every N beats
-    double beatsPerChord = 4.0 - ctx.params.energy * 2.0;  // 2-4 beats
-    beatsPerChord = std::max(beatsPerChord, 1.0);
-    
-    double beatPosition = ctx.t / ctx.secondsPerBeat;
-    int chordIndex = static_cast<int>(beatPosition / beatsPerChord);
-    
-    // Use different chord inversions/voicings based on chordIndex
-    std::vector<int> chordDegrees;
-    switch (chordIndex % 3) {
-        case 0: chordDegrees = {0, 2, 4, 6}; break;  // I chord
-        case 1: chordDegrees = {3, 5, 0, 2}; break;  // IV chord
-        case 2: chordDegrees = {4, 6, 1, 3}; break;  // V chord
-    }
-    
-    // Rhythmic envelope (pulsing on beats)
-    double beatFraction = std::fmod(beatPosition, 1.0);
-    double rhythmEnv = 0.0;
-    if (beatFraction < 0.05) {
-        rhythmEnv = beatFraction / 0.05;  // Attack
-    } else if (beatFraction < 0.8) {
-        rhythmEnv = 1.0 - (beatFraction - 0.05) * 0.3;  // Gentle decay
-    } else {
-        rhythmEnv = 0.7 - (beatFraction - 0.8) * 2.0;  // Release
-    }
-    rhythmEnv = std::max(0.0, rhythmEnv);
-    
-    double sample = 0.0;
-    
-    for (int i = 0; i < numNotes; ++i) {
-        double freq = getScaleNoteFreq(ctx.params.baseFrequency, ctx.scale, chordDegrees[i]);
-        double phaseStep = 2.0 * M_PI * freq / SAMPLE_RATE;
-        
-        double noteValue = oscillator(ctx.phases[i], ctx.params.brightness);
-        sample += noteValue * rhythmEnv / static_cast<double>(numNotes);
-        
-        ctx.phases[i] += phaseStep;
-        if (ctx.phases[i] > 2.0 * M_PI) ctx.phases[i] -= 2.0 * M_PI;
+static void renderChordBlock(SynthState& st, double* out, int frames) {
+    const double dt = 1.0 / SAMPLE_RATE;
+    for (int i = 0; i < frames; ++i) {
+        double beatPosition = st.t / st.secondsPerBeat;
+        int chordIndex = static_cast<int>(beatPosition / st.beatsPerChord);
+        st.segment[i] = chordIndex % 3;
+
+        // Rhythmic envelope (pulsing on beats)
+        double beatFraction = std::fmod(beatPosition, 1.0);
+        double rhythmEnv = 0.0;
+        if (beatFraction < 0.05) {
+            rhythmEnv = beatFraction / 0.05;  // Attack
+        } else if (beatFraction < 0.8) {
+            rhythmEnv = 1.0 - (beatFraction - 0.05) * 0.3;  // Gentle decay
+        } else {
+            rhythmEnv = 0.7 - (beatFraction - 0.8) * 2.0;  // Release
+        }
+        st.env[i] = std::max(0.0, rhythmEnv);
+
+        st.t += dt;
     }
-    
-    return sample * 0.7;  // Chords are rich and full
-}
 
-}  // namespace
+    std::fill(out, out + frames, 0.0);
 
-void generateAmbientTrack(const std::string& outputPath, 
-                          const MusicParameters& params,
-                          const StyleParameters* styleParams) {
-    // Phase 7: styleParams available for Person B to use for:
-    // - Ambience layer mixing (ocean/rain/forest/city samples)
-    // - Instrument preset selection (pad/keys/pluck/bell oscillators)
-    // - Mood-based lushness adjustment (reverb, envelope times, melody presence)
-    // For now, ignored - Person B will implement in their tasks
-    (void)styleParams;  // Suppress unused parameter warning
-    
-    // Duration based on energy (more energy = slightly longer, more complex)
-    const double durationSeconds = 8.0 + params.energy * 4.0;  // 8-12 seconds
-    const int numSamples = static_cast<int>(durationSeconds * SAMPLE_RATE);
+    // Render each run of frames that shares one chord voicing
+    int runStart = 0;
+    while (runStart < frames) {
+        int voicing = st.segment[runStart];
+        int runEnd = runStart + 1;
+        while (runEnd < frames && st.segment[runEnd] == voicing) ++runEnd;
 
-    std::ofstream out(outputPath, std::ios::binary);
-    if (!out) {
-        throw std::runtime_error("Failed to open output WAV: " + outputPath);
+        for (int v = 0; v < st.chordNotes; ++v) {
+            st.voices[v].phaseStep = st.chordSteps[voicing][v];
+            accumulateVoice(st.voices[v], st.params.brightness, st.env + runStart,
+                            static_cast<double>(st.chordNotes), st.phase, out + runStart,
+                            runEnd - runStart);
+        }
+        runStart = runEnd;
     }
 
-    // --- Write WAV header (PCM 16-bit, mono) ---
-    int numChannels = 1;
-    int bitsPerSample = 16;
-    int byteRate = SAMPLE_RATE * numChannels * bitsPerSample / 8;
-    int blockAlign = numChannels * bitsPerSample / 8;
-    int dataSize = numSamples * numChannels * bitsPerSample / 8;
-    int chunkSize = 36 + dataSize;
-
-    // RIFF header
-    out.write("RIFF", 4);
-    writeLE(out, chunkSize, 4);
-    out.write("WAVE", 4);
-
-    // fmt subchunk
-    out.write("fmt ", 4);
-    writeLE(out, 16, 4);             // Subchunk1Size
-    writeLE(out, 1, 2);              // AudioFormat (PCM)
-    writeLE(out, numChannels, 2);    // NumChannels
-    writeLE(out, SAMPLE_RATE, 4);    // SampleRate
-    writeLE(out, byteRate, 4);       // ByteRate
-    writeLE(out, blockAlign, 2);     // BlockAlign
-    writeLE(out, bitsPerSample, 2);  // BitsPerSample
-
-    // data subchunk
-    out.write("data", 4);
-    writeLE(out, dataSize, 4);
+    for (int i = 0; i < frames; ++i) out[i] *= 0.7;  // Chords are rich and full
+}
+
+// Duration based on energy (more energy = slightly longer, more complex)
+static int ambientTrackFrames(const MusicParameters& params) {
+    const double durationSeconds = 8.0 + params.energy * 4.0;  // 8-12 seconds
+    return static_cast<int>(durationSeconds * SAMPLE_RATE);
+}
+
+// Renders the whole track block by block into a mono 16-bit writer
+static void renderAmbientTrack(WavWriter& writer, const MusicParameters& params) {
+    const int numSamples = ambientTrackFrames(params);
 
     // --- Musical synthesis with 7 parameters ---
     
-    auto scale = getScaleSemitones(params.scaleType);
+    // Unknown scale types have always played Lydian here
+    const ScaleIntervals& scale = scaleIntervals(params.scaleType, 3);
     double secondsPerBeat = 60.0 / params.tempoBpm;
     
     // Reverb: simple feedback delay line
@@ -257,82 +251,98 @@ void generateAmbientTrack(const std::string& outputPath,
     int delayIndex = 0;
     double reverbFeedback = 0.3 + params.reverb * 0.4;  // 0.3-0.7 feedback
     
-    // Oscillator phases (persistent across samples)
-    std::vector<double> phases(8, 0.0);  // Support up to 8 voices
-    
     // Low-pass filter state for brightness control
-    float filterState = 0.0f;
+    double filterState = 0.0;
     double filterCoeff = 0.7 + params.brightness * 0.25;  // 0.7-0.95 (higher = brighter)
-    
-    double t = 0.0;
-    double dt = 1.0 / SAMPLE_RATE;
-    
-    for (int i = 0; i < numSamples; ++i) {
-        // Build synthesis context
-        SynthContext ctx = {t, params, scale, secondsPerBeat, phases};
-        
+
+    // Mix dry and wet based on reverb amount
+    double dryMix = 1.0 - params.reverb * 0.6;  // Always keep some dry
+    double wetMix = params.reverb * 0.8;
+
+    SynthState synth{params, secondsPerBeat};
+    initSynthState(synth, scale);
+
+    double block[BLOCK_SIZE];
+    float pcm[BLOCK_SIZE];
+
+    for (int blockStart = 0; blockStart < numSamples; blockStart += BLOCK_SIZE) {
+        const int frames = std::min(BLOCK_SIZE, numSamples - blockStart);
+
         // Generate dry signal based on pattern type
-        double dry = 0.0;
-        
         if (params.patternType == 0) {
             // Pad: sustained, ambient
-            dry = synthPadSample(ctx);
+            renderPadBlock(synth, block, frames);
         } else if (params.patternType == 1) {
             // Arpeggio: rhythmic, flowing
-            dry = synthArpSample(ctx);
+            renderArpBlock(synth, block, frames);
         } else {
             // Chords: harmonic blocks
-            dry = synthChordSample(ctx);
+            renderChordBlock(synth, block, frames);
         }
-        
+
         // Simple one-pole low-pass filter controlled by brightness
         // Higher brightness = less filtering = brighter sound
-        filterState = filterState * (1.0 - filterCoeff) + dry * filterCoeff;
-        double filtered = filterState;
-        
-        // Reverb processing
-        float delayed = delayBuffer[delayIndex];
-        float reverbSignal = filtered + delayed * reverbFeedback;
-        
-        delayBuffer[delayIndex] = reverbSignal;
-        delayIndex = (delayIndex + 1) % delaySamples;
-        
-        // Mix dry and wet based on reverb amount
-        double dryMix = 1.0 - params.reverb * 0.6;  // Always keep some dry
-        double wetMix = params.reverb * 0.8;
-        float mixed = filtered * dryMix + reverbSignal * wetMix;
-        
-        // Global envelope (fade in/out for smooth start/end)
-        double globalEnv = 1.0;
-        if (i < SAMPLE_RATE * 0.5) {
-            // Fade in over 0.5 seconds
-            globalEnv = static_cast<double>(i) / (SAMPLE_RATE * 0.5);
-        } else if (i > numSamples - SAMPLE_RATE * 1.0) {
-            // Fade out over 1 second
-            globalEnv = static_cast<double>(numSamples - i) / (SAMPLE_RATE * 1.0);
-        }
-        
-        float sample = mixed * globalEnv;
-        
-        // Soft clipping to prevent harsh distortion
-        if (sample > 0.9f) {
-            sample = 0.9f + 0.1f * std::tanh((sample - 0.9f) / 0.1f);
-        } else if (sample < -0.9f) {
-            sample = -0.9f + 0.1f * std::tanh((sample + 0.9f) / 0.1f);
+        onePoleLowpass(block, frames, filterCoeff, filterState);
+
+        // Reverb processing (feedback delay) and dry/wet mix
+        feedbackDelayMix(block, frames, delayBuffer.data(), delaySamples, delayIndex,
+                         reverbFeedback, dryMix, wetMix);
+
+        for (int j = 0; j < frames; ++j) {
+            const int i = blockStart + j;
+
+            // Global envelope (fade in/out for smooth start/end)
+            double globalEnv = 1.0;
+            if (i < SAMPLE_RATE * 0.5) {
+                // Fade in over 0.5 seconds
+                globalEnv = static_cast<double>(i) / (SAMPLE_RATE * 0.5);
+            } else if (i > numSamples - SAMPLE_RATE * 1.0) {
+                // Fade out over 1 second
+                globalEnv = static_cast<double>(numSamples - i) / (SAMPLE_RATE * 1.0);
+            }
+
+            float sample = static_cast<float>(block[j] * globalEnv);
+
+            // Soft clipping to prevent harsh distortion
+            if (sample > 0.9f) {
+                sample = 0.9f + 0.1f * std::tanh((sample - 0.9f) / 0.1f);
+            } else if (sample < -0.9f) {
+                sample = -0.9f + 0.1f * std::tanh((sample + 0.9f) / 0.1f);
+            }
+
+            // Final hard limit and 16-bit conversion happen in the writer
+            pcm[j] = sample;
         }
-        
-        // Final hard limit
-        sample = std::max(-1.0f, std::min(1.0f, sample));
-        
-        // Convert to 16-bit PCM
-        int16_t intSample = static_cast<int16_t>(sample * 32767.0f);
-        writeLE(out, static_cast<std::uint16_t>(intSample), 2);
-        
-        t += dt;
-    }
 
-    out.close();
-    if (!out) {
-        throw std::runtime_error("Error while writing WAV file: " + outputPath);
+        writer.writeSamples(pcm, frames);
     }
-}
\ No newline at end of file
+
+}
+
+}  // namespace
+
+void generateAmbientTrack(const std::string& outputPath, 
+                          const MusicParameters& params,
+                          const StyleParameters* styleParams) {
+    // Phase 7: styleParams available for Person B to use for:
+    // - Ambience layer mixing (ocean/rain/forest/city samples)
+    // - Instrument preset selection (pad/keys/pluck/bell oscillators)
+    // - Mood-based lushness adjustment (reverb, envelope times, melody presence)
+    // For now, ignored - Person B will implement in their tasks
+    (void)styleParams;  // Suppress unused parameter warning
+
+    // PCM 16-bit, mono
+    WavWriter writer(outputPath, SAMPLE_RATE, 1, ambientTrackFrames(params));
+    renderAmbientTrack(writer, params);
+    writer.finish();
+}
+
+void streamAmbientTrack(const std::function<bool(const char* data, std::size_t size)>& sink,
+                        const MusicParameters& params,
+                        const StyleParameters* styleParams) {
+    (void)styleParams;  // See generateAmbientTrack
+
+    WavWriter writer(sink, SAMPLE_RATE, 1, ambientTrackFrames(params));
+    renderAmbientTrack(writer, params);
+    writer.finish();
+}
@@ -1,16 +1,94 @@
 #include "AudioProducerClient.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 #include "httplib.h"
 #include "json.hpp"
 
 using json = nlohmann::json;
 
-AudioProducerClient::AudioProducerClient(const std::string& baseUrl)
-    : baseUrl_(baseUrl), port_(9001) {
+static int envInt(const char* key, int def) {
+  const char* v = std::getenv(key);
+  if (!v) return def;
+  try {
+    return std::stoi(v);
+  } catch (...) {
+    return def;
+  }
+}
+
+AudioProducerClient::Options AudioProducerClient::optionsFromEnv() {
+  Options o;
+  o.connectTimeoutMs = std::max(
+      1, envInt("SC_PRODUCER_CONNECT_TIMEOUT_MS", o.connectTimeoutMs));
+  o.produceTimeoutSec =
+      std::max(1, envInt("SC_PRODUCER_TIMEOUT_SECONDS", o.produceTimeoutSec));
+  o.maxIdleConnections = static_cast<size_t>(std::max(
+      0, envInt("SC_PRODUCER_POOL_SIZE",
+                static_cast<int>(o.maxIdleConnections))));
+  o.healthIntervalMs = std::max(
+      0, envInt("SC_PRODUCER_HEALTH_INTERVAL_MS", o.healthIntervalMs));
+  return o;
+}
+
+AudioProducerClient::AudioProducerClient(const std::string& baseUrl,
+                                         const Options& options)
+    : baseUrl_(baseUrl), port_(9001), options_(options) {
   parseUrl();
+  if (options_.healthIntervalMs > 0) {
+    healthThread_ = std::thread(&AudioProducerClient::healthLoop, this);
+  }
+}
+
+AudioProducerClient::~AudioProducerClient() {
+  {
+    std::lock_guard<std::mutex> lock(healthMutex_);
+    stopping_ = true;
+  }
+  healthCv_.notify_all();
+  if (healthThread_.joinable()) healthThread_.join();
+}
+
+std::unique_ptr<httplib::Client> AudioProducerClient::acquireConnection() {
+  {
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    if (!idle_.empty()) {
+      std::unique_ptr<httplib::Client> client = std::move(idle_.back());
+      idle_.pop_back();
+      return client;
+    }
+  }
+
+  auto client = std::make_unique<httplib::Client>(host_, port_);
+  client->set_keep_alive(true);
+  client->set_connection_timeout(
+      std::chrono::milliseconds(options_.connectTimeoutMs));
+  return client;
+}
+
+void AudioProducerClient::releaseConnection(
+    std::unique_ptr<httplib::Client> client) {
+  std::lock_guard<std::mutex> lock(poolMutex_);
+  if (idle_.size() < options_.maxIdleConnections) {
+    idle_.push_back(std::move(client));
+  }
+}
+
+void AudioProducerClient::healthLoop() {
+  std::unique_lock<std::mutex> lock(healthMutex_);
+  while (!stopping_) {
+    lock.unlock();
+    healthCheck();
+    lock.lock();
+    healthCv_.wait_for(lock,
+                       std::chrono::milliseconds(options_.healthIntervalMs),
+                       [this] { return stopping_; });
+  }
 }
 
 void AudioProducerClient::parseUrl() {
@@ -37,10 +115,74 @@ bool AudioProducerClient::produceTrack(
     const std::map<std::string, std::string>& stems,
     const std::string& outputPath, const std::string& genre,
     bool applyMastering, bool applySidechain,
-    const std::vector<std::string>& sidechainTargets) {
+    const std::vector<std::string>& sidechainTargets,
+    ProgressCallback progress) {
+  return postProduce("stems", stems, outputPath, genre, applyMastering,
+                     applySidechain, sidechainTargets, progress);
+}
+
+std::future<bool> AudioProducerClient::produceTrackAsync(
+    std::map<std::string, std::string> stems, std::string outputPath,
+    std::string genre, bool applyMastering, bool applySidechain,
+    std::vector<std::string> sidechainTargets, ProgressCallback progress) {
+  return std::async(
+      std::launch::async,
+      [this, stems = std::move(stems), outputPath = std::move(outputPath),
+       genre = std::move(genre), applyMastering, applySidechain,
+       sidechainTargets = std::move(sidechainTargets),
+       progress = std::move(progress)] {
+        return produceTrack(stems, outputPath, genre, applyMastering,
+                            applySidechain, sidechainTargets, progress);
+      });
+}
+
+bool AudioProducerClient::produceFromRenderedStems(
+    const std::map<std::string, std::string>& stemAudio,
+    const std::string& outputPath, const std::string& genre,
+    bool applyMastering, bool applySidechain,
+    const std::vector<std::string>& sidechainTargets,
+    ProgressCallback progress) {
+  return postProduce("stem_audio", stemAudio, outputPath, genre,
+                     applyMastering, applySidechain, sidechainTargets,
+                     progress);
+}
+
+// Pass on every complete {"progress": ...} line in buffer[from, end) and
+// return where the unfinished line starts
+static size_t dispatchProgressLines(
+    const std::string& buffer, size_t from,
+    const AudioProducerClient::ProgressCallback& progress) {
+  size_t newline;
+  while ((newline = buffer.find('\n', from)) != std::string::npos) {
+    json line = json::parse(buffer.begin() + from, buffer.begin() + newline,
+                            nullptr, false);
+    from = newline + 1;
+    if (line.is_object() && line.contains("progress")) {
+      progress(line.value("progress", 0.0), line.value("stage", ""));
+    }
+  }
+  return from;
+}
+
+// The result object: the whole body, or for an NDJSON stream its last line
+static json parseProduceResult(const std::string& body, bool ndjson) {
+  if (!ndjson) return json::parse(body);
+  size_t end = body.find_last_not_of("\r\n");
+  if (end == std::string::npos) return json::object();
+  size_t start = body.rfind('\n', end);
+  start = start == std::string::npos ? 0 : start + 1;
+  return json::parse(body.begin() + start, body.begin() + end + 1);
+}
+
+bool AudioProducerClient::postProduce(
+    const char* stemsKey, const std::map<std::string, std::string>& stems,
+    const std::string& outputPath, const std::string& genre,
+    bool applyMastering, bool applySidechain,
+    const std::vector<std::string>& sidechainTargets,
+    const ProgressCallback& progress) {
   try {
-    httplib::Client client(host_, port_);
-    client.set_read_timeout(120);  // 2 minutes for complex mixing/mastering
+    std::unique_ptr<httplib::Client> client = acquireConnection();
+    client->set_read_timeout(options_.produceTimeoutSec, 0);
 
     // Build JSON request
     json req;
@@ -50,7 +192,7 @@ bool AudioProducerClient::produceTrack(
     for (const auto& [name, path] : stems) {
       stemsObj[name] = path;
     }
-    req["stems"] = stemsObj;
+    req[stemsKey] = stemsObj;
 
     req["output_path"] = outputPath;
     req["genre"] = genre;
@@ -73,22 +215,43 @@ bool AudioProducerClient::produceTrack(
               << ", Sidechain: " << (applySidechain ? "yes" : "no")
               << std::endl;
 
-    auto res = client.Post("/produce", body, "application/json");
+    // With a progress callback, ask for an NDJSON stream and read it as it
+    // arrives; progress lines are passed on as soon as they are complete
+    std::string received;
+    size_t parsed = 0;
+    httplib::Headers headers;
+    if (progress) {
+      headers.emplace("Accept", "application/x-ndjson, application/json");
+    }
+    auto res = client->Post(
+        "/produce", headers, body, "application/json",
+        [&](const char* data, size_t length) {
+          received.append(data, length);
+          if (progress) {
+            parsed = dispatchProgressLines(received, parsed, progress);
+          }
+          return true;
+        });
 
     if (!res) {
+      healthy_ = false;
       std::cerr << "[AudioProducerClient] HTTP request failed: "
                 << httplib::to_string(res.error()) << std::endl;
       return false;
     }
+    healthy_ = res->status < 500;
+    releaseConnection(std::move(client));
 
     if (res->status != 200) {
       std::cerr << "[AudioProducerClient] HTTP error " << res->status << ": "
-                << res->body << std::endl;
+                << received << std::endl;
       return false;
     }
 
     // Parse response
-    json response = json::parse(res->body);
+    bool ndjson = res->get_header_value("Content-Type").find("ndjson") !=
+                  std::string::npos;
+    json response = parseProduceResult(received, ndjson);
 
     if (response["status"] == "success") {
       std::cout << "[AudioProducerClient] Success!" << std::endl;
@@ -117,11 +280,38 @@ bool AudioProducerClient::produceTrack(
   }
 }
 
+// Shared /render-stem response handling
+static bool checkRenderResponse(const httplib::Result& res) {
+  if (!res) {
+    std::cerr << "[AudioProducerClient] HTTP request failed: "
+              << httplib::to_string(res.error()) << std::endl;
+    return false;
+  }
+
+  if (res->status != 200) {
+    std::cerr << "[AudioProducerClient] HTTP error " << res->status << ": "
+              << res->body << std::endl;
+    return false;
+  }
+
+  json response = json::parse(res->body);
+
+  if (response["status"] == "success") {
+    std::cout << "[AudioProducerClient] Stem rendered successfully"
+              << std::endl;
+    return true;
+  } else {
+    std::cerr << "[AudioProducerClient] Render failed: "
+              << response.value("message", "Unknown error") << std::endl;
+    return false;
+  }
+}
+
 bool AudioProducerClient::renderStem(const std::string& midiPath,
                                      const std::string& outputPath) {
   try {
-    httplib::Client client(host_, port_);
-    client.set_read_timeout(60);
+    std::unique_ptr<httplib::Client> client = acquireConnection();
+    client->set_read_timeout(options_.renderTimeoutSec, 0);
 
     json req;
     req["midi_path"] = midiPath;
@@ -132,31 +322,38 @@ bool AudioProducerClient::renderStem(const std::string& midiPath,
     std::cout << "[AudioProducerClient] Rendering stem: " << midiPath
               << std::endl;
 
-    auto res = client.Post("/render-stem", body, "application/json");
+    auto res = client->Post("/render-stem", body, "application/json");
+    healthy_ = res && res->status < 500;
+    if (res) releaseConnection(std::move(client));
+    return checkRenderResponse(res);
 
-    if (!res) {
-      std::cerr << "[AudioProducerClient] HTTP request failed: "
-                << httplib::to_string(res.error()) << std::endl;
-      return false;
-    }
+  } catch (const std::exception& e) {
+    std::cerr << "[AudioProducerClient] Exception: " << e.what() << std::endl;
+    return false;
+  }
+}
 
-    if (res->status != 200) {
-      std::cerr << "[AudioProducerClient] HTTP error " << res->status << ": "
-                << res->body << std::endl;
-      return false;
-    }
+bool AudioProducerClient::renderStem(const std::string& name,
+                                     const std::vector<uint8_t>& midi,
+                                     const std::string& outputPath) {
+  try {
+    std::unique_ptr<httplib::Client> client = acquireConnection();
+    client->set_read_timeout(options_.renderTimeoutSec, 0);
 
-    json response = json::parse(res->body);
+    httplib::UploadFormDataItems items = {
+        {"midi", std::string(midi.begin(), midi.end()), name + ".mid",
+         "audio/midi"},
+        {"name", name, "", ""},
+        {"output_path", outputPath, "", ""},
+    };
 
-    if (response["status"] == "success") {
-      std::cout << "[AudioProducerClient] Stem rendered successfully"
-                << std::endl;
-      return true;
-    } else {
-      std::cerr << "[AudioProducerClient] Render failed: "
-                << response.value("message", "Unknown error") << std::endl;
-      return false;
-    }
+    std::cout << "[AudioProducerClient] Rendering stem: " << name << " ("
+              << midi.size() << " bytes)" << std::endl;
+
+    auto res = client->Post("/render-stem", items);
+    healthy_ = res && res->status < 500;
+    if (res) releaseConnection(std::move(client));
+    return checkRenderResponse(res);
 
   } catch (const std::exception& e) {
     std::cerr << "[AudioProducerClient] Exception: " << e.what() << std::endl;
@@ -164,25 +361,84 @@ bool AudioProducerClient::renderStem(const std::string& midiPath,
   }
 }
 
+std::map<std::string, std::string> AudioProducerClient::renderStems(
+    const std::map<std::string, std::vector<uint8_t>>& stems,
+    const std::string& outputDir, size_t maxInFlight) {
+  std::vector<const std::pair<const std::string, std::vector<uint8_t>>*> work;
+  for (const auto& stem : stems) {
+    work.push_back(&stem);
+  }
+  std::vector<std::string> wavPaths(work.size());
+  std::vector<char> rendered(work.size(), 0);
+
+  // Each thread takes the next stem until none are left; the caller is
+  // one of them
+  std::atomic<size_t> next{0};
+  auto renderNext = [&] {
+    for (size_t i; (i = next.fetch_add(1)) < work.size();) {
+      wavPaths[i] = outputDir + "/" + work[i]->first + ".wav";
+      rendered[i] = renderStem(work[i]->first, work[i]->second, wavPaths[i]);
+    }
+  };
+
+  size_t threads = std::min(std::max<size_t>(maxInFlight, 1), work.size());
+  std::vector<std::thread> helpers;
+  for (size_t t = 1; t < threads; ++t) {
+    helpers.emplace_back(renderNext);
+  }
+  renderNext();
+  for (auto& t : helpers) {
+    t.join();
+  }
+
+  std::map<std::string, std::string> result;
+  for (size_t i = 0; i < work.size(); ++i) {
+    if (rendered[i]) result[work[i]->first] = wavPaths[i];
+  }
+  return result;
+}
+
+bool AudioProducerClient::produceTrackParallel(
+    const std::map<std::string, std::vector<uint8_t>>& stems,
+    const std::string& stemsDir, const std::string& outputPath,
+    const std::string& genre, bool applyMastering, bool applySidechain,
+    const std::vector<std::string>& sidechainTargets, size_t maxInFlight,
+    ProgressCallback progress) {
+  std::cout << "[AudioProducerClient] Rendering " << stems.size()
+            << " stems, up to " << maxInFlight << " at a time..." << std::endl;
+
+  std::map<std::string, std::string> stemAudio =
+      renderStems(stems, stemsDir, maxInFlight);
+  if (stemAudio.size() != stems.size()) {
+    std::cerr << "[AudioProducerClient] " << (stems.size() - stemAudio.size())
+              << " of " << stems.size() << " stems failed to render"
+              << std::endl;
+    return false;
+  }
+
+  return produceFromRenderedStems(stemAudio, outputPath, genre,
+                                  applyMastering, applySidechain,
+                                  sidechainTargets, progress);
+}
+
 bool AudioProducerClient::healthCheck() {
+  bool ok = false;
   try {
-    httplib::Client client(host_, port_);
-    client.set_read_timeout(5);
-
-    auto res = client.Get("/health");
+    std::unique_ptr<httplib::Client> client = acquireConnection();
+    client->set_read_timeout(5, 0);
 
-    if (!res) {
-      return false;
-    }
+    auto res = client->Get("/health");
 
-    if (res->status != 200) {
-      return false;
+    if (res) {
+      releaseConnection(std::move(client));
+      ok = res->status == 200 &&
+           json::parse(res->body, nullptr, false).value("status", "") ==
+               "healthy";
     }
 
-    json response = json::parse(res->body);
-    return response["status"] == "healthy";
-
   } catch (...) {
-    return false;
+    ok = false;
   }
+  healthy_ = ok;
+  return ok;
 }
@@ -1,19 +1,41 @@
 #include "Composer.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
-#include <iostream>
+#include <cstdint>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <random>
+#include <utility>
 #include <vector>
 
+#include "CompositionCache.hpp"
 #include "GenreTemplate.hpp"
+#include "Log.hpp"
 #include "MidiWriter.hpp"
+#include "MusicTheory.hpp"
 #include "SectionPlanner.hpp"
 #include "SongSpec.hpp"
+#include "WorkerPool.hpp"
 
 namespace {
 
+// Upper-end MIDI events per bar for each role (busy drum fills, 16th-note
+// lines), used to pre-size tracks so composing never reallocates
+size_t eventsPerBarEstimate(TrackRole role) {
+  switch (role) {
+    case TrackRole::DRUMS: return 64;
+    case TrackRole::BASS: return 16;
+    case TrackRole::CHORDS: return 32;
+    case TrackRole::LEAD: return 32;
+    case TrackRole::PAD: return 16;
+    case TrackRole::FX: return 0;
+  }
+  return 16;
+}
+
 // Phase 9: Drum pattern data structures
 struct DrumHit {
   int step;        // Position in 16th notes (0-15 for one bar in 4/4)
@@ -56,22 +78,6 @@ bool isOffBeat(int tick, int ticksPerBeat) {
   return (eighthBeatIndex == 1 && positionInEighth == 0);
 }
 
-// Musical scale intervals in semitones
-std::vector<int> getScaleIntervals(int scaleType) {
-  switch (scaleType) {
-    case 0:  // Major
-      return {0, 2, 4, 5, 7, 9, 11};
-    case 1:  // Minor
-      return {0, 2, 3, 5, 7, 8, 10};
-    case 2:  // Dorian
-      return {0, 2, 3, 5, 7, 9, 10};
-    case 3:  // Lydian
-      return {0, 2, 4, 6, 7, 9, 11};
-    default:
-      return {0, 2, 4, 5, 7, 9, 11};
-  }
-}
-
 // Phase 8: Velocity scaling based on section energy for dynamics
 int scaleVelocity(int baseVelocity, float sectionEnergy) {
   // intro/outro (0.2): 60-80
@@ -94,79 +100,11 @@ int scaleVelocity(int baseVelocity, float sectionEnergy) {
   return std::max(40, std::min(120, scaled));
 }
 
-// Chord progression templates for different scale types
-struct ChordProgression {
-  std::vector<int> degrees;  // Scale degrees (0-6)
-  std::string name;
-};
-
-// Phase 9: Get chord progressions based on scale type and genre
-std::vector<ChordProgression> getProgressions(int scaleType, Genre genre = Genre::EDM_DROP) {
-  if (genre == Genre::RAP) {
-    // Rap/Trap: Simple 2-4 chord loops, often minor
-    if (scaleType == 1 || scaleType == 2) {  // Minor or Dorian
-      return {{{0, 5, 2, 6}, "i-VI-III-VII"},
-              {{0, 6, 5, 6}, "i-VII-VI-VII"},
-              {{0, 3, 5, 5}, "i-iv-VI-VI"}};
-    } else {
-      return {{{0, 4, 3, 4}, "I-V-IV-V"},
-              {{0, 5, 3, 3}, "I-vi-IV-IV"}};
-    }
-  } else if (genre == Genre::RNB) {
-    // R&B: Extended chords, jazzy progressions
-    if (scaleType == 0 || scaleType == 3) {  // Major or Lydian
-      return {{{1, 4, 0, 0}, "ii7-V7-Imaj7-Imaj7"},
-              {{3, 2, 1, 4}, "IVmaj7-iii7-ii7-V7"},
-              {{0, 4, 5, 3}, "I-V-vi-IV"}};  // Pop progression but works well
-    } else {  // Minor or Dorian
-      return {{{0, 3, 6, 5}, "i7-iv7-VII-VI"},
-              {{0, 5, 3, 4}, "i-VI-iv-v7"}};
-    }
-  } else if (genre == Genre::HOUSE) {
-    // House: Uplifting, repetitive progressions
-    if (scaleType == 0 || scaleType == 3) {  // Major or Lydian
-      return {{{0, 5, 3, 4}, "I-vi-IV-V"},  // Classic pop
-              {{3, 4, 0, 5}, "IV-V-I-vi"},  // Uplifting
-              {{0, 4, 5, 3}, "I-V-vi-IV"}};  // Modern house
-    } else {
-      return {{{0, 6, 3, 4}, "i-VII-iv-v"},
-              {{0, 3, 5, 5}, "i-iv-VI-VI"}};
-    }
-  }
-  
-  // Original progressions for EDM genres
-  if (scaleType == 0 || scaleType == 3) {
-    // Major / Lydian progressions
-    return {{{0, 5, 3, 4}, "I-vi-IV-V"},
-            {{0, 4, 0, 5}, "I-V-I-vi"},
-            {{0, 3, 4, 4}, "I-IV-V-V"}};
-  } else {
-    // Minor / Dorian progressions
-    return {{{0, 3, 5, 5}, "i-iv-VI-VI"},
-            {{0, 4, 3, 5}, "i-v-iv-VI"},
-            {{0, 5, 3, 3}, "i-VI-iv-iv"}};
-  }
-}
-
-// Overload for backward compatibility
-std::vector<ChordProgression> getProgressions(int scaleType) {
-  return getProgressions(scaleType, Genre::EDM_DROP);
-}
-
-// Random number generator for humanization
-std::mt19937& getRng() {
-  static std::mt19937 rng(42);  // Fixed seed for reproducibility
-  return rng;
-}
-
-float randomFloat(float min, float max) {
-  std::uniform_real_distribution<float> dist(min, max);
-  return dist(getRng());
-}
-
-int randomInt(int min, int max) {
+// Humanization draws from the composing track's own generator (see
+// trackRng), never a shared one, so tracks can be composed concurrently
+int randomInt(std::mt19937& rng, int min, int max) {
   std::uniform_int_distribution<int> dist(min, max);
-  return dist(getRng());
+  return dist(rng);
 }
 
 // Phase 9: Genre-specific drum pattern data
@@ -295,30 +233,71 @@ DrumPattern getRnBPattern(float energy) {
   return pattern;
 }
 
+// Energy thresholds the genre drum patterns above branch on (keep in sync).
+// Every energy between two neighbouring steps builds the same bar, so each
+// genre needs one pattern per bucket.
+constexpr float kPatternEnergySteps[] = {0.4f, 0.5f, 0.6f, 0.7f};
+constexpr size_t kPatternEnergyBuckets = std::size(kPatternEnergySteps) + 1;
+
+size_t patternEnergyBucket(float energy) {
+  size_t bucket = 0;
+  for (float step : kPatternEnergySteps) {
+    if (energy > step) ++bucket;
+  }
+  return bucket;
+}
+
+// An energy inside each bucket, for building the bank
+float patternBucketEnergy(size_t bucket) {
+  if (bucket == 0) return 0.0f;
+  float low = kPatternEnergySteps[bucket - 1];
+  float high = bucket < std::size(kPatternEnergySteps)
+                   ? kPatternEnergySteps[bucket]
+                   : 1.0f;
+  return 0.5f * (low + high);
+}
+
+// Genre drum bar for an energy, from a bank compiled once on first use.
+// nullptr for genres without pattern data (EDM uses generateDrumsBar).
+const DrumPattern* genreDrumPattern(Genre genre, float energy) {
+  static const auto bank = [] {
+    std::array<std::array<DrumPattern, kPatternEnergyBuckets>, 3> b;
+    for (size_t i = 0; i < kPatternEnergyBuckets; ++i) {
+      float e = patternBucketEnergy(i);
+      b[0][i] = getHousePattern(e);
+      b[1][i] = getTrapPattern(e);
+      b[2][i] = getRnBPattern(e);
+    }
+    return b;
+  }();
+
+  size_t bucket = patternEnergyBucket(energy);
+  switch (genre) {
+    case Genre::HOUSE: return &bank[0][bucket];
+    case Genre::RAP: return &bank[1][bucket];
+    case Genre::RNB: return &bank[2][bucket];
+    default: return nullptr;
+  }
+}
+
 // Phase 9: Generate drums using pattern data + swing
-void generateDrumsBarGenre(MidiWriter& midi, int trackIdx, int startTick,
-                           int ticksPerBar, const GenreProfile& genre, 
+void generateDrumsBarGenre(MidiWriter::TrackEvents& midi, std::mt19937& rng,
+                           int startTick, int ticksPerBar, const GenreProfile& genre, 
                            float energy, float complexity, bool addFill = false) {
   int ticksPerBeat = ticksPerBar / 4;
   int ticksPer16th = ticksPerBeat / 4;
   int channel = 9;  // MIDI channel 10 (drums)
   
-  // Get appropriate pattern based on genre
-  DrumPattern pattern;
-  if (genre.genre == Genre::HOUSE) {
-    pattern = getHousePattern(energy);
-  } else if (genre.genre == Genre::RAP) {
-    pattern = getTrapPattern(energy);
-  } else if (genre.genre == Genre::RNB) {
-    pattern = getRnBPattern(energy);
-  } else {
+  // Get appropriate pattern based on genre (shared, never copied)
+  const DrumPattern* pattern = genreDrumPattern(genre.genre, energy);
+  if (!pattern) {
     // EDM patterns - use the existing logic via old function
     // (fallback to prevent duplicate code)
     return;  // Will use old generateDrumsBar
   }
   
-  // Play pattern hits
-  for (const auto& hit : pattern.hits) {
+  // Stamp the pattern's hits at this bar's tick offset
+  for (const auto& hit : pattern->hits) {
     int hitTick = startTick + hit.step * ticksPer16th;
     
     // Apply swing if genre uses it
@@ -326,17 +305,17 @@ void generateDrumsBarGenre(MidiWriter& midi, int trackIdx, int startTick,
                          genre.useSwing, genre.swingAmount) + startTick;
     
     // Humanization
-    int vel = hit.velocity + randomInt(-5, 5);
+    int vel = hit.velocity + randomInt(rng, -5, 5);
     vel = std::clamp(vel, 40, 127);
     
     // Add slight timing variation (except for kicks in house - keep those tight)
     int timingVar = 0;
     if (genre.genre != Genre::HOUSE || hit.note != KICK) {
-      timingVar = randomInt(-3, 3);
+      timingVar = randomInt(rng, -3, 3);
     }
     
-    midi.addNoteOn(trackIdx, hitTick + timingVar, channel, hit.note, vel);
-    midi.addNoteOff(trackIdx, hitTick + timingVar + ticksPer16th, channel, hit.note);
+    midi.addNoteOn(hitTick + timingVar, channel, hit.note, vel);
+    midi.addNoteOff(hitTick + timingVar + ticksPer16th, channel, hit.note);
   }
   
   // Add fills at section transitions
@@ -347,31 +326,31 @@ void generateDrumsBarGenre(MidiWriter& midi, int trackIdx, int startTick,
       // House: Snare roll
       for (int i = 0; i < 4; ++i) {
         int vel = 70 + i * 8;  // Crescendo
-        midi.addNoteOn(trackIdx, fillStart + i * ticksPer16th, channel, SNARE, vel);
-        midi.addNoteOff(trackIdx, fillStart + i * ticksPer16th + ticksPer16th/2, channel, SNARE);
+        midi.addNoteOn(fillStart + i * ticksPer16th, channel, SNARE, vel);
+        midi.addNoteOff(fillStart + i * ticksPer16th + ticksPer16th/2, channel, SNARE);
       }
     } else if (genre.genre == Genre::RAP) {
       // Rap: Hi-hat roll
       for (int i = 0; i < 8; ++i) {
         int vel = 65 + i * 4;
-        midi.addNoteOn(trackIdx, fillStart + i * (ticksPer16th/2), channel, CLOSED_HAT, vel);
-        midi.addNoteOff(trackIdx, fillStart + i * (ticksPer16th/2) + 20, channel, CLOSED_HAT);
+        midi.addNoteOn(fillStart + i * (ticksPer16th/2), channel, CLOSED_HAT, vel);
+        midi.addNoteOff(fillStart + i * (ticksPer16th/2) + 20, channel, CLOSED_HAT);
       }
     } else if (genre.genre == Genre::RNB) {
       // R&B: Tom fill (melodic)
       int toms[] = {TOM_HIGH, TOM_MID, TOM_LOW, TOM_LOW};
       for (int i = 0; i < 4; ++i) {
         int vel = 75 + i * 5;
-        midi.addNoteOn(trackIdx, fillStart + i * ticksPer16th, channel, toms[i], vel);
-        midi.addNoteOff(trackIdx, fillStart + i * ticksPer16th + ticksPer16th, channel, toms[i]);
+        midi.addNoteOn(fillStart + i * ticksPer16th, channel, toms[i], vel);
+        midi.addNoteOff(fillStart + i * ticksPer16th + ticksPer16th, channel, toms[i]);
       }
     }
   }
 }
 
 // Original drum generator (for EDM genres)
-void generateDrumsBar(MidiWriter& midi, int trackIdx, int startTick,
-                      int ticksPerBar, GrooveType groove, float energy,
+void generateDrumsBar(MidiWriter::TrackEvents& midi, std::mt19937& rng,
+                      int startTick, int ticksPerBar, GrooveType groove, float energy,
                       float complexity, bool addFill = false) {
   int ticksPerBeat = ticksPerBar / 4;
   int channel = 9;  // MIDI channel 10 (9 in 0-indexed) = drums
@@ -381,22 +360,21 @@ void generateDrumsBar(MidiWriter& midi, int trackIdx, int startTick,
   if (groove == GrooveType::CHILL) {
     // Sparse, laid-back pattern
     // Kick on 1 and 3
-    midi.addNoteOn(trackIdx, startTick, channel, KICK, baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat / 2, channel, KICK);
+    midi.addNoteOn(startTick, channel, KICK, baseVelocity);
+    midi.addNoteOff(startTick + ticksPerBeat / 2, channel, KICK);
 
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat * 2, channel, KICK,
+    midi.addNoteOn(startTick + ticksPerBeat * 2, channel, KICK,
                    baseVelocity - 10);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat * 2 + ticksPerBeat / 2,
+    midi.addNoteOff(startTick + ticksPerBeat * 2 + ticksPerBeat / 2,
                     channel, KICK);
 
     // Sparse hi-hats
     if (complexity > 0.3f) {
       for (int beat = 0; beat < 4; ++beat) {
-        int vel = baseVelocity - 20 + randomInt(-5, 5);
-        midi.addNoteOn(trackIdx, startTick + beat * ticksPerBeat, channel,
+        int vel = baseVelocity - 20 + randomInt(rng, -5, 5);
+        midi.addNoteOn(startTick + beat * ticksPerBeat, channel,
                        CLOSED_HAT, vel);
-        midi.addNoteOff(trackIdx,
-                        startTick + beat * ticksPerBeat + ticksPerBeat / 4,
+        midi.addNoteOff(startTick + beat * ticksPerBeat + ticksPerBeat / 4,
                         channel, CLOSED_HAT);
       }
     }
@@ -405,65 +383,62 @@ void generateDrumsBar(MidiWriter& midi, int trackIdx, int startTick,
     // Energetic 4-on-floor pattern
     // Kick on every beat
     for (int beat = 0; beat < 4; ++beat) {
-      int vel = baseVelocity + randomInt(-5, 5);
-      midi.addNoteOn(trackIdx, startTick + beat * ticksPerBeat, channel, KICK,
+      int vel = baseVelocity + randomInt(rng, -5, 5);
+      midi.addNoteOn(startTick + beat * ticksPerBeat, channel, KICK,
                      vel);
-      midi.addNoteOff(trackIdx,
-                      startTick + beat * ticksPerBeat + ticksPerBeat / 2,
+      midi.addNoteOff(startTick + beat * ticksPerBeat + ticksPerBeat / 2,
                       channel, KICK);
     }
 
     // Snare on 2 and 4
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat, channel, SNARE,
+    midi.addNoteOn(startTick + ticksPerBeat, channel, SNARE,
                    baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat + ticksPerBeat / 2,
+    midi.addNoteOff(startTick + ticksPerBeat + ticksPerBeat / 2,
                     channel, SNARE);
 
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat * 3, channel, SNARE,
+    midi.addNoteOn(startTick + ticksPerBeat * 3, channel, SNARE,
                    baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat * 3 + ticksPerBeat / 2,
+    midi.addNoteOff(startTick + ticksPerBeat * 3 + ticksPerBeat / 2,
                     channel, SNARE);
 
     // 8th note hi-hats
     for (int i = 0; i < 8; ++i) {
-      int vel = baseVelocity - 10 + randomInt(-5, 5);
+      int vel = baseVelocity - 10 + randomInt(rng, -5, 5);
       int hat = (i % 4 == 3 && complexity > 0.6f) ? OPEN_HAT : CLOSED_HAT;
-      midi.addNoteOn(trackIdx, startTick + i * (ticksPerBeat / 2), channel, hat,
+      midi.addNoteOn(startTick + i * (ticksPerBeat / 2), channel, hat,
                      vel);
-      midi.addNoteOff(trackIdx,
-                      startTick + i * (ticksPerBeat / 2) + ticksPerBeat / 4,
+      midi.addNoteOff(startTick + i * (ticksPerBeat / 2) + ticksPerBeat / 4,
                       channel, hat);
     }
 
   } else {
     // STRAIGHT: Standard rock/pop beat
     // Kick on 1 and 3
-    midi.addNoteOn(trackIdx, startTick, channel, KICK, baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat / 2, channel, KICK);
+    midi.addNoteOn(startTick, channel, KICK, baseVelocity);
+    midi.addNoteOff(startTick + ticksPerBeat / 2, channel, KICK);
 
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat * 2, channel, KICK,
+    midi.addNoteOn(startTick + ticksPerBeat * 2, channel, KICK,
                    baseVelocity - 5);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat * 2 + ticksPerBeat / 2,
+    midi.addNoteOff(startTick + ticksPerBeat * 2 + ticksPerBeat / 2,
                     channel, KICK);
 
     // Snare on 2 and 4
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat, channel, SNARE,
+    midi.addNoteOn(startTick + ticksPerBeat, channel, SNARE,
                    baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat + ticksPerBeat / 2,
+    midi.addNoteOff(startTick + ticksPerBeat + ticksPerBeat / 2,
                     channel, SNARE);
 
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat * 3, channel, SNARE,
+    midi.addNoteOn(startTick + ticksPerBeat * 3, channel, SNARE,
                    baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat * 3 + ticksPerBeat / 2,
+    midi.addNoteOff(startTick + ticksPerBeat * 3 + ticksPerBeat / 2,
                     channel, SNARE);
 
     // Quarter note hi-hats
     for (int beat = 0; beat < 4; ++beat) {
-      int vel = baseVelocity - 15 + randomInt(-5, 5);
-      midi.addNoteOn(trackIdx, startTick + beat * ticksPerBeat, channel,
+      int vel = baseVelocity - 15 + randomInt(rng, -5, 5);
+      midi.addNoteOn(startTick + beat * ticksPerBeat, channel,
                      CLOSED_HAT, vel);
-      midi.addNoteOff(trackIdx,
-                      startTick + beat * ticksPerBeat + ticksPerBeat / 4,
+      midi.addNoteOff(startTick + beat * ticksPerBeat + ticksPerBeat / 4,
                       channel, CLOSED_HAT);
     }
   }
@@ -476,8 +451,8 @@ void generateDrumsBar(MidiWriter& midi, int trackIdx, int startTick,
     
     for (int i = 0; i < 4; ++i) {
       int vel = baseVelocity - 10 + i * 5;  // Crescendo
-      midi.addNoteOn(trackIdx, fillStart + i * sixteenthNote, channel, SNARE, vel);
-      midi.addNoteOff(trackIdx, fillStart + i * sixteenthNote + sixteenthNote / 2, channel, SNARE);
+      midi.addNoteOn(fillStart + i * sixteenthNote, channel, SNARE, vel);
+      midi.addNoteOff(fillStart + i * sixteenthNote + sixteenthNote / 2, channel, SNARE);
     }
     
     // Crash on the downbeat of next section (added by next bar generation)
@@ -485,140 +460,129 @@ void generateDrumsBar(MidiWriter& midi, int trackIdx, int startTick,
 }
 
 // Generate bass line for one bar (Phase 8: Enhanced with EDM-style patterns)
-void generateBassBar(MidiWriter& midi, int trackIdx, int startTick,
+void generateBassBar(MidiWriter::TrackEvents& midi, int startTick,
                      int ticksPerBar, int rootNote, int chordDegree,
-                     const std::vector<int>& scale, int channel, float energy,
+                     const ScaleIntervals& scale, int channel, float energy,
                      float complexity) {
   int ticksPerBeat = ticksPerBar / 4;
   int baseVelocity = 70 + static_cast<int>(energy * 25);
 
   // Bass plays root of current chord, octave down
-  int bassNote = rootNote - 12 + scale[chordDegree % scale.size()];
-  int fifthNote = rootNote - 12 + scale[(chordDegree + 4) % scale.size()];
+  int bassNote = chordTone(scale, rootNote - 12, chordDegree, CHORD_ROOT);
+  int fifthNote = chordTone(scale, rootNote - 12, chordDegree, CHORD_FIFTH);
   int octaveUp = bassNote + 12;
 
   if (energy < 0.3f) {
     // Low energy: simple whole notes or half notes
-    midi.addNoteOn(trackIdx, startTick, channel, bassNote, baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBar - 10, channel, bassNote);
+    midi.addNoteOn(startTick, channel, bassNote, baseVelocity);
+    midi.addNoteOff(startTick + ticksPerBar - 10, channel, bassNote);
   } else if (energy < 0.6f) {
     // Medium energy: root on 1 and 3 with octave variation
-    midi.addNoteOn(trackIdx, startTick, channel, bassNote, baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat * 2 - 10, channel,
+    midi.addNoteOn(startTick, channel, bassNote, baseVelocity);
+    midi.addNoteOff(startTick + ticksPerBeat * 2 - 10, channel,
                     bassNote);
 
     // Octave jump on beat 3
     int note2 = (complexity > 0.4f) ? octaveUp : bassNote;
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat * 2, channel, note2,
+    midi.addNoteOn(startTick + ticksPerBeat * 2, channel, note2,
                    baseVelocity - 5);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBar - 10, channel, note2);
+    midi.addNoteOff(startTick + ticksPerBar - 10, channel, note2);
   } else {
     // High energy: Walking bass with 8th notes (EDM-style)
     // Pattern: root - fifth - octave - fifth (creates movement)
     int eighthNote = ticksPerBeat / 2;
     
     // Beat 1: root
-    midi.addNoteOn(trackIdx, startTick, channel, bassNote, baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + eighthNote - 5, channel, bassNote);
+    midi.addNoteOn(startTick, channel, bassNote, baseVelocity);
+    midi.addNoteOff(startTick + eighthNote - 5, channel, bassNote);
     
     // Beat 1.5: fifth
-    midi.addNoteOn(trackIdx, startTick + eighthNote, channel, fifthNote,
+    midi.addNoteOn(startTick + eighthNote, channel, fifthNote,
                    baseVelocity - 10);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat - 5, channel, fifthNote);
+    midi.addNoteOff(startTick + ticksPerBeat - 5, channel, fifthNote);
     
     // Beat 2: root (accented)
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat, channel, bassNote,
+    midi.addNoteOn(startTick + ticksPerBeat, channel, bassNote,
                    baseVelocity - 5);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat + eighthNote - 5, channel,
+    midi.addNoteOff(startTick + ticksPerBeat + eighthNote - 5, channel,
                     bassNote);
     
     // Beat 3: octave up (creates lift)
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat * 2, channel, octaveUp,
+    midi.addNoteOn(startTick + ticksPerBeat * 2, channel, octaveUp,
                    baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat * 2 + eighthNote - 5,
+    midi.addNoteOff(startTick + ticksPerBeat * 2 + eighthNote - 5,
                     channel, octaveUp);
     
     // Beat 3.5: fifth
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat * 2 + eighthNote, channel,
+    midi.addNoteOn(startTick + ticksPerBeat * 2 + eighthNote, channel,
                    fifthNote, baseVelocity - 10);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBeat * 3 - 5, channel,
+    midi.addNoteOff(startTick + ticksPerBeat * 3 - 5, channel,
                     fifthNote);
     
     // Beat 4: root (leads back to next bar)
-    midi.addNoteOn(trackIdx, startTick + ticksPerBeat * 3, channel, bassNote,
+    midi.addNoteOn(startTick + ticksPerBeat * 3, channel, bassNote,
                    baseVelocity - 5);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBar - 5, channel, bassNote);
+    midi.addNoteOff(startTick + ticksPerBar - 5, channel, bassNote);
   }
 }
 
 // Phase 9: Build extended chord voicings for R&B/Jazz styles
-std::vector<int> buildExtendedChord(int rootNote, int chordDegree,
-                                     const std::vector<int>& scale,
-                                     Genre genre, float complexity) {
-  std::vector<int> chordNotes;
-  
+ChordNotes buildExtendedChord(int rootNote, int chordDegree,
+                              const ScaleIntervals& scale,
+                              Genre genre, float complexity) {
   // Always include root, third, fifth
-  chordNotes.push_back(rootNote + scale[chordDegree % scale.size()]);
-  chordNotes.push_back(rootNote + scale[(chordDegree + 2) % scale.size()]);
-  chordNotes.push_back(rootNote + scale[(chordDegree + 4) % scale.size()]);
-  
+  ChordNotes chordNotes = triadNotes(scale, rootNote, chordDegree, false);
+
   if (genre == Genre::RNB) {
     // R&B: Add 7th and optionally 9th/11th
-    chordNotes.push_back(rootNote + scale[(chordDegree + 6) % scale.size()]);  // 7th
-    
+    chordNotes.add(chordTone(scale, rootNote, chordDegree, CHORD_SEVENTH));
+
     if (complexity > 0.6f) {
       // Add 9th (2nd an octave up)
-      chordNotes.push_back(rootNote + 12 + scale[(chordDegree + 1) % scale.size()]);
+      chordNotes.add(chordTone(scale, rootNote + 12, chordDegree, CHORD_NINTH));
     }
-    
+
     if (complexity > 0.8f) {
       // Add 11th (4th an octave up) for very lush sound
-      chordNotes.push_back(rootNote + 12 + scale[(chordDegree + 3) % scale.size()]);
+      chordNotes.add(chordTone(scale, rootNote + 12, chordDegree, CHORD_ELEVENTH));
     }
   } else {
     // Other genres: Add 7th if complexity is high
     if (complexity > 0.6f) {
-      chordNotes.push_back(rootNote + scale[(chordDegree + 6) % scale.size()]);
+      chordNotes.add(chordTone(scale, rootNote, chordDegree, CHORD_SEVENTH));
     }
   }
-  
+
   return chordNotes;
 }
 
 // Generate chord voicing for one bar (Phase 8: Rhythmic variation based on energy)
-void generateChordBar(MidiWriter& midi, int trackIdx, int startTick,
+void generateChordBar(MidiWriter::TrackEvents& midi, int startTick,
                       int ticksPerBar, int rootNote, int chordDegree,
-                      const std::vector<int>& scale, int channel, float energy,
+                      const ScaleIntervals& scale, int channel, float energy,
                       float complexity) {
   int ticksPerBeat = ticksPerBar / 4;
   int baseVelocity = 60 + static_cast<int>(energy * 20);
 
-  // Build triad: root, third, fifth
-  std::vector<int> chordNotes;
-  chordNotes.push_back(rootNote + scale[chordDegree % scale.size()]);
-  chordNotes.push_back(rootNote + scale[(chordDegree + 2) % scale.size()]);
-  chordNotes.push_back(rootNote + scale[(chordDegree + 4) % scale.size()]);
-  
-  // Add 7th for complexity
-  if (complexity > 0.6f) {
-    chordNotes.push_back(rootNote + scale[(chordDegree + 6) % scale.size()]);
-  }
+  // Build triad: root, third, fifth, plus the 7th for complexity
+  ChordNotes chordNotes =
+      triadNotes(scale, rootNote, chordDegree, complexity > 0.6f);
 
   if (energy < 0.3f) {
     // Intro/break: long sustained chords (2 bars worth of sustain)
     for (int note : chordNotes) {
-      midi.addNoteOn(trackIdx, startTick, channel, note, baseVelocity - 10);
-      midi.addNoteOff(trackIdx, startTick + ticksPerBar - 10, channel, note);
+      midi.addNoteOn(startTick, channel, note, baseVelocity - 10);
+      midi.addNoteOff(startTick + ticksPerBar - 10, channel, note);
     }
   } else if (energy < 0.7f) {
     // Build: half-note chords (on beats 1 and 3)
     for (int note : chordNotes) {
-      midi.addNoteOn(trackIdx, startTick, channel, note, baseVelocity);
-      midi.addNoteOff(trackIdx, startTick + ticksPerBeat * 2 - 10, channel, note);
+      midi.addNoteOn(startTick, channel, note, baseVelocity);
+      midi.addNoteOff(startTick + ticksPerBeat * 2 - 10, channel, note);
 
-      midi.addNoteOn(trackIdx, startTick + ticksPerBeat * 2, channel, note,
+      midi.addNoteOn(startTick + ticksPerBeat * 2, channel, note,
                      baseVelocity - 5);
-      midi.addNoteOff(trackIdx, startTick + ticksPerBar - 10, channel, note);
+      midi.addNoteOff(startTick + ticksPerBar - 10, channel, note);
     }
   } else {
     // Drop: rhythmic quarter-note stabs (EDM-style)
@@ -630,8 +594,8 @@ void generateChordBar(MidiWriter& midi, int trackIdx, int startTick,
     
     for (int stab : stabs) {
       for (int note : chordNotes) {
-        midi.addNoteOn(trackIdx, startTick + stab, channel, note, stabbedVel);
-        midi.addNoteOff(trackIdx, startTick + stab + eighthNote - 10, channel, note);
+        midi.addNoteOn(startTick + stab, channel, note, stabbedVel);
+        midi.addNoteOff(startTick + stab + eighthNote - 10, channel, note);
       }
       stabbedVel -= 3;  // Slight velocity variation
     }
@@ -639,26 +603,31 @@ void generateChordBar(MidiWriter& midi, int trackIdx, int startTick,
 }
 
 // Phase 8: Motif-based lead/hook generator
-void generateMelodyBar(MidiWriter& midi, int trackIdx, int startTick,
-                       int ticksPerBar, int rootNote, int chordDegree,
-                       const std::vector<int>& scale, int channel,
+void generateMelodyBar(MidiWriter::TrackEvents& midi, std::mt19937& rng,
+                       int startTick, int ticksPerBar, int rootNote,
+                       int chordDegree,
+                       const ScaleIntervals& scale, int channel,
                        float moodScore, int& melodicState) {
   int ticksPerBeat = ticksPerBar / 4;
   int baseVelocity = 75 + static_cast<int>(moodScore * 20);
 
   // Create a 4-note motif from scale degrees 0, 2, 4 (root, third, fifth)
   // This creates a memorable, singable hook
-  std::vector<int> motifDegrees;
-  
+  // Happy/bright: ascending motif, up and back down
+  static constexpr int kBrightMotif[] = {0, 2, 4, 5, 4, 2};
+  // Neutral: stepwise with repetition (repetitive hook)
+  static constexpr int kNeutralMotif[] = {0, 2, 2, 4, 4, 2};
+  // Dark/moody: descending or sparse
+  static constexpr int kDarkMotif[] = {4, 2, 0, 2};
+
+  const int* motifDegrees = kDarkMotif;
+  size_t motifLength = std::size(kDarkMotif);
   if (moodScore > 0.6f) {
-    // Happy/bright: ascending motif (0-2-4-5 or similar)
-    motifDegrees = {0, 2, 4, 5, 4, 2};  // Up and back down
+    motifDegrees = kBrightMotif;
+    motifLength = std::size(kBrightMotif);
   } else if (moodScore > 0.4f) {
-    // Neutral: stepwise with repetition
-    motifDegrees = {0, 2, 2, 4, 4, 2};  // Repetitive hook
-  } else {
-    // Dark/moody: descending or sparse
-    motifDegrees = {4, 2, 0, 2};  // Descending
+    motifDegrees = kNeutralMotif;
+    motifLength = std::size(kNeutralMotif);
   }
   
   // Rhythm: use 8th notes for energetic feel, quarter notes for chill
@@ -666,10 +635,9 @@ void generateMelodyBar(MidiWriter& midi, int trackIdx, int startTick,
   int noteDuration = use16ths ? (ticksPerBeat / 4) : (ticksPerBeat / 2);
   
   int tick = startTick;
-  for (size_t i = 0; i < motifDegrees.size() && tick < startTick + ticksPerBar; ++i) {
-    // Calculate note from scale degree relative to chord
-    int degree = (chordDegree + motifDegrees[i]) % scale.size();
-    int note = rootNote + 12 + scale[degree];  // Octave up from root
+  for (size_t i = 0; i < motifLength && tick < startTick + ticksPerBar; ++i) {
+    // Calculate note from scale degree relative to chord, octave up from root
+    int note = chordTone(scale, rootNote + 12, chordDegree, motifDegrees[i]);
     
     // Add slight transposition based on melodic state (creates variation)
     if (melodicState > 3) {
@@ -685,85 +653,76 @@ void generateMelodyBar(MidiWriter& midi, int trackIdx, int startTick,
     int duration = noteDuration;
     int velocity = baseVelocity;
     
-    if (i == 0 || i == motifDegrees.size() - 1) {
+    if (i == 0 || i == motifLength - 1) {
       // Accent first and last notes of motif
       velocity += 10;
       duration = noteDuration * 3 / 2;  // Slightly longer
     }
     
     // Humanization: slight velocity variation
-    velocity += randomInt(-5, 5);
+    velocity += randomInt(rng, -5, 5);
     
-    midi.addNoteOn(trackIdx, tick, channel, note, velocity);
-    midi.addNoteOff(trackIdx, tick + duration - 5, channel, note);
+    midi.addNoteOn(tick, channel, note, velocity);
+    midi.addNoteOff(tick + duration - 5, channel, note);
     
     tick += noteDuration;
   }
   
   // Update melodic state for variation across bars
-  melodicState += randomInt(-1, 2);
+  melodicState += randomInt(rng, -1, 2);
   melodicState = std::max(-3, std::min(4, melodicState));
 }
 
 // Generate pad (sustained chords) for one bar
-void generatePadBar(MidiWriter& midi, int trackIdx, int startTick,
+void generatePadBar(MidiWriter::TrackEvents& midi, int startTick,
                     int ticksPerBar, int rootNote, int chordDegree,
-                    const std::vector<int>& scale, int channel,
+                    const ScaleIntervals& scale, int channel,
                     float moodScore) {
   int baseVelocity = 50 + static_cast<int>(moodScore * 15);
 
   // Pad plays simple sustained chords (root + third or root + fifth)
-  std::vector<int> padNotes;
-  padNotes.push_back(rootNote + scale[chordDegree % scale.size()]);
+  ChordNotes padNotes;
+  padNotes.add(chordTone(scale, rootNote, chordDegree, CHORD_ROOT));
 
   if (moodScore > 0.5f) {
     // Add third for more lush sound
-    padNotes.push_back(rootNote + scale[(chordDegree + 2) % scale.size()]);
+    padNotes.add(chordTone(scale, rootNote, chordDegree, CHORD_THIRD));
   }
 
   for (int note : padNotes) {
-    midi.addNoteOn(trackIdx, startTick, channel, note, baseVelocity);
-    midi.addNoteOff(trackIdx, startTick + ticksPerBar - 10, channel, note);
+    midi.addNoteOn(startTick, channel, note, baseVelocity);
+    midi.addNoteOff(startTick + ticksPerBar - 10, channel, note);
   }
 }
 
-}  // anonymous namespace
-
-void composeSongToMidi(const SongSpec& spec, const std::string& midiPath) {
-  MidiWriter midi(480);  // 480 ticks per quarter note
-  midi.setTempo(spec.tempoBpm);
-  midi.setTimeSignature(4, 4);
-
-  // Calculate timing
-  int ticksPerQuarter = 480;
-  int ticksPerBar = ticksPerQuarter * 4;  // 4/4 time
-
-  // Get scale intervals
-  std::vector<int> scale = getScaleIntervals(spec.scaleType);
-
-  // Phase 9: Get genre-aware chord progression
-  auto progressions = getProgressions(spec.scaleType, spec.genreProfile.genre);
-  auto progression =
-      progressions[0];  // Use first progression (can be randomized)
-
-  // Create tracks with TrackRole enum support
-  std::map<TrackRole, int> trackIndices;
-  std::map<TrackRole, int> channelMap;
+// Independent generator per track: splitmix64 of the song seed and the
+// track's position in the spec, so a track's notes depend only on the seed
+// and never on which thread composed it or how far the others got
+std::mt19937 trackRng(uint32_t songSeed, size_t trackIndex) {
+  uint64_t z = (static_cast<uint64_t>(songSeed) << 32) + trackIndex + 1;
+  z += 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+  std::seed_seq seq{static_cast<uint32_t>(z), static_cast<uint32_t>(z >> 32)};
+  return std::mt19937(seq);
+}
 
-  for (const auto& trackSpec : spec.tracks) {
-    const char* roleName = trackRoleName(trackSpec.role);
-    int trackIdx = midi.addTrack(roleName);
-    trackIndices[trackSpec.role] = trackIdx;
-    channelMap[trackSpec.role] = trackSpec.midiChannel;
+// Compose every bar of one track into its own event list
+void composeTrack(const SongSpec& spec, size_t trackIndex,
+                  const ScaleIntervals& scale,
+                  const ChordProgression& progression, int ticksPerBar,
+                  MidiWriter::TrackEvents& midi) {
+  const TrackSpec& trackSpec = spec.tracks[trackIndex];
+  int channel = trackSpec.midiChannel;
+  std::mt19937 rng = trackRng(spec.seed, trackIndex);
+  midi.reserve(1 + spec.totalBars * eventsPerBarEstimate(trackSpec.role));
 
-    // Add program change at start (except for drums)
-    if (trackSpec.role != TrackRole::DRUMS) {
-      midi.addProgramChange(trackIdx, 0, trackSpec.midiChannel,
-                            trackSpec.program);
-    }
+  // Add program change at start (except for drums)
+  if (trackSpec.role != TrackRole::DRUMS) {
+    midi.addProgramChange(0, channel, trackSpec.program);
   }
 
-  // Compose each section
   int currentTick = 0;
   int melodicState = 2;  // Start on third degree for melody
 
@@ -795,248 +754,176 @@ void composeSongToMidi(const SongSpec& spec, const std::string& midiPath) {
         leadActiveThisBar = (bar >= section.bars / 2) && activity.lead;
       }
 
-      // Generate each track for this bar
-      for (const auto& trackSpec : spec.tracks) {
-        int trackIdx = trackIndices[trackSpec.role];
-        int channel = channelMap[trackSpec.role];
-
-        switch (trackSpec.role) {
-          case TrackRole::DRUMS:
-            // Only generate if active in this section
-            if (activity.drums) {
-              // Phase 9: Use genre-specific drum generator for Rap/House/RnB
-              if (spec.genreProfile.genre == Genre::HOUSE ||
-                  spec.genreProfile.genre == Genre::RAP ||
-                  spec.genreProfile.genre == Genre::RNB) {
-                generateDrumsBarGenre(midi, trackIdx, currentTick, ticksPerBar,
-                                      spec.genreProfile, sectionEnergy, 
-                                      trackSpec.complexity, isLastBarOfSection);
-              } else {
-                // EDM genres use original generator
-                generateDrumsBar(midi, trackIdx, currentTick, ticksPerBar,
-                                 spec.groove, sectionEnergy, trackSpec.complexity,
-                                 isLastBarOfSection);
-              }
-            }
-            break;
-          case TrackRole::BASS:
-            if (activity.bass) {
-              generateBassBar(midi, trackIdx, currentTick, ticksPerBar,
-                              spec.rootMidiNote, chordDegree, scale, channel,
-                              sectionEnergy, trackSpec.complexity);
-            }
-            break;
-          case TrackRole::CHORDS:
-            if (activity.chords) {
-              generateChordBar(midi, trackIdx, currentTick, ticksPerBar,
-                               spec.rootMidiNote, chordDegree, scale, channel,
-                               sectionEnergy, trackSpec.complexity);
-            }
-            break;
-          case TrackRole::LEAD:
-            // Only generate lead if active in this section/bar
-            if (leadActiveThisBar && activity.lead) {
-              generateMelodyBar(midi, trackIdx, currentTick, ticksPerBar,
-                                spec.rootMidiNote, chordDegree, scale, channel,
-                                spec.moodScore, melodicState);
+      switch (trackSpec.role) {
+        case TrackRole::DRUMS:
+          // Only generate if active in this section
+          if (activity.drums) {
+            // Phase 9: Use genre-specific drum generator for Rap/House/RnB
+            if (spec.genreProfile.genre == Genre::HOUSE ||
+                spec.genreProfile.genre == Genre::RAP ||
+                spec.genreProfile.genre == Genre::RNB) {
+              generateDrumsBarGenre(midi, rng, currentTick, ticksPerBar,
+                                    spec.genreProfile, sectionEnergy, 
+                                    trackSpec.complexity, isLastBarOfSection);
+            } else {
+              // EDM genres use original generator
+              generateDrumsBar(midi, rng, currentTick, ticksPerBar,
+                               spec.groove, sectionEnergy, trackSpec.complexity,
+                               isLastBarOfSection);
             }
-            break;
-          case TrackRole::PAD:
-            if (activity.pad) {
-              generatePadBar(midi, trackIdx, currentTick, ticksPerBar,
+          }
+          break;
+        case TrackRole::BASS:
+          if (activity.bass) {
+            generateBassBar(midi, currentTick, ticksPerBar,
+                            spec.rootMidiNote, chordDegree, scale, channel,
+                            sectionEnergy, trackSpec.complexity);
+          }
+          break;
+        case TrackRole::CHORDS:
+          if (activity.chords) {
+            generateChordBar(midi, currentTick, ticksPerBar,
                              spec.rootMidiNote, chordDegree, scale, channel,
-                             spec.moodScore);
-            }
-            break;
-          case TrackRole::FX:
-            // Phase 9: FX triggers for transitions
-            // TODO: Add reverse cymbals, impacts, sweeps at section boundaries
-            break;
-        }
+                             sectionEnergy, trackSpec.complexity);
+          }
+          break;
+        case TrackRole::LEAD:
+          // Only generate lead if active in this section/bar
+          if (leadActiveThisBar && activity.lead) {
+            generateMelodyBar(midi, rng, currentTick, ticksPerBar,
+                              spec.rootMidiNote, chordDegree, scale, channel,
+                              spec.moodScore, melodicState);
+          }
+          break;
+        case TrackRole::PAD:
+          if (activity.pad) {
+            generatePadBar(midi, currentTick, ticksPerBar,
+                           spec.rootMidiNote, chordDegree, scale, channel,
+                           spec.moodScore);
+          }
+          break;
+        case TrackRole::FX:
+          // Phase 9: FX triggers for transitions
+          // TODO: Add reverse cymbals, impacts, sweeps at section boundaries
+          break;
       }
 
       currentTick += ticksPerBar;
     }
   }
+}
+
+}  // anonymous namespace
+
+void warmComposer() {
+  for (Genre genre : {Genre::HOUSE, Genre::RAP, Genre::RNB}) {
+    genreDrumPattern(genre, 0.0f);
+  }
+}
+
+MidiWriter composeSong(const SongSpec& spec,
+                       std::pmr::memory_resource* resource) {
+  MidiWriter midi(480, resource);  // 480 ticks per quarter note
+  midi.setTempo(spec.tempoBpm);
+  midi.setTimeSignature(4, 4);
+
+  // Calculate timing
+  int ticksPerQuarter = 480;
+  int ticksPerBar = ticksPerQuarter * 4;  // 4/4 time
+
+  // Get scale intervals (unknown scale types play Major)
+  const ScaleIntervals& scale = scaleIntervals(spec.scaleType);
+
+  // Phase 9: Get genre-aware chord progression
+  const ProgressionSet& progressions =
+      progressionSet(spec.genreProfile.genre, spec.scaleType);
+  const auto& progression =
+      progressions[0];  // Use first progression (can be randomized)
+
+  // Tracks share nothing while composing (own RNG, own event list), so
+  // compose them in parallel and merge in spec order. Event lists come
+  // from the writer's resource, so merging them moves rather than copies.
+  std::pmr::vector<MidiWriter::TrackEvents> trackEvents(resource);
+  trackEvents.reserve(spec.tracks.size());
+  for (size_t i = 0; i < spec.tracks.size(); ++i) {
+    trackEvents.emplace_back(resource);
+  }
+  sharedWorkerPool().parallelFor(
+      spec.tracks.size(), spec.tracks.size(), [&](size_t i) {
+        composeTrack(spec, i, scale, progression, ticksPerBar, trackEvents[i]);
+      });
+
+  for (size_t i = 0; i < spec.tracks.size(); ++i) {
+    int trackIdx = midi.addTrack(trackRoleName(spec.tracks[i].role));
+    midi.mergeTrack(trackIdx, std::move(trackEvents[i]));
+  }
+
+  return midi;
+}
 
-  // Write MIDI file
+void composeSongToMidi(const SongSpec& spec, const std::string& midiPath) {
+  composeSong(spec).write(midiPath);
+}
+
+std::map<std::string, std::string> composeSongToMidiAndStems(
+    const SongSpec& spec, const std::string& midiPath,
+    const std::string& outputDir) {
+  // One composition, serialized twice from the same encoded tracks
+  MidiWriter midi = composeSong(spec);
   midi.write(midiPath);
+  return midi.writeSeparateStems(outputDir);
 }
 
 // ============================================================================
 // PHASE 8: GENRE-AWARE COMPOSITION
 // ============================================================================
 
-void composeGenreSongToMidi(const SongPlan& plan, const std::string& midiPath) {
+MidiWriter composeGenreSong(const SongPlan& plan,
+                            std::pmr::memory_resource* resource) {
   // For now, convert SongPlan to SongSpec and use existing composer
   // TODO: Later implement full pattern-based composition with automation
-  SongSpec spec = songPlanToSpec(plan);
+  SongSpec spec = songPlanToSpec(plan, resource);
 
   // Add genre information to output
-  std::cout << "[Genre Composition] " << genreTypeName(plan.genre) << std::endl;
-  std::cout << "[Sections] ";
-  for (const auto& sec : plan.sections) {
-    std::cout << sectionTypeName(sec.type);
-    if (sec.hasDrop) std::cout << "*";
-    std::cout << "(" << sec.bars << ") ";
+  if (logger().enabled(LogLevel::DEBUG)) {
+    std::string sections;
+    for (const auto& sec : plan.sections) {
+      if (!sections.empty()) sections += ' ';
+      sections += sectionTypeName(sec.type);
+      if (sec.hasDrop) sections += '*';
+      sections += "(" + std::to_string(sec.bars) + ")";
+    }
+    logDebug("Composer", "genre composition", {{"genre", genreTypeName(plan.genre)},
+                                               {"sections", sections}});
   }
-  std::cout << std::endl;
 
   // Use the existing composition engine
-  composeSongToMidi(spec, midiPath);
+  return composeSong(spec, resource);
 }
 
-std::map<std::string, std::string> composeSongToStems(
-    const SongSpec& spec, const std::string& outputDir) {
-  // Create a MIDI writer
-  MidiWriter midi(480);
-  midi.setTempo(spec.tempoBpm);
-  midi.setTimeSignature(4, 4);
-
-  // Generate composition (reusing logic from composeSongToMidi)
-  std::vector<int> scale = getScaleIntervals(spec.scaleType);
-  int rootNote = spec.rootMidiNote;
-  
-  // Add tracks
-  std::vector<std::string> trackNames;
-  std::vector<int> trackIndices;
-
-  for (const auto& track : spec.tracks) {
-    const char* roleName = trackRoleName(track.role);
-    int trackIdx = midi.addTrack(roleName);
-    trackNames.push_back(roleName);
-    trackIndices.push_back(trackIdx);
-
-    // Set instrument (except for drums)
-    if (track.role != TrackRole::DRUMS) {
-      midi.addProgramChange(trackIdx, 0, track.midiChannel, track.program);
-    }
-  }
-
-  // Generate musical content for each section
-  int currentTick = 0;
-  int ticksPerBeat = 480;
-  int ticksPerBar = ticksPerBeat * 4;
-
-  for (const auto& section : spec.sections) {
-    int sectionTicks = ticksPerBar * section.bars;
-
-    // Generate content for each track
-    for (size_t i = 0; i < spec.tracks.size(); ++i) {
-      const auto& track = spec.tracks[i];
-      int trackIdx = trackIndices[i];
-
-      // Different patterns based on track role
-      switch (track.role) {
-        case TrackRole::DRUMS:
-          // Drum pattern (simplified)
-          for (int bar = 0; bar < section.bars; ++bar) {
-            int barStart = currentTick + bar * ticksPerBar;
-
-            // Kick on beats 1 and 3
-            midi.addNoteOn(trackIdx, barStart, 9, 36, 100);
-            midi.addNoteOff(trackIdx, barStart + ticksPerBeat / 2, 9, 36);
-
-            midi.addNoteOn(trackIdx, barStart + ticksPerBeat * 2, 9, 36, 100);
-            midi.addNoteOff(
-                trackIdx, barStart + ticksPerBeat * 2 + ticksPerBeat / 2, 9, 36);
-
-            // Snare on beats 2 and 4
-            midi.addNoteOn(trackIdx, barStart + ticksPerBeat, 9, 38, 90);
-            midi.addNoteOff(trackIdx, barStart + ticksPerBeat + ticksPerBeat / 2,
-                            9, 38);
-
-            midi.addNoteOn(trackIdx, barStart + ticksPerBeat * 3, 9, 38, 90);
-            midi.addNoteOff(
-                trackIdx, barStart + ticksPerBeat * 3 + ticksPerBeat / 2, 9, 38);
-          }
-          break;
-          
-        case TrackRole::BASS:
-          // Bass line - root note pattern
-          for (int bar = 0; bar < section.bars; ++bar) {
-            int barStart = currentTick + bar * ticksPerBar;
-            int bassNote = rootNote - 12;  // One octave below root
+void composeGenreSongToMidi(const SongPlan& plan, const std::string& midiPath) {
+  MidiWriter::writeBytes(
+      midiPath, sharedCompositionCache().getOrCompose(plan, false)->midi);
+}
 
-            midi.addNoteOn(trackIdx, barStart, track.midiChannel, bassNote, 80);
-            midi.addNoteOff(trackIdx, barStart + ticksPerBeat * 2, track.midiChannel, bassNote);
+std::map<std::string, std::string> composeGenreSongToMidiAndStems(
+    const SongPlan& plan, const std::string& midiPath,
+    const std::string& outputDir) {
+  std::shared_ptr<const CachedComposition> song =
+      sharedCompositionCache().getOrCompose(plan, true);
+  MidiWriter::writeBytes(midiPath, song->midi);
 
-            midi.addNoteOn(trackIdx, barStart + ticksPerBeat * 2, track.midiChannel, bassNote, 80);
-            midi.addNoteOff(trackIdx, barStart + ticksPerBeat * 4, track.midiChannel, bassNote);
-          }
-          break;
-          
-        case TrackRole::CHORDS:
-          // Chord progression
-          {
-            std::vector<ChordProgression> progs = getProgressions(spec.scaleType, spec.genreProfile.genre);
-            const auto& prog = progs[0];
-
-            for (int bar = 0; bar < section.bars; ++bar) {
-              int barStart = currentTick + bar * ticksPerBar;
-              int chordIdx = bar % prog.degrees.size();
-              int degree = prog.degrees[chordIdx];
-              int chordRoot = rootNote + scale[degree];
-
-              // Triad
-              std::vector<int> chord = {chordRoot, chordRoot + scale[2],
-                                        chordRoot + scale[4]};
-
-              for (int note : chord) {
-                midi.addNoteOn(trackIdx, barStart, track.midiChannel, note, 70);
-                midi.addNoteOff(trackIdx, barStart + ticksPerBar, track.midiChannel, note);
-              }
-            }
-          }
-          break;
-          
-        case TrackRole::LEAD:
-          // Melody line
-          {
-            std::mt19937 rng(42);
-            std::uniform_int_distribution<> noteDist(0, scale.size() - 1);
-
-            for (int bar = 0; bar < section.bars; ++bar) {
-              int barStart = currentTick + bar * ticksPerBar;
-
-              for (int beat = 0; beat < 4; ++beat) {
-                int noteStart = barStart + beat * ticksPerBeat;
-                int scaleIdx = noteDist(rng);
-                int note = rootNote + 12 + scale[scaleIdx];  // One octave up
-
-                midi.addNoteOn(trackIdx, noteStart, track.midiChannel, note, 75);
-                midi.addNoteOff(trackIdx, noteStart + ticksPerBeat * 3 / 4, track.midiChannel, note);
-              }
-            }
-          }
-          break;
-          
-        case TrackRole::PAD:
-          // Sustained pad chords
-          for (int bar = 0; bar < section.bars; bar += 2) {
-            int barStart = currentTick + bar * ticksPerBar;
-
-            // Sustained chord
-            std::vector<int> padChord = {rootNote, rootNote + scale[2],
-                                         rootNote + scale[4],
-                                         rootNote + 12 + scale[1]};
-
-            for (int note : padChord) {
-              midi.addNoteOn(trackIdx, barStart, track.midiChannel, note, 60);
-              midi.addNoteOff(trackIdx, barStart + ticksPerBar * 2, track.midiChannel, note);
-            }
-          }
-          break;
-          
-        case TrackRole::FX:
-          // TODO: FX track implementation
-          break;
-      }
-    }
-
-    currentTick += sectionTicks;
+  std::map<std::string, std::string> result;
+  for (const auto& [name, bytes] : song->stems) {
+    std::string filepath = outputDir + "/" + name + ".mid";
+    MidiWriter::writeBytes(filepath, bytes);
+    result[name] = filepath;
   }
+  return result;
+}
 
-  // Write separate stem files
-  return midi.writeSeparateStems(outputDir);
+std::map<std::string, std::string> composeSongToStems(
+    const SongSpec& spec, const std::string& outputDir) {
+  // Same composition as composeSongToMidi, so the stems sum to the mix
+  return composeSong(spec).writeSeparateStems(outputDir);
 }
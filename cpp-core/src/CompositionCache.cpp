@@ -0,0 +1,300 @@
+#include "CompositionCache.hpp"
+
+#include "Composer.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "SongSpec.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <thread>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Bump whenever the composer's output for a given plan changes, so disk
+// entries written by older builds are not served
+static const char* kCompositionFormat = "composition-v1";
+
+// songPlanToSpec() leaves the spec's default humanization seed
+static const uint32_t kPlanSeed = SongSpec().seed;
+
+// FNV-1a, 64-bit, as for the feature cache keys
+static uint64_t fnv1a64(const unsigned char* data, size_t size, uint64_t hash) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static long envLong(const char* key, long def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stol(v);
+    } catch (...) {
+        std::cerr << "[WARN] Invalid " << key << " value, using default " << def << std::endl;
+        return def;
+    }
+}
+
+// Fixed-width little-endian fields, so equal plans give equal bytes
+static void appendInt(std::string& out, int64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+    }
+}
+
+static void appendFloat(std::string& out, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    appendInt(out, bits);
+}
+
+static void appendString(std::string& out, std::string_view value) {
+    appendInt(out, static_cast<int64_t>(value.size()));
+    out += value;
+}
+
+static std::vector<uint8_t> readBytes(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return {};
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+static bool writeBytes(const fs::path& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return static_cast<bool>(out);
+}
+
+size_t CachedComposition::byteSize() const {
+    size_t total = midi.size();
+    for (const auto& [name, bytes] : stems) {
+        total += name.size() + bytes.size();
+    }
+    return total;
+}
+
+CompositionCache::CompositionCache(const Config& config) : config_(config) {
+    if (!config_.diskDir.empty()) {
+        std::error_code ec;
+        fs::create_directories(config_.diskDir, ec);
+        if (ec) {
+            std::cerr << "[WARN] Cannot create composition cache directory " << config_.diskDir
+                      << " (" << ec.message() << "), disk cache disabled" << std::endl;
+            config_.diskDir.clear();
+        }
+    }
+}
+
+CompositionCache::Config CompositionCache::configFromEnv() {
+    Config config;
+    config.maxBytes = static_cast<size_t>(std::max(
+        0L, envLong("SC_COMPOSITION_CACHE_BYTES", static_cast<long>(config.maxBytes))));
+    if (const char* dir = std::getenv("SC_COMPOSITION_CACHE_DIR")) {
+        config.diskDir = dir;
+    }
+    return config;
+}
+
+std::string CompositionCache::planKey(const SongPlan& plan, uint32_t seed) {
+    std::string canonical = kCompositionFormat;
+    appendInt(canonical, seed);
+    appendInt(canonical, static_cast<int64_t>(plan.genre));
+    appendInt(canonical, plan.totalBars);
+    appendInt(canonical, plan.tempoBpm);
+    appendInt(canonical, plan.scaleType);
+    appendInt(canonical, plan.rootNote);
+    appendInt(canonical, static_cast<int64_t>(plan.sections.size()));
+    for (const PlannedSection& section : plan.sections) {
+        appendInt(canonical, static_cast<int64_t>(section.type));
+        appendInt(canonical, section.startBar);
+        appendInt(canonical, section.bars);
+        appendFloat(canonical, section.energy);
+        appendInt(canonical, section.hasDrop);
+        appendInt(canonical, section.filterSweep);
+        appendInt(canonical, section.volumeBuild);
+        appendFloat(canonical, section.dropIntensity);
+    }
+    appendInt(canonical, static_cast<int64_t>(plan.activeInstruments.size()));
+    for (std::string_view role : plan.activeInstruments) {
+        appendString(canonical, role);
+    }
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(canonical.data());
+    uint64_t first = fnv1a64(data, canonical.size(), 0xcbf29ce484222325ULL);
+    uint64_t second = fnv1a64(data, canonical.size(), first ^ 0x9e3779b97f4a7c15ULL);
+
+    char hex[33];
+    std::snprintf(hex, sizeof(hex), "%016llx%016llx",
+                  static_cast<unsigned long long>(first),
+                  static_cast<unsigned long long>(second));
+    return hex;
+}
+
+std::shared_ptr<const CachedComposition> CompositionCache::lookup(const std::string& key,
+                                                                  bool withStems) {
+    if (!enabled()) return nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end() && (!withStems || it->second->value->hasStems)) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            ++stats_.hits;
+            return it->second->value;
+        }
+    }
+
+    // Disk I/O happens outside the lock
+    if (!config_.diskDir.empty()) {
+        if (auto fromDisk = loadFromDisk(key, withStems)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            insertLocked(key, fromDisk);
+            ++stats_.hits;
+            ++stats_.diskHits;
+            return fromDisk;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.misses;
+    return nullptr;
+}
+
+void CompositionCache::store(const std::string& key, std::shared_ptr<const CachedComposition> value) {
+    if (!enabled()) return;
+    if (!config_.diskDir.empty()) {
+        saveToDisk(key, *value);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    insertLocked(key, std::move(value));
+}
+
+std::shared_ptr<const CachedComposition> CompositionCache::getOrCompose(
+    const SongPlan& plan, bool withStems, std::pmr::memory_resource* resource) {
+    std::string key;
+    if (enabled()) {
+        key = planKey(plan, kPlanSeed);
+        if (auto hit = lookup(key, withStems)) {
+            logDebug("Generate", "composition cache hit", {{"key", key}});
+            return hit;
+        }
+    }
+
+    auto composed = std::make_shared<CachedComposition>();
+    {
+        StageTimer timer(Stage::COMPOSE);
+        MidiWriter midi = composeGenreSong(plan, resource);
+        composed->midi = midi.toBytes();
+        if (withStems) {
+            composed->stems = midi.separateStemBytes();
+            composed->hasStems = true;
+        }
+    }
+    if (enabled()) store(key, composed);
+    return composed;
+}
+
+CompositionCache::Stats CompositionCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s = stats_;
+    s.entries = index_.size();
+    s.bytes = bytes_;
+    return s;
+}
+
+void CompositionCache::insertLocked(const std::string& key,
+                                    std::shared_ptr<const CachedComposition> value) {
+    size_t size = value->byteSize() + key.size();
+    if (size > config_.maxBytes) return;  // would evict everything else
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        // Replaced by the same song with stems added
+        bytes_ -= it->second->value->byteSize() + key.size();
+        it->second->value = std::move(value);
+        lru_.splice(lru_.begin(), lru_, it->second);
+    } else {
+        lru_.push_front(Entry{key, std::move(value)});
+        index_[key] = lru_.begin();
+    }
+    bytes_ += size;
+
+    while (bytes_ > config_.maxBytes) {
+        const Entry& oldest = lru_.back();
+        bytes_ -= oldest.value->byteSize() + oldest.key.size();
+        index_.erase(oldest.key);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+std::shared_ptr<const CachedComposition> CompositionCache::loadFromDisk(const std::string& key,
+                                                                        bool withStems) const {
+    fs::path base = fs::path(config_.diskDir) / key;
+    auto loaded = std::make_shared<CachedComposition>();
+    loaded->midi = readBytes(fs::path(base) += ".mid");
+    if (loaded->midi.empty()) return nullptr;
+
+    fs::path stemsDir = fs::path(base) += ".stems";
+    std::error_code ec;
+    if (fs::is_directory(stemsDir, ec)) {
+        for (const auto& file : fs::directory_iterator(stemsDir, ec)) {
+            if (file.path().extension() != ".mid") continue;
+            std::vector<uint8_t> bytes = readBytes(file.path());
+            if (bytes.empty()) return nullptr;
+            loaded->stems[file.path().stem().string()] = std::move(bytes);
+        }
+        loaded->hasStems = !ec;
+    }
+    if (withStems && !loaded->hasStems) return nullptr;
+    return loaded;
+}
+
+void CompositionCache::saveToDisk(const std::string& key, const CachedComposition& value) const {
+    // Write then rename so other workers never see a partial entry
+    fs::path base = fs::path(config_.diskDir) / key;
+    // Thread ids repeat across forked workers, so the pid goes in too
+    std::string suffix = ".tmp" + std::to_string(getpid()) + "-" +
+                         std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::error_code ec;
+
+    if (value.hasStems) {
+        fs::path stemsDir = fs::path(base) += ".stems";
+        fs::path tmpDir = fs::path(stemsDir) += suffix;
+        fs::create_directories(tmpDir, ec);
+        bool written = !ec;
+        for (const auto& [name, bytes] : value.stems) {
+            written = written && writeBytes(tmpDir / (name + ".mid"), bytes);
+        }
+        // Fails harmlessly if another worker got there first
+        if (written) fs::rename(tmpDir, stemsDir, ec);
+        if (!written || ec) fs::remove_all(tmpDir, ec);
+    }
+
+    fs::path path = fs::path(base) += ".mid";
+    fs::path tmp = fs::path(path) += suffix;
+    if (!writeBytes(tmp, value.midi)) {
+        fs::remove(tmp, ec);
+        return;
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) fs::remove(tmp, ec);
+}
+
+CompositionCache& sharedCompositionCache() {
+    static CompositionCache cache(CompositionCache::configFromEnv());
+    return cache;
+}
@@ -0,0 +1,225 @@
+#include "DenseKernels.hpp"
+#include "SimdDispatch.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SC_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SC_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// NOTE: built with -ffp-contract=off (see CMakeLists.txt), like SynthKernels.cpp
+
+namespace {
+
+// --- Scalar reference paths, outputs [begin, outputs) of one row ---
+
+void denseRowScalar(const float* x, std::size_t inputs, const float* w, const float* bias,
+                    std::size_t outputs, bool relu, float* y, std::size_t begin) {
+    for (std::size_t j = begin; j < outputs; ++j) {
+        float acc = 0.0f;
+        for (std::size_t i = 0; i < inputs; ++i) {
+            acc = acc + x[i] * w[i * outputs + j];
+        }
+        float v = acc + bias[j];
+        y[j] = relu ? (v > 0.0f ? v : 0.0f) : v;
+    }
+}
+
+void denseRowInt8Scalar(const float* x, std::size_t inputs, const int8_t* w, const float* scales,
+                        const float* bias, std::size_t outputs, bool relu, float* y,
+                        std::size_t begin) {
+    for (std::size_t j = begin; j < outputs; ++j) {
+        float acc = 0.0f;
+        for (std::size_t i = 0; i < inputs; ++i) {
+            acc = acc + x[i] * static_cast<float>(w[i * outputs + j]);
+        }
+        float v = acc * scales[j] + bias[j];
+        y[j] = relu ? (v > 0.0f ? v : 0.0f) : v;
+    }
+}
+
+// --- x86: SSE2 (baseline) and AVX2 ---
+
+#if defined(SC_SIMD_X86)
+
+// Four int8 weights sign-extended to floats
+inline __m128 loadInt8x4Sse2(const int8_t* p) {
+    int32_t raw;
+    std::memcpy(&raw, p, sizeof(raw));
+    __m128i b = _mm_cvtsi32_si128(raw);
+    __m128i w = _mm_unpacklo_epi8(b, b);
+    __m128i d = _mm_unpacklo_epi16(w, w);  // each byte in all four bytes of its lane
+    return _mm_cvtepi32_ps(_mm_srai_epi32(d, 24));
+}
+
+void denseRowSse2(const float* x, std::size_t inputs, const float* w, const float* bias,
+                  std::size_t outputs, bool relu, float* y) {
+    const __m128 zero = _mm_setzero_ps();
+    std::size_t j = 0;
+    for (; j + 4 <= outputs; j += 4) {
+        __m128 acc = zero;
+        for (std::size_t i = 0; i < inputs; ++i) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(x[i]), _mm_loadu_ps(w + i * outputs + j)));
+        }
+        __m128 v = _mm_add_ps(acc, _mm_loadu_ps(bias + j));
+        _mm_storeu_ps(y + j, relu ? _mm_max_ps(v, zero) : v);
+    }
+    denseRowScalar(x, inputs, w, bias, outputs, relu, y, j);
+}
+
+void denseRowInt8Sse2(const float* x, std::size_t inputs, const int8_t* w, const float* scales,
+                      const float* bias, std::size_t outputs, bool relu, float* y) {
+    const __m128 zero = _mm_setzero_ps();
+    std::size_t j = 0;
+    for (; j + 4 <= outputs; j += 4) {
+        __m128 acc = zero;
+        for (std::size_t i = 0; i < inputs; ++i) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(x[i]), loadInt8x4Sse2(w + i * outputs + j)));
+        }
+        __m128 v = _mm_add_ps(_mm_mul_ps(acc, _mm_loadu_ps(scales + j)), _mm_loadu_ps(bias + j));
+        _mm_storeu_ps(y + j, relu ? _mm_max_ps(v, zero) : v);
+    }
+    denseRowInt8Scalar(x, inputs, w, scales, bias, outputs, relu, y, j);
+}
+
+__attribute__((target("avx2")))
+void denseRowAvx2(const float* x, std::size_t inputs, const float* w, const float* bias,
+                  std::size_t outputs, bool relu, float* y) {
+    const __m256 zero = _mm256_setzero_ps();
+    std::size_t j = 0;
+    for (; j + 8 <= outputs; j += 8) {
+        __m256 acc = zero;
+        for (std::size_t i = 0; i < inputs; ++i) {
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(x[i]),
+                                                   _mm256_loadu_ps(w + i * outputs + j)));
+        }
+        __m256 v = _mm256_add_ps(acc, _mm256_loadu_ps(bias + j));
+        _mm256_storeu_ps(y + j, relu ? _mm256_max_ps(v, zero) : v);
+    }
+    denseRowScalar(x, inputs, w, bias, outputs, relu, y, j);
+}
+
+__attribute__((target("avx2")))
+void denseRowInt8Avx2(const float* x, std::size_t inputs, const int8_t* w, const float* scales,
+                      const float* bias, std::size_t outputs, bool relu, float* y) {
+    const __m256 zero = _mm256_setzero_ps();
+    std::size_t j = 0;
+    for (; j + 8 <= outputs; j += 8) {
+        __m256 acc = zero;
+        for (std::size_t i = 0; i < inputs; ++i) {
+            __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + i * outputs + j));
+            __m256 wv = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(x[i]), wv));
+        }
+        __m256 v = _mm256_add_ps(_mm256_mul_ps(acc, _mm256_loadu_ps(scales + j)),
+                                 _mm256_loadu_ps(bias + j));
+        _mm256_storeu_ps(y + j, relu ? _mm256_max_ps(v, zero) : v);
+    }
+    denseRowInt8Scalar(x, inputs, w, scales, bias, outputs, relu, y, j);
+}
+
+#endif  // SC_SIMD_X86
+
+// --- aarch64: NEON ---
+
+#if defined(SC_SIMD_NEON)
+
+void denseRowNeon(const float* x, std::size_t inputs, const float* w, const float* bias,
+                  std::size_t outputs, bool relu, float* y) {
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    std::size_t j = 0;
+    for (; j + 4 <= outputs; j += 4) {
+        float32x4_t acc = zero;
+        for (std::size_t i = 0; i < inputs; ++i) {
+            acc = vaddq_f32(acc, vmulq_f32(vdupq_n_f32(x[i]), vld1q_f32(w + i * outputs + j)));
+        }
+        float32x4_t v = vaddq_f32(acc, vld1q_f32(bias + j));
+        vst1q_f32(y + j, relu ? vmaxq_f32(v, zero) : v);
+    }
+    denseRowScalar(x, inputs, w, bias, outputs, relu, y, j);
+}
+
+void denseRowInt8Neon(const float* x, std::size_t inputs, const int8_t* w, const float* scales,
+                      const float* bias, std::size_t outputs, bool relu, float* y) {
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    std::size_t j = 0;
+    for (; j + 8 <= outputs; j += 8) {
+        float32x4_t lo = zero;
+        float32x4_t hi = zero;
+        for (std::size_t i = 0; i < inputs; ++i) {
+            int16x8_t wide = vmovl_s8(vld1_s8(w + i * outputs + j));
+            float32x4_t xv = vdupq_n_f32(x[i]);
+            lo = vaddq_f32(lo, vmulq_f32(xv, vcvtq_f32_s32(vmovl_s16(vget_low_s16(wide)))));
+            hi = vaddq_f32(hi, vmulq_f32(xv, vcvtq_f32_s32(vmovl_high_s16(wide))));
+        }
+        float32x4_t vlo = vaddq_f32(vmulq_f32(lo, vld1q_f32(scales + j)), vld1q_f32(bias + j));
+        float32x4_t vhi = vaddq_f32(vmulq_f32(hi, vld1q_f32(scales + j + 4)), vld1q_f32(bias + j + 4));
+        vst1q_f32(y + j, relu ? vmaxq_f32(vlo, zero) : vlo);
+        vst1q_f32(y + j + 4, relu ? vmaxq_f32(vhi, zero) : vhi);
+    }
+    denseRowInt8Scalar(x, inputs, w, scales, bias, outputs, relu, y, j);
+}
+
+#endif  // SC_SIMD_NEON
+
+}  // namespace
+
+void denseLayer(const float* in, std::size_t rows, std::size_t inputs,
+                const float* weights, const float* bias, std::size_t outputs,
+                bool relu, float* out) {
+    SimdLevel level = activeSimdLevel();
+    for (std::size_t r = 0; r < rows; ++r) {
+        const float* x = in + r * inputs;
+        float* y = out + r * outputs;
+        switch (level) {
+#if defined(SC_SIMD_X86)
+            case SimdLevel::AVX2:
+                denseRowAvx2(x, inputs, weights, bias, outputs, relu, y);
+                break;
+            case SimdLevel::SSE2:
+                denseRowSse2(x, inputs, weights, bias, outputs, relu, y);
+                break;
+#endif
+#if defined(SC_SIMD_NEON)
+            case SimdLevel::NEON:
+                denseRowNeon(x, inputs, weights, bias, outputs, relu, y);
+                break;
+#endif
+            default:
+                denseRowScalar(x, inputs, weights, bias, outputs, relu, y, 0);
+                break;
+        }
+    }
+}
+
+void denseLayerInt8(const float* in, std::size_t rows, std::size_t inputs,
+                    const int8_t* weights, const float* scales, const float* bias,
+                    std::size_t outputs, bool relu, float* out) {
+    SimdLevel level = activeSimdLevel();
+    for (std::size_t r = 0; r < rows; ++r) {
+        const float* x = in + r * inputs;
+        float* y = out + r * outputs;
+        switch (level) {
+#if defined(SC_SIMD_X86)
+            case SimdLevel::AVX2:
+                denseRowInt8Avx2(x, inputs, weights, scales, bias, outputs, relu, y);
+                break;
+            case SimdLevel::SSE2:
+                denseRowInt8Sse2(x, inputs, weights, scales, bias, outputs, relu, y);
+                break;
+#endif
+#if defined(SC_SIMD_NEON)
+            case SimdLevel::NEON:
+                denseRowInt8Neon(x, inputs, weights, scales, bias, outputs, relu, y);
+                break;
+#endif
+            default:
+                denseRowInt8Scalar(x, inputs, weights, scales, bias, outputs, relu, y, 0);
+                break;
+        }
+    }
+}
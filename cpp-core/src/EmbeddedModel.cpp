@@ -0,0 +1,177 @@
+#include "EmbeddedModel.hpp"
+
+#include "DenseKernels.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Rows evaluated together; bounds the scratch buffers for large batches
+static const size_t kRowChunk = 64;
+
+namespace {
+
+// Bounds-checked reads from the mapped file
+class Reader {
+public:
+    Reader(const unsigned char* data, size_t size, const std::string& path)
+        : data_(data), size_(size), path_(path) {}
+
+    template <typename T>
+    const T* take(size_t count) {
+        size_t bytes = count * sizeof(T);
+        if (count > size_ / sizeof(T) || bytes > size_ - offset_) {
+            fail("truncated");
+        }
+        const T* p = reinterpret_cast<const T*>(data_ + offset_);
+        offset_ += bytes;
+        return p;
+    }
+
+    uint32_t u32() { return *take<uint32_t>(1); }
+
+    void align4() {
+        size_t padded = (offset_ + 3) & ~size_t(3);
+        if (padded > size_) fail("truncated");
+        offset_ = padded;
+    }
+
+    size_t remaining() const { return size_ - offset_; }
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error("Invalid embedded model " + path_ + ": " + what);
+    }
+
+private:
+    const unsigned char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+    const std::string& path_;
+};
+
+}  // namespace
+
+EmbeddedModel::EmbeddedModel(const std::string& path) : path_(path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open embedded model: " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to read embedded model: " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    map_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        throw std::runtime_error("Failed to map embedded model: " + path);
+    }
+
+    // The mapping is released by the destructor only once construction
+    // succeeds, so validation failures unmap here
+    try {
+        Reader reader(static_cast<const unsigned char*>(map_), size_, path_);
+        const char* magic = reader.take<char>(4);
+        if (std::memcmp(magic, "SCNN", 4) != 0) reader.fail("bad magic");
+        if (reader.u32() != kVersion) reader.fail("unsupported version");
+        inputs_ = reader.u32();
+        outputs_ = reader.u32();
+        uint32_t layerCount = reader.u32();
+        reader.u32();  // reserved
+        if (inputs_ == 0 || outputs_ == 0 || layerCount == 0) reader.fail("empty network");
+
+        inputMean_ = reader.take<float>(inputs_);
+        inputScale_ = reader.take<float>(inputs_);
+        outputMean_ = reader.take<float>(outputs_);
+        outputScale_ = reader.take<float>(outputs_);
+
+        size_t width = inputs_;
+        layers_.reserve(layerCount);
+        for (uint32_t l = 0; l < layerCount; ++l) {
+            Layer layer{};
+            layer.inputs = reader.u32();
+            layer.outputs = reader.u32();
+            uint32_t activation = reader.u32();
+            uint32_t dtype = reader.u32();
+            if (layer.inputs != width) reader.fail("layer " + std::to_string(l) + " input size mismatch");
+            if (layer.outputs == 0) reader.fail("layer " + std::to_string(l) + " has no outputs");
+            if (activation > 1) reader.fail("unknown activation");
+            layer.relu = activation == 1;
+
+            size_t count = layer.inputs * layer.outputs;
+            if (count / layer.outputs != layer.inputs) reader.fail("layer too large");
+            if (dtype == 0) {
+                layer.weights = reader.take<float>(count);
+            } else if (dtype == 1) {
+                layer.scales = reader.take<float>(layer.outputs);
+                layer.weightsInt8 = reader.take<int8_t>(count);
+                reader.align4();
+            } else {
+                reader.fail("unknown dtype");
+            }
+            layer.bias = reader.take<float>(layer.outputs);
+
+            width = layer.outputs;
+            maxWidth_ = std::max(maxWidth_, width);
+            layers_.push_back(layer);
+        }
+        if (width != outputs_) reader.fail("last layer doesn't match the output size");
+        if (reader.remaining() != 0) reader.fail("trailing bytes");
+        maxWidth_ = std::max(maxWidth_, inputs_);
+    } catch (...) {
+        ::munmap(map_, size_);
+        map_ = nullptr;
+        throw;
+    }
+}
+
+EmbeddedModel::~EmbeddedModel() {
+    if (map_) ::munmap(map_, size_);
+}
+
+bool EmbeddedModel::quantized() const {
+    return std::any_of(layers_.begin(), layers_.end(),
+                       [](const Layer& l) { return l.weightsInt8 != nullptr; });
+}
+
+void EmbeddedModel::evaluate(const float* in, size_t rows, float* out) const {
+    std::vector<float> a(std::min(rows, kRowChunk) * maxWidth_);
+    std::vector<float> b(a.size());
+
+    for (size_t begin = 0; begin < rows; begin += kRowChunk) {
+        size_t n = std::min(kRowChunk, rows - begin);
+        const float* x = in + begin * inputs_;
+        for (size_t r = 0; r < n; ++r) {
+            for (size_t i = 0; i < inputs_; ++i) {
+                a[r * inputs_ + i] = (x[r * inputs_ + i] - inputMean_[i]) * inputScale_[i];
+            }
+        }
+
+        float* cur = a.data();
+        float* next = b.data();
+        for (const Layer& layer : layers_) {
+            if (layer.weightsInt8) {
+                denseLayerInt8(cur, n, layer.inputs, layer.weightsInt8, layer.scales, layer.bias,
+                               layer.outputs, layer.relu, next);
+            } else {
+                denseLayer(cur, n, layer.inputs, layer.weights, layer.bias, layer.outputs,
+                           layer.relu, next);
+            }
+            std::swap(cur, next);
+        }
+
+        float* y = out + begin * outputs_;
+        for (size_t r = 0; r < n; ++r) {
+            for (size_t j = 0; j < outputs_; ++j) {
+                y[r * outputs_ + j] = cur[r * outputs_ + j] * outputScale_[j] + outputMean_[j];
+            }
+        }
+    }
+}
@@ -0,0 +1,232 @@
+#include "FeatureCache.hpp"
+
+#include "json.hpp"
+
+#include "Log.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+// Part of every key. Bump whenever the meaning of a stored analysis
+// changes, so disk entries written by older builds are not served.
+// v2: "model" entries are never a heuristic stand-in for TF Serving.
+static const char* kAnalysisFormat = "analysis-v2";
+
+// FNV-1a, 64-bit. Not cryptographic: fine for de-duplicating uploads, not
+// for untrusted inputs that try to collide on purpose.
+static uint64_t fnv1a64(const unsigned char* data, size_t size, uint64_t hash) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static long envLong(const char* key, long def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stol(v);
+    } catch (...) {
+        std::cerr << "[WARN] Invalid " << key << " value, using default " << def << std::endl;
+        return def;
+    }
+}
+
+FeatureCache::FeatureCache(const Config& config) : config_(config) {
+    if (!config_.diskDir.empty()) {
+        std::error_code ec;
+        fs::create_directories(config_.diskDir, ec);
+        if (ec) {
+            std::cerr << "[WARN] Cannot create cache directory " << config_.diskDir
+                      << " (" << ec.message() << "), disk cache disabled" << std::endl;
+            config_.diskDir.clear();
+        }
+    }
+}
+
+FeatureCache::Config FeatureCache::configFromEnv() {
+    Config config;
+    config.maxEntries = static_cast<size_t>(std::max(0L, envLong("SC_CACHE_ENTRIES", 1024)));
+    config.ttl = std::chrono::seconds(std::max(0L, envLong("SC_CACHE_TTL_SECONDS", 3600)));
+    if (const char* dir = std::getenv("SC_CACHE_DIR")) {
+        config.diskDir = dir;
+    }
+    return config;
+}
+
+std::string FeatureCache::contentKey(const void* data, size_t size, const std::string& variant) {
+    const uint64_t offsetBasis = 0xcbf29ce484222325ULL;
+    uint64_t content = fnv1a64(static_cast<const unsigned char*>(data), size, offsetBasis);
+
+    // Second half: variant and length, seeded by the content hash
+    std::string tail = variant + "#" + std::to_string(size);
+    uint64_t qualified = fnv1a64(reinterpret_cast<const unsigned char*>(tail.data()),
+                                 tail.size(), content ^ 0x9e3779b97f4a7c15ULL);
+
+    char hex[33];
+    std::snprintf(hex, sizeof(hex), "%016llx%016llx",
+                  static_cast<unsigned long long>(content),
+                  static_cast<unsigned long long>(qualified));
+    return hex;
+}
+
+std::string FeatureCache::variantFor(const std::string& mode, const FeatureOptions& options) {
+    std::string variant = std::string(kAnalysisFormat) + ":" + mode;
+    if (options.fast) {
+        variant += ":fast" + std::to_string(options.pixelBudget);
+    }
+    return variant;
+}
+
+bool FeatureCache::lookup(const std::string& key, CachedAnalysis& out) {
+    if (!enabled()) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            if (Clock::now() < it->second->expires) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                out = it->second->value;
+                ++stats_.hits;
+                return true;
+            }
+            lru_.erase(it->second);
+            index_.erase(it);
+            ++stats_.evictions;
+        }
+    }
+
+    // Disk I/O happens outside the lock
+    CachedAnalysis fromDisk;
+    std::chrono::seconds age{0};
+    if (!config_.diskDir.empty() && loadFromDisk(key, fromDisk, age) && age < config_.ttl) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        insertLocked(key, fromDisk, Clock::now() + (config_.ttl - age));
+        ++stats_.hits;
+        ++stats_.diskHits;
+        out = fromDisk;
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.misses;
+    return false;
+}
+
+void FeatureCache::store(const std::string& key, const CachedAnalysis& value) {
+    if (!enabled()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        insertLocked(key, value, Clock::now() + config_.ttl);
+    }
+    if (!config_.diskDir.empty()) {
+        saveToDisk(key, value);
+    }
+}
+
+FeatureCache::Stats FeatureCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s = stats_;
+    s.entries = index_.size();
+    return s;
+}
+
+void FeatureCache::insertLocked(const std::string& key, const CachedAnalysis& value,
+                                Clock::time_point expires) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->value = value;
+        it->second->expires = expires;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+
+    lru_.push_front(Entry{key, value, expires});
+    index_[key] = lru_.begin();
+
+    while (index_.size() > config_.maxEntries) {
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+bool FeatureCache::loadFromDisk(const std::string& key, CachedAnalysis& out,
+                                std::chrono::seconds& age) const {
+    fs::path path = fs::path(config_.diskDir) / (key + ".json");
+    std::error_code ec;
+    auto mtime = fs::last_write_time(path, ec);
+    if (ec) return false;
+    age = std::chrono::duration_cast<std::chrono::seconds>(
+        fs::file_time_type::clock::now() - mtime);
+
+    std::ifstream in(path);
+    if (!in) return false;
+    try {
+        json j = json::parse(in);
+        const json& f = j.at("features");
+        out.features = ImageFeatures{
+            f.at(0).get<float>(), f.at(1).get<float>(), f.at(2).get<float>(),
+            f.at(3).get<float>(), f.at(4).get<float>(), f.at(5).get<float>(),
+            f.at(6).get<float>(), f.at(7).get<float>(), f.at(8).get<float>()
+        };
+        const json& p = j.at("params");
+        out.params.tempoBpm      = p.at("tempoBpm").get<float>();
+        out.params.baseFrequency = p.at("baseFrequency").get<float>();
+        out.params.energy        = p.at("energy").get<float>();
+        out.params.brightness    = p.at("brightness").get<float>();
+        out.params.reverb        = p.at("reverb").get<float>();
+        out.params.scaleType     = p.at("scaleType").get<int>();
+        out.params.patternType   = p.at("patternType").get<int>();
+        return true;
+    } catch (const std::exception& ex) {
+        logWarn("FeatureCache", "ignoring corrupt cache file", {{"path", path.string()}, {"error", ex.what()}});
+        return false;
+    }
+}
+
+void FeatureCache::saveToDisk(const std::string& key, const CachedAnalysis& value) const {
+    const ImageFeatures& f = value.features;
+    const MusicParameters& p = value.params;
+    json j;
+    j["features"] = {f.avgR, f.avgG, f.avgB, f.brightness, f.hue,
+                     f.saturation, f.colorfulness, f.contrast, f.warmth};
+    j["params"] = {
+        {"tempoBpm",      p.tempoBpm},
+        {"baseFrequency", p.baseFrequency},
+        {"energy",        p.energy},
+        {"brightness",    p.brightness},
+        {"reverb",        p.reverb},
+        {"scaleType",     p.scaleType},
+        {"patternType",   p.patternType}
+    };
+
+    // Write then rename so concurrent readers never see a partial file. The
+    // tmp name is unique per process and thread: workers share the directory.
+    fs::path path = fs::path(config_.diskDir) / (key + ".json");
+    fs::path tmp = path;
+    tmp += ".tmp" + std::to_string(getpid()) + "-" +
+           std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return;
+        out << j.dump();
+        if (!out) return;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) fs::remove(tmp, ec);
+}
@@ -0,0 +1,318 @@
+#include "Generation.hpp"
+
+#include "Composer.hpp"
+#include "CompositionCache.hpp"
+#include "GenreTemplate.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "MusicMapping.hpp"
+#include "RequestArena.hpp"
+#include "SectionPlanner.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+std::string readImageFile(const std::string& path) {
+    StageTimer timer(Stage::IMAGE_LOAD);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Failed to load image: " + path);
+    }
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+FeatureOptions featureOptionsFromJson(const json& body, FeatureOptions defaults) {
+    FeatureOptions options = defaults;
+    if (body.contains("fast_features") && body["fast_features"].is_boolean()) {
+        options.fast = body["fast_features"].get<bool>();
+    }
+    if (body.contains("pixel_budget") && body["pixel_budget"].is_number_unsigned()) {
+        options.pixelBudget = body["pixel_budget"].get<size_t>();
+    }
+    return options;
+}
+
+namespace {
+
+struct PlannedSong {
+    GenreType genre;
+    SongPlan plan;
+};
+
+// Genre selection and song planning for one analysed image; the plan is
+// allocated from the request's arena
+PlannedSong planAnalysis(const CachedAnalysis& analysis, std::pmr::memory_resource* arena) {
+    StageTimer timer(Stage::PLAN);
+    const ImageFeatures& features = analysis.features;
+    const MusicParameters& params = analysis.params;
+
+    // Phase 12 A2.2: Select genre from image
+    GenreType decidedGenre = selectGenreFromImage(features, params.energy);
+    const GenreTemplate& genreTemplate = getGenreTemplate(decidedGenre);
+
+    logDebug("Generate", "selected genre", {{"genre", genreTypeName(decidedGenre)},
+                                            {"min_bpm", genreTemplate.minTempo},
+                                            {"max_bpm", genreTemplate.maxTempo}});
+
+    // Plan song structure
+    return {decidedGenre, planSong(features, params, genreTemplate, arena)};
+}
+
+// The response fields that don't depend on where the MIDI went
+json describeSong(const CachedAnalysis& analysis, const PlannedSong& song) {
+    const MusicParameters& params = analysis.params;
+
+    // Scale type string
+    const char* scaleNames[] = {"Major", "Minor", "Dorian", "Lydian"};
+    const char* scaleTypeStr = (params.scaleType >= 0 && params.scaleType <= 3)
+                                ? scaleNames[params.scaleType]
+                                : "Unknown";
+
+    // Build JSON response with new 7-dim parameters + decided genre
+    json resp;
+    resp["decided_genre"] = genreTypeName(song.genre);  // Phase 12 A2.2: Return decided genre!
+    resp["tempo_bpm"] = song.plan.tempoBpm;
+    resp["scale_type"] = scaleTypeStr;
+    resp["params"] = {
+        {"tempoBpm",      params.tempoBpm},
+        {"baseFrequency", params.baseFrequency},
+        {"energy",        params.energy},
+        {"brightness",    params.brightness},
+        {"reverb",        params.reverb},
+        {"scaleType",     params.scaleType},
+        {"patternType",   params.patternType}
+    };
+    return resp;
+}
+
+}  // namespace
+
+// "w<index>_" in prefork workers, which share the output directory
+static const std::string& workerTag() {
+    static const std::string tag = [] {
+        const char* worker = std::getenv("SC_SERVE_WORKER");
+        return worker ? "w" + std::string(worker) + "_" : std::string();
+    }();
+    return tag;
+}
+
+json composeAnalysis(const CachedAnalysis& analysis, const std::string& outputDir) {
+    static std::atomic<unsigned long> sequence{0};
+
+    // Output filename
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    std::string stem = std::to_string(millis) + "_" + workerTag() + std::to_string(sequence++);
+    fs::path outPath = fs::path(outputDir) / ("sound_" + stem + ".wav");
+
+    // Plan, spec and composer temporaries for this request, released together
+    RequestArena arena;
+    PlannedSong song = planAnalysis(analysis, &arena);
+
+    // Generate MIDI file
+    fs::path midiPath = fs::path(outputDir) / ("composition_" + stem + ".mid");
+
+    logDebug("Generate", "composing MIDI", {{"path", midiPath.string()}});
+    std::shared_ptr<const CachedComposition> composition =
+        sharedCompositionCache().getOrCompose(song.plan, false, &arena);
+    {
+        StageTimer timer(Stage::MIDI_WRITE);
+        MidiWriter::writeBytes(midiPath.string(), composition->midi);
+    }
+    metrics().add(Counter::BYTES_WRITTEN, composition->midi.size());
+
+    json resp = describeSong(analysis, song);
+    resp["midi_path"] = midiPath.string();  // Phase 12: Return MIDI path instead of WAV
+    resp["audio_path"] = outPath.string();  // Keep for backward compatibility
+    return resp;
+}
+
+json composeAnalysisToMemory(const CachedAnalysis& analysis, std::vector<uint8_t>& midi) {
+    RequestArena arena;
+    PlannedSong song = planAnalysis(analysis, &arena);
+    std::shared_ptr<const CachedComposition> composition =
+        sharedCompositionCache().getOrCompose(song.plan, false, &arena);
+    {
+        StageTimer timer(Stage::MIDI_WRITE);
+        midi = composition->midi;
+    }
+
+    logDebug("Generate", "composed MIDI in memory", {{"bytes", midi.size()}});
+
+    json resp = describeSong(analysis, song);
+    resp["midi_bytes"] = midi.size();
+    return resp;
+}
+
+BatchItem batchItemFromJson(const json& entry, const BatchItem& defaults) {
+    BatchItem item = defaults;
+    if (entry.is_string()) {
+        item.imagePath = entry.get<std::string>();
+        return item;
+    }
+    if (!entry.is_object() || !entry.contains("image_path") || !entry["image_path"].is_string()) {
+        throw std::invalid_argument("batch entry needs a string 'image_path'");
+    }
+    item.imagePath = entry["image_path"].get<std::string>();
+    if (entry.contains("mode") && entry["mode"].is_string()) {
+        item.mode = entry["mode"].get<std::string>();
+    }
+    item.featureOptions = featureOptionsFromJson(entry, defaults.featureOptions);
+    return item;
+}
+
+BatchGenerator::Options BatchGenerator::optionsFromEnv() {
+    Options o;
+    if (const char* v = std::getenv("SC_BATCH_WINDOW")) {
+        try {
+            o.window = static_cast<size_t>(std::max(1L, std::stol(v)));
+        } catch (...) {
+            std::cerr << "[WARN] Invalid SC_BATCH_WINDOW value, using default "
+                      << o.window << std::endl;
+        }
+    }
+    return o;
+}
+
+BatchGenerator::BatchGenerator(const std::string& outputDir, const ModelClient* model,
+                               FeatureCache* cache, const Options& options)
+    : outputDir_(outputDir), model_(model), cache_(cache), options_(options) {
+    options_.window = std::max<size_t>(options_.window, 1);
+    fs::create_directories(outputDir_);
+}
+
+namespace {
+
+struct BatchSlot {
+    CachedAnalysis analysis;
+    std::string cacheKey;
+    bool ready = false;      // params known (cache hit or heuristic)
+    int errorStatus = 0;     // non-zero: failed, skip later stages
+    std::string error;
+};
+
+}  // namespace
+
+size_t BatchGenerator::run(const std::vector<BatchItem>& items, const Emit& emit) {
+    WorkerPool& pool = sharedWorkerPool();
+    std::mutex emitMutex;
+    bool stopped = false;
+    size_t succeeded = 0;
+
+    auto emitLine = [&](const json& line, bool ok) {
+        std::lock_guard<std::mutex> lock(emitMutex);
+        if (stopped) return;
+        if (ok) ++succeeded;
+        if (!emit(line)) stopped = true;
+    };
+    auto isStopped = [&] {
+        std::lock_guard<std::mutex> lock(emitMutex);
+        return stopped;
+    };
+
+    for (size_t begin = 0; begin < items.size() && !isStopped(); begin += options_.window) {
+        size_t count = std::min(options_.window, items.size() - begin);
+        std::vector<BatchSlot> slots(count);
+
+        // Stage 1: read, look up, decode and analyse in parallel
+        pool.parallelFor(count, count, [&](size_t i) {
+            const BatchItem& item = items[begin + i];
+            BatchSlot& slot = slots[i];
+            if (item.mode != "heuristic" && item.mode != "model") {
+                slot.errorStatus = 400;
+                slot.error = "Unknown mode (expected 'heuristic' or 'model')";
+                return;
+            }
+            try {
+                std::string bytes = readImageFile(item.imagePath);
+                if (cache_) {
+                    slot.cacheKey = FeatureCache::contentKey(
+                        bytes.data(), bytes.size(),
+                        FeatureCache::variantFor(item.mode, item.featureOptions));
+                    if (cache_->lookup(slot.cacheKey, slot.analysis)) {
+                        slot.ready = true;
+                        return;
+                    }
+                }
+                slot.analysis.features = extractImageFeaturesFromMemory(
+                    reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size(),
+                    item.featureOptions);
+                if (item.mode == "heuristic") {
+                    slot.analysis.params = mapFeaturesToMusicHeuristic(slot.analysis.features);
+                    slot.ready = true;
+                    if (cache_) cache_->store(slot.cacheKey, slot.analysis);
+                }
+            } catch (const std::exception& ex) {
+                slot.errorStatus = 500;
+                slot.error = std::string("Internal server error: ") + ex.what();
+            }
+        });
+
+        // Stage 2: one model request for the whole window
+        std::vector<size_t> modelSlots;
+        std::vector<ImageFeatures> rows;
+        for (size_t i = 0; i < count; ++i) {
+            if (!slots[i].errorStatus && !slots[i].ready) {
+                modelSlots.push_back(i);
+                rows.push_back(slots[i].analysis.features);
+            }
+        }
+        if (!rows.empty()) {
+            bool usedModel = false;
+            std::vector<MusicParameters> params;
+            if (model_) {
+                params = mapFeaturesToMusicModelBatch(rows, *model_, &usedModel);
+            } else {
+                for (const ImageFeatures& f : rows) {
+                    params.push_back(mapFeaturesToMusicHeuristic(f));
+                }
+            }
+            for (size_t r = 0; r < modelSlots.size(); ++r) {
+                BatchSlot& slot = slots[modelSlots[r]];
+                slot.analysis.params = params[r];
+                slot.ready = true;
+                // A heuristic stand-in must not be served as the model's answer later
+                if (cache_ && usedModel) cache_->store(slot.cacheKey, slot.analysis);
+            }
+        }
+
+        // Stage 3: plan + compose in parallel, emitting each as it finishes
+        pool.parallelFor(count, count, [&](size_t i) {
+            if (isStopped()) return;
+            const BatchItem& item = items[begin + i];
+            BatchSlot& slot = slots[i];
+            json line = {{"index", begin + i}, {"image_path", item.imagePath}};
+            if (!slot.errorStatus) {
+                try {
+                    line["result"] = composeAnalysis(slot.analysis, outputDir_);
+                } catch (const std::exception& ex) {
+                    slot.errorStatus = 500;
+                    slot.error = std::string("Internal server error: ") + ex.what();
+                }
+            }
+            if (slot.errorStatus) {
+                line["status"] = "error";
+                line["error"] = slot.error;
+                line["error_status"] = slot.errorStatus;
+            } else {
+                line["status"] = "ok";
+            }
+            emitLine(line, !slot.errorStatus);
+        });
+    }
+    return succeeded;
+}
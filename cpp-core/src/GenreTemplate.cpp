@@ -1,8 +1,8 @@
 #include "GenreTemplate.hpp"
 #include "ImageFeatures.hpp"
+#include "Log.hpp"
 #include <stdexcept>
 #include <cmath>
-#include <iostream>
 
 std::string SectionTemplate::name() const {
     return sectionTypeName(type);
@@ -172,27 +172,27 @@ GenreType selectGenreFromImage(const ImageFeatures& features, float energy) {
     // Clamp energy to safe range
     float safeEnergy = std::max(0.3f, std::min(0.9f, energy));
     if (safeEnergy != energy) {
-        std::cout << "[Genre Selection] Clamped energy from " << energy 
-                  << " to " << safeEnergy << " (safety)" << std::endl;
+        logDebug("Genre Selection", "clamped energy", {{"from", energy}, {"to", safeEnergy}});
     }
     
     // Heuristic mapping based on color and energy
     
     // Edge case 1: Very dark image (brightness < 0.2) → Cinematic (safe, moody)
     if (features.brightness < 0.2f) {
-        std::cout << "[Genre Selection] Very dark image → CINEMATIC" << std::endl;
+        logDebug("Genre Selection", "very dark image", {{"genre", "CINEMATIC"}});
         return GenreType::CINEMATIC;
     }
     
     // Edge case 2: Very bright image (brightness > 0.9) → Avoid crazy tempos
     if (features.brightness > 0.9f && safeEnergy > 0.7f) {
-        std::cout << "[Genre Selection] Very bright + high energy → RETROWAVE (avoiding EDM_DROP)" << std::endl;
+        logDebug("Genre Selection", "very bright and high energy, avoiding EDM_DROP",
+                 {{"genre", "RETROWAVE"}});
         return GenreType::RETROWAVE;  // Safer tempo range than EDM_DROP
     }
     
     // Edge case 3: Low saturation (grayscale-ish) → Cinematic
     if (features.saturation < 0.15f && features.colorfulness < 0.2f) {
-        std::cout << "[Genre Selection] Grayscale image → CINEMATIC" << std::endl;
+        logDebug("Genre Selection", "grayscale image", {{"genre", "CINEMATIC"}});
         return GenreType::CINEMATIC;
     }
     
@@ -3,20 +3,36 @@
 #include "httplib.h"
 #include "json.hpp"
 
+#include "CompositionCache.hpp"
+#include "ConcurrencyLimit.hpp"
+#include "FeatureCache.hpp"
+#include "Generation.hpp"
 #include "ImageFeatures.hpp"
+#include "JobQueue.hpp"
+#include "Log.hpp"
+#include "MemoryBudget.hpp"
+#include "Metrics.hpp"
 #include "MusicMapping.hpp"
 #include "ModelClient.hpp"
+#include "PredictionBatcher.hpp"
+#include "SingleFlight.hpp"
+#include "Warmup.hpp"
 #include "AudioEngine.hpp"
-#include "MusicalStyle.hpp"  // Phase 7
-#include "GenreTemplate.hpp"  // Phase 12: Genre selection
-#include "SectionPlanner.hpp" // Phase 12: Song planning
-#include "Composer.hpp"       // Phase 12: Genre-based composition
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <filesystem>
-#include <iostream>
+#include <memory>
+#include <random>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
@@ -26,124 +42,803 @@ static std::string getEnvOrDefault(const char* key, const std::string& def) {
     return v ? std::string(v) : def;
 }
 
+// Map features to parameters with the requested mode.
+// Returns false for an unknown mode. usedFallback reports a "model" request
+// that was answered by the heuristic because TF Serving was unavailable.
+static bool mapFeaturesWithMode(const ImageFeatures& features, const std::string& mode,
+                                PredictionBatcher& batcher, MusicParameters& params,
+                                bool* usedFallback = nullptr) {
+    if (usedFallback) *usedFallback = false;
+    if (mode == "heuristic") {
+        params = mapFeaturesToMusicHeuristic(features);
+    } else if (mode == "model") {
+        bool usedModel = false;
+        params = mapFeaturesToMusicModel(features, batcher, &usedModel);
+        if (usedFallback) *usedFallback = !usedModel;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Decode + features + mapping for one encoded image, through the content
+// cache (knownKey: its cache key, when already computed). Returns false
+// for an unknown mode; throws if it can't be decoded.
+static bool analyzeImageBytes(FeatureCache& cache, PredictionBatcher& batcher,
+                              const std::string& bytes,
+                              const std::string& mode, const FeatureOptions& featureOptions,
+                              CachedAnalysis& analysis, const std::string& knownKey = std::string()) {
+    std::string key = !knownKey.empty()
+                          ? knownKey
+                          : FeatureCache::contentKey(bytes.data(), bytes.size(),
+                                                     FeatureCache::variantFor(mode, featureOptions));
+    if (cache.lookup(key, analysis)) {
+        logDebug("HTTP", "feature cache hit", {{"key", key}});
+        return true;
+    }
+
+    analysis.features = extractImageFeaturesFromMemory(
+        reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size(), featureOptions);
+    bool usedFallback = false;
+    if (!mapFeaturesWithMode(analysis.features, mode, batcher, analysis.params, &usedFallback)) {
+        return false;
+    }
+    // A heuristic stand-in must not be served as the model's answer later
+    if (!usedFallback) {
+        cache.store(key, analysis);
+    }
+    return true;
+}
+
+// What a /generate caller gets back; shared by coalesced requests
+struct GenerateOutcome {
+    JobQueue::Snapshot job;                     // final state of the job
+    std::shared_ptr<std::vector<uint8_t>> midi;  // the "midi" form's body
+    bool rejected = false;                      // the job queue was full
+};
+
+// A generation request: the JSON options, plus the image itself when it
+// was uploaded rather than named by "image_path"
+struct GenerateRequest {
+    json body;
+    std::shared_ptr<const std::string> image;
+    std::string requestId;
+    std::string contentKey;  // feature cache key of the upload, once computed
+};
+
+// The client's X-Request-Id when it's a sane token, else a fresh one
+static std::string requestIdFor(const httplib::Request& req) {
+    std::string id = req.get_header_value("X-Request-Id");
+    bool valid = !id.empty() && id.size() <= 40 &&
+                 std::all_of(id.begin(), id.end(), [](unsigned char c) {
+                     return std::isalnum(c) || c == '-' || c == '_' || c == '.';
+                 });
+    if (valid) return id;
+
+    static const uint32_t prefix = std::random_device{}();
+    static std::atomic<uint64_t> counter{0};
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%08x%08llx", prefix,
+                  static_cast<unsigned long long>(counter.fetch_add(1, std::memory_order_relaxed)));
+    return buf;
+}
+
+// Multipart fields and query parameters arrive as text
+static json fieldValue(const std::string& name, const std::string& text) {
+    if (name == "fast_features") {
+        return text == "1" || text == "true" || text == "yes";
+    }
+    if (name == "pixel_budget") {
+        try {
+            return static_cast<size_t>(std::stoull(text));
+        } catch (...) {
+            throw RequestError(400, "Invalid 'pixel_budget'");
+        }
+    }
+    return text;
+}
+
+// Accepts three body forms:
+//   application/json                    {"image_path": ..., options}
+//   multipart/form-data                 file field "image", options as text fields
+//   image/* or application/octet-stream the encoded image, options as query parameters
+// Throws RequestError for anything unusable.
+static GenerateRequest parseGenerateRequest(const httplib::Request& req) {
+    GenerateRequest request;
+    request.requestId = requestIdFor(req);
+    std::string contentType = req.get_header_value("Content-Type");
+
+    if (req.is_multipart_form_data()) {
+        request.body = json::object();
+        for (const auto& field : req.form.fields) {
+            request.body[field.first] = fieldValue(field.first, field.second.content);
+        }
+        auto file = req.form.files.find("image");
+        if (file != req.form.files.end()) {
+            request.image = std::make_shared<const std::string>(file->second.content);
+        }
+    } else if (contentType.rfind("image/", 0) == 0 ||
+               contentType.rfind("application/octet-stream", 0) == 0) {
+        request.body = json::object();
+        for (const auto& param : req.params) {
+            request.body[param.first] = fieldValue(param.first, param.second);
+        }
+        request.image = std::make_shared<const std::string>(req.body);
+    } else {
+        if (req.body.empty()) {
+            throw RequestError(400, "Missing request body");
+        }
+        try {
+            request.body = json::parse(req.body);
+        } catch (const std::exception& ex) {
+            throw RequestError(400, std::string("Invalid JSON: ") + ex.what());
+        }
+    }
+
+    if (request.image && request.image->empty()) {
+        throw RequestError(400, "Empty image upload");
+    }
+    if (!request.image && (!request.body.contains("image_path") || !request.body["image_path"].is_string())) {
+        throw RequestError(400, "Missing or invalid 'image_path'");
+    }
+    return request;
+}
+
+// Where the composed MIDI goes: "file" (under SC_OUTPUT_DIR, path in the
+// JSON), "inline" (base64 in the JSON) or "midi" (the response body).
+// Uploads default to "inline" so they never touch the filesystem.
+static std::string responseForm(const GenerateRequest& request) {
+    std::string form = request.image ? "inline" : "file";
+    if (request.body.contains("response") && request.body["response"].is_string()) {
+        form = request.body["response"].get<std::string>();
+    }
+    if (form != "file" && form != "inline" && form != "midi") {
+        throw RequestError(400, "Unknown response (expected 'file', 'inline' or 'midi')");
+    }
+    return form;
+}
+
+static std::string base64Encode(const std::vector<uint8_t>& data) {
+    static const char* alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t v = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+        out.push_back(alphabet[(v >> 18) & 63]);
+        out.push_back(alphabet[(v >> 12) & 63]);
+        out.push_back(alphabet[(v >> 6) & 63]);
+        out.push_back(alphabet[v & 63]);
+    }
+    if (i < data.size()) {
+        uint32_t v = uint32_t(data[i]) << 16;
+        if (i + 1 < data.size()) v |= uint32_t(data[i + 1]) << 8;
+        out.push_back(alphabet[(v >> 18) & 63]);
+        out.push_back(alphabet[(v >> 12) & 63]);
+        out.push_back(i + 1 < data.size() ? alphabet[(v >> 6) & 63] : '=');
+        out.push_back('=');
+    }
+    return out;
+}
+
+static std::string requestMode(const GenerateRequest& request, const std::string& defaultMode) {
+    if (request.body.contains("mode") && request.body["mode"].is_string()) {
+        return request.body["mode"].get<std::string>();
+    }
+    return defaultMode;
+}
+
+// Requests that would get the same response: the upload's feature cache
+// key (content hash, mode and feature options), or the image path with
+// the same options, plus the response form. Keeps the upload's key on the
+// request so the analysis doesn't hash the bytes again.
+static std::string coalescingKey(GenerateRequest& request, const std::string& defaultMode) {
+    std::string variant = FeatureCache::variantFor(requestMode(request, defaultMode),
+                                                   featureOptionsFromJson(request.body));
+    std::string form = responseForm(request);
+    if (request.image) {
+        request.contentKey = FeatureCache::contentKey(request.image->data(), request.image->size(),
+                                                      variant);
+        return request.contentKey + "|" + form;
+    }
+    return "path:" + request.body["image_path"].get<std::string>() + "|" + variant + "|" + form;
+}
+
+// Mode and feature options from the request, then the cached analysis of
+// the uploaded bytes or of the file at image_path
+static CachedAnalysis analyzeRequest(const GenerateRequest& request, const std::string& defaultMode,
+                                     const char* endpoint, FeatureCache& cache,
+                                     PredictionBatcher& batcher) {
+    const json& body = request.body;
+    std::string mode = requestMode(request, defaultMode);
+    FeatureOptions featureOptions = featureOptionsFromJson(body);
+
+    if (request.image) {
+        logDebug("HTTP", endpoint, {{"upload_bytes", request.image->size()},
+                                    {"mode", mode},
+                                    {"fast_features", featureOptions.fast}});
+    } else {
+        logDebug("HTTP", endpoint, {{"image_path", body["image_path"].get_ref<const std::string&>()},
+                                    {"mode", mode},
+                                    {"fast_features", featureOptions.fast}});
+    }
+
+    // Extract features and choose mapping (cached by image content)
+    CachedAnalysis analysis;
+    bool knownMode;
+    try {
+        if (request.image) {
+            try {
+                knownMode = analyzeImageBytes(cache, batcher, *request.image, mode, featureOptions,
+                                              analysis, request.contentKey);
+            } catch (const MemoryBudgetExceeded&) {
+                throw;
+            } catch (const std::runtime_error& ex) {
+                // Undecodable bytes are the client's problem, unlike an unreadable server-side path
+                throw RequestError(400, ex.what());
+            }
+        } else {
+            knownMode = analyzeImageBytes(cache, batcher, readImageFile(body["image_path"].get<std::string>()),
+                                          mode, featureOptions, analysis);
+        }
+    } catch (const MemoryBudgetExceeded& ex) {
+        // Larger than the whole budget can never run; otherwise the pod is busy
+        throw RequestError(ex.fits() ? 503 : 413, ex.what());
+    }
+    if (!knownMode) {
+        throw RequestError(400, "Unknown mode (expected 'heuristic' or 'model')");
+    }
+    return analysis;
+}
+
+// Everything /generate does for one request: analysis, genre selection,
+// planning and MIDI composition. Returns the response JSON; throws
+// RequestError for client errors. Runs on a JobQueue worker. midi receives
+// the file for the "midi" response form (null where that isn't offered).
+static json generateResponse(const GenerateRequest& request, const std::string& form,
+                             const std::string& defaultMode, const std::string& outputDir,
+                             FeatureCache& cache, PredictionBatcher& batcher,
+                             std::vector<uint8_t>* midi) {
+    StageTimer timer(Stage::GENERATE);
+    CachedAnalysis analysis = analyzeRequest(request, defaultMode, "/generate", cache, batcher);
+    if (form == "file") {
+        return composeAnalysis(analysis, outputDir);
+    }
+    if (form == "midi") {
+        return composeAnalysisToMemory(analysis, *midi);
+    }
+    std::vector<uint8_t> bytes;
+    json resp = composeAnalysisToMemory(analysis, bytes);
+    resp["midi_base64"] = base64Encode(bytes);
+    return resp;
+}
+
+// One generation job, tagged with its request id; logs one summary line
+// with the stage timings (or the failure)
+static json runGenerate(const GenerateRequest& request, const std::string& defaultMode,
+                        const std::string& outputDir, FeatureCache& cache,
+                        PredictionBatcher& batcher, std::vector<uint8_t>* midi) {
+    LogContext context(request.requestId);
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [start]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    try {
+        std::string form = responseForm(request);
+        if (form == "midi" && !midi) {
+            throw RequestError(400, "'response': 'midi' is only available from POST /generate");
+        }
+        json resp = generateResponse(request, form, defaultMode, outputDir, cache, batcher, midi);
+
+        if (logger().enabled(LogLevel::INFO)) {
+            const std::string& genre = resp["decided_genre"].get_ref<const std::string&>();
+            std::vector<LogField> fields = {{"form", form}, {"genre", genre}, {"ms", elapsedMs()}};
+            context.appendTimingFields(fields);
+            logger().log(LogLevel::INFO, "HTTP", "generate done", fields.data(), fields.size());
+        }
+        return resp;
+    } catch (const RequestError& ex) {
+        logInfo("HTTP", "generate rejected", {{"status", ex.status()}, {"error", ex.what()},
+                                              {"ms", elapsedMs()}});
+        throw;
+    } catch (const std::exception& ex) {
+        logError("HTTP", "generate failed", {{"error", ex.what()}, {"ms", elapsedMs()}});
+        throw;
+    }
+}
+
+// Set by SIGTERM/SIGINT. A watcher thread turns it into svr.stop(), so
+// running jobs finish and queued log lines are written before exit.
+static volatile std::sig_atomic_t g_stopRequested = 0;
+
+extern "C" void onStopSignal(int) {
+    g_stopRequested = 1;
+}
+
+static const long MAX_JOB_WAIT_SECONDS = 30;
+static const int SSE_HEARTBEAT_SECONDS = 15;
+static const size_t DEFAULT_BATCH_MAX_ITEMS = 10000;
+static const size_t DEFAULT_BATCH_CONCURRENCY = 2;
+static const size_t DEFAULT_MAX_BODY_BYTES = 64 * 1024 * 1024;
+
+static json jobJson(const JobQueue::Snapshot& job) {
+    json j = {{"job_id", job.id}, {"status", JobQueue::stateName(job.state)}};
+    if (job.state == JobQueue::State::DONE) {
+        j["result"] = job.result;
+    } else if (job.state == JobQueue::State::FAILED) {
+        j["error"] = job.error;
+        j["error_status"] = job.errorStatus;
+    }
+    return j;
+}
+
+// Job queue full: tell the client to back off briefly
+static void rejectBusy(httplib::Response& res) {
+    res.status = 429;
+    res.set_header("Retry-After", "1");
+    res.set_content("Too many queued jobs, retry later", "text/plain");
+}
+
 void runHttpServer(
     int port,
     const std::string& defaultMode,
     const std::string& outputDir
 ) {
+    // Times setup from here; GET /ready answers 503 until warmup finishes
+    // (SC_WARMUP, SC_WARMUP_SYNTHETIC, SC_WARMUP_MODEL_CONNECTIONS)
+    Warmup warmup(Warmup::optionsFromEnv());
+
     httplib::Server svr;
 
+    // Prefork workers (SC_SERVE_WORKER set) share the port; say so
+    // explicitly rather than relying on httplib's default socket options
+    const char* workerIndex = std::getenv("SC_SERVE_WORKER");
+    if (workerIndex) {
+        svr.set_socket_options([](socket_t sock) {
+            int one = 1;
+            setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+        });
+    }
+
     // Ensure output directory exists
     fs::create_directories(outputDir);
 
-    svr.Post("/generate", [defaultMode, outputDir](const httplib::Request& req, httplib::Response& res) {
+    // Uploads are held in memory; larger bodies get 413 (SC_MAX_BODY_BYTES)
+    size_t maxBodyBytes = static_cast<size_t>(std::max(1LL, std::atoll(
+        getEnvOrDefault("SC_MAX_BODY_BYTES", std::to_string(DEFAULT_MAX_BODY_BYTES)).c_str())));
+    svr.set_payload_max_length(maxBodyBytes);
+
+    // Requests run concurrently on httplib's threads; unless configured,
+    // give each image at most half the pool so one upload can't starve the rest
+    if (!std::getenv("SC_FEATURE_THREADS")) {
+        setFeatureThreads(std::max(1, featureThreads() / 2));
+    }
+
+    // One long-lived TF Serving client: URL parsed once, pooled keep-alive
+    // connections, circuit breaker shared by all requests
+    ModelClient modelClient(getEnvOrDefault(
+        "SC_TF_SERVING_URL",
+        "http://localhost:8501/v1/models/soundcanvas:predict"
+    ));
+
+    // Concurrent "model" requests share TF Serving calls
+    // (SC_TF_BATCH_SIZE rows or SC_TF_BATCH_WAIT_US, whichever comes first)
+    PredictionBatcher batcher(modelClient);
+
+    // Image analyses keyed by content hash (SC_CACHE_ENTRIES / _TTL_SECONDS / _DIR)
+    FeatureCache cache(FeatureCache::configFromEnv());
+
+    // Generation runs here, not on httplib's connection threads
+    // (SC_JOB_WORKERS threads, SC_JOB_QUEUE_DEPTH waiting jobs, then 429)
+    JobQueue jobs(JobQueue::optionsFromEnv());
+
+    // /generate/batch streams from the connection thread, outside the job
+    // queue: at most SC_BATCH_CONCURRENCY run at once, then 429
+    ConcurrencyLimit batchSlots(static_cast<size_t>(std::max(0L, std::atol(
+        getEnvOrDefault("SC_BATCH_CONCURRENCY", std::to_string(DEFAULT_BATCH_CONCURRENCY)).c_str()))));
+
+    // Readiness probe: keeps autoscaled instances out of rotation until
+    // the lazy state the first requests would pay for is initialized
+    svr.Get("/ready", [&warmup](const httplib::Request&, httplib::Response& res) {
+        res.status = warmup.ready() ? 200 : 503;
+        res.set_content(warmup.status().dump(), "application/json");
+    });
+
+    svr.Get("/cache/stats", [&cache](const httplib::Request&, httplib::Response& res) {
+        FeatureCache::Stats stats = cache.stats();
+        json resp = {
+            {"hits",      stats.hits},
+            {"disk_hits", stats.diskHits},
+            {"misses",    stats.misses},
+            {"evictions", stats.evictions},
+            {"entries",   stats.entries}
+        };
+        CompositionCache::Stats songs = sharedCompositionCache().stats();
+        resp["composition"] = {
+            {"hits",      songs.hits},
+            {"disk_hits", songs.diskHits},
+            {"misses",    songs.misses},
+            {"evictions", songs.evictions},
+            {"entries",   songs.entries},
+            {"bytes",     songs.bytes}
+        };
+        res.set_content(resp.dump(), "application/json");
+    });
+
+    // Prometheus scrape: stage latency histograms and counters, plus the
+    // job queue and cache state
+    svr.Get("/metrics", [&jobs, &cache, &warmup, &batchSlots](const httplib::Request&, httplib::Response& res) {
+        std::string out;
+        metrics().appendPrometheus(out);
+        appendPrometheusMetric(out, "soundcanvas_ready", "gauge",
+                               "1 once startup warmup has finished.",
+                               warmup.ready() ? 1.0 : 0.0);
+        appendPrometheusMetric(out, "soundcanvas_startup_seconds", "gauge",
+                               "Time from server start to ready (0 while warming up).",
+                               warmup.startupSeconds());
+        appendPrometheusMetric(out, "soundcanvas_jobs_queued", "gauge",
+                               "Generation jobs waiting for a worker.",
+                               static_cast<double>(jobs.queued()));
+        appendPrometheusMetric(out, "soundcanvas_jobs_running", "gauge",
+                               "Generation jobs currently running.",
+                               static_cast<double>(jobs.running()));
+        appendPrometheusMetric(out, "soundcanvas_jobs_retained", "gauge",
+                               "Finished jobs kept for GET /jobs/{id}.",
+                               static_cast<double>(jobs.retained()));
+        appendPrometheusMetric(out, "soundcanvas_batches_running", "gauge",
+                               "/generate/batch streams in progress.",
+                               static_cast<double>(batchSlots.active()));
+
+        FeatureCache::Stats stats = cache.stats();
+        appendPrometheusMetric(out, "soundcanvas_feature_cache_hits_total", "counter",
+                               "Feature cache hits in memory.", static_cast<double>(stats.hits));
+        appendPrometheusMetric(out, "soundcanvas_feature_cache_disk_hits_total", "counter",
+                               "Feature cache hits on disk.", static_cast<double>(stats.diskHits));
+        appendPrometheusMetric(out, "soundcanvas_feature_cache_misses_total", "counter",
+                               "Feature cache misses.", static_cast<double>(stats.misses));
+        appendPrometheusMetric(out, "soundcanvas_feature_cache_entries", "gauge",
+                               "Feature cache entries in memory.", static_cast<double>(stats.entries));
+
+        MemoryBudget::Stats memory = sharedMemoryBudget().stats();
+        appendPrometheusMetric(out, "soundcanvas_memory_budget_bytes", "gauge",
+                               "Memory budget for image decodes (0 = unlimited).",
+                               static_cast<double>(memory.budgetBytes));
+        appendPrometheusMetric(out, "soundcanvas_memory_reserved_bytes", "gauge",
+                               "Memory budget currently reserved by decodes.",
+                               static_cast<double>(memory.reservedBytes));
+        appendPrometheusMetric(out, "soundcanvas_memory_waiting", "gauge",
+                               "Decodes waiting for memory budget.",
+                               static_cast<double>(memory.waiting));
+        appendPrometheusMetric(out, "soundcanvas_memory_waits_total", "counter",
+                               "Decodes that had to wait for memory budget.",
+                               static_cast<double>(memory.waited));
+        appendPrometheusMetric(out, "soundcanvas_memory_rejections_total", "counter",
+                               "Images larger than the whole memory budget (413).",
+                               static_cast<double>(memory.rejected));
+        appendPrometheusMetric(out, "soundcanvas_memory_timeouts_total", "counter",
+                               "Decodes that gave up waiting for memory budget (503).",
+                               static_cast<double>(memory.timedOut));
+
+        CompositionCache::Stats songs = sharedCompositionCache().stats();
+        appendPrometheusMetric(out, "soundcanvas_composition_cache_hits_total", "counter",
+                               "Composition cache hits, memory or disk.", static_cast<double>(songs.hits));
+        appendPrometheusMetric(out, "soundcanvas_composition_cache_misses_total", "counter",
+                               "Composition cache misses.", static_cast<double>(songs.misses));
+        appendPrometheusMetric(out, "soundcanvas_composition_cache_bytes", "gauge",
+                               "Serialized MIDI held by the composition cache.",
+                               static_cast<double>(songs.bytes));
+        res.set_content(out, "text/plain; version=0.0.4");
+    });
+
+    // Shared by the job endpoints and synchronous /generate
+    auto submitGenerate = [defaultMode, outputDir, &cache, &batcher, &jobs](
+                              GenerateRequest request,
+                              std::shared_ptr<std::vector<uint8_t>> midi = nullptr,
+                              bool pinned = false) {
+        return jobs.submit([defaultMode, outputDir, &cache, &batcher, request, midi]() {
+            return runGenerate(request, defaultMode, outputDir, cache, batcher, midi.get());
+        }, pinned);
+    };
+
+    // Identical /generate requests arriving while one is in flight wait
+    // for it instead of running the pipeline again (SC_COALESCE=0 disables)
+    bool coalesce = std::atoi(getEnvOrDefault("SC_COALESCE", "1").c_str()) != 0;
+    auto inFlightGenerates = std::make_shared<SingleFlight<GenerateOutcome>>();
+
+    // Synchronous form: the work still runs on the job pool, this
+    // connection thread only waits for it. With "response": "midi" the
+    // body is the MIDI file and the song summary moves to X-* headers.
+    svr.Post("/generate", [&jobs, submitGenerate, coalesce, defaultMode, inFlightGenerates](
+                              const httplib::Request& req, httplib::Response& res) {
+        InFlightRequest inFlight;
         try {
-            if (req.body.empty()) {
+            GenerateRequest request = parseGenerateRequest(req);
+            LogContext context(request.requestId);
+            res.set_header("X-Request-Id", request.requestId);
+            bool binary = responseForm(request) == "midi";
+            std::string key = coalesce ? coalescingKey(request, defaultMode) : std::string();
+
+            auto execute = [&]() {
+                GenerateOutcome outcome;
+                outcome.midi = binary ? std::make_shared<std::vector<uint8_t>>() : nullptr;
+                // Pinned: kept until erased below, however fast jobs churn
+                std::string id = submitGenerate(std::move(request), outcome.midi, true);
+                if (id.empty()) {
+                    outcome.rejected = true;
+                    return outcome;
+                }
+                while (jobs.waitFor(id, std::chrono::seconds(60), outcome.job) &&
+                       (outcome.job.state == JobQueue::State::QUEUED ||
+                        outcome.job.state == JobQueue::State::RUNNING)) {
+                }
+                // Nobody else polls a synchronous job, don't retain its result
+                jobs.erase(id);
+                return outcome;
+            };
+            bool joined = false;
+            GenerateOutcome outcome = key.empty() ? execute() : inFlightGenerates->run(key, execute, &joined);
+            if (joined) {
+                metrics().add(Counter::GENERATE_COALESCED);
+                logDebug("HTTP", "/generate coalesced with an identical request in flight");
+            }
+            if (outcome.rejected) {
+                rejectBusy(res);
+                return;
+            }
+
+            const JobQueue::Snapshot& job = outcome.job;
+            const std::shared_ptr<std::vector<uint8_t>>& midi = outcome.midi;
+            if (job.state == JobQueue::State::DONE && binary) {
+                res.status = 200;
+                res.set_header("X-Decided-Genre", job.result["decided_genre"].get<std::string>());
+                res.set_header("X-Tempo-Bpm", job.result["tempo_bpm"].dump());
+                res.set_header("X-Scale-Type", job.result["scale_type"].get<std::string>());
+                res.set_content(reinterpret_cast<const char*>(midi->data()), midi->size(), "audio/midi");
+            } else if (job.state == JobQueue::State::DONE) {
+                res.status = 200;
+                res.set_content(job.result.dump(), "application/json");
+            } else {
+                // Failures were logged by the job itself
+                res.status = job.errorStatus ? job.errorStatus : 500;
+                if (res.status == 503) res.set_header("Retry-After", "1");
+                res.set_content(job.error.empty() ? "Job dropped" : job.error, "text/plain");
+            }
+        } catch (const RequestError& ex) {
+            res.status = ex.status();
+            res.set_content(ex.what(), "text/plain");
+        } catch (const std::exception& ex) {
+            logError("HTTP", "/generate failed", {{"error", ex.what()}});
+            res.status = 500;
+            res.set_content(std::string("Internal server error: ") + ex.what(), "text/plain");
+        }
+    });
+
+    // Asynchronous form: 202 with a job id, poll GET /jobs/{id}.
+    // Takes the same bodies as /generate.
+    svr.Post("/jobs", [submitGenerate](const httplib::Request& req, httplib::Response& res) {
+        GenerateRequest request;
+        try {
+            request = parseGenerateRequest(req);
+            if (responseForm(request) == "midi") {
+                throw RequestError(400, "'response': 'midi' is only available from POST /generate");
+            }
+        } catch (const RequestError& ex) {
+            res.status = ex.status();
+            res.set_content(ex.what(), "text/plain");
+            return;
+        }
+
+        std::string requestId = request.requestId;
+        std::string id = submitGenerate(std::move(request));
+        if (id.empty()) {
+            rejectBusy(res);
+            return;
+        }
+        res.status = 202;
+        res.set_header("Location", "/jobs/" + id);
+        res.set_header("X-Request-Id", requestId);
+        res.set_content(json({{"job_id", id}, {"status", "queued"}}).dump(), "application/json");
+    });
+
+    // ?wait=<seconds> long-polls until the job finishes (capped)
+    svr.Get("/jobs/:id", [&jobs](const httplib::Request& req, httplib::Response& res) {
+        long waitSeconds = 0;
+        if (req.has_param("wait")) {
+            try {
+                waitSeconds = std::clamp(std::stol(req.get_param_value("wait")), 0L, MAX_JOB_WAIT_SECONDS);
+            } catch (...) {
                 res.status = 400;
-                res.set_content("Missing request body", "text/plain");
+                res.set_content("Invalid 'wait'", "text/plain");
                 return;
             }
+        }
 
-            json body = json::parse(req.body);
-            if (!body.contains("image_path") || !body["image_path"].is_string()) {
+        JobQueue::Snapshot job;
+        if (!jobs.waitFor(req.path_params.at("id"), std::chrono::seconds(waitSeconds), job)) {
+            res.status = 404;
+            res.set_content("Unknown job", "text/plain");
+            return;
+        }
+        res.status = 200;
+        res.set_content(jobJson(job).dump(), "application/json");
+    });
+
+    // Server-sent events: the current state, then a final event when the
+    // job finishes (comment heartbeats keep proxies from timing out)
+    svr.Get("/jobs/:id/events", [&jobs](const httplib::Request& req, httplib::Response& res) {
+        std::string id = req.path_params.at("id");
+        JobQueue::Snapshot job;
+        if (!jobs.get(id, job)) {
+            res.status = 404;
+            res.set_content("Unknown job", "text/plain");
+            return;
+        }
+
+        res.status = 200;
+        res.set_header("Cache-Control", "no-cache");
+        res.set_chunked_content_provider(
+            "text/event-stream",
+            [&jobs, id, job](size_t offset, httplib::DataSink& sink) mutable {
+                auto send = [&sink](const std::string& text) {
+                    return sink.write(text.data(), text.size());
+                };
+                auto event = [](const JobQueue::Snapshot& s) {
+                    return std::string("event: ") + JobQueue::stateName(s.state) +
+                           "\ndata: " + jobJson(s).dump() + "\n\n";
+                };
+
+                if (offset == 0 && !send(event(job))) return false;
+                while (job.state == JobQueue::State::QUEUED || job.state == JobQueue::State::RUNNING) {
+                    if (!jobs.waitFor(id, std::chrono::seconds(SSE_HEARTBEAT_SECONDS), job)) {
+                        break;  // expired or server stopping
+                    }
+                    bool finished = job.state == JobQueue::State::DONE ||
+                                    job.state == JobQueue::State::FAILED;
+                    if (!send(finished ? event(job) : std::string(": keep-alive\n\n"))) return false;
+                }
+                sink.done();
+                return true;
+            });
+    });
+
+    // Many images in one request, results streamed as NDJSON lines in
+    // completion order. Body: {"items": [path | {"image_path", ...}, ...]}
+    // plus optional top-level "mode"/"fast_features"/"pixel_budget" defaults.
+    size_t batchMaxItems = static_cast<size_t>(std::max(1L, std::atol(
+        getEnvOrDefault("SC_BATCH_MAX_ITEMS", std::to_string(DEFAULT_BATCH_MAX_ITEMS)).c_str())));
+    svr.Post("/generate/batch", [defaultMode, outputDir, batchMaxItems, &cache, &modelClient, &jobs,
+                                 &batchSlots](const httplib::Request& req, httplib::Response& res) {
+        std::vector<BatchItem> items;
+        try {
+            json body = json::parse(req.body.empty() ? "{}" : req.body);
+            if (!body.contains("items") || !body["items"].is_array()) {
                 res.status = 400;
-                res.set_content("Missing or invalid 'image_path'", "text/plain");
+                res.set_content("Missing or invalid 'items'", "text/plain");
+                return;
+            }
+            if (body["items"].size() > batchMaxItems) {
+                res.status = 413;
+                res.set_content("Too many items (max " + std::to_string(batchMaxItems) + ")", "text/plain");
                 return;
             }
 
-            std::string imagePath = body["image_path"].get<std::string>();
-            std::string mode = defaultMode;
+            BatchItem defaults;
+            defaults.mode = defaultMode;
             if (body.contains("mode") && body["mode"].is_string()) {
-                mode = body["mode"].get<std::string>();
+                defaults.mode = body["mode"].get<std::string>();
             }
+            defaults.featureOptions = featureOptionsFromJson(body);
 
-            std::cout << "[HTTP] /generate image_path=" << imagePath
-                      << " mode=" << mode << std::endl;
-
-            // Extract features
-            ImageFeatures features = extractImageFeatures(imagePath);
-
-            // Choose mapping
-            MusicParameters params;
-            if (mode == "heuristic") {
-                params = mapFeaturesToMusicHeuristic(features);
-            } else if (mode == "model") {
-                std::string tfUrl = getEnvOrDefault(
-                    "SC_TF_SERVING_URL",
-                    "http://localhost:8501/v1/models/soundcanvas:predict"
-                );
-                ModelClient client(tfUrl);
-                params = mapFeaturesToMusicModel(features, client);
-            } else {
-                res.status = 400;
-                res.set_content("Unknown mode (expected 'heuristic' or 'model')", "text/plain");
-                return;
+            items.reserve(body["items"].size());
+            for (const json& entry : body["items"]) {
+                items.push_back(batchItemFromJson(entry, defaults));
             }
+        } catch (const std::exception& ex) {
+            res.status = 400;
+            res.set_content(std::string("Invalid batch: ") + ex.what(), "text/plain");
+            return;
+        }
 
-            // Output filename
-            auto now = std::chrono::system_clock::now().time_since_epoch();
-            auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
-            std::string filename = "sound_" + std::to_string(millis) + ".wav";
-            fs::path outPath = fs::path(outputDir) / filename;
-
-            // Phase 7: Derive extended style parameters
-            StyleParameters style = deriveStyle(features, params);
-
-            // Phase 12 A2.2: Select genre from image and create MIDI
-            GenreType decidedGenre = selectGenreFromImage(features, params.energy);
-            const GenreTemplate& genreTemplate = getGenreTemplate(decidedGenre);
-            
-            std::cout << "[HTTP] Selected genre: " << genreTypeName(decidedGenre) 
-                      << " (tempo range: " << genreTemplate.minTempo << "-" 
-                      << genreTemplate.maxTempo << " BPM)" << std::endl;
-
-            // Plan song structure
-            SongPlan plan = planSong(features, params, genreTemplate);
-            
-            // Generate MIDI file
-            std::string midiFilename = "composition_" + std::to_string(millis) + ".mid";
-            fs::path midiPath = fs::path(outputDir) / midiFilename;
-            
-            std::cout << "[HTTP] Composing MIDI to: " << midiPath << std::endl;
-            composeGenreSongToMidi(plan, midiPath.string());
-            
-            // Scale type string
-            const char* scaleNames[] = {"Major", "Minor", "Dorian", "Lydian"};
-            const char* scaleTypeStr = (params.scaleType >= 0 && params.scaleType <= 3)
-                                        ? scaleNames[params.scaleType]
-                                        : "Unknown";
-
-            // Build JSON response with new 7-dim parameters + decided genre
-            json resp;
-            resp["midi_path"] = midiPath.string();  // Phase 12: Return MIDI path instead of WAV
-            resp["audio_path"] = outPath.string();  // Keep for backward compatibility
-            resp["decided_genre"] = genreTypeName(decidedGenre);  // Phase 12 A2.2: Return decided genre!
-            resp["tempo_bpm"] = plan.tempoBpm;
-            resp["scale_type"] = scaleTypeStr;
-            resp["params"] = {
-                {"tempoBpm",      params.tempoBpm},
-                {"baseFrequency", params.baseFrequency},
-                {"energy",        params.energy},
-                {"brightness",    params.brightness},
-                {"reverb",        params.reverb},
-                {"scaleType",     params.scaleType},
-                {"patternType",   params.patternType}
-            };
+        // No batch slot, or /generate is already backed up: a batch would
+        // only compete with it. The slot is held until the stream ends.
+        ConcurrencyLimit::Slot slot;
+        if (jobs.queued() < jobs.options().maxQueued) slot = batchSlots.tryAcquire();
+        if (!slot) {
+            rejectBusy(res);
+            return;
+        }
+
+        logInfo("HTTP", "/generate/batch", {{"items", items.size()}});
+
+        res.status = 200;
+        res.set_chunked_content_provider(
+            "application/x-ndjson",
+            [items, outputDir, &cache, &modelClient, slot](size_t /*offset*/, httplib::DataSink& sink) {
+                InFlightRequest inFlight;
+                BatchGenerator generator(outputDir, &modelClient, &cache);
+                generator.run(items, [&sink](const json& line) {
+                    std::string text = line.dump() + "\n";
+                    return sink.write(text.data(), text.size());
+                });
+                sink.done();
+                return true;
+            });
+    });
+
+    // Ambient WAV streamed straight from the synth as a chunked response
+    // (no temp file). Same bodies as /generate.
+    svr.Post("/generate/ambient", [defaultMode, &cache, &batcher](const httplib::Request& req, httplib::Response& res) {
+        InFlightRequest inFlight;
+        try {
+            GenerateRequest request = parseGenerateRequest(req);
+            LogContext context(request.requestId);
+            res.set_header("X-Request-Id", request.requestId);
+            CachedAnalysis analysis = analyzeRequest(request, defaultMode, "/generate/ambient",
+                                                     cache, batcher);
+            MusicParameters params = analysis.params;
 
             res.status = 200;
-            res.set_content(resp.dump(), "application/json");
+            res.set_chunked_content_provider(
+                "audio/wav",
+                [params](size_t /*offset*/, httplib::DataSink& sink) {
+                    InFlightRequest inFlight;
+                    try {
+                        streamAmbientTrack(
+                            [&sink](const char* data, std::size_t size) {
+                                return sink.write(data, size);
+                            },
+                            params);
+                        sink.done();
+                        return true;
+                    } catch (const std::exception& ex) {
+                        logWarn("HTTP", "/generate/ambient stream aborted", {{"error", ex.what()}});
+                        return false;
+                    }
+                });
+        } catch (const RequestError& ex) {
+            res.status = ex.status();
+            res.set_content(ex.what(), "text/plain");
         } catch (const std::exception& ex) {
-            std::cerr << "[HTTP] Error in /generate: " << ex.what() << std::endl;
+            logError("HTTP", "/generate/ambient failed", {{"error", ex.what()}});
             res.status = 500;
             res.set_content(std::string("Internal server error: ") + ex.what(), "text/plain");
         }
     });
 
-    std::cout << "[HTTP] Server starting on port " << port
-              << " (defaultMode=" << defaultMode
-              << ", outputDir=" << outputDir << ")" << std::endl;
+    logInfo("HTTP", "server starting", {{"port", port},
+                                        {"worker", workerIndex ? workerIndex : "-"},
+                                        {"default_mode", defaultMode},
+                                        {"output_dir", outputDir},
+                                        {"feature_threads", featureThreads()},
+                                        {"job_workers", jobs.options().workers},
+                                        {"job_queue_depth", jobs.options().maxQueued}});
+
+    // Warm up while already listening, so probes see 503 rather than
+    // connection refused
+    std::thread warmupThread([&warmup, &modelClient] { warmup.run(&modelClient); });
+
+    std::signal(SIGTERM, onStopSignal);
+    std::signal(SIGINT, onStopSignal);
+    std::atomic<bool> listenDone{false};
+    std::thread stopWatcher([&svr, &listenDone] {
+        while (!listenDone.load()) {
+            if (g_stopRequested && svr.is_running()) {
+                logInfo("HTTP", "server stopping");
+                svr.stop();
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    });
 
-    if (!svr.listen("0.0.0.0", port)) {
+    bool listened = svr.listen("0.0.0.0", port);
+    listenDone.store(true);
+    stopWatcher.join();
+    warmupThread.join();
+    if (!listened) {
         throw std::runtime_error("Failed to start HTTP server on port " + std::to_string(port));
     }
 }
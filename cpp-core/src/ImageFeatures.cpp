@@ -2,147 +2,131 @@
 #include "stb_image.h"
 
 #include "ImageFeatures.hpp"
+#include "ImageKernels.hpp"
+#include "MemoryBudget.hpp"
+#include "Metrics.hpp"
+#include "WorkerPool.hpp"
 #include <stdexcept>
 #include <cmath>
-#include <vector>
 #include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <vector>
 
-// Helper: Convert RGB [0,1] to HSV [H: 0-360, S: 0-1, V: 0-1]
-static void rgbToHsv(float r, float g, float b, float& h, float& s, float& v) {
-    float cmax = std::max({r, g, b});
-    float cmin = std::min({r, g, b});
-    float delta = cmax - cmin;
+// Images below this size are not worth splitting across threads
+static const size_t PARALLEL_MIN_PIXELS = 1 << 20;
 
-    // Value
-    v = cmax;
+// Rows per tile never drop below this, so tiles stay well above a few
+// cache lines even for narrow images
+static const int MIN_TILE_ROWS = 16;
 
-    // Saturation
-    if (cmax == 0.0f) {
-        s = 0.0f;
-    } else {
-        s = delta / cmax;
-    }
+// Tiles per worker: a little slack so uneven scheduling still balances
+static const int TILES_PER_WORKER = 4;
+
+static std::atomic<int> g_featureThreads{-1};  // -1 = not resolved yet
 
-    // Hue
-    if (delta == 0.0f) {
-        h = 0.0f;  // undefined, but we'll use 0
-    } else if (cmax == r) {
-        h = 60.0f * fmodf(((g - b) / delta), 6.0f);
-    } else if (cmax == g) {
-        h = 60.0f * (((b - r) / delta) + 2.0f);
-    } else {
-        h = 60.0f * (((r - g) / delta) + 4.0f);
+int featureThreads() {
+    int threads = g_featureThreads.load(std::memory_order_relaxed);
+    if (threads < 0) {
+        threads = 0;
+        if (const char* env = std::getenv("SC_FEATURE_THREADS")) {
+            try {
+                threads = std::max(0, std::stoi(env));
+            } catch (...) {
+                threads = 0;
+            }
+        }
+        if (threads == 0) {
+            threads = static_cast<int>(sharedWorkerPool().threadCount());
+        }
+        g_featureThreads.store(threads, std::memory_order_relaxed);
     }
+    return threads;
+}
 
-    if (h < 0.0f) h += 360.0f;
+void setFeatureThreads(int threads) {
+    if (threads <= 0) {
+        threads = static_cast<int>(sharedWorkerPool().threadCount());
+    }
+    g_featureThreads.store(threads, std::memory_order_relaxed);
 }
 
-ImageFeatures extractImageFeatures(const std::string& imagePath) {
-    int width, height, channels;
-    unsigned char* data = stbi_load(imagePath.c_str(), &width, &height, &channels, 3);
-    if (!data) {
-        throw std::runtime_error("Failed to load image: " + imagePath);
+// Per-tile partial sums, one cache line apart so workers never share a line
+struct alignas(64) TileMoments {
+    PixelMoments moments;
+};
+
+// Accumulate the image in row tiles on the shared pool. Partials are merged
+// in tile order, so the result does not depend on scheduling.
+static PixelMoments accumulateTiled(const unsigned char* rgb, int width, int height) {
+    const size_t numPixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+    const int threads = featureThreads();
+    if (threads <= 1 || numPixels < PARALLEL_MIN_PIXELS) {
+        PixelMoments moments;
+        accumulatePixels(rgb, numPixels, moments);
+        return moments;
     }
 
-    const int numPixels = width * height;
-    
-    // Accumulate RGB for averages
-    long long sumR = 0, sumG = 0, sumB = 0;
-    
-    // Accumulate HSV for averages
-    double sumHue = 0.0, sumSat = 0.0;
-    
-    // Accumulate for colorfulness metric
-    double sumRG = 0.0, sumYB = 0.0;
-    double sumRG_sq = 0.0, sumYB_sq = 0.0;
-    
-    // Accumulate for contrast
-    std::vector<float> grayValues;
-    grayValues.reserve(numPixels);
-    
-    for (int i = 0; i < numPixels; ++i) {
-        unsigned char rByte = data[3 * i + 0];
-        unsigned char gByte = data[3 * i + 1];
-        unsigned char bByte = data[3 * i + 2];
-
-        // Normalize to [0, 1]
-        float r = rByte / 255.0f;
-        float g = gByte / 255.0f;
-        float b = bByte / 255.0f;
-
-        sumR += rByte;
-        sumG += gByte;
-        sumB += bByte;
-
-        // HSV conversion
-        float h, s, v;
-        rgbToHsv(r, g, b, h, s, v);
-        sumHue += h;  // H is in [0, 360]
-        sumSat += s;  // S is in [0, 1]
-
-        // Colorfulness: opponent color space (Hasler & Süsstrunk 2003)
-        // rg = R - G
-        // yb = 0.5 * (R + G) - B
-        float rg = r - g;
-        float yb = 0.5f * (r + g) - b;
-        
-        sumRG += rg;
-        sumYB += yb;
-        sumRG_sq += rg * rg;
-        sumYB_sq += yb * yb;
-
-        // Grayscale for contrast
-        float gray = 0.299f * r + 0.587f * g + 0.114f * b;
-        grayValues.push_back(gray);
+    const int rowsPerTile = std::max(MIN_TILE_ROWS, height / (threads * TILES_PER_WORKER) + 1);
+    const size_t numTiles = static_cast<size_t>((height + rowsPerTile - 1) / rowsPerTile);
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+
+    std::vector<TileMoments> tiles(numTiles);
+    sharedWorkerPool().parallelFor(numTiles, static_cast<size_t>(threads), [&](size_t t) {
+        int rowBegin = static_cast<int>(t) * rowsPerTile;
+        int rows = std::min(rowsPerTile, height - rowBegin);
+        accumulatePixels(rgb + rowBegin * rowBytes, static_cast<size_t>(rows) * width,
+                         tiles[t].moments);
+    });
+
+    PixelMoments moments;
+    for (const TileMoments& tile : tiles) {
+        mergePixelMoments(moments, tile.moments);
     }
+    return moments;
+}
 
-    stbi_image_free(data);
+// Turn the accumulated moments into the normalized feature vector
+static ImageFeatures finalizeFeatures(const PixelMoments& m, size_t numPixels) {
+    const double n = static_cast<double>(numPixels);
 
     // === Basic RGB features ===
-    float avgR = static_cast<float>(sumR) / (255.0f * numPixels);
-    float avgG = static_cast<float>(sumG) / (255.0f * numPixels);
-    float avgB = static_cast<float>(sumB) / (255.0f * numPixels);
+    float avgR = static_cast<float>(m.sumR / (255.0 * n));
+    float avgG = static_cast<float>(m.sumG / (255.0 * n));
+    float avgB = static_cast<float>(m.sumB / (255.0 * n));
     float brightness = (avgR + avgG + avgB) / 3.0f;
 
     // === HSV features ===
-    float hue = static_cast<float>(sumHue) / numPixels;  // Average hue in [0, 360]
+    float hue = static_cast<float>(m.sumHue / n);  // Average hue in [0, 360]
     hue = hue / 360.0f;  // Normalize to [0, 1]
-    
-    float saturation = static_cast<float>(sumSat) / numPixels;  // Already [0, 1]
+
+    float saturation = static_cast<float>(m.sumSat / n);  // Already [0, 1]
 
     // === Colorfulness metric ===
-    // Mean and std dev of rg and yb
-    float meanRG = static_cast<float>(sumRG) / numPixels;
-    float meanYB = static_cast<float>(sumYB) / numPixels;
-    
-    float varianceRG = (static_cast<float>(sumRG_sq) / numPixels) - (meanRG * meanRG);
-    float varianceYB = (static_cast<float>(sumYB_sq) / numPixels) - (meanYB * meanYB);
-    
-    float stdRG = std::sqrt(std::max(0.0f, varianceRG));
-    float stdYB = std::sqrt(std::max(0.0f, varianceYB));
-    
+    // Mean and std dev of rg and yb (variance in double: E[x^2] - E[x]^2)
+    double meanRG = m.sumRG / n;
+    double meanYB = m.sumYB / n;
+
+    double varianceRG = m.sumRG_sq / n - meanRG * meanRG;
+    double varianceYB = m.sumYB_sq / n - meanYB * meanYB;
+
+    double stdRG = std::sqrt(std::max(0.0, varianceRG));
+    double stdYB = std::sqrt(std::max(0.0, varianceYB));
+
     // Colorfulness formula: sqrt(std_rg^2 + std_yb^2) + 0.3 * sqrt(mean_rg^2 + mean_yb^2)
-    float colorfulness = std::sqrt(stdRG * stdRG + stdYB * stdYB) + 
-                        0.3f * std::sqrt(meanRG * meanRG + meanYB * meanYB);
-    
+    float colorfulness = static_cast<float>(std::sqrt(stdRG * stdRG + stdYB * stdYB) +
+                                            0.3 * std::sqrt(meanRG * meanRG + meanYB * meanYB));
+
     // Normalize colorfulness: typical range is 0-100, clamp to [0, 1]
     colorfulness = std::min(colorfulness / 100.0f, 1.0f);
 
     // === Contrast: standard deviation of grayscale ===
-    float meanGray = 0.0f;
-    for (float g : grayValues) {
-        meanGray += g;
-    }
-    meanGray /= numPixels;
+    double meanGray = m.sumGray / n;
+    double varianceGray = m.sumGray_sq / n - meanGray * meanGray;
 
-    float varianceGray = 0.0f;
-    for (float g : grayValues) {
-        float diff = g - meanGray;
-        varianceGray += diff * diff;
-    }
-    varianceGray /= numPixels;
-
-    float contrast = std::sqrt(varianceGray);  // Already normalized to [0, 1] range
+    float contrast = static_cast<float>(std::sqrt(std::max(0.0, varianceGray)));  // Already normalized to [0, 1] range
 
     // === Phase 9: Warmth calculation ===
     // Warmth: ratio of warm colors (red/orange: hue 0-60 deg) vs cool (blue/cyan: 180-240 deg)
@@ -175,3 +159,120 @@ ImageFeatures extractImageFeatures(const std::string& imagePath) {
         warmth
     };
 }
+
+// Stratified subset for fast mode: every stride-th row, and within it every
+// stride-th pixel starting at a per-row offset so columns don't alias.
+// Sampled pixels are gathered into a row buffer for the SIMD kernel.
+static PixelMoments accumulateSampled(const unsigned char* rgb, int width, int height,
+                                      size_t stride, size_t& numSampled) {
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+    std::vector<unsigned char> row(3 * (static_cast<size_t>(width) / stride + 1));
+
+    PixelMoments moments;
+    numSampled = 0;
+    size_t rowIndex = 0;
+    for (size_t y = stride / 2; y < static_cast<size_t>(height); y += stride, ++rowIndex) {
+        const unsigned char* src = rgb + y * rowBytes;
+        size_t offset = (stride / 2 + rowIndex * 5) % stride;  // 5: coprime-ish row jitter
+        size_t count = 0;
+        for (size_t x = offset; x < static_cast<size_t>(width); x += stride, ++count) {
+            row[3 * count + 0] = src[3 * x + 0];
+            row[3 * count + 1] = src[3 * x + 1];
+            row[3 * count + 2] = src[3 * x + 2];
+        }
+        accumulatePixels(row.data(), count, moments);
+        numSampled += count;
+    }
+    return moments;
+}
+
+// Compute features from a decoded RGB buffer, then free it
+static ImageFeatures featuresFromDecoded(unsigned char* data, int width, int height,
+                                         const FeatureOptions& options) {
+    size_t numPixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+
+    // Grid stride giving roughly pixelBudget samples (1 = use every pixel)
+    size_t stride = 1;
+    if (options.fast && options.pixelBudget > 0 && numPixels > options.pixelBudget) {
+        stride = static_cast<size_t>(std::ceil(
+            std::sqrt(static_cast<double>(numPixels) / static_cast<double>(options.pixelBudget))));
+    }
+
+    PixelMoments moments;
+    try {
+        if (stride > 1) {
+            moments = accumulateSampled(data, width, height, stride, numPixels);
+        } else {
+            moments = accumulateTiled(data, width, height);
+        }
+    } catch (...) {
+        stbi_image_free(data);
+        throw;
+    }
+
+    stbi_image_free(data);
+
+    return finalizeFeatures(moments, numPixels);
+}
+
+// Conservative peak of a stb_image decode to RGB. PNG is the worst case:
+// the inflated rows, the unfiltered image and the RGB conversion are all
+// live at once (JPEG holds its component planes plus the output)
+static size_t decodePeakBytes(int width, int height, int channels, bool sixteenBit) {
+    size_t pixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+    size_t sample = sixteenBit ? 2 : 1;
+    return pixels * (2 * static_cast<size_t>(std::max(channels, 1)) * sample + 3) + (64 << 10);
+}
+
+// Reserve the decode's estimated peak in the shared memory budget before
+// decoding, from the dimensions in the image header. Waits, or throws
+// MemoryBudgetExceeded. Headers stb_image can't parse reserve nothing;
+// the decode reports those.
+static MemoryBudget::Reservation reserveDecode(bool probed, int width, int height, int channels,
+                                               bool sixteenBit) {
+    if (!probed) return MemoryBudget::Reservation();
+    StageTimer timer(Stage::MEMORY_WAIT);
+    return sharedMemoryBudget().acquire(
+        decodePeakBytes(width, height, channels, sixteenBit),
+        "Decoding a " + std::to_string(width) + "x" + std::to_string(height) + " image");
+}
+
+ImageFeatures extractImageFeatures(const std::string& imagePath, const FeatureOptions& options) {
+    int width, height, channels;
+    MemoryBudget::Reservation reservation;
+    if (sharedMemoryBudget().enabled()) {
+        bool probed = stbi_info(imagePath.c_str(), &width, &height, &channels) != 0;
+        reservation = reserveDecode(probed, width, height, channels,
+                                    probed && stbi_is_16_bit(imagePath.c_str()));
+    }
+
+    StageTimer timer(Stage::FEATURES);
+    unsigned char* data = stbi_load(imagePath.c_str(), &width, &height, &channels, 3);
+    if (!data) {
+        throw std::runtime_error("Failed to load image: " + imagePath);
+    }
+    return featuresFromDecoded(data, width, height, options);
+}
+
+ImageFeatures extractImageFeaturesFromMemory(const unsigned char* bytes, size_t size,
+                                             const FeatureOptions& options) {
+    if (size > static_cast<size_t>(INT_MAX)) {
+        throw std::runtime_error("Image data too large to decode");
+    }
+    int width, height, channels;
+    MemoryBudget::Reservation reservation;
+    if (sharedMemoryBudget().enabled()) {
+        int length = static_cast<int>(size);
+        bool probed = stbi_info_from_memory(bytes, length, &width, &height, &channels) != 0;
+        reservation = reserveDecode(probed, width, height, channels,
+                                    probed && stbi_is_16_bit_from_memory(bytes, length));
+    }
+
+    StageTimer timer(Stage::FEATURES);
+    unsigned char* data = stbi_load_from_memory(bytes, static_cast<int>(size),
+                                                &width, &height, &channels, 3);
+    if (!data) {
+        throw std::runtime_error(std::string("Failed to decode image: ") + stbi_failure_reason());
+    }
+    return featuresFromDecoded(data, width, height, options);
+}
@@ -0,0 +1,387 @@
+#include "ImageKernels.hpp"
+#include "SimdDispatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SC_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SC_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Vector paths keep float partial sums per lane and fold them into the
+// double moments every FLUSH_PIXELS pixels, which bounds float rounding to
+// a few hundred additions per lane.
+constexpr std::size_t FLUSH_PIXELS = 256;
+
+constexpr float INV_255 = 1.0f / 255.0f;
+
+// Convert RGB [0,1] to HSV [H: 0-360, S: 0-1, V: 0-1]
+void rgbToHsv(float r, float g, float b, float& h, float& s, float& v) {
+    float cmax = std::max({r, g, b});
+    float cmin = std::min({r, g, b});
+    float delta = cmax - cmin;
+
+    // Value
+    v = cmax;
+
+    // Saturation
+    if (cmax == 0.0f) {
+        s = 0.0f;
+    } else {
+        s = delta / cmax;
+    }
+
+    // Hue
+    if (delta == 0.0f) {
+        h = 0.0f;  // undefined, but we'll use 0
+    } else if (cmax == r) {
+        h = 60.0f * fmodf(((g - b) / delta), 6.0f);
+    } else if (cmax == g) {
+        h = 60.0f * (((b - r) / delta) + 2.0f);
+    } else {
+        h = 60.0f * (((r - g) / delta) + 4.0f);
+    }
+
+    if (h < 0.0f) h += 360.0f;
+}
+
+void accumulatePixelsScalar(const unsigned char* rgb, std::size_t begin, std::size_t end,
+                            PixelMoments& m) {
+    for (std::size_t i = begin; i < end; ++i) {
+        unsigned char rByte = rgb[3 * i + 0];
+        unsigned char gByte = rgb[3 * i + 1];
+        unsigned char bByte = rgb[3 * i + 2];
+
+        // Normalize to [0, 1]
+        float r = rByte / 255.0f;
+        float g = gByte / 255.0f;
+        float b = bByte / 255.0f;
+
+        m.sumR += rByte;
+        m.sumG += gByte;
+        m.sumB += bByte;
+
+        // HSV conversion
+        float h, s, v;
+        rgbToHsv(r, g, b, h, s, v);
+        m.sumHue += h;
+        m.sumSat += s;
+
+        // Colorfulness: opponent color space (Hasler & Süsstrunk 2003)
+        float rg = r - g;
+        float yb = 0.5f * (r + g) - b;
+
+        m.sumRG += rg;
+        m.sumYB += yb;
+        m.sumRG_sq += rg * rg;
+        m.sumYB_sq += yb * yb;
+
+        // Grayscale for contrast
+        float gray = 0.299f * r + 0.587f * g + 0.114f * b;
+        m.sumGray += gray;
+        m.sumGray_sq += static_cast<double>(gray) * gray;
+    }
+}
+
+// Lane-wise partial sums shared by the vector paths (8 lanes each)
+struct LaneSums {
+    std::int32_t r[8], g[8], b[8];
+    float hue[8], sat[8];
+    float rg[8], yb[8], rgSq[8], ybSq[8];
+    float gray[8], graySq[8];
+};
+
+void flushLanes(const LaneSums& l, PixelMoments& m) {
+    for (int k = 0; k < 8; ++k) {
+        m.sumR += l.r[k];
+        m.sumG += l.g[k];
+        m.sumB += l.b[k];
+        m.sumHue += l.hue[k];
+        m.sumSat += l.sat[k];
+        m.sumRG += l.rg[k];
+        m.sumYB += l.yb[k];
+        m.sumRG_sq += l.rgSq[k];
+        m.sumYB_sq += l.ybSq[k];
+        m.sumGray += l.gray[k];
+        m.sumGray_sq += l.graySq[k];
+    }
+}
+
+// --- x86: AVX2 ---
+
+#if defined(SC_SIMD_X86)
+
+// pshufb masks that gather one channel of 8 RGB pixels (24 bytes) from a
+// 16-byte low load and an 8-byte high load. 0x80 zeroes the byte.
+alignas(16) const std::int8_t SHUF_LO[3][16] = {
+    {0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+    {1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+    {2, 5, 8, 11, 14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+};
+alignas(16) const std::int8_t SHUF_HI[3][16] = {
+    {-128, -128, -128, -128, -128, -128, 2, 5, -128, -128, -128, -128, -128, -128, -128, -128},
+    {-128, -128, -128, -128, -128, 0, 3, 6, -128, -128, -128, -128, -128, -128, -128, -128},
+    {-128, -128, -128, -128, -128, 1, 4, 7, -128, -128, -128, -128, -128, -128, -128, -128},
+};
+
+__attribute__((target("avx2")))
+void accumulatePixelsAvx2(const unsigned char* rgb, std::size_t numPixels, PixelMoments& m) {
+    const __m128i loR = _mm_load_si128(reinterpret_cast<const __m128i*>(SHUF_LO[0]));
+    const __m128i loG = _mm_load_si128(reinterpret_cast<const __m128i*>(SHUF_LO[1]));
+    const __m128i loB = _mm_load_si128(reinterpret_cast<const __m128i*>(SHUF_LO[2]));
+    const __m128i hiR = _mm_load_si128(reinterpret_cast<const __m128i*>(SHUF_HI[0]));
+    const __m128i hiG = _mm_load_si128(reinterpret_cast<const __m128i*>(SHUF_HI[1]));
+    const __m128i hiB = _mm_load_si128(reinterpret_cast<const __m128i*>(SHUF_HI[2]));
+
+    const __m256 vInv255 = _mm256_set1_ps(INV_255);
+    const __m256 vZero = _mm256_setzero_ps();
+    const __m256 vOne = _mm256_set1_ps(1.0f);
+    const __m256 vTwo = _mm256_set1_ps(2.0f);
+    const __m256 vFour = _mm256_set1_ps(4.0f);
+    const __m256 vSixty = _mm256_set1_ps(60.0f);
+    const __m256 v360 = _mm256_set1_ps(360.0f);
+    const __m256 vHalf = _mm256_set1_ps(0.5f);
+    const __m256 vWr = _mm256_set1_ps(0.299f);
+    const __m256 vWg = _mm256_set1_ps(0.587f);
+    const __m256 vWb = _mm256_set1_ps(0.114f);
+
+    std::size_t i = 0;
+    while (i + 8 <= numPixels) {
+        std::size_t blockEnd = std::min(numPixels, i + FLUSH_PIXELS);
+
+        __m256i accR = _mm256_setzero_si256(), accG = accR, accB = accR;
+        __m256 accHue = vZero, accSat = vZero;
+        __m256 accRG = vZero, accYB = vZero, accRGSq = vZero, accYBSq = vZero;
+        __m256 accGray = vZero, accGraySq = vZero;
+
+        for (; i + 8 <= blockEnd; i += 8) {
+            const unsigned char* p = rgb + 3 * i;
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i hi = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 16));
+
+            __m256i ri = _mm256_cvtepu8_epi32(
+                _mm_or_si128(_mm_shuffle_epi8(lo, loR), _mm_shuffle_epi8(hi, hiR)));
+            __m256i gi = _mm256_cvtepu8_epi32(
+                _mm_or_si128(_mm_shuffle_epi8(lo, loG), _mm_shuffle_epi8(hi, hiG)));
+            __m256i bi = _mm256_cvtepu8_epi32(
+                _mm_or_si128(_mm_shuffle_epi8(lo, loB), _mm_shuffle_epi8(hi, hiB)));
+
+            accR = _mm256_add_epi32(accR, ri);
+            accG = _mm256_add_epi32(accG, gi);
+            accB = _mm256_add_epi32(accB, bi);
+
+            __m256 r = _mm256_mul_ps(_mm256_cvtepi32_ps(ri), vInv255);
+            __m256 g = _mm256_mul_ps(_mm256_cvtepi32_ps(gi), vInv255);
+            __m256 b = _mm256_mul_ps(_mm256_cvtepi32_ps(bi), vInv255);
+
+            // HSV: pick the hue sector by which channel is the max (r wins ties,
+            // then g, as in rgbToHsv). Zero deltas/maxima divide by one instead.
+            __m256 cmax = _mm256_max_ps(r, _mm256_max_ps(g, b));
+            __m256 cmin = _mm256_min_ps(r, _mm256_min_ps(g, b));
+            __m256 delta = _mm256_sub_ps(cmax, cmin);
+
+            __m256 isR = _mm256_cmp_ps(cmax, r, _CMP_EQ_OQ);
+            __m256 isG = _mm256_andnot_ps(isR, _mm256_cmp_ps(cmax, g, _CMP_EQ_OQ));
+            __m256 num = _mm256_blendv_ps(_mm256_sub_ps(r, g), _mm256_sub_ps(b, r), isG);
+            num = _mm256_blendv_ps(num, _mm256_sub_ps(g, b), isR);
+            __m256 offset = _mm256_blendv_ps(vFour, vTwo, isG);
+            offset = _mm256_blendv_ps(offset, vZero, isR);
+
+            __m256 hasDelta = _mm256_cmp_ps(delta, vZero, _CMP_GT_OQ);
+            __m256 safeDelta = _mm256_blendv_ps(vOne, delta, hasDelta);
+            __m256 h = _mm256_mul_ps(vSixty, _mm256_add_ps(_mm256_div_ps(num, safeDelta), offset));
+            h = _mm256_and_ps(h, hasDelta);
+            h = _mm256_add_ps(h, _mm256_and_ps(v360, _mm256_cmp_ps(h, vZero, _CMP_LT_OQ)));
+
+            __m256 safeMax = _mm256_blendv_ps(vOne, cmax, _mm256_cmp_ps(cmax, vZero, _CMP_GT_OQ));
+            __m256 s = _mm256_div_ps(delta, safeMax);
+
+            accHue = _mm256_add_ps(accHue, h);
+            accSat = _mm256_add_ps(accSat, s);
+
+            // Opponent channels
+            __m256 rg = _mm256_sub_ps(r, g);
+            __m256 yb = _mm256_sub_ps(_mm256_mul_ps(vHalf, _mm256_add_ps(r, g)), b);
+            accRG = _mm256_add_ps(accRG, rg);
+            accYB = _mm256_add_ps(accYB, yb);
+            accRGSq = _mm256_add_ps(accRGSq, _mm256_mul_ps(rg, rg));
+            accYBSq = _mm256_add_ps(accYBSq, _mm256_mul_ps(yb, yb));
+
+            // Grayscale
+            __m256 gray = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vWr, r), _mm256_mul_ps(vWg, g)),
+                                        _mm256_mul_ps(vWb, b));
+            accGray = _mm256_add_ps(accGray, gray);
+            accGraySq = _mm256_add_ps(accGraySq, _mm256_mul_ps(gray, gray));
+        }
+
+        LaneSums l;
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(l.r), accR);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(l.g), accG);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(l.b), accB);
+        _mm256_storeu_ps(l.hue, accHue);
+        _mm256_storeu_ps(l.sat, accSat);
+        _mm256_storeu_ps(l.rg, accRG);
+        _mm256_storeu_ps(l.yb, accYB);
+        _mm256_storeu_ps(l.rgSq, accRGSq);
+        _mm256_storeu_ps(l.ybSq, accYBSq);
+        _mm256_storeu_ps(l.gray, accGray);
+        _mm256_storeu_ps(l.graySq, accGraySq);
+        flushLanes(l, m);
+    }
+    accumulatePixelsScalar(rgb, i, numPixels, m);
+}
+
+#endif  // SC_SIMD_X86
+
+// --- ARM: NEON (two float32x4 halves per 8 pixels) ---
+
+#if defined(SC_SIMD_NEON)
+
+struct NeonHsv {
+    float32x4_t h, s;
+};
+
+inline NeonHsv hsvNeon(float32x4_t r, float32x4_t g, float32x4_t b) {
+    const float32x4_t vZero = vdupq_n_f32(0.0f);
+    const float32x4_t vOne = vdupq_n_f32(1.0f);
+
+    float32x4_t cmax = vmaxq_f32(r, vmaxq_f32(g, b));
+    float32x4_t cmin = vminq_f32(r, vminq_f32(g, b));
+    float32x4_t delta = vsubq_f32(cmax, cmin);
+
+    uint32x4_t isR = vceqq_f32(cmax, r);
+    uint32x4_t isG = vbicq_u32(vceqq_f32(cmax, g), isR);
+    float32x4_t num = vbslq_f32(isG, vsubq_f32(b, r), vsubq_f32(r, g));
+    num = vbslq_f32(isR, vsubq_f32(g, b), num);
+    float32x4_t offset = vbslq_f32(isG, vdupq_n_f32(2.0f), vdupq_n_f32(4.0f));
+    offset = vbslq_f32(isR, vZero, offset);
+
+    uint32x4_t hasDelta = vcgtq_f32(delta, vZero);
+    float32x4_t safeDelta = vbslq_f32(hasDelta, delta, vOne);
+    float32x4_t h = vmulq_f32(vdupq_n_f32(60.0f), vaddq_f32(vdivq_f32(num, safeDelta), offset));
+    h = vbslq_f32(hasDelta, h, vZero);
+    h = vaddq_f32(h, vbslq_f32(vcltq_f32(h, vZero), vdupq_n_f32(360.0f), vZero));
+
+    float32x4_t safeMax = vbslq_f32(vcgtq_f32(cmax, vZero), cmax, vOne);
+    return {h, vdivq_f32(delta, safeMax)};
+}
+
+void accumulatePixelsNeon(const unsigned char* rgb, std::size_t numPixels, PixelMoments& m) {
+    const float32x4_t vInv255 = vdupq_n_f32(INV_255);
+    const float32x4_t vHalf = vdupq_n_f32(0.5f);
+    const float32x4_t vWr = vdupq_n_f32(0.299f);
+    const float32x4_t vWg = vdupq_n_f32(0.587f);
+    const float32x4_t vWb = vdupq_n_f32(0.114f);
+
+    std::size_t i = 0;
+    while (i + 8 <= numPixels) {
+        std::size_t blockEnd = std::min(numPixels, i + FLUSH_PIXELS);
+
+        // [0] = pixels 0-3 of each group, [1] = pixels 4-7
+        uint32x4_t accR[2] = {vdupq_n_u32(0), vdupq_n_u32(0)};
+        uint32x4_t accG[2] = {vdupq_n_u32(0), vdupq_n_u32(0)};
+        uint32x4_t accB[2] = {vdupq_n_u32(0), vdupq_n_u32(0)};
+        float32x4_t accHue[2], accSat[2], accRG[2], accYB[2];
+        float32x4_t accRGSq[2], accYBSq[2], accGray[2], accGraySq[2];
+        for (int k = 0; k < 2; ++k) {
+            accHue[k] = accSat[k] = accRG[k] = accYB[k] = vdupq_n_f32(0.0f);
+            accRGSq[k] = accYBSq[k] = accGray[k] = accGraySq[k] = vdupq_n_f32(0.0f);
+        }
+
+        for (; i + 8 <= blockEnd; i += 8) {
+            uint8x8x3_t px = vld3_u8(rgb + 3 * i);  // de-interleaves R, G, B
+            uint16x8_t r16 = vmovl_u8(px.val[0]);
+            uint16x8_t g16 = vmovl_u8(px.val[1]);
+            uint16x8_t b16 = vmovl_u8(px.val[2]);
+
+            for (int k = 0; k < 2; ++k) {
+                uint32x4_t ri = vmovl_u16(k == 0 ? vget_low_u16(r16) : vget_high_u16(r16));
+                uint32x4_t gi = vmovl_u16(k == 0 ? vget_low_u16(g16) : vget_high_u16(g16));
+                uint32x4_t bi = vmovl_u16(k == 0 ? vget_low_u16(b16) : vget_high_u16(b16));
+                accR[k] = vaddq_u32(accR[k], ri);
+                accG[k] = vaddq_u32(accG[k], gi);
+                accB[k] = vaddq_u32(accB[k], bi);
+
+                float32x4_t r = vmulq_f32(vcvtq_f32_u32(ri), vInv255);
+                float32x4_t g = vmulq_f32(vcvtq_f32_u32(gi), vInv255);
+                float32x4_t b = vmulq_f32(vcvtq_f32_u32(bi), vInv255);
+
+                NeonHsv hsv = hsvNeon(r, g, b);
+                accHue[k] = vaddq_f32(accHue[k], hsv.h);
+                accSat[k] = vaddq_f32(accSat[k], hsv.s);
+
+                float32x4_t rg = vsubq_f32(r, g);
+                float32x4_t yb = vsubq_f32(vmulq_f32(vHalf, vaddq_f32(r, g)), b);
+                accRG[k] = vaddq_f32(accRG[k], rg);
+                accYB[k] = vaddq_f32(accYB[k], yb);
+                accRGSq[k] = vaddq_f32(accRGSq[k], vmulq_f32(rg, rg));
+                accYBSq[k] = vaddq_f32(accYBSq[k], vmulq_f32(yb, yb));
+
+                float32x4_t gray = vaddq_f32(vaddq_f32(vmulq_f32(vWr, r), vmulq_f32(vWg, g)),
+                                             vmulq_f32(vWb, b));
+                accGray[k] = vaddq_f32(accGray[k], gray);
+                accGraySq[k] = vaddq_f32(accGraySq[k], vmulq_f32(gray, gray));
+            }
+        }
+
+        LaneSums l;
+        for (int k = 0; k < 2; ++k) {
+            vst1q_s32(l.r + 4 * k, vreinterpretq_s32_u32(accR[k]));
+            vst1q_s32(l.g + 4 * k, vreinterpretq_s32_u32(accG[k]));
+            vst1q_s32(l.b + 4 * k, vreinterpretq_s32_u32(accB[k]));
+            vst1q_f32(l.hue + 4 * k, accHue[k]);
+            vst1q_f32(l.sat + 4 * k, accSat[k]);
+            vst1q_f32(l.rg + 4 * k, accRG[k]);
+            vst1q_f32(l.yb + 4 * k, accYB[k]);
+            vst1q_f32(l.rgSq + 4 * k, accRGSq[k]);
+            vst1q_f32(l.ybSq + 4 * k, accYBSq[k]);
+            vst1q_f32(l.gray + 4 * k, accGray[k]);
+            vst1q_f32(l.graySq + 4 * k, accGraySq[k]);
+        }
+        flushLanes(l, m);
+    }
+    accumulatePixelsScalar(rgb, i, numPixels, m);
+}
+
+#endif  // SC_SIMD_NEON
+
+}  // namespace
+
+void accumulatePixels(const unsigned char* rgb, std::size_t numPixels, PixelMoments& m) {
+    switch (activeSimdLevel()) {
+#if defined(SC_SIMD_X86)
+        case SimdLevel::AVX2:
+            accumulatePixelsAvx2(rgb, numPixels, m);
+            return;
+#endif
+#if defined(SC_SIMD_NEON)
+        case SimdLevel::NEON:
+            accumulatePixelsNeon(rgb, numPixels, m);
+            return;
+#endif
+        default:
+            accumulatePixelsScalar(rgb, 0, numPixels, m);
+            return;
+    }
+}
+
+void mergePixelMoments(PixelMoments& total, const PixelMoments& part) {
+    total.sumR += part.sumR;
+    total.sumG += part.sumG;
+    total.sumB += part.sumB;
+    total.sumHue += part.sumHue;
+    total.sumSat += part.sumSat;
+    total.sumRG += part.sumRG;
+    total.sumYB += part.sumYB;
+    total.sumRG_sq += part.sumRG_sq;
+    total.sumYB_sq += part.sumYB_sq;
+    total.sumGray += part.sumGray;
+    total.sumGray_sq += part.sumGray_sq;
+}
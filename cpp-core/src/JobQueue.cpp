@@ -0,0 +1,208 @@
+#include "JobQueue.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iterator>
+#include <random>
+
+static long envLong(const char* key, long def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stol(v);
+    } catch (...) {
+        return def;
+    }
+}
+
+JobQueue::Options JobQueue::optionsFromEnv() {
+    Options o;
+    o.workers = static_cast<size_t>(
+        std::max(1L, envLong("SC_JOB_WORKERS", static_cast<long>(o.workers))));
+    o.maxQueued = static_cast<size_t>(
+        std::max(0L, envLong("SC_JOB_QUEUE_DEPTH", static_cast<long>(o.maxQueued))));
+    // A finished job must outlive the wake-up of whoever polls it
+    o.retention = std::chrono::seconds(
+        std::max(1L, envLong("SC_JOB_RETENTION_SECONDS", static_cast<long>(o.retention.count()))));
+    o.maxRetained = static_cast<size_t>(
+        std::max(1L, envLong("SC_JOB_MAX_RETAINED", static_cast<long>(o.maxRetained))));
+    return o;
+}
+
+const char* JobQueue::stateName(State state) {
+    switch (state) {
+        case State::QUEUED: return "queued";
+        case State::RUNNING: return "running";
+        case State::DONE: return "done";
+        case State::FAILED: return "failed";
+    }
+    return "unknown";
+}
+
+JobQueue::JobQueue(const Options& options) : options_(options) {
+    options_.workers = std::max<size_t>(options_.workers, 1);
+
+    // Random per-process prefix so ids from before a restart never resolve
+    // to a different job afterwards
+    std::random_device rd;
+    idPrefix_ = (static_cast<uint64_t>(rd()) << 32) ^ rd();
+
+    for (size_t i = 0; i < options_.workers; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+JobQueue::~JobQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workCv_.notify_all();
+    doneCv_.notify_all();
+    for (auto& t : workers_) {
+        t.join();
+    }
+}
+
+std::string JobQueue::submit(Work work, bool pinned) {
+    std::string id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || pending_.size() >= options_.maxQueued) return "";
+        pruneLocked(Clock::now());
+
+        char buf[33];
+        std::snprintf(buf, sizeof(buf), "%016llx%08llx",
+                      static_cast<unsigned long long>(idPrefix_),
+                      static_cast<unsigned long long>(nextId_++));
+        id = buf;
+
+        Job& job = jobs_[id];
+        job.snapshot.id = id;
+        job.work = std::move(work);
+        job.pinned = pinned;
+        pending_.push_back(id);
+    }
+    workCv_.notify_one();
+    return id;
+}
+
+bool JobQueue::get(const std::string& id, Snapshot& out) {
+    return waitFor(id, std::chrono::milliseconds(0), out);
+}
+
+bool JobQueue::waitFor(const std::string& id, std::chrono::milliseconds timeout,
+                       Snapshot& out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    pruneLocked(Clock::now());
+    auto finishedOrGone = [this, &id] {
+        auto it = jobs_.find(id);
+        return stopping_ || it == jobs_.end() ||
+               it->second.snapshot.state == State::DONE ||
+               it->second.snapshot.state == State::FAILED;
+    };
+    if (timeout.count() > 0) {
+        doneCv_.wait_for(lock, timeout, finishedOrGone);
+    }
+
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return false;
+    out = it->second.snapshot;
+    return true;
+}
+
+bool JobQueue::erase(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end() ||
+        (it->second.snapshot.state != State::DONE && it->second.snapshot.state != State::FAILED)) {
+        return false;
+    }
+    bool pinned = it->second.pinned;
+    jobs_.erase(it);
+    if (pinned) return true;
+    // Usually the most recently finished job, so search from the back
+    auto pos = std::find(finishedOrder_.rbegin(), finishedOrder_.rend(), id);
+    if (pos != finishedOrder_.rend()) finishedOrder_.erase(std::next(pos).base());
+    return true;
+}
+
+size_t JobQueue::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+size_t JobQueue::running() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+size_t JobQueue::retained() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finishedOrder_.size();
+}
+
+void JobQueue::workerLoop() {
+    for (;;) {
+        std::string id;
+        Work work;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workCv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (stopping_) return;
+            id = pending_.front();
+            pending_.pop_front();
+            Job& job = jobs_[id];
+            job.snapshot.state = State::RUNNING;
+            work = std::move(job.work);
+            ++running_;
+        }
+
+        Snapshot outcome;
+        try {
+            outcome.result = work();
+            outcome.state = State::DONE;
+        } catch (const RequestError& ex) {
+            outcome.state = State::FAILED;
+            outcome.errorStatus = ex.status();
+            outcome.error = ex.what();
+        } catch (const std::exception& ex) {
+            outcome.state = State::FAILED;
+            outcome.errorStatus = 500;
+            outcome.error = std::string("Internal server error: ") + ex.what();
+        } catch (...) {
+            outcome.state = State::FAILED;
+            outcome.errorStatus = 500;
+            outcome.error = "Internal server error";
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --running_;
+            Job& job = jobs_[id];
+            job.snapshot.state = outcome.state;
+            job.snapshot.result = std::move(outcome.result);
+            job.snapshot.errorStatus = outcome.errorStatus;
+            job.snapshot.error = std::move(outcome.error);
+            job.finished = Clock::now();
+            if (!job.pinned) finishedOrder_.push_back(id);
+            pruneLocked(job.finished);
+        }
+        doneCv_.notify_all();
+    }
+}
+
+// Oldest finished jobs first: expired ones, then any over maxRetained
+void JobQueue::pruneLocked(Clock::time_point now) {
+    while (!finishedOrder_.empty()) {
+        auto it = jobs_.find(finishedOrder_.front());
+        if (it != jobs_.end() && finishedOrder_.size() <= options_.maxRetained &&
+            now - it->second.finished < options_.retention) {
+            break;
+        }
+        if (it != jobs_.end()) jobs_.erase(it);
+        finishedOrder_.pop_front();
+    }
+}
@@ -0,0 +1,568 @@
+#include "Log.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+// Bytes of encoded component, message and fields per ring slot; longer
+// lines are cut at a field boundary and marked truncated=true
+static const size_t kRecordBytes = 480;
+
+// Records formatted per write; bounds the writer's buffers
+static const size_t kBatchRecords = 256;
+
+// The writer re-checks the ring this often even without a wakeup
+static const std::chrono::milliseconds kWriterPoll(100);
+
+// ---------------------------------------------------------------------
+// LogField
+// ---------------------------------------------------------------------
+
+LogField& LogField::operator=(const LogField& other) {
+    key_ = other.key_;
+    numeric_ = other.numeric_;
+    size_ = other.size_;
+    if (other.text_) {
+        text_ = other.text_;
+    } else {
+        text_ = nullptr;
+        std::memcpy(buffer_, other.buffer_, sizeof(buffer_));
+    }
+    return *this;
+}
+
+void LogField::set(std::string_view text) {
+    text_ = text.data();
+    size_ = text.size();
+}
+
+void LogField::formatInteger(long long value) {
+    int n = std::snprintf(buffer_, sizeof(buffer_), "%lld", value);
+    size_ = n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+void LogField::formatFloat(double value) {
+    double magnitude = value < 0 ? -value : value;
+    const char* format = (magnitude == 0.0 || magnitude >= 0.001) ? "%.3f" : "%.3g";
+    int n = std::snprintf(buffer_, sizeof(buffer_), format, value);
+    size_ = n > 0 ? std::min(static_cast<size_t>(n), sizeof(buffer_) - 1) : 0;
+}
+
+// ---------------------------------------------------------------------
+// Records and ring slots
+// ---------------------------------------------------------------------
+
+/**
+ * One line in its raw form: length-prefixed component and message, then
+ * per field a kind byte ('s' or 'n'), key and value.
+ */
+struct Logger::Record {
+    int64_t timeNs;
+    uint8_t level;
+    uint8_t fieldCount;
+    bool truncated;
+    uint16_t size;
+    char data[kRecordBytes];
+};
+
+struct Logger::Slot {
+    std::atomic<uint64_t> sequence;
+    Record record;
+};
+
+namespace {
+
+thread_local LogContext* tlContext = nullptr;
+
+class RecordWriter {
+public:
+    RecordWriter(char* data, size_t capacity) : data_(data), capacity_(capacity) {}
+
+    bool fits(size_t bytes) const { return size_ + bytes <= capacity_; }
+
+    // u16 length + bytes; false if s didn't fit whole (when clip, the
+    // part that fits is still written)
+    bool string(std::string_view s, bool clip) {
+        bool whole = fits(2 + s.size());
+        if (!whole) {
+            if (!clip || !fits(2)) return false;
+            s = s.substr(0, capacity_ - size_ - 2);
+        }
+        uint16_t n = static_cast<uint16_t>(s.size());
+        std::memcpy(data_ + size_, &n, 2);
+        std::memcpy(data_ + size_ + 2, s.data(), n);
+        size_ += 2 + n;
+        return whole;
+    }
+
+    bool field(std::string_view key, std::string_view value, bool numeric) {
+        if (!fits(1 + 2 + key.size() + 2 + value.size())) return false;
+        data_[size_++] = numeric ? 'n' : 's';
+        string(key, false);
+        string(value, false);
+        return true;
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    char* data_;
+    size_t capacity_;
+    size_t size_ = 0;
+};
+
+class RecordReader {
+public:
+    RecordReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+    std::string_view string() {
+        uint16_t n = 0;
+        if (offset_ + 2 > size_) return {};
+        std::memcpy(&n, data_ + offset_, 2);
+        offset_ += 2;
+        n = static_cast<uint16_t>(std::min<size_t>(n, size_ - offset_));
+        std::string_view s(data_ + offset_, n);
+        offset_ += n;
+        return s;
+    }
+
+    char kind() { return offset_ < size_ ? data_[offset_++] : 's'; }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+};
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARN: return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+        case LogLevel::OFF: break;
+    }
+    return "OFF";
+}
+
+const char* levelNameLower(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG: return "debug";
+        case LogLevel::INFO: return "info";
+        case LogLevel::WARN: return "warn";
+        case LogLevel::ERROR: return "error";
+        case LogLevel::OFF: break;
+    }
+    return "off";
+}
+
+// 2026-01-02T03:04:05.678Z
+void appendTimestamp(std::string& out, int64_t timeNs) {
+    time_t seconds = static_cast<time_t>(timeNs / 1000000000);
+    int millis = static_cast<int>((timeNs / 1000000) % 1000);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                          utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour,
+                          utc.tm_min, utc.tm_sec, millis);
+    if (n > 0) out.append(buf, std::min(static_cast<size_t>(n), sizeof(buf) - 1));
+}
+
+// logfmt: bare unless empty or containing spaces, quotes, '=' or controls
+void appendTextValue(std::string& out, std::string_view value) {
+    bool quote = value.empty();
+    for (char c : value) {
+        if (c == ' ' || c == '"' || c == '=' || static_cast<unsigned char>(c) < 0x20) {
+            quote = true;
+            break;
+        }
+    }
+    if (!quote) {
+        out.append(value);
+        return;
+    }
+    out += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += ' ';
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void appendJsonString(std::string& out, std::string_view value) {
+    static const char* hex = "0123456789abcdef";
+    out += '"';
+    for (char c : value) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\t') {
+            out += "\\t";
+        } else if (u < 0x20) {
+            out += "\\u00";
+            out += hex[u >> 4];
+            out += hex[u & 0xf];
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+bool parseLevel(const char* value, LogLevel& level) {
+    std::string s(value);
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (s == "debug") level = LogLevel::DEBUG;
+    else if (s == "info") level = LogLevel::INFO;
+    else if (s == "warn" || s == "warning") level = LogLevel::WARN;
+    else if (s == "error") level = LogLevel::ERROR;
+    else if (s == "off" || s == "none") level = LogLevel::OFF;
+    else return false;
+    return true;
+}
+
+size_t roundUpPowerOfTwo(size_t n) {
+    size_t p = 2;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------
+// Logger
+// ---------------------------------------------------------------------
+
+Logger::Options Logger::optionsFromEnv(Options options) {
+    if (const char* level = std::getenv("SC_LOG_LEVEL")) {
+        if (!parseLevel(level, options.level)) {
+            std::fprintf(stderr, "Warning: ignoring unknown SC_LOG_LEVEL=%s\n", level);
+        }
+    }
+    if (const char* format = std::getenv("SC_LOG_FORMAT")) {
+        std::string f(format);
+        if (f == "json") options.json = true;
+        else if (f == "text") options.json = false;
+        else std::fprintf(stderr, "Warning: ignoring unknown SC_LOG_FORMAT=%s\n", format);
+    }
+    if (const char* async = std::getenv("SC_LOG_ASYNC")) {
+        options.async = std::atoi(async) != 0;
+    }
+    return options;
+}
+
+Logger::Logger() = default;
+
+Logger::~Logger() {
+    stopWriter();
+}
+
+Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+void Logger::configure(const Options& options) {
+    stopWriter();
+    std::fflush(stdout);
+    options_ = options;
+    level_.store(static_cast<int>(options.level), std::memory_order_relaxed);
+    if (options_.async) startWriter();
+}
+
+void Logger::startWriter() {
+    size_t capacity = roundUpPowerOfTwo(std::max<size_t>(options_.capacity, 16));
+    slots_.reset(new Slot[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask_ = capacity - 1;
+    enqueuePos_.store(0, std::memory_order_relaxed);
+    dequeuePos_ = 0;
+    written_ = 0;
+    stopping_ = false;
+    writer_ = std::thread([this]() { writerLoop(); });
+}
+
+void Logger::stopWriter() {
+    if (!writer_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeCv_.notify_one();
+    writer_.join();
+    slots_.reset();
+}
+
+void Logger::log(LogLevel level, std::string_view component, std::string_view message,
+                 const LogField* fields, size_t count) {
+    if (!enabled(level) || level == LogLevel::OFF) return;
+
+    if (!writer_.joinable()) {
+        // Synchronous: format on the caller and write straight through
+        Record record;
+        encode(record, level, component, message, fields, count);
+        thread_local std::string line;
+        line.clear();
+        format(record, line);
+        std::lock_guard<std::mutex> lock(mutex_);
+        FILE* stream = level >= LogLevel::WARN ? stderr : stdout;
+        std::fwrite(line.data(), 1, line.size(), stream);
+        std::fflush(stream);
+        return;
+    }
+
+    // Claim a slot (Vyukov): its sequence equals pos when free
+    uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots_[pos & mask_];
+        uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);  // full
+            return;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    encode(slot->record, level, component, message, fields, count);
+    // Sequentially consistent with the writer announcing a wait before its
+    // last look at the ring, so a sleeping writer is always woken
+    slot->sequence.store(pos + 1, std::memory_order_seq_cst);
+    if (writerWaiting_.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wakeCv_.notify_one();
+    }
+}
+
+void Logger::encode(Record& record, LogLevel level, std::string_view component,
+                    std::string_view message, const LogField* fields, size_t count) const {
+    record.timeNs = nowNanos();
+    record.level = static_cast<uint8_t>(level);
+    record.fieldCount = 0;
+
+    // The request id of the thread's LogContext leads the fields
+    RecordWriter writer(record.data, kRecordBytes);
+    writer.string(component.substr(0, 64), true);
+    record.truncated = !writer.string(message, true);
+    if (LogContext* context = LogContext::current()) {
+        if (writer.field("request_id", context->requestId(), false)) ++record.fieldCount;
+    }
+    for (size_t i = 0; i < count && record.fieldCount < 255; ++i) {
+        if (!writer.field(fields[i].key(), fields[i].value(), fields[i].numeric())) {
+            record.truncated = true;
+            break;
+        }
+        ++record.fieldCount;
+    }
+    record.size = static_cast<uint16_t>(writer.size());
+}
+
+size_t Logger::drain(std::string& out, std::string& err) {
+    size_t n = 0;
+    while (n < kBatchRecords) {
+        Slot& slot = slots_[dequeuePos_ & mask_];
+        uint64_t seq = slot.sequence.load(std::memory_order_acquire);
+        if (seq != dequeuePos_ + 1) break;  // empty, or claimed but not yet published
+        format(slot.record, static_cast<LogLevel>(slot.record.level) >= LogLevel::WARN ? err : out);
+        slot.sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+        ++dequeuePos_;
+        ++n;
+    }
+    return n;
+}
+
+void Logger::write(std::string& out, std::string& err) {
+    if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+        out.clear();
+    }
+    if (!err.empty()) {
+        std::fwrite(err.data(), 1, err.size(), stderr);
+        std::fflush(stderr);
+        err.clear();
+    }
+}
+
+void Logger::writerLoop() {
+    std::string out;
+    std::string err;
+    uint64_t reportedDrops = dropped_.load(std::memory_order_relaxed);
+
+    for (;;) {
+        size_t n = drain(out, err);
+
+        uint64_t drops = dropped_.load(std::memory_order_relaxed);
+        if (drops != reportedDrops) {
+            Record record{};
+            record.timeNs = nowNanos();
+            record.level = static_cast<uint8_t>(LogLevel::WARN);
+            LogField field("count", drops - reportedDrops);
+            RecordWriter writer(record.data, kRecordBytes);
+            writer.string("Log", false);
+            writer.string("lines dropped, log ring full", false);
+            writer.field(field.key(), field.value(), true);
+            record.fieldCount = 1;
+            record.size = static_cast<uint16_t>(writer.size());
+            format(record, err);
+            reportedDrops = drops;
+        }
+
+        if (n > 0 || !out.empty() || !err.empty()) {
+            write(out, err);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                written_ = dequeuePos_;
+            }
+            flushedCv_.notify_all();
+            if (n == kBatchRecords) continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        writerWaiting_.store(true, std::memory_order_seq_cst);
+        Slot& next = slots_[dequeuePos_ & mask_];
+        bool pending = next.sequence.load(std::memory_order_seq_cst) == dequeuePos_ + 1;
+        if (!pending) {
+            if (stopping_ && enqueuePos_.load(std::memory_order_acquire) == dequeuePos_) {
+                writerWaiting_.store(false, std::memory_order_relaxed);
+                break;
+            }
+            wakeCv_.wait_for(lock, kWriterPoll);
+        }
+        writerWaiting_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Logger::flush() {
+    if (!writer_.joinable()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::fflush(stdout);
+        std::fflush(stderr);
+        return;
+    }
+    uint64_t target = enqueuePos_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(mutex_);
+    wakeCv_.notify_one();
+    flushedCv_.wait(lock, [&]() { return written_ >= target; });
+}
+
+void Logger::format(const Record& record, std::string& out) const {
+    RecordReader reader(record.data, record.size);
+    LogLevel level = static_cast<LogLevel>(record.level);
+    std::string_view component = reader.string();
+    std::string_view message = reader.string();
+
+    if (options_.json) {
+        out += "{\"ts\":\"";
+        appendTimestamp(out, record.timeNs);
+        out += "\",\"level\":\"";
+        out += levelNameLower(level);
+        out += "\",\"component\":";
+        appendJsonString(out, component);
+        out += ",\"msg\":";
+        appendJsonString(out, message);
+        for (uint8_t i = 0; i < record.fieldCount; ++i) {
+            bool numeric = reader.kind() == 'n';
+            std::string_view key = reader.string();
+            std::string_view value = reader.string();
+            out += ',';
+            appendJsonString(out, key);
+            out += ':';
+            if (numeric) {
+                out.append(value);
+            } else {
+                appendJsonString(out, value);
+            }
+        }
+        if (record.truncated) out += ",\"truncated\":true";
+        out += "}\n";
+        return;
+    }
+
+    if (options_.timestamps) {
+        appendTimestamp(out, record.timeNs);
+        out += ' ';
+    }
+    out += levelName(level);
+    out += " [";
+    out.append(component);
+    out += "] ";
+    out.append(message);
+    for (uint8_t i = 0; i < record.fieldCount; ++i) {
+        reader.kind();
+        std::string_view key = reader.string();
+        std::string_view value = reader.string();
+        out += ' ';
+        out.append(key);
+        out += '=';
+        appendTextValue(out, value);
+    }
+    if (record.truncated) out += " truncated=true";
+    out += '\n';
+}
+
+// ---------------------------------------------------------------------
+// LogContext
+// ---------------------------------------------------------------------
+
+LogContext::LogContext(std::string_view requestId) : previous_(tlContext) {
+    idSize_ = std::min(requestId.size(), sizeof(id_));
+    std::memcpy(id_, requestId.data(), idSize_);
+    tlContext = this;
+}
+
+LogContext::~LogContext() {
+    tlContext = previous_;
+}
+
+LogContext* LogContext::current() {
+    return tlContext;
+}
+
+void LogContext::addTiming(const char* name, std::chrono::nanoseconds elapsed) {
+    for (size_t i = 0; i < timings_; ++i) {
+        if (timingNames_[i] == name || std::strcmp(timingNames_[i], name) == 0) {
+            timingNanos_[i] += elapsed.count();
+            return;
+        }
+    }
+    if (timings_ == MAX_TIMINGS) return;
+    timingNames_[timings_] = name;
+    std::snprintf(timingKeys_[timings_], sizeof(timingKeys_[timings_]), "%s_ms", name);
+    timingNanos_[timings_] = elapsed.count();
+    ++timings_;
+}
+
+void LogContext::appendTimingFields(std::vector<LogField>& fields) const {
+    for (size_t i = 0; i < timings_; ++i) {
+        fields.emplace_back(timingKeys_[i], static_cast<double>(timingNanos_[i]) / 1e6);
+    }
+}
@@ -0,0 +1,110 @@
+#include "MemoryBudget.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+static long long envLongLong(const char* key, long long def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stoll(v);
+    } catch (...) {
+        std::cerr << "[WARN] Invalid " << key << " value, using default " << def << std::endl;
+        return def;
+    }
+}
+
+static std::string megabytes(size_t bytes) {
+    return std::to_string((bytes + (1 << 20) - 1) >> 20) + " MB";
+}
+
+MemoryBudget::Options MemoryBudget::optionsFromEnv() {
+    Options o;
+    o.budgetBytes = static_cast<size_t>(std::max(0LL, envLongLong("SC_MEMORY_BUDGET_BYTES", 0)));
+    o.maxWait = std::chrono::milliseconds(std::max(
+        0LL, envLongLong("SC_MEMORY_BUDGET_WAIT_MS", static_cast<long long>(o.maxWait.count()))));
+    return o;
+}
+
+MemoryBudget::MemoryBudget(const Options& options) : options_(options) {
+    stats_.budgetBytes = options_.budgetBytes;
+}
+
+MemoryBudget::Reservation MemoryBudget::acquire(size_t bytes, const std::string& what) {
+    if (!enabled() || bytes == 0) return Reservation();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (bytes > options_.budgetBytes) {
+        ++stats_.rejected;
+        throw MemoryBudgetExceeded(what + " needs about " + megabytes(bytes) +
+                                       ", more than the whole memory budget (" +
+                                       megabytes(options_.budgetBytes) + ")",
+                                   false);
+    }
+
+    // Admitted at once only when nobody is queued ahead
+    if (queue_.empty() && reserved_ + bytes <= options_.budgetBytes) {
+        reserved_ += bytes;
+        return Reservation(this, bytes);
+    }
+
+    ++stats_.waited;
+    auto self = queue_.insert(queue_.end(), bytes);
+    auto admissible = [&]() {
+        return self == queue_.begin() && reserved_ + bytes <= options_.budgetBytes;
+    };
+    bool admitted = cv_.wait_for(lock, options_.maxWait, admissible);
+    queue_.erase(self);
+    if (!admitted) {
+        ++stats_.timedOut;
+        cv_.notify_all();  // the next in line may fit now
+        throw MemoryBudgetExceeded(what + " waited " + std::to_string(options_.maxWait.count()) +
+                                       " ms for " + megabytes(bytes) + " of memory budget",
+                                   true);
+    }
+    reserved_ += bytes;
+    cv_.notify_all();  // the next in line may fit too
+    return Reservation(this, bytes);
+}
+
+void MemoryBudget::release(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reserved_ -= bytes;
+    }
+    cv_.notify_all();
+}
+
+MemoryBudget::Stats MemoryBudget::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s = stats_;
+    s.reservedBytes = reserved_;
+    s.waiting = queue_.size();
+    return s;
+}
+
+MemoryBudget::Reservation::Reservation(Reservation&& other) noexcept
+    : budget_(other.budget_), bytes_(other.bytes_) {
+    other.budget_ = nullptr;
+    other.bytes_ = 0;
+}
+
+MemoryBudget::Reservation& MemoryBudget::Reservation::operator=(Reservation&& other) noexcept {
+    if (this != &other) {
+        if (budget_) budget_->release(bytes_);
+        budget_ = std::exchange(other.budget_, nullptr);
+        bytes_ = std::exchange(other.bytes_, 0);
+    }
+    return *this;
+}
+
+MemoryBudget::Reservation::~Reservation() {
+    if (budget_) budget_->release(bytes_);
+}
+
+MemoryBudget& sharedMemoryBudget() {
+    static MemoryBudget budget(MemoryBudget::optionsFromEnv());
+    return budget;
+}
@@ -0,0 +1,102 @@
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+// 100 us .. 10 s: feature extraction and composition sit in the low
+// milliseconds, model calls and whole jobs further up
+const std::array<double, LatencyHistogram::BUCKETS> LatencyHistogram::kUpperBoundsSeconds = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+    0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+};
+
+static std::string formatNumber(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    return buf;
+}
+
+void LatencyHistogram::observe(std::chrono::nanoseconds elapsed) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    size_t bucket = 0;
+    while (bucket < BUCKETS && seconds > kUpperBoundsSeconds[bucket]) {
+        ++bucket;
+    }
+    counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+    sumNanos_.fetch_add(static_cast<uint64_t>(std::max<int64_t>(elapsed.count(), 0)),
+                        std::memory_order_relaxed);
+}
+
+void LatencyHistogram::appendPrometheus(std::string& out, const char* name,
+                                        const std::string& labels) const {
+    // Buckets are stored individually and made cumulative here, so _count
+    // always equals the +Inf bucket even while observe() runs concurrently
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= BUCKETS; ++i) {
+        cumulative += counts_[i].load(std::memory_order_relaxed);
+        out += name;
+        out += "_bucket{" + labels + ",le=\"";
+        out += i < BUCKETS ? formatNumber(kUpperBoundsSeconds[i]) : "+Inf";
+        out += "\"} " + std::to_string(cumulative) + "\n";
+    }
+    double sumSeconds = sumNanos_.load(std::memory_order_relaxed) / 1e9;
+    out += std::string(name) + "_sum{" + labels + "} " + formatNumber(sumSeconds) + "\n";
+    out += std::string(name) + "_count{" + labels + "} " + std::to_string(cumulative) + "\n";
+}
+
+const char* Metrics::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::IMAGE_LOAD: return "image_load";
+        case Stage::MEMORY_WAIT: return "memory_wait";
+        case Stage::FEATURES: return "features";
+        case Stage::MAP_MODEL: return "map_model";
+        case Stage::MAP_HEURISTIC: return "map_heuristic";
+        case Stage::PLAN: return "plan";
+        case Stage::COMPOSE: return "compose";
+        case Stage::MIDI_WRITE: return "midi_write";
+        case Stage::GENERATE: return "generate";
+        case Stage::COUNT: break;
+    }
+    return "unknown";
+}
+
+void appendPrometheusMetric(std::string& out, const char* name, const char* type,
+                            const char* help, double value) {
+    out += std::string("# HELP ") + name + " " + help + "\n";
+    out += std::string("# TYPE ") + name + " " + type + "\n";
+    out += std::string(name) + " " + formatNumber(value) + "\n";
+}
+
+void Metrics::appendPrometheus(std::string& out) const {
+    const char* histogram = "soundcanvas_stage_duration_seconds";
+    out += std::string("# HELP ") + histogram + " Time spent in each generation stage.\n";
+    out += std::string("# TYPE ") + histogram + " histogram\n";
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        std::string labels = std::string("stage=\"") + stageName(static_cast<Stage>(i)) + "\"";
+        stages_[i].appendPrometheus(out, histogram, labels);
+    }
+
+    appendPrometheusMetric(out, "soundcanvas_model_requests_total", "counter",
+                           "TF Serving requests attempted.",
+                           static_cast<double>(value(Counter::MODEL_REQUESTS)));
+    appendPrometheusMetric(out, "soundcanvas_model_errors_total", "counter",
+                           "TF Serving requests that failed, including circuit breaker rejections.",
+                           static_cast<double>(value(Counter::MODEL_ERRORS)));
+    appendPrometheusMetric(out, "soundcanvas_model_fallbacks_total", "counter",
+                           "Model-mode images mapped by the heuristic because the model failed.",
+                           static_cast<double>(value(Counter::MODEL_FALLBACKS)));
+    appendPrometheusMetric(out, "soundcanvas_bytes_written_total", "counter",
+                           "MIDI bytes written to disk.",
+                           static_cast<double>(value(Counter::BYTES_WRITTEN)));
+    appendPrometheusMetric(out, "soundcanvas_generate_coalesced_total", "counter",
+                           "/generate requests that waited for an identical one in flight.",
+                           static_cast<double>(value(Counter::GENERATE_COALESCED)));
+    appendPrometheusMetric(out, "soundcanvas_http_requests_in_flight", "gauge",
+                           "Generation requests currently being served.",
+                           static_cast<double>(inFlight_.load(std::memory_order_relaxed)));
+}
+
+Metrics& metrics() {
+    static Metrics instance;
+    return instance;
+}
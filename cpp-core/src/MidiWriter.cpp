@@ -2,63 +2,139 @@
 
 #include <algorithm>
 #include <fstream>
+#include <set>
 #include <stdexcept>
+#include <utility>
 
-MidiWriter::MidiWriter(int ticksPerQuarter)
+MidiWriter::MidiWriter(int ticksPerQuarter,
+                       std::pmr::memory_resource* resource)
     : ticksPerQuarter_(ticksPerQuarter),
       tempoBpm_(120.0f),
       timeSignatureNumerator_(4),
-      timeSignatureDenominator_(4) {}
-
-void MidiWriter::setTempo(float bpm) { tempoBpm_ = bpm; }
+      timeSignatureDenominator_(4),
+      tracks_(resource),
+      encoded_(resource),
+      chunkOffsets_(resource) {}
+
+void MidiWriter::setTempo(float bpm) {
+  tempoBpm_ = bpm;
+  encodedValid_ = false;
+}
 
 void MidiWriter::setTimeSignature(int numerator, int denominator) {
   timeSignatureNumerator_ = numerator;
   timeSignatureDenominator_ = denominator;
+  encodedValid_ = false;
 }
 
 int MidiWriter::addTrack(const std::string& name) {
-  tracks_.push_back({name, {}});
+  // Name and events come from the writer's resource; moving the track in
+  // keeps them there
+  auto alloc = tracks_.get_allocator();
+  tracks_.push_back({std::pmr::string(name, alloc),
+                     std::pmr::vector<MidiEvent>(alloc)});
+  encodedValid_ = false;
   return static_cast<int>(tracks_.size()) - 1;
 }
 
+void MidiWriter::reserve(int track, size_t eventCount) {
+  if (track < 0 || track >= static_cast<int>(tracks_.size())) return;
+  tracks_[track].events.reserve(eventCount);
+}
+
+void MidiWriter::insertOrdered(std::pmr::vector<MidiEvent>& events,
+                               const MidiEvent& event) {
+  // The Composer adds events almost in time order, so keep each track
+  // sorted on insertion: usually an append, otherwise a short move of the
+  // few later events. upper_bound places equal keys after existing ones,
+  // so ties keep insertion order and output is reproducible.
+  if (events.empty() || !(event < events.back())) {
+    events.push_back(event);
+  } else {
+    events.insert(std::upper_bound(events.begin(), events.end(), event), event);
+  }
+}
+
+MidiWriter::MidiEvent MidiWriter::noteOnEvent(int tick, int channel, int note,
+                                              int velocity) {
+  return {tick,
+          {static_cast<uint8_t>(0x90 | (channel & 0x0F)),
+           static_cast<uint8_t>(note & 0x7F),
+           static_cast<uint8_t>(velocity & 0x7F)},
+          3};
+}
+
+MidiWriter::MidiEvent MidiWriter::noteOffEvent(int tick, int channel,
+                                               int note) {
+  return {tick,
+          {static_cast<uint8_t>(0x80 | (channel & 0x0F)),
+           static_cast<uint8_t>(note & 0x7F),
+           static_cast<uint8_t>(0x40)},  // Default release velocity
+          3};
+}
+
+MidiWriter::MidiEvent MidiWriter::programChangeEvent(int tick, int channel,
+                                                     int program) {
+  return {tick,
+          {static_cast<uint8_t>(0xC0 | (channel & 0x0F)),
+           static_cast<uint8_t>(program & 0x7F), 0},
+          2};
+}
+
+void MidiWriter::insertEvent(int track, const MidiEvent& event) {
+  encodedValid_ = false;
+  insertOrdered(tracks_[track].events, event);
+}
+
 void MidiWriter::addNoteOn(int track, int tick, int channel, int note,
                            int velocity) {
   if (track < 0 || track >= static_cast<int>(tracks_.size())) return;
-
-  MidiEvent event;
-  event.tick = tick;
-  event.data = {static_cast<uint8_t>(0x90 | (channel & 0x0F)),
-                static_cast<uint8_t>(note & 0x7F),
-                static_cast<uint8_t>(velocity & 0x7F)};
-  tracks_[track].events.push_back(event);
+  insertEvent(track, noteOnEvent(tick, channel, note, velocity));
 }
 
 void MidiWriter::addNoteOff(int track, int tick, int channel, int note) {
   if (track < 0 || track >= static_cast<int>(tracks_.size())) return;
-
-  MidiEvent event;
-  event.tick = tick;
-  event.data = {
-      static_cast<uint8_t>(0x80 | (channel & 0x0F)),
-      static_cast<uint8_t>(note & 0x7F),
-      static_cast<uint8_t>(0x40)  // Default release velocity
-  };
-  tracks_[track].events.push_back(event);
+  insertEvent(track, noteOffEvent(tick, channel, note));
 }
 
 void MidiWriter::addProgramChange(int track, int tick, int channel,
                                   int program) {
   if (track < 0 || track >= static_cast<int>(tracks_.size())) return;
+  insertEvent(track, programChangeEvent(tick, channel, program));
+}
+
+void MidiWriter::mergeTrack(int track, TrackEvents&& incoming) {
+  if (track < 0 || track >= static_cast<int>(tracks_.size())) return;
+  encodedValid_ = false;
+
+  auto& events = tracks_[track].events;
+  if (events.empty()) {
+    // Steals the buffer when both share a resource, copies otherwise
+    events = std::move(incoming.events_);
+    return;
+  }
+  // inplace_merge is stable: on equal keys the existing events stay first
+  size_t existing = events.size();
+  events.insert(events.end(), incoming.events_.begin(), incoming.events_.end());
+  std::inplace_merge(events.begin(), events.begin() + existing, events.end());
+  incoming.events_.clear();
+}
 
-  MidiEvent event;
-  event.tick = tick;
-  event.data = {static_cast<uint8_t>(0xC0 | (channel & 0x0F)),
-                static_cast<uint8_t>(program & 0x7F)};
-  tracks_[track].events.push_back(event);
+void MidiWriter::TrackEvents::addNoteOn(int tick, int channel, int note,
+                                        int velocity) {
+  insertOrdered(events_, noteOnEvent(tick, channel, note, velocity));
 }
 
-void MidiWriter::writeVarLen(std::vector<uint8_t>& out, uint32_t value) {
+void MidiWriter::TrackEvents::addNoteOff(int tick, int channel, int note) {
+  insertOrdered(events_, noteOffEvent(tick, channel, note));
+}
+
+void MidiWriter::TrackEvents::addProgramChange(int tick, int channel,
+                                               int program) {
+  insertOrdered(events_, programChangeEvent(tick, channel, program));
+}
+
+void MidiWriter::writeVarLen(ByteBuffer& out, uint32_t value) {
   // MIDI variable-length encoding
   uint32_t buffer = value & 0x7F;
   while ((value >>= 7) > 0) {
@@ -77,59 +153,54 @@ void MidiWriter::writeVarLen(std::vector<uint8_t>& out, uint32_t value) {
   }
 }
 
-void MidiWriter::writeU16(std::vector<uint8_t>& out, uint16_t value) {
-  out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
-  out.push_back(static_cast<uint8_t>(value & 0xFF));
-}
-
-void MidiWriter::writeU32(std::vector<uint8_t>& out, uint32_t value) {
+void MidiWriter::writeU32(ByteBuffer& out, uint32_t value) {
   out.push_back(static_cast<uint8_t>((value >> 24) & 0xFF));
   out.push_back(static_cast<uint8_t>((value >> 16) & 0xFF));
   out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
   out.push_back(static_cast<uint8_t>(value & 0xFF));
 }
 
-std::vector<uint8_t> MidiWriter::buildTrackData(int trackIndex) {
-  std::vector<uint8_t> trackData;
+void MidiWriter::appendTrackChunk(ByteBuffer& out, int trackIndex) {
+  const auto& track = tracks_[trackIndex];
 
-  // Sort events by tick
-  auto& track = tracks_[trackIndex];
-  std::sort(track.events.begin(), track.events.end());
+  // "MTrk" + length placeholder, patched once the body is written
+  out.push_back('M');
+  out.push_back('T');
+  out.push_back('r');
+  out.push_back('k');
+  size_t lengthPos = out.size();
+  writeU32(out, 0);
+  size_t bodyStart = out.size();
 
   // First track gets tempo and time signature meta events
   if (trackIndex == 0) {
     // Track name (optional)
     if (!track.name.empty()) {
-      writeVarLen(trackData, 0);  // Delta time 0
-      trackData.push_back(0xFF);  // Meta event
-      trackData.push_back(0x03);  // Track name
-      writeVarLen(trackData, static_cast<uint32_t>(track.name.size()));
-      for (char c : track.name) {
-        trackData.push_back(static_cast<uint8_t>(c));
-      }
+      writeVarLen(out, 0);  // Delta time 0
+      out.push_back(0xFF);  // Meta event
+      out.push_back(0x03);  // Track name
+      writeVarLen(out, static_cast<uint32_t>(track.name.size()));
+      out.insert(out.end(), track.name.begin(), track.name.end());
     }
 
     // Set tempo
-    writeVarLen(trackData, 0);  // Delta time 0
-    trackData.push_back(0xFF);  // Meta event
-    trackData.push_back(0x51);  // Set tempo
-    trackData.push_back(0x03);  // Length = 3 bytes
+    writeVarLen(out, 0);  // Delta time 0
+    out.push_back(0xFF);  // Meta event
+    out.push_back(0x51);  // Set tempo
+    out.push_back(0x03);  // Length = 3 bytes
 
     // Microseconds per quarter note
-    uint32_t microsecondsPerQuarter =
-        static_cast<uint32_t>(60000000.0f / tempoBpm_);
-    trackData.push_back(
-        static_cast<uint8_t>((microsecondsPerQuarter >> 16) & 0xFF));
-    trackData.push_back(
-        static_cast<uint8_t>((microsecondsPerQuarter >> 8) & 0xFF));
-    trackData.push_back(static_cast<uint8_t>(microsecondsPerQuarter & 0xFF));
+    uint32_t usPerQuarter = microsecondsPerQuarter();
+    out.push_back(static_cast<uint8_t>((usPerQuarter >> 16) & 0xFF));
+    out.push_back(static_cast<uint8_t>((usPerQuarter >> 8) & 0xFF));
+    out.push_back(static_cast<uint8_t>(usPerQuarter & 0xFF));
 
     // Time signature
-    writeVarLen(trackData, 0);  // Delta time 0
-    trackData.push_back(0xFF);  // Meta event
-    trackData.push_back(0x58);  // Time signature
-    trackData.push_back(0x04);  // Length = 4 bytes
-    trackData.push_back(static_cast<uint8_t>(timeSignatureNumerator_));
+    writeVarLen(out, 0);  // Delta time 0
+    out.push_back(0xFF);  // Meta event
+    out.push_back(0x58);  // Time signature
+    out.push_back(0x04);  // Length = 4 bytes
+    out.push_back(static_cast<uint8_t>(timeSignatureNumerator_));
     // Denominator as power of 2 (4 = 2^2)
     int denomLog2 = 0;
     int denom = timeSignatureDenominator_;
@@ -137,146 +208,228 @@ std::vector<uint8_t> MidiWriter::buildTrackData(int trackIndex) {
       denom >>= 1;
       denomLog2++;
     }
-    trackData.push_back(static_cast<uint8_t>(denomLog2));
-    trackData.push_back(0x18);  // MIDI clocks per metronome click
-    trackData.push_back(0x08);  // 32nd notes per quarter note
+    out.push_back(static_cast<uint8_t>(denomLog2));
+    out.push_back(0x18);  // MIDI clocks per metronome click
+    out.push_back(0x08);  // 32nd notes per quarter note
   }
 
-  // Add all events with delta times
+  // Add all events with delta times. Running status: a channel event with
+  // the same status byte as the previous one omits it (meta events above
+  // come first, so nothing cancels it mid-track).
   int lastTick = 0;
+  uint8_t runningStatus = 0;
   for (const auto& event : track.events) {
     int deltaTicks = event.tick - lastTick;
     if (deltaTicks < 0) deltaTicks = 0;
 
-    writeVarLen(trackData, static_cast<uint32_t>(deltaTicks));
-    for (uint8_t byte : event.data) {
-      trackData.push_back(byte);
+    writeVarLen(out, static_cast<uint32_t>(deltaTicks));
+    const uint8_t* first = event.data;
+    if (event.data[0] == runningStatus) {
+      ++first;
+    } else {
+      runningStatus = event.data[0];
     }
+    out.insert(out.end(), first, event.data + event.size);
 
     lastTick = event.tick;
   }
 
   // End of track meta event
-  writeVarLen(trackData, 0);
-  trackData.push_back(0xFF);
-  trackData.push_back(0x2F);
-  trackData.push_back(0x00);
+  writeVarLen(out, 0);
+  out.push_back(0xFF);
+  out.push_back(0x2F);
+  out.push_back(0x00);
+
+  uint32_t length = static_cast<uint32_t>(out.size() - bodyStart);
+  out[lengthPos + 0] = static_cast<uint8_t>((length >> 24) & 0xFF);
+  out[lengthPos + 1] = static_cast<uint8_t>((length >> 16) & 0xFF);
+  out[lengthPos + 2] = static_cast<uint8_t>((length >> 8) & 0xFF);
+  out[lengthPos + 3] = static_cast<uint8_t>(length & 0xFF);
+}
+
+void MidiWriter::encodeTracks() {
+  if (encodedValid_) return;
+
+  // Upper bound: 4-byte delta + 3 data bytes per event, plus chunk header,
+  // name and the fixed meta events. One allocation for the whole file.
+  size_t capacity = 0;
+  for (const auto& track : tracks_) {
+    capacity += 8 + 64 + track.name.size() + track.events.size() * 7;
+  }
+  encoded_.clear();
+  encoded_.reserve(capacity);
 
-  return trackData;
+  chunkOffsets_.assign(1, 0);
+  for (size_t i = 0; i < tracks_.size(); ++i) {
+    appendTrackChunk(encoded_, static_cast<int>(i));
+    chunkOffsets_.push_back(encoded_.size());
+  }
+  encodedValid_ = true;
 }
 
-void MidiWriter::write(const std::string& filepath) {
+std::array<uint8_t, 14> MidiWriter::fileHeader(uint16_t format,
+                                               size_t trackCount) const {
+  uint16_t tracks = static_cast<uint16_t>(trackCount);
+  uint16_t division = static_cast<uint16_t>(ticksPerQuarter_);
+  return {'M', 'T', 'h', 'd',
+          0, 0, 0, 6,                                       // Chunk length (always 6)
+          static_cast<uint8_t>(format >> 8),                // 0 = single track, 1 = multi-track
+          static_cast<uint8_t>(format & 0xFF),
+          static_cast<uint8_t>(tracks >> 8),                // Number of tracks
+          static_cast<uint8_t>(tracks & 0xFF),
+          static_cast<uint8_t>(division >> 8),
+          static_cast<uint8_t>(division & 0xFF)};
+}
+
+void MidiWriter::writeFile(const std::string& filepath, uint16_t format,
+                           size_t firstTrack, size_t trackCount) {
   std::ofstream file(filepath, std::ios::binary);
   if (!file) {
     throw std::runtime_error("Failed to create MIDI file: " + filepath);
   }
 
-  std::vector<uint8_t> data;
-
   // --- MIDI Header Chunk ---
-  // "MThd"
-  data.push_back('M');
-  data.push_back('T');
-  data.push_back('h');
-  data.push_back('d');
-
-  // Chunk length (always 6 for header)
-  writeU32(data, 6);
-
-  // Format 1 (multi-track)
-  writeU16(data, 1);
-
-  // Number of tracks
-  writeU16(data, static_cast<uint16_t>(tracks_.size()));
-
-  // Ticks per quarter note
-  writeU16(data, static_cast<uint16_t>(ticksPerQuarter_));
-
-  // --- Track Chunks ---
-  for (size_t i = 0; i < tracks_.size(); ++i) {
-    std::vector<uint8_t> trackData = buildTrackData(static_cast<int>(i));
+  std::array<uint8_t, 14> header = fileHeader(format, trackCount);
 
-    // "MTrk"
-    data.push_back('M');
-    data.push_back('T');
-    data.push_back('r');
-    data.push_back('k');
+  // --- Track Chunks (already encoded, written straight from the buffer) ---
+  const uint8_t* chunks = encoded_.data() + chunkOffsets_[firstTrack];
+  size_t chunkBytes = chunkOffsets_[firstTrack + trackCount] - chunkOffsets_[firstTrack];
 
-    // Track length
-    writeU32(data, static_cast<uint32_t>(trackData.size()));
-
-    // Track data
-    data.insert(data.end(), trackData.begin(), trackData.end());
-  }
-
-  // Write to file
-  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  file.write(reinterpret_cast<const char*>(header.data()), header.size());
+  file.write(reinterpret_cast<const char*>(chunks), chunkBytes);
   file.close();
+  if (!file) {
+    throw std::runtime_error("Error while writing MIDI file: " + filepath);
+  }
 }
 
-void MidiWriter::writeSingleTrack(int trackIndex, const std::string& filepath) {
-  if (trackIndex < 0 || trackIndex >= static_cast<int>(tracks_.size())) {
-    throw std::runtime_error("Invalid track index");
-  }
+void MidiWriter::write(const std::string& filepath) {
+  encodeTracks();
+  writeFile(filepath, 1, 0, tracks_.size());
+}
 
+void MidiWriter::writeBytes(const std::string& filepath,
+                            const std::vector<uint8_t>& bytes) {
   std::ofstream file(filepath, std::ios::binary);
   if (!file) {
-    throw std::runtime_error("Cannot open file for writing: " + filepath);
+    throw std::runtime_error("Failed to create MIDI file: " + filepath);
   }
+  file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  file.close();
+  if (!file) {
+    throw std::runtime_error("Error while writing MIDI file: " + filepath);
+  }
+}
 
-  std::vector<uint8_t> data;
-
-  // --- Header Chunk ---
-  data.push_back('M');
-  data.push_back('T');
-  data.push_back('h');
-  data.push_back('d');
+std::vector<uint8_t> MidiWriter::fileBytes(uint16_t format, size_t firstTrack,
+                                           size_t trackCount) {
+  const uint8_t* chunks = encoded_.data() + chunkOffsets_[firstTrack];
+  size_t chunkBytes = chunkOffsets_[firstTrack + trackCount] - chunkOffsets_[firstTrack];
 
-  // Chunk length (always 6 for header)
-  writeU32(data, 6);
+  std::array<uint8_t, 14> header = fileHeader(format, trackCount);
+  std::vector<uint8_t> out(header.size() + chunkBytes);
+  std::copy(header.begin(), header.end(), out.begin());
+  std::copy(chunks, chunks + chunkBytes, out.begin() + header.size());
+  return out;
+}
 
-  // Format 0 (single track with tempo)
-  writeU16(data, 0);
+std::vector<uint8_t> MidiWriter::toBytes() {
+  encodeTracks();
+  return fileBytes(1, 0, tracks_.size());
+}
 
-  // Number of tracks (1)
-  writeU16(data, 1);
+uint32_t MidiWriter::microsecondsPerQuarter() const {
+  return static_cast<uint32_t>(60000000.0f / tempoBpm_);
+}
 
-  // Ticks per quarter note
-  writeU16(data, static_cast<uint16_t>(ticksPerQuarter_));
+std::vector<MidiWriter::ChannelMessage> MidiWriter::mergedEvents() const {
+  size_t total = 0;
+  for (const Track& track : tracks_) total += track.events.size();
+
+  // Tracks are concatenated in order and each is already sorted, so a
+  // stable sort on tick alone gives the sequencer's order
+  std::vector<ChannelMessage> merged;
+  merged.reserve(total);
+  for (const Track& track : tracks_) {
+    for (const MidiEvent& e : track.events) {
+      merged.push_back({e.tick, e.data[0], e.data[1],
+                        static_cast<uint8_t>(e.size > 2 ? e.data[2] : 0)});
+    }
+  }
+  std::stable_sort(merged.begin(), merged.end(),
+                   [](const ChannelMessage& a, const ChannelMessage& b) {
+                     return a.tick < b.tick;
+                   });
+  return merged;
+}
 
-  // --- Single Track Chunk ---
-  std::vector<uint8_t> trackData = buildTrackData(trackIndex);
+std::vector<MidiWriter::ChannelMessage> MidiWriter::trackMessages(
+    int track) const {
+  std::vector<ChannelMessage> messages;
+  if (track < 0 || track >= static_cast<int>(tracks_.size())) return messages;
+  messages.reserve(tracks_[track].events.size());
+  for (const MidiEvent& e : tracks_[track].events) {
+    messages.push_back({e.tick, e.data[0], e.data[1],
+                        static_cast<uint8_t>(e.size > 2 ? e.data[2] : 0)});
+  }
+  return messages;
+}
 
-  // "MTrk"
-  data.push_back('M');
-  data.push_back('T');
-  data.push_back('r');
-  data.push_back('k');
+size_t MidiWriter::byteSize() {
+  encodeTracks();
+  return 14 + encoded_.size();
+}
 
-  // Track length
-  writeU32(data, static_cast<uint32_t>(trackData.size()));
+void MidiWriter::writeSingleTrack(int trackIndex, const std::string& filepath) {
+  if (trackIndex < 0 || trackIndex >= static_cast<int>(tracks_.size())) {
+    throw std::runtime_error("Invalid track index");
+  }
 
-  // Track data
-  data.insert(data.end(), trackData.begin(), trackData.end());
+  // A track's chunk is the same in the combined file and in its stem
+  encodeTracks();
+  writeFile(filepath, 0, static_cast<size_t>(trackIndex), 1);
+}
 
-  // Write to file
-  file.write(reinterpret_cast<const char*>(data.data()), data.size());
-  file.close();
+std::vector<std::string> MidiWriter::stemNames() const {
+  std::vector<std::string> names;
+  std::set<std::string> used;
+  for (size_t i = 0; i < tracks_.size(); ++i) {
+    std::string trackName(tracks_[i].name);
+    if (trackName.empty()) {
+      trackName = "track" + std::to_string(i);
+    }
+    // Tracks sharing a name (e.g. two drum parts) each keep their own file
+    std::string baseName = trackName;
+    for (int n = 2; used.count(trackName); ++n) {
+      trackName = baseName + "_" + std::to_string(n);
+    }
+    used.insert(trackName);
+    names.push_back(trackName);
+  }
+  return names;
 }
 
 std::map<std::string, std::string> MidiWriter::writeSeparateStems(
     const std::string& baseDir) {
   std::map<std::string, std::string> result;
+  std::vector<std::string> names = stemNames();
 
   for (size_t i = 0; i < tracks_.size(); ++i) {
-    std::string trackName = tracks_[i].name;
-    if (trackName.empty()) {
-      trackName = "track" + std::to_string(i);
-    }
-
-    std::string filepath = baseDir + "/" + trackName + ".mid";
+    std::string filepath = baseDir + "/" + names[i] + ".mid";
     writeSingleTrack(static_cast<int>(i), filepath);
-    result[trackName] = filepath;
+    result[names[i]] = filepath;
+  }
+
+  return result;
+}
+
+std::map<std::string, std::vector<uint8_t>> MidiWriter::separateStemBytes() {
+  std::map<std::string, std::vector<uint8_t>> result;
+  std::vector<std::string> names = stemNames();
+
+  encodeTracks();
+  for (size_t i = 0; i < tracks_.size(); ++i) {
+    result[names[i]] = fileBytes(0, i, 1);
   }
 
   return result;
@@ -0,0 +1,400 @@
+#include "MixEngine.hpp"
+
+#include "GenreTemplate.hpp"
+#include "MixKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <limits>
+#include <string_view>
+
+static constexpr double PI = 3.14159265358979323846;
+
+static long envLong(const char* key, long def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stol(v);
+    } catch (...) {
+        return def;
+    }
+}
+
+static float envFloat(const char* key, float def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stof(v);
+    } catch (...) {
+        return def;
+    }
+}
+
+static float dbToGain(double db) {
+    return static_cast<float>(std::pow(10.0, db / 20.0));
+}
+
+MixEngine::Options MixEngine::optionsFromEnv() {
+    Options o;
+    o.sampleRate = static_cast<int>(
+        std::max(8000L, envLong("SC_RENDER_SAMPLE_RATE", o.sampleRate)));
+    o.targetLufs = envFloat("SC_MIX_TARGET_LUFS", o.targetLufs);
+    o.ceilingDb = std::min(0.0f, envFloat("SC_MIX_CEILING_DB", o.ceilingDb));
+    o.duckDepthDb = std::max(0.0f, envFloat("SC_MIX_DUCK_DB", o.duckDepthDb));
+    return o;
+}
+
+MixEngine::MixEngine(const Options& options) : options_(options) {
+    options_.blockFrames = std::max<size_t>(options_.blockFrames, 1);
+    options_.sampleRate = std::max(options_.sampleRate, 1);
+}
+
+// ---------------------------------------------------------------------------
+// Loudness (ITU-R BS.1770-4)
+// ---------------------------------------------------------------------------
+
+namespace {
+
+struct Biquad {
+    double b0, b1, b2, a1, a2;
+    double z1 = 0.0, z2 = 0.0;
+
+    double process(double x) {
+        double y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        return y;
+    }
+};
+
+// K-weighting: the high shelf (head) and the high-pass (RLB) of BS.1770,
+// derived for any sample rate from their analogue prototypes
+Biquad kWeightingShelf(int sampleRate) {
+    const double f0 = 1681.974450955533;
+    const double gainDb = 3.999843853973347;
+    const double q = 0.7071752369554196;
+    double k = std::tan(PI * f0 / sampleRate);
+    double vh = std::pow(10.0, gainDb / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    return {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0,
+            (vh - vb * k / q + k * k) / a0, 2.0 * (k * k - 1.0) / a0,
+            (1.0 - k / q + k * k) / a0};
+}
+
+Biquad kWeightingHighPass(int sampleRate) {
+    const double f0 = 38.13547087602444;
+    const double q = 0.5003270373238773;
+    double k = std::tan(PI * f0 / sampleRate);
+    double a0 = 1.0 + k / q + k * k;
+    return {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+}
+
+double blockLoudness(double meanSquare) {
+    return -0.691 + 10.0 * std::log10(meanSquare);
+}
+
+// One-pole smoothing coefficient for a time constant
+float followerCoeff(float ms, int sampleRate) {
+    if (ms <= 0.0f) return 1.0f;
+    return static_cast<float>(1.0 - std::exp(-1000.0 / (ms * sampleRate)));
+}
+
+}  // namespace
+
+double MixEngine::integratedLoudness(const float* samples, size_t frames, int sampleRate) {
+    const double silence = -std::numeric_limits<double>::infinity();
+    if (frames == 0 || sampleRate <= 0) return silence;
+
+    Biquad shelf[2] = {kWeightingShelf(sampleRate), kWeightingShelf(sampleRate)};
+    Biquad highPass[2] = {kWeightingHighPass(sampleRate), kWeightingHighPass(sampleRate)};
+
+    // K-weighted energy per 100 ms hop; gating blocks are four hops
+    // (400 ms, 75% overlap)
+    const size_t hop = std::max<size_t>(1, static_cast<size_t>(sampleRate) / 10);
+    std::vector<double> hopEnergy;
+    hopEnergy.reserve(frames / hop + 1);
+    double energy = 0.0;
+    size_t inHop = 0;
+    for (size_t f = 0; f < frames; ++f) {
+        for (int c = 0; c < 2; ++c) {
+            double y = highPass[c].process(shelf[c].process(samples[2 * f + c]));
+            energy += y * y;
+        }
+        if (++inHop == hop) {
+            hopEnergy.push_back(energy);
+            energy = 0.0;
+            inHop = 0;
+        }
+    }
+
+    std::vector<double> blocks;
+    if (hopEnergy.size() >= 4) {
+        for (size_t i = 0; i + 4 <= hopEnergy.size(); ++i) {
+            double sum = hopEnergy[i] + hopEnergy[i + 1] + hopEnergy[i + 2] + hopEnergy[i + 3];
+            blocks.push_back(sum / (4.0 * hop));
+        }
+    } else {
+        // Shorter than one gating block: measure it whole
+        double sum = energy;
+        for (double e : hopEnergy) sum += e;
+        blocks.push_back(sum / frames);
+    }
+
+    // Absolute gate at -70 LUFS, then relative gate 10 LU below the
+    // loudness of what passed it
+    const double absoluteGate = 1e-7 * std::pow(10.0, 0.0691);  // -70 LUFS as mean square
+    double sum = 0.0;
+    size_t count = 0;
+    for (double z : blocks) {
+        if (z > absoluteGate) {
+            sum += z;
+            ++count;
+        }
+    }
+    if (count == 0) return silence;
+
+    const double relativeGate = (sum / count) * 0.1;  // -10 LU
+    double gatedSum = 0.0;
+    size_t gatedCount = 0;
+    for (double z : blocks) {
+        if (z > absoluteGate && z > relativeGate) {
+            gatedSum += z;
+            ++gatedCount;
+        }
+    }
+    return blockLoudness(gatedSum / gatedCount);
+}
+
+// ---------------------------------------------------------------------------
+// Mix
+// ---------------------------------------------------------------------------
+
+void MixEngine::mixStems(const std::vector<MixStem>& stems, std::vector<float>& out) const {
+    const size_t frames = out.size() / 2;
+    const size_t block = options_.blockFrames;
+    const int sampleRate = options_.sampleRate;
+
+    bool haveKey = std::any_of(stems.begin(), stems.end(),
+                               [](const MixStem& s) { return s.sidechainKey; });
+    bool ducking = haveKey && options_.duckDepthDb > 0.0f &&
+                   std::any_of(stems.begin(), stems.end(), [](const MixStem& s) { return s.ducked; });
+
+    // Sidechain key: the low end of the key stems in mono, rectified. Its
+    // peak over the song anchors the ducking threshold.
+    std::vector<float> key;
+    float keyPeak = 0.0f;
+    if (ducking) {
+        key.assign(frames, 0.0f);
+        for (const MixStem& stem : stems) {
+            if (!stem.sidechainKey) continue;
+            size_t n = std::min(stem.frames, frames);
+            float g = stem.gain * 0.5f;
+            for (size_t f = 0; f < n; ++f) {
+                key[f] += (stem.samples[2 * f] + stem.samples[2 * f + 1]) * g;
+            }
+        }
+        float c = static_cast<float>(1.0 - std::exp(-2.0 * PI * options_.keyLowpassHz / sampleRate));
+        float s1 = 0.0f, s2 = 0.0f;  // two poles: ~12 dB/oct above the kick
+        for (size_t f = 0; f < frames; ++f) {
+            s1 += (key[f] - s1) * c;
+            s2 += (s1 - s2) * c;
+            key[f] = std::fabs(s2);
+            keyPeak = std::max(keyPeak, key[f]);
+        }
+        ducking = keyPeak > 0.0f;
+    }
+
+    const float threshold = keyPeak * std::min(dbToGain(options_.duckThresholdDb), 0.999f);
+    const float depth = 1.0f - dbToGain(-options_.duckDepthDb);
+    const float attack = followerCoeff(options_.duckAttackMs, sampleRate);
+    const float release = followerCoeff(options_.duckReleaseMs, sampleRate);
+    float env = 0.0f;
+
+    std::vector<float> duckBus(ducking ? 2 * block : 0, 0.0f);
+    std::vector<float> duckGain(ducking ? block : 0);
+
+    for (size_t begin = 0; begin < frames; begin += block) {
+        size_t n = std::min(block, frames - begin);
+        float* mixOut = out.data() + 2 * begin;
+
+        for (const MixStem& stem : stems) {
+            if (stem.frames <= begin) continue;
+            size_t avail = std::min(n, stem.frames - begin);
+            float* dest = (ducking && stem.ducked) ? duckBus.data() : mixOut;
+            mixAccumulate(stem.samples + 2 * begin, stem.gain, dest, 2 * avail);
+        }
+
+        if (ducking) {
+            // Linear in amplitude from the threshold (no ducking) to the
+            // key's peak (full depth)
+            for (size_t f = 0; f < n; ++f) {
+                float x = key[begin + f];
+                env += (x - env) * (x > env ? attack : release);
+                float amount = std::clamp((env - threshold) / (keyPeak - threshold), 0.0f, 1.0f);
+                duckGain[f] = 1.0f - amount * depth;
+            }
+            mixAccumulateFrameGain(duckBus.data(), duckGain.data(), mixOut, n);
+            std::fill(duckBus.begin(), duckBus.begin() + 2 * n, 0.0f);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Bus compressor and limiter
+// ---------------------------------------------------------------------------
+
+void MixEngine::compress(std::vector<float>& out, float inputGain) const {
+    const size_t frames = out.size() / 2;
+    const size_t block = options_.blockFrames;
+    const float threshold = dbToGain(options_.compThresholdDb);
+    const float exponent = 1.0f / std::max(options_.compRatio, 1.0f) - 1.0f;
+    const float attack = followerCoeff(options_.compAttackMs, options_.sampleRate);
+    const float release = followerCoeff(options_.compReleaseMs, options_.sampleRate);
+
+    std::vector<float> gains(block);
+    float env = 0.0f;
+    for (size_t begin = 0; begin < frames; begin += block) {
+        size_t n = std::min(block, frames - begin);
+        float* samples = out.data() + 2 * begin;
+
+        framePeaks(samples, gains.data(), n);
+        for (size_t f = 0; f < n; ++f) {
+            float x = gains[f] * inputGain;
+            env += (x - env) * (x > env ? attack : release);
+            // Above threshold, output rises 1/ratio dB per input dB
+            float reduction = env > threshold ? std::pow(env / threshold, exponent) : 1.0f;
+            gains[f] = inputGain * reduction;
+        }
+        applyFrameGain(samples, gains.data(), n);
+    }
+}
+
+void MixEngine::limit(std::vector<float>& out, float inputGain) const {
+    const size_t frames = out.size() / 2;
+    const size_t block = options_.blockFrames;
+    const float ceiling = dbToGain(options_.ceilingDb);
+    const size_t lookahead = std::max<size_t>(
+        1, static_cast<size_t>(options_.lookaheadMs * options_.sampleRate / 1000.0f));
+    const float release = followerCoeff(options_.limiterReleaseMs, options_.sampleRate);
+
+    // Gain each frame needs to stay under the ceiling
+    std::vector<float> gain(frames);
+    for (size_t begin = 0; begin < frames; begin += block) {
+        framePeaks(out.data() + 2 * begin, gain.data() + begin, std::min(block, frames - begin));
+    }
+    for (float& g : gain) {
+        float peak = g * inputGain;
+        g = peak > ceiling ? ceiling / peak : 1.0f;
+    }
+
+    // Lookahead: the minimum over the next `lookahead` frames, then a
+    // moving average over as many frames. Every window that averages into
+    // a frame's gain contains that frame, so no frame exceeds the ceiling,
+    // and the gain ramps down ahead of each peak instead of stepping.
+    std::vector<float> windowMin(frames);
+    std::deque<size_t> candidates;
+    for (size_t i = frames; i-- > 0;) {
+        while (!candidates.empty() && gain[candidates.back()] >= gain[i]) candidates.pop_back();
+        candidates.push_back(i);
+        if (candidates.front() >= i + lookahead) candidates.pop_front();
+        windowMin[i] = gain[candidates.front()];
+    }
+
+    // Frames before the start repeat windowMin[0], whose window covers
+    // the first `lookahead` frames
+    const float lead = frames > 0 ? windowMin[0] : 1.0f;
+    double sum = static_cast<double>(lead) * lookahead;
+    float smoothed = 1.0f;
+    for (size_t i = 0; i < frames; ++i) {
+        sum += windowMin[i] - (i >= lookahead ? windowMin[i - lookahead] : lead);
+        float g = std::min(static_cast<float>(sum / lookahead), 1.0f);
+        // Release slowly; a lower target always takes effect at once
+        smoothed = g < smoothed ? g : smoothed + (g - smoothed) * release;
+        gain[i] = smoothed * inputGain;
+    }
+
+    for (size_t begin = 0; begin < frames; begin += block) {
+        applyFrameGain(out.data() + 2 * begin, gain.data() + begin, std::min(block, frames - begin));
+    }
+}
+
+MixResult MixEngine::mix(const std::vector<MixStem>& stems) const {
+    size_t frames = 0;
+    for (const MixStem& stem : stems) frames = std::max(frames, stem.frames);
+
+    MixResult result;
+    result.samples.assign(2 * frames, 0.0f);
+    mixStems(stems, result.samples);
+
+    const int sampleRate = options_.sampleRate;
+    auto normalizationGain = [&](double loudness) {
+        if (!std::isfinite(loudness)) return 1.0f;
+        return dbToGain(std::min<double>(options_.targetLufs - loudness, options_.maxGainDb));
+    };
+
+    if (options_.master && frames > 0) {
+        // Gain-stage to the target so the compressor threshold means the
+        // same for every song, then bring the compressed mix back to the
+        // target and limit it
+        compress(result.samples,
+                 normalizationGain(integratedLoudness(result.samples.data(), frames, sampleRate)));
+        limit(result.samples,
+              normalizationGain(integratedLoudness(result.samples.data(), frames, sampleRate)));
+    }
+
+    result.loudnessLufs = integratedLoudness(result.samples.data(), frames, sampleRate);
+    result.peak = 0.0f;
+    std::vector<float> peaks(options_.blockFrames);
+    for (size_t begin = 0; begin < frames; begin += options_.blockFrames) {
+        size_t n = std::min(options_.blockFrames, frames - begin);
+        framePeaks(result.samples.data() + 2 * begin, peaks.data(), n);
+        result.peak = std::max(result.peak, *std::max_element(peaks.begin(), peaks.begin() + n));
+    }
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Stems from a composed song
+// ---------------------------------------------------------------------------
+
+std::vector<MixStem> specMixStems(const SongSpec& spec,
+                                  const std::vector<std::vector<float>>& tracks) {
+    std::vector<MixStem> stems;
+    size_t count = std::min(spec.tracks.size(), tracks.size());
+    stems.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const TrackSpec& track = spec.tracks[i];
+        MixStem stem;
+        stem.name = trackRoleName(track.role);
+        stem.samples = tracks[i].data();
+        stem.frames = tracks[i].size() / 2;
+        stem.gain = track.baseVolume;
+        stem.sidechainKey = track.role == TrackRole::DRUMS;
+        stem.ducked = track.role == TrackRole::BASS || track.role == TrackRole::CHORDS ||
+                      track.role == TrackRole::LEAD || track.role == TrackRole::PAD;
+        stems.push_back(stem);
+    }
+    return stems;
+}
+
+std::vector<MixStem> planMixStems(const SongPlan& plan, const SongSpec& spec,
+                                  const std::vector<std::vector<float>>& tracks) {
+    // songPlanToSpec() makes one track per active instrument, in order
+    std::vector<MixStem> stems = specMixStems(spec, tracks);
+    const GenreTemplate& genre = getGenreTemplate(plan.genre);
+
+    bool hasKick = std::find(plan.activeInstruments.begin(), plan.activeInstruments.end(),
+                             std::string_view("kick")) != plan.activeInstruments.end();
+    for (size_t i = 0; i < stems.size() && i < plan.activeInstruments.size(); ++i) {
+        std::string_view role = plan.activeInstruments[i];
+        auto layer = std::find_if(genre.layers.begin(), genre.layers.end(),
+                                  [&](const InstrumentLayer& l) { return l.role == role; });
+        stems[i].name = std::string(role);
+        if (hasKick) stems[i].sidechainKey = role == "kick";
+        stems[i].ducked = layer != genre.layers.end() && layer->sidechainTarget;
+    }
+    return stems;
+}
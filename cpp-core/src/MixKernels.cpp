@@ -0,0 +1,308 @@
+#include "MixKernels.hpp"
+#include "SimdDispatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SC_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SC_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// NOTE: built with -ffp-contract=off (see CMakeLists.txt), like SynthKernels.cpp
+
+namespace {
+
+// --- Scalar reference paths ---
+
+void accumulateScalar(const float* in, float gain, float* out, std::size_t begin,
+                      std::size_t count) {
+    for (std::size_t i = begin; i < count; ++i) {
+        out[i] = out[i] + in[i] * gain;
+    }
+}
+
+void accumulateFrameGainScalar(const float* in, const float* g, float* out, std::size_t begin,
+                               std::size_t frames) {
+    for (std::size_t f = begin; f < frames; ++f) {
+        out[2 * f] = out[2 * f] + in[2 * f] * g[f];
+        out[2 * f + 1] = out[2 * f + 1] + in[2 * f + 1] * g[f];
+    }
+}
+
+void applyFrameGainScalar(float* s, const float* g, std::size_t begin, std::size_t frames) {
+    for (std::size_t f = begin; f < frames; ++f) {
+        s[2 * f] = s[2 * f] * g[f];
+        s[2 * f + 1] = s[2 * f + 1] * g[f];
+    }
+}
+
+void framePeaksScalar(const float* in, float* peaks, std::size_t begin, std::size_t frames) {
+    for (std::size_t f = begin; f < frames; ++f) {
+        peaks[f] = std::max(std::fabs(in[2 * f]), std::fabs(in[2 * f + 1]));
+    }
+}
+
+// --- x86: SSE2 (baseline) and AVX2 ---
+
+#if defined(SC_SIMD_X86)
+
+void accumulateSse2(const float* in, float gain, float* out, std::size_t count) {
+    const __m128 vGain = _mm_set1_ps(gain);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(in + i), vGain);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), x));
+    }
+    accumulateScalar(in, gain, out, i, count);
+}
+
+__attribute__((target("avx2")))
+void accumulateAvx2(const float* in, float gain, float* out, std::size_t count) {
+    const __m256 vGain = _mm256_set1_ps(gain);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(in + i), vGain);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), x));
+    }
+    accumulateScalar(in, gain, out, i, count);
+}
+
+// Four frame gains [g0 g1 g2 g3] as [g0 g0 g1 g1] and [g2 g2 g3 g3]
+inline void duplicateGainsSse2(const float* g, __m128& lo, __m128& hi) {
+    __m128 v = _mm_loadu_ps(g);
+    lo = _mm_unpacklo_ps(v, v);
+    hi = _mm_unpackhi_ps(v, v);
+}
+
+__attribute__((target("avx2")))
+inline void duplicateGainsAvx2(const float* g, __m256& lo, __m256& hi) {
+    __m256 v = _mm256_loadu_ps(g);
+    lo = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+    hi = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7));
+}
+
+void accumulateFrameGainSse2(const float* in, const float* g, float* out, std::size_t frames) {
+    std::size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        __m128 lo, hi;
+        duplicateGainsSse2(g + f, lo, hi);
+        float* o = out + 2 * f;
+        const float* x = in + 2 * f;
+        _mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), _mm_mul_ps(_mm_loadu_ps(x), lo)));
+        _mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_mul_ps(_mm_loadu_ps(x + 4), hi)));
+    }
+    accumulateFrameGainScalar(in, g, out, f, frames);
+}
+
+__attribute__((target("avx2")))
+void accumulateFrameGainAvx2(const float* in, const float* g, float* out, std::size_t frames) {
+    std::size_t f = 0;
+    for (; f + 8 <= frames; f += 8) {
+        __m256 lo, hi;
+        duplicateGainsAvx2(g + f, lo, hi);
+        float* o = out + 2 * f;
+        const float* x = in + 2 * f;
+        _mm256_storeu_ps(o, _mm256_add_ps(_mm256_loadu_ps(o), _mm256_mul_ps(_mm256_loadu_ps(x), lo)));
+        _mm256_storeu_ps(o + 8, _mm256_add_ps(_mm256_loadu_ps(o + 8),
+                                              _mm256_mul_ps(_mm256_loadu_ps(x + 8), hi)));
+    }
+    accumulateFrameGainScalar(in, g, out, f, frames);
+}
+
+void applyFrameGainSse2(float* s, const float* g, std::size_t frames) {
+    std::size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        __m128 lo, hi;
+        duplicateGainsSse2(g + f, lo, hi);
+        float* o = s + 2 * f;
+        _mm_storeu_ps(o, _mm_mul_ps(_mm_loadu_ps(o), lo));
+        _mm_storeu_ps(o + 4, _mm_mul_ps(_mm_loadu_ps(o + 4), hi));
+    }
+    applyFrameGainScalar(s, g, f, frames);
+}
+
+__attribute__((target("avx2")))
+void applyFrameGainAvx2(float* s, const float* g, std::size_t frames) {
+    std::size_t f = 0;
+    for (; f + 8 <= frames; f += 8) {
+        __m256 lo, hi;
+        duplicateGainsAvx2(g + f, lo, hi);
+        float* o = s + 2 * f;
+        _mm256_storeu_ps(o, _mm256_mul_ps(_mm256_loadu_ps(o), lo));
+        _mm256_storeu_ps(o + 8, _mm256_mul_ps(_mm256_loadu_ps(o + 8), hi));
+    }
+    applyFrameGainScalar(s, g, f, frames);
+}
+
+void framePeaksSse2(const float* in, float* peaks, std::size_t frames) {
+    const __m128 vSign = _mm_set1_ps(-0.0f);
+    std::size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        __m128 a = _mm_andnot_ps(vSign, _mm_loadu_ps(in + 2 * f));      // L0 R0 L1 R1
+        __m128 b = _mm_andnot_ps(vSign, _mm_loadu_ps(in + 2 * f + 4));  // L2 R2 L3 R3
+        __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(peaks + f, _mm_max_ps(left, right));
+    }
+    framePeaksScalar(in, peaks, f, frames);
+}
+
+__attribute__((target("avx2")))
+void framePeaksAvx2(const float* in, float* peaks, std::size_t frames) {
+    const __m256 vSign = _mm256_set1_ps(-0.0f);
+    std::size_t f = 0;
+    for (; f + 8 <= frames; f += 8) {
+        __m256 a = _mm256_andnot_ps(vSign, _mm256_loadu_ps(in + 2 * f));
+        __m256 b = _mm256_andnot_ps(vSign, _mm256_loadu_ps(in + 2 * f + 8));
+        // Per 128-bit lane: [p0 p1 p4 p5 | p2 p3 p6 p7], then restore order
+        __m256 left = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 right = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256d m = _mm256_castps_pd(_mm256_max_ps(left, right));
+        _mm256_storeu_ps(peaks + f,
+                         _mm256_castpd_ps(_mm256_permute4x64_pd(m, _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+    framePeaksScalar(in, peaks, f, frames);
+}
+
+#endif  // SC_SIMD_X86
+
+// --- ARM: NEON (aarch64 baseline) ---
+
+#if defined(SC_SIMD_NEON)
+
+void accumulateNeon(const float* in, float gain, float* out, std::size_t count) {
+    const float32x4_t vGain = vdupq_n_f32(gain);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t x = vmulq_f32(vld1q_f32(in + i), vGain);
+        vst1q_f32(out + i, vaddq_f32(vld1q_f32(out + i), x));
+    }
+    accumulateScalar(in, gain, out, i, count);
+}
+
+void accumulateFrameGainNeon(const float* in, const float* g, float* out, std::size_t frames) {
+    std::size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        float32x4_t v = vld1q_f32(g + f);
+        float32x4x2_t gains = vzipq_f32(v, v);
+        float* o = out + 2 * f;
+        const float* x = in + 2 * f;
+        vst1q_f32(o, vaddq_f32(vld1q_f32(o), vmulq_f32(vld1q_f32(x), gains.val[0])));
+        vst1q_f32(o + 4, vaddq_f32(vld1q_f32(o + 4), vmulq_f32(vld1q_f32(x + 4), gains.val[1])));
+    }
+    accumulateFrameGainScalar(in, g, out, f, frames);
+}
+
+void applyFrameGainNeon(float* s, const float* g, std::size_t frames) {
+    std::size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        float32x4_t v = vld1q_f32(g + f);
+        float32x4x2_t gains = vzipq_f32(v, v);
+        float* o = s + 2 * f;
+        vst1q_f32(o, vmulq_f32(vld1q_f32(o), gains.val[0]));
+        vst1q_f32(o + 4, vmulq_f32(vld1q_f32(o + 4), gains.val[1]));
+    }
+    applyFrameGainScalar(s, g, f, frames);
+}
+
+void framePeaksNeon(const float* in, float* peaks, std::size_t frames) {
+    std::size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        float32x4x2_t lr = vld2q_f32(in + 2 * f);
+        vst1q_f32(peaks + f, vmaxq_f32(vabsq_f32(lr.val[0]), vabsq_f32(lr.val[1])));
+    }
+    framePeaksScalar(in, peaks, f, frames);
+}
+
+#endif  // SC_SIMD_NEON
+
+}  // namespace
+
+void mixAccumulate(const float* in, float gain, float* out, std::size_t count) {
+    switch (activeSimdLevel()) {
+#if defined(SC_SIMD_X86)
+        case SimdLevel::AVX2:
+            accumulateAvx2(in, gain, out, count);
+            return;
+        case SimdLevel::SSE2:
+            accumulateSse2(in, gain, out, count);
+            return;
+#endif
+#if defined(SC_SIMD_NEON)
+        case SimdLevel::NEON:
+            accumulateNeon(in, gain, out, count);
+            return;
+#endif
+        default:
+            accumulateScalar(in, gain, out, 0, count);
+            return;
+    }
+}
+
+void mixAccumulateFrameGain(const float* in, const float* frameGain, float* out,
+                            std::size_t frames) {
+    switch (activeSimdLevel()) {
+#if defined(SC_SIMD_X86)
+        case SimdLevel::AVX2:
+            accumulateFrameGainAvx2(in, frameGain, out, frames);
+            return;
+        case SimdLevel::SSE2:
+            accumulateFrameGainSse2(in, frameGain, out, frames);
+            return;
+#endif
+#if defined(SC_SIMD_NEON)
+        case SimdLevel::NEON:
+            accumulateFrameGainNeon(in, frameGain, out, frames);
+            return;
+#endif
+        default:
+            accumulateFrameGainScalar(in, frameGain, out, 0, frames);
+            return;
+    }
+}
+
+void applyFrameGain(float* samples, const float* frameGain, std::size_t frames) {
+    switch (activeSimdLevel()) {
+#if defined(SC_SIMD_X86)
+        case SimdLevel::AVX2:
+            applyFrameGainAvx2(samples, frameGain, frames);
+            return;
+        case SimdLevel::SSE2:
+            applyFrameGainSse2(samples, frameGain, frames);
+            return;
+#endif
+#if defined(SC_SIMD_NEON)
+        case SimdLevel::NEON:
+            applyFrameGainNeon(samples, frameGain, frames);
+            return;
+#endif
+        default:
+            applyFrameGainScalar(samples, frameGain, 0, frames);
+            return;
+    }
+}
+
+void framePeaks(const float* in, float* peaks, std::size_t frames) {
+    switch (activeSimdLevel()) {
+#if defined(SC_SIMD_X86)
+        case SimdLevel::AVX2:
+            framePeaksAvx2(in, peaks, frames);
+            return;
+        case SimdLevel::SSE2:
+            framePeaksSse2(in, peaks, frames);
+            return;
+#endif
+#if defined(SC_SIMD_NEON)
+        case SimdLevel::NEON:
+            framePeaksNeon(in, peaks, frames);
+            return;
+#endif
+        default:
+            framePeaksScalar(in, peaks, 0, frames);
+            return;
+    }
+}
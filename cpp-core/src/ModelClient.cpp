@@ -3,15 +3,19 @@
 #include "httplib.h"
 #include "json.hpp"
 
+#include "EmbeddedModel.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdlib>
 #include <stdexcept>
 
 using json = nlohmann::json;
 
-ModelClient::ModelClient(const std::string& baseUrl)
-    : baseUrl_(baseUrl) {}
-
-// Helper to split baseUrl_ into host + path for httplib
+// Helper to split the predict URL into host + path for httplib
 static void parseUrl(const std::string& url, std::string& host, int& port, std::string& path) {
     // Expect something like: http://localhost:8501/v1/models/soundcanvas:predict
     const std::string prefix = "http://";
@@ -36,66 +40,277 @@ static void parseUrl(const std::string& url, std::string& host, int& port, std::
     }
 }
 
-MusicParameters ModelClient::predict(const ImageFeatures& f) const {
-    std::string host;
-    int port;
-    std::string path;
-    parseUrl(baseUrl_, host, port, path);
+static int envInt(const char* key, int def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stoi(v);
+    } catch (...) {
+        return def;
+    }
+}
 
-    httplib::Client cli(host, port);
-    cli.set_read_timeout(5, 0);  // 5 seconds
+ModelClient::Options ModelClient::optionsFromEnv() {
+    Options o;
+    o.connectTimeoutMs = std::max(1, envInt("SC_TF_CONNECT_TIMEOUT_MS", o.connectTimeoutMs));
+    o.readTimeoutMs = std::max(1, envInt("SC_TF_READ_TIMEOUT_MS", o.readTimeoutMs));
+    o.maxIdleConnections = static_cast<size_t>(
+        std::max(0, envInt("SC_TF_POOL_SIZE", static_cast<int>(o.maxIdleConnections))));
+    o.breakerFailureThreshold = std::max(1, envInt("SC_TF_BREAKER_FAILURES", o.breakerFailureThreshold));
+    o.breakerOpenMs = std::max(0, envInt("SC_TF_BREAKER_OPEN_MS", o.breakerOpenMs));
+    if (const char* path = std::getenv("SC_EMBEDDED_MODEL")) {
+        o.embeddedModelPath = path;
+    }
+    return o;
+}
 
-    // Build JSON payload: {"instances": [[avgR, avgG, avgB, brightness, hue, saturation, colorfulness, contrast]]}
-    json payload;
-    payload["instances"] = json::array();
-    payload["instances"].push_back({
-        f.avgR,
-        f.avgG,
-        f.avgB,
-        f.brightness,
-        f.hue,
-        f.saturation,
-        f.colorfulness,
-        f.contrast
-    });
-
-    auto res = cli.Post(path.c_str(), payload.dump(), "application/json");
+ModelClient::ModelClient(const std::string& baseUrl, const Options& options)
+    : baseUrl_(baseUrl), options_(options) {
+    // A bad URL surfaces from predict() so callers still fall back cleanly
+    try {
+        parseUrl(baseUrl_, host_, port_, path_);
+    } catch (const std::exception& ex) {
+        urlError_ = ex.what();
+    }
+
+    if (!options_.embeddedModelPath.empty()) {
+        embedded_ = std::make_unique<EmbeddedModel>(options_.embeddedModelPath);
+        if (embedded_->inputs() != kFeatureInputs || embedded_->outputs() < kParameterOutputs) {
+            throw std::runtime_error("Embedded model " + options_.embeddedModelPath + " has " +
+                                     std::to_string(embedded_->inputs()) + " inputs and " +
+                                     std::to_string(embedded_->outputs()) + " outputs (expected " +
+                                     std::to_string(kFeatureInputs) + " and " +
+                                     std::to_string(kParameterOutputs) + ")");
+        }
+        logInfo("Model", "embedded model loaded, in-process inference",
+                {{"path", options_.embeddedModelPath},
+                 {"layers", embedded_->layerCount()},
+                 {"int8", embedded_->quantized()}});
+    }
+}
+
+ModelClient::~ModelClient() = default;
+
+std::unique_ptr<httplib::Client> ModelClient::acquireConnection() const {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex_);
+        if (!idle_.empty()) {
+            std::unique_ptr<httplib::Client> cli = std::move(idle_.back());
+            idle_.pop_back();
+            return cli;
+        }
+    }
+
+    auto cli = std::make_unique<httplib::Client>(host_, port_);
+    cli->set_keep_alive(true);
+    cli->set_connection_timeout(std::chrono::milliseconds(options_.connectTimeoutMs));
+    cli->set_read_timeout(std::chrono::milliseconds(options_.readTimeoutMs));
+    cli->set_write_timeout(std::chrono::milliseconds(options_.readTimeoutMs));
+    return cli;
+}
+
+void ModelClient::releaseConnection(std::unique_ptr<httplib::Client> cli) const {
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    if (idle_.size() < options_.maxIdleConnections) {
+        idle_.push_back(std::move(cli));
+    }
+}
+
+bool ModelClient::admit() const {
+    std::lock_guard<std::mutex> lock(breakerMutex_);
+    if (!open_) return true;
+    // Half-open: after the cool-down a single probe request goes through
+    if (!probeInFlight_ && Clock::now() >= openUntil_) {
+        probeInFlight_ = true;
+        return true;
+    }
+    return false;
+}
+
+void ModelClient::recordSuccess() const {
+    std::lock_guard<std::mutex> lock(breakerMutex_);
+    if (open_) {
+        logInfo("Model", "TF Serving reachable again, closing circuit breaker");
+    }
+    consecutiveFailures_ = 0;
+    open_ = false;
+    probeInFlight_ = false;
+}
+
+void ModelClient::recordFailure() const {
+    std::lock_guard<std::mutex> lock(breakerMutex_);
+    ++consecutiveFailures_;
+    if (open_ || consecutiveFailures_ >= options_.breakerFailureThreshold) {
+        if (!open_) {
+            logWarn("Model", "TF Serving failing, opening circuit breaker",
+                    {{"consecutive_failures", consecutiveFailures_},
+                     {"open_ms", options_.breakerOpenMs}});
+        }
+        open_ = true;
+        probeInFlight_ = false;
+        openUntil_ = Clock::now() + std::chrono::milliseconds(options_.breakerOpenMs);
+    }
+}
+
+bool ModelClient::available() const {
+    if (embedded_) return true;
+    std::lock_guard<std::mutex> lock(breakerMutex_);
+    return !open_;
+}
+
+size_t ModelClient::warmup(size_t connections) const {
+    if (embedded_ || !urlError_.empty()) return 0;
+
+    // .../models/<name>:predict -> .../models/<name>, the model status
+    std::string statusPath = path_.substr(0, path_.rfind(':'));
+    if (statusPath.empty() || statusPath.find('/') == std::string::npos) statusPath = path_;
+
+    // Distinct connections, so n of them are pooled rather than one reused
+    std::vector<std::unique_ptr<httplib::Client>> opened;
+    for (size_t i = 0; i < std::min(connections, options_.maxIdleConnections); ++i) {
+        std::unique_ptr<httplib::Client> cli = acquireConnection();
+        auto res = cli->Get(statusPath.c_str());
+        if (!res || res->status != 200) break;  // down or not serving the model yet
+        opened.push_back(std::move(cli));
+    }
+
+    size_t count = opened.size();
+    for (auto& cli : opened) releaseConnection(std::move(cli));
+    return count;
+}
+
+std::string ModelClient::post(const std::string& payload) const {
+    if (!urlError_.empty()) {
+        throw std::runtime_error(urlError_);
+    }
+    if (!admit()) {
+        throw std::runtime_error("TF Serving circuit breaker open");
+    }
+
+    std::unique_ptr<httplib::Client> cli = acquireConnection();
+    auto res = cli->Post(path_.c_str(), payload, "application/json");
     if (!res) {
+        // Connection is in an unknown state; drop it rather than pooling it
+        recordFailure();
         throw std::runtime_error("Failed to reach TF Serving");
     }
     if (res->status != 200) {
+        if (res->status >= 500) {
+            recordFailure();
+        } else {
+            recordSuccess();  // Server is up; the request itself is bad
+        }
+        releaseConnection(std::move(cli));
         throw std::runtime_error("TF Serving returned non-200: " + std::to_string(res->status));
     }
 
-    json body = json::parse(res->body);
-
-    if (!body.contains("predictions") || !body["predictions"].is_array() || body["predictions"].empty()) {
-        throw std::runtime_error("TF Serving response missing 'predictions'");
-    }
+    recordSuccess();
+    std::string body = std::move(res->body);
+    releaseConnection(std::move(cli));
+    return body;
+}
 
-    const auto& pred = body["predictions"][0];
-    if (!pred.is_array() || pred.size() < 7) {
-        throw std::runtime_error("TF Serving prediction has wrong shape (expected 7 outputs)");
-    }
+// One model input row: [avgR, avgG, avgB, brightness, hue, saturation, colorfulness, contrast]
+static std::array<float, ModelClient::kFeatureInputs> featureRow(const ImageFeatures& f) {
+    return {f.avgR, f.avgG, f.avgB, f.brightness, f.hue, f.saturation, f.colorfulness, f.contrast};
+}
 
-    // Order must match music_params_to_vector:
-    // [0] tempo_bpm
-    // [1] base_frequency
-    // [2] energy
-    // [3] brightness
-    // [4] reverb
-    // [5] scale_type
-    // [6] pattern_type
+// One model output row. Order must match music_params_to_vector:
+// [0] tempo_bpm
+// [1] base_frequency
+// [2] energy
+// [3] brightness
+// [4] reverb
+// [5] scale_type
+// [6] pattern_type
+static MusicParameters paramsFromRow(const double* row) {
     MusicParameters params;
-    params.tempoBpm      = static_cast<float>(pred[0].get<double>());
-    params.baseFrequency = static_cast<float>(pred[1].get<double>());
-    params.energy        = static_cast<float>(pred[2].get<double>());
-    params.brightness    = static_cast<float>(pred[3].get<double>());
-    params.reverb        = static_cast<float>(pred[4].get<double>());
+    params.tempoBpm      = static_cast<float>(row[0]);
+    params.baseFrequency = static_cast<float>(row[1]);
+    params.energy        = static_cast<float>(row[2]);
+    params.brightness    = static_cast<float>(row[3]);
+    params.reverb        = static_cast<float>(row[4]);
 
     // Round to nearest int for discrete controls
-    params.scaleType     = static_cast<int>(std::round(pred[5].get<double>()));
-    params.patternType   = static_cast<int>(std::round(pred[6].get<double>()));
+    params.scaleType     = static_cast<int>(std::round(row[5]));
+    params.patternType   = static_cast<int>(std::round(row[6]));
 
     return params;
 }
+
+// Parse one row of TF Serving's "predictions"
+static MusicParameters paramsFromPrediction(const json& pred) {
+    if (!pred.is_array() || pred.size() < ModelClient::kParameterOutputs) {
+        throw std::runtime_error("TF Serving prediction has wrong shape (expected 7 outputs)");
+    }
+    double row[ModelClient::kParameterOutputs];
+    for (size_t i = 0; i < ModelClient::kParameterOutputs; ++i) {
+        row[i] = pred[i].get<double>();
+    }
+    return paramsFromRow(row);
+}
+
+// The whole batch through the in-process model
+static std::vector<MusicParameters> predictEmbedded(const EmbeddedModel& model,
+                                                    const std::vector<ImageFeatures>& batch) {
+    std::vector<float> in;
+    in.reserve(batch.size() * ModelClient::kFeatureInputs);
+    for (const ImageFeatures& f : batch) {
+        auto row = featureRow(f);
+        in.insert(in.end(), row.begin(), row.end());
+    }
+    std::vector<float> out(batch.size() * model.outputs());
+    model.evaluate(in.data(), batch.size(), out.data());
+
+    std::vector<MusicParameters> results;
+    results.reserve(batch.size());
+    for (size_t r = 0; r < batch.size(); ++r) {
+        double row[ModelClient::kParameterOutputs];
+        for (size_t i = 0; i < ModelClient::kParameterOutputs; ++i) {
+            row[i] = out[r * model.outputs() + i];
+        }
+        results.push_back(paramsFromRow(row));
+    }
+    return results;
+}
+
+MusicParameters ModelClient::predict(const ImageFeatures& f) const {
+    return predictBatch(std::vector<ImageFeatures>{f}).front();
+}
+
+std::vector<MusicParameters> ModelClient::predictBatch(const std::vector<ImageFeatures>& batch) const {
+    if (batch.empty()) {
+        return {};
+    }
+    if (embedded_) {
+        return predictEmbedded(*embedded_, batch);
+    }
+
+    // Build JSON payload: {"instances": [[avgR, avgG, avgB, brightness, hue, saturation, colorfulness, contrast], ...]}
+    json payload;
+    payload["instances"] = json::array();
+    for (const ImageFeatures& f : batch) {
+        payload["instances"].push_back(featureRow(f));
+    }
+
+    metrics().add(Counter::MODEL_REQUESTS);
+    try {
+        json body = json::parse(post(payload.dump()));
+
+        if (!body.contains("predictions") || !body["predictions"].is_array() ||
+            body["predictions"].size() != batch.size()) {
+            throw std::runtime_error("TF Serving response missing 'predictions' (expected " +
+                                     std::to_string(batch.size()) + " rows)");
+        }
+
+        std::vector<MusicParameters> results;
+        results.reserve(batch.size());
+        for (const json& pred : body["predictions"]) {
+            results.push_back(paramsFromPrediction(pred));
+        }
+        return results;
+    } catch (...) {
+        metrics().add(Counter::MODEL_ERRORS);
+        throw;
+    }
+}
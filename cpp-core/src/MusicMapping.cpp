@@ -1,8 +1,10 @@
 #include "MusicMapping.hpp"
 
+#include "Log.hpp"
+#include "Metrics.hpp"
+
 #include <algorithm>
 #include <cmath>
-#include <iostream>
 #include <stdexcept>
 
 // Helper functions
@@ -14,6 +16,8 @@ static float clamp(float x, float lo, float hi) {
 
 // --- Heuristic mapping (Phase 5.5 logic - ported from Python) ---
 MusicParameters mapFeaturesToMusicHeuristic(const ImageFeatures& f) {
+  StageTimer timer(Stage::MAP_HEURISTIC);
+
   // Destructure for readability
   float avgR = f.avgR;
   float avgG = f.avgG;
@@ -108,35 +112,86 @@ MusicParameters mapFeaturesToMusicHeuristic(const ImageFeatures& f) {
 }
 
 // --- Model-based mapping with fallback ---
-MusicParameters mapFeaturesToMusicModel(const ImageFeatures& features,
-                                        const ModelClient& client) {
-  try {
-    // Try to get prediction from TF Serving
-    MusicParameters fromModel = client.predict(features);
 
-    // Apply safety clamping to ensure values are in valid ranges
-    // (model should already output good values, but this is a safety net)
-
-    // Clamp continuous fields
-    fromModel.tempoBpm = clamp(fromModel.tempoBpm, 40.0f, 180.0f);
-    fromModel.baseFrequency = clamp(fromModel.baseFrequency, 100.0f, 400.0f);
-    fromModel.energy = clamp01(fromModel.energy);
-    fromModel.brightness = clamp01(fromModel.brightness);
-    fromModel.reverb = clamp01(fromModel.reverb);
+// Safety clamping for model output (model should already output good
+// values, but this is a safety net)
+static MusicParameters clampModelOutput(MusicParameters fromModel) {
+  // Clamp continuous fields
+  fromModel.tempoBpm = clamp(fromModel.tempoBpm, 40.0f, 180.0f);
+  fromModel.baseFrequency = clamp(fromModel.baseFrequency, 100.0f, 400.0f);
+  fromModel.energy = clamp01(fromModel.energy);
+  fromModel.brightness = clamp01(fromModel.brightness);
+  fromModel.reverb = clamp01(fromModel.reverb);
+
+  // Clamp discrete fields (use local clamp function, not std::clamp)
+  fromModel.scaleType = static_cast<int>(
+      clamp(static_cast<float>(fromModel.scaleType), 0.0f, 3.0f));
+  fromModel.patternType = static_cast<int>(
+      clamp(static_cast<float>(fromModel.patternType), 0.0f, 2.0f));
+  return fromModel;
+}
 
-    // Clamp discrete fields (use local clamp function, not std::clamp)
-    fromModel.scaleType = static_cast<int>(
-        clamp(static_cast<float>(fromModel.scaleType), 0.0f, 3.0f));
-    fromModel.patternType = static_cast<int>(
-        clamp(static_cast<float>(fromModel.patternType), 0.0f, 2.0f));
+// Runs predict(); on any error falls back to the heuristic
+template <typename Predict>
+static MusicParameters mapWithFallback(const ImageFeatures& features,
+                                       Predict predict, bool* usedModel) {
+  StageTimer timer(Stage::MAP_MODEL);
+  if (usedModel) *usedModel = false;
+  try {
+    // Try to get prediction from TF Serving
+    MusicParameters fromModel = clampModelOutput(predict(features));
 
-    std::cout << "[INFO] Model prediction successful.\n";
+    logDebug("Mapping", "model prediction successful");
+    if (usedModel) *usedModel = true;
     return fromModel;
   } catch (const std::exception& ex) {
     // If TF Serving is down or returns error, fall back to heuristic
-    std::cerr
-        << "[WARN] Model prediction failed, falling back to heuristic. Reason: "
-        << ex.what() << std::endl;
+    logWarn("Mapping", "model prediction failed, falling back to heuristic",
+            {{"error", ex.what()}});
+    metrics().add(Counter::MODEL_FALLBACKS);
     return mapFeaturesToMusicHeuristic(features);
   }
+}
+
+MusicParameters mapFeaturesToMusicModel(const ImageFeatures& features,
+                                        const ModelClient& client,
+                                        bool* usedModel) {
+  return mapWithFallback(
+      features, [&client](const ImageFeatures& f) { return client.predict(f); },
+      usedModel);
+}
+
+MusicParameters mapFeaturesToMusicModel(const ImageFeatures& features,
+                                        PredictionBatcher& batcher,
+                                        bool* usedModel) {
+  return mapWithFallback(
+      features, [&batcher](const ImageFeatures& f) { return batcher.predict(f); },
+      usedModel);
+}
+
+std::vector<MusicParameters> mapFeaturesToMusicModelBatch(
+    const std::vector<ImageFeatures>& features, const ModelClient& client,
+    bool* usedModel) {
+  StageTimer timer(Stage::MAP_MODEL);
+  if (usedModel) *usedModel = false;
+  std::vector<MusicParameters> result;
+  if (features.empty()) return result;
+  result.reserve(features.size());
+  try {
+    for (const MusicParameters& p : client.predictBatch(features)) {
+      result.push_back(clampModelOutput(p));
+    }
+    logDebug("Mapping", "model batch prediction successful",
+             {{"rows", features.size()}});
+    if (usedModel) *usedModel = true;
+  } catch (const std::exception& ex) {
+    logWarn("Mapping", "model batch prediction failed, falling back to heuristic",
+            {{"rows", features.size()}, {"error", ex.what()}});
+    metrics().add(Counter::MODEL_FALLBACKS, features.size());
+    result.clear();
+    for (const ImageFeatures& f : features) {
+      result.push_back(mapFeaturesToMusicHeuristic(f));
+    }
+  }
+  return result;
 }
\ No newline at end of file
@@ -1,8 +1,18 @@
 #include "PatternTransform.hpp"
+#include "MusicTheory.hpp"
+#include "SimdDispatch.hpp"
 #include <algorithm>
 #include <cmath>
 #include <random>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SC_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SC_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
 // ============================================================================
 // PATTERN TRANSFORMATION FUNCTIONS
 // ============================================================================
@@ -54,6 +64,266 @@ void humanize(MidiPattern& pattern, int timingVariance, int velocityVariance) {
     }
 }
 
+// ============================================================================
+// STRUCTURE-OF-ARRAYS PATTERNS
+// ============================================================================
+
+void MidiPatternColumns::reserve(size_t count) {
+    note.reserve(count);
+    velocity.reserve(count);
+    startTick.reserve(count);
+    duration.reserve(count);
+    channel.reserve(count);
+}
+
+void MidiPatternColumns::resize(size_t count) {
+    note.resize(count);
+    velocity.resize(count);
+    startTick.resize(count);
+    duration.resize(count);
+    channel.resize(count);
+}
+
+MidiPatternColumns toColumns(const MidiPattern& pattern) {
+    MidiPatternColumns columns;
+    columns.lengthInTicks = pattern.lengthInTicks;
+    columns.lengthInBars = pattern.lengthInBars;
+    columns.reserve(pattern.notes.size());
+    for (const auto& n : pattern.notes) {
+        columns.note.push_back(n.note);
+        columns.velocity.push_back(n.velocity);
+        columns.startTick.push_back(n.startTick);
+        columns.duration.push_back(n.duration);
+        columns.channel.push_back(n.channel);
+    }
+    return columns;
+}
+
+MidiPattern fromColumns(const MidiPatternColumns& columns) {
+    MidiPattern pattern;
+    pattern.lengthInTicks = columns.lengthInTicks;
+    pattern.lengthInBars = columns.lengthInBars;
+    pattern.notes.reserve(columns.size());
+    for (size_t i = 0; i < columns.size(); ++i) {
+        pattern.notes.push_back({columns.note[i], columns.velocity[i],
+                                 columns.startTick[i], columns.duration[i],
+                                 columns.channel[i]});
+    }
+    return pattern;
+}
+
+namespace {
+
+// Counter-based randomness: each (seed, stream, index) hashes to its own
+// 64-bit value (splitmix64), so no generator state runs through the loop
+// and thinning/humanizing one note never shifts the draws of another
+enum RandomStream : uint32_t { THIN = 0, TIMING = 1, VELOCITY = 2 };
+
+inline uint64_t noteHash(uint32_t seed, RandomStream stream, size_t index) {
+    uint64_t z = ((static_cast<uint64_t>(seed) << 32) | stream) +
+                 (static_cast<uint64_t>(index) + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Same test as the random_device version: drop when a uniform [0, 1)
+// draw exceeds keepRatio
+inline bool keepNote(uint32_t seed, size_t index, float keepRatio) {
+    float u = static_cast<float>(noteHash(seed, THIN, index) >> 40) * (1.0f / 16777216.0f);
+    return u <= keepRatio;
+}
+
+// Uniform integer in [-variance, variance]
+inline int jitter(uint32_t seed, RandomStream stream, size_t index, int variance) {
+    if (variance <= 0) return 0;
+    uint64_t range = 2 * static_cast<uint64_t>(variance) + 1;
+    uint64_t low = noteHash(seed, stream, index) & 0xffffffffULL;
+    return static_cast<int>((low * range) >> 32) - variance;
+}
+
+inline int transposedNote(int note, int semitones) {
+    return std::clamp(note + semitones, 0, 127);
+}
+
+inline int scaledVelocity(int velocity, float factor) {
+    return std::clamp(static_cast<int>(velocity * factor), 1, 127);
+}
+
+// --- Column kernels (scalar reference + vector paths, identical output) ---
+
+void transposeScalar(int* note, size_t begin, size_t count, int semitones) {
+    for (size_t i = begin; i < count; ++i) {
+        note[i] = transposedNote(note[i], semitones);
+    }
+}
+
+void scaleVelocityScalar(int* velocity, size_t begin, size_t count, float factor) {
+    for (size_t i = begin; i < count; ++i) {
+        velocity[i] = scaledVelocity(velocity[i], factor);
+    }
+}
+
+#if defined(SC_SIMD_X86)
+__attribute__((target("avx2")))
+void transposeAvx2(int* note, size_t count, int semitones) {
+    const __m256i shift = _mm256_set1_epi32(semitones);
+    const __m256i lo = _mm256_setzero_si256();
+    const __m256i hi = _mm256_set1_epi32(127);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* p = reinterpret_cast<__m256i*>(note + i);
+        __m256i x = _mm256_add_epi32(_mm256_loadu_si256(p), shift);
+        _mm256_storeu_si256(p, _mm256_min_epi32(_mm256_max_epi32(x, lo), hi));
+    }
+    transposeScalar(note, i, count, semitones);
+}
+
+__attribute__((target("avx2")))
+void scaleVelocityAvx2(int* velocity, size_t count, float factor) {
+    const __m256 f = _mm256_set1_ps(factor);
+    const __m256i lo = _mm256_set1_epi32(1);
+    const __m256i hi = _mm256_set1_epi32(127);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* p = reinterpret_cast<__m256i*>(velocity + i);
+        // cvtt truncates toward zero like static_cast<int>
+        __m256 v = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256(p)), f);
+        __m256i x = _mm256_cvttps_epi32(v);
+        _mm256_storeu_si256(p, _mm256_min_epi32(_mm256_max_epi32(x, lo), hi));
+    }
+    scaleVelocityScalar(velocity, i, count, factor);
+}
+#endif
+
+#if defined(SC_SIMD_NEON)
+void transposeNeon(int* note, size_t count, int semitones) {
+    const int32x4_t shift = vdupq_n_s32(semitones);
+    const int32x4_t lo = vdupq_n_s32(0);
+    const int32x4_t hi = vdupq_n_s32(127);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int32x4_t x = vaddq_s32(vld1q_s32(note + i), shift);
+        vst1q_s32(note + i, vminq_s32(vmaxq_s32(x, lo), hi));
+    }
+    transposeScalar(note, i, count, semitones);
+}
+
+void scaleVelocityNeon(int* velocity, size_t count, float factor) {
+    const float32x4_t f = vdupq_n_f32(factor);
+    const int32x4_t lo = vdupq_n_s32(1);
+    const int32x4_t hi = vdupq_n_s32(127);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t v = vmulq_f32(vcvtq_f32_s32(vld1q_s32(velocity + i)), f);
+        int32x4_t x = vcvtq_s32_f32(v);  // rounds toward zero
+        vst1q_s32(velocity + i, vminq_s32(vmaxq_s32(x, lo), hi));
+    }
+    scaleVelocityScalar(velocity, i, count, factor);
+}
+#endif
+
+}  // namespace
+
+void transposePattern(MidiPatternColumns& pattern, int semitones) {
+    int* note = pattern.note.data();
+    size_t count = pattern.size();
+    switch (activeSimdLevel()) {
+#if defined(SC_SIMD_X86)
+        case SimdLevel::AVX2:
+            transposeAvx2(note, count, semitones);
+            return;
+#endif
+#if defined(SC_SIMD_NEON)
+        case SimdLevel::NEON:
+            transposeNeon(note, count, semitones);
+            return;
+#endif
+        default:
+            transposeScalar(note, 0, count, semitones);
+            return;
+    }
+}
+
+void scaleVelocity(MidiPatternColumns& pattern, float factor) {
+    int* velocity = pattern.velocity.data();
+    size_t count = pattern.size();
+    switch (activeSimdLevel()) {
+#if defined(SC_SIMD_X86)
+        case SimdLevel::AVX2:
+            scaleVelocityAvx2(velocity, count, factor);
+            return;
+#endif
+#if defined(SC_SIMD_NEON)
+        case SimdLevel::NEON:
+            scaleVelocityNeon(velocity, count, factor);
+            return;
+#endif
+        default:
+            scaleVelocityScalar(velocity, 0, count, factor);
+            return;
+    }
+}
+
+void thinNotes(MidiPatternColumns& pattern, float keepRatio, uint32_t seed) {
+    applyTransforms(pattern, PatternTransformChain()
+                                 .thin(keepRatio)
+                                 .withSeed(seed));
+}
+
+void humanize(MidiPatternColumns& pattern, int timingVariance, int velocityVariance,
+              uint32_t seed) {
+    size_t count = pattern.size();
+    for (size_t i = 0; i < count; ++i) {
+        pattern.startTick[i] =
+            std::max(0, pattern.startTick[i] + jitter(seed, TIMING, i, timingVariance));
+        pattern.velocity[i] = std::clamp(
+            pattern.velocity[i] + jitter(seed, VELOCITY, i, velocityVariance), 1, 127);
+    }
+}
+
+void applyTransforms(MidiPatternColumns& pattern, const PatternTransformChain& chain) {
+    bool thinning = chain.keepRatio < 1.0f;
+    bool humanizing = chain.timingVariance > 0 || chain.velocityVariance > 0;
+
+    if (!thinning && !humanizing) {
+        // Pure per-column arithmetic: run the vector kernels
+        transposePattern(pattern, chain.semitones);
+        scaleVelocity(pattern, chain.velocityFactor);
+        return;
+    }
+    if (chain.keepRatio <= 0.0f) {
+        pattern.resize(0);
+        return;
+    }
+
+    // One pass: stable in-place compaction of the kept rows, transforming
+    // each as it moves. Humanize draws are keyed by the output index, as if
+    // humanize ran on the already-thinned pattern.
+    uint32_t seed = chain.seed;
+    size_t count = pattern.size();
+    size_t out = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (thinning && !keepNote(seed, i, chain.keepRatio)) continue;
+
+        int velocity = scaledVelocity(pattern.velocity[i], chain.velocityFactor);
+        int start = pattern.startTick[i];
+        if (humanizing) {
+            start = std::max(0, start + jitter(seed, TIMING, out, chain.timingVariance));
+            velocity = std::clamp(
+                velocity + jitter(seed, VELOCITY, out, chain.velocityVariance), 1, 127);
+        }
+
+        pattern.note[out] = transposedNote(pattern.note[i], chain.semitones);
+        pattern.velocity[out] = velocity;
+        pattern.startTick[out] = start;
+        pattern.duration[out] = pattern.duration[i];
+        pattern.channel[out] = pattern.channel[i];
+        ++out;
+    }
+    pattern.resize(out);
+}
+
 std::vector<int> generateFilterSweep(int bars, float startCutoff, float endCutoff) {
     std::vector<int> sweep;
     for (int i = 0; i < bars; ++i) {
@@ -160,24 +430,8 @@ MidiPattern createBassPattern(int bars, int rootNote, int scaleType, float compl
     const int beatsPerBar = 4;
     pattern.lengthInTicks = bars * beatsPerBar * ticksPerBeat;
     
-    // Define scale intervals (semitones from root)
-    std::vector<int> scaleNotes;
-    switch (scaleType) {
-        case 0:  // Major
-            scaleNotes = {0, 2, 4, 5, 7, 9, 11};
-            break;
-        case 1:  // Minor
-            scaleNotes = {0, 2, 3, 5, 7, 8, 10};
-            break;
-        case 2:  // Dorian
-            scaleNotes = {0, 2, 3, 5, 7, 9, 10};
-            break;
-        case 3:  // Lydian
-            scaleNotes = {0, 2, 4, 6, 7, 9, 11};
-            break;
-        default:
-            scaleNotes = {0, 2, 4, 5, 7, 9, 11};
-    }
+    // Scale intervals (semitones from root); unknown types play Major
+    const ScaleIntervals& scaleNotes = scaleIntervals(scaleType);
     
     // Simple bass pattern: root on 1, fifth on 3 (or more complex if complexity high)
     for (int bar = 0; bar < bars; ++bar) {
@@ -0,0 +1,124 @@
+#include "PredictionBatcher.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+static long envLong(const char* key, long def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stol(v);
+    } catch (...) {
+        return def;
+    }
+}
+
+PredictionBatcher::Options PredictionBatcher::optionsFromEnv() {
+    Options o;
+    o.maxBatchSize = static_cast<size_t>(
+        std::max(1L, envLong("SC_TF_BATCH_SIZE", static_cast<long>(o.maxBatchSize))));
+    o.maxWait = std::chrono::microseconds(
+        std::max(0L, envLong("SC_TF_BATCH_WAIT_US", static_cast<long>(o.maxWait.count()))));
+    o.dispatchers = static_cast<size_t>(
+        std::max(1L, envLong("SC_TF_BATCH_DISPATCHERS", static_cast<long>(o.dispatchers))));
+    return o;
+}
+
+PredictionBatcher::PredictionBatcher(const ModelClient& client, const Options& options)
+    : client_(client), options_(options) {
+    options_.maxBatchSize = std::max<size_t>(options_.maxBatchSize, 1);
+    options_.dispatchers = std::max<size_t>(options_.dispatchers, 1);
+    for (size_t i = 0; i < options_.dispatchers; ++i) {
+        dispatchers_.emplace_back([this] { dispatchLoop(); });
+    }
+}
+
+PredictionBatcher::~PredictionBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : dispatchers_) {
+        t.join();
+    }
+}
+
+std::future<MusicParameters> PredictionBatcher::submit(const ImageFeatures& features) {
+    // In-process inference takes microseconds; holding it for a batch
+    // would only add the wait
+    if (client_.embedded()) {
+        std::promise<MusicParameters> result;
+        try {
+            result.set_value(client_.predict(features));
+        } catch (...) {
+            result.set_exception(std::current_exception());
+        }
+        return result.get_future();
+    }
+
+    Pending pending{features, {}, std::chrono::steady_clock::now()};
+    std::future<MusicParameters> future = pending.result.get_future();
+    bool wakeAll;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(pending));
+        wakeAll = queue_.size() == 1 || queue_.size() >= options_.maxBatchSize;
+    }
+    // The first row starts a dispatcher's deadline; a full batch releases it early
+    if (wakeAll) {
+        cv_.notify_all();
+    } else {
+        cv_.notify_one();
+    }
+    return future;
+}
+
+MusicParameters PredictionBatcher::predict(const ImageFeatures& features) {
+    return submit(features).get();
+}
+
+void PredictionBatcher::dispatchLoop() {
+    for (;;) {
+        std::vector<Pending> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;  // stopping and drained
+
+            // Hold the batch open until it fills or its oldest row times out
+            while (!stopping_ && !queue_.empty() && queue_.size() < options_.maxBatchSize) {
+                auto deadline = queue_.front().enqueued + options_.maxWait;
+                if (cv_.wait_until(lock, deadline) == std::cv_status::timeout) break;
+            }
+            if (queue_.empty()) continue;  // another dispatcher took it
+
+            size_t n = std::min(queue_.size(), options_.maxBatchSize);
+            batch.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+
+        std::vector<ImageFeatures> rows;
+        rows.reserve(batch.size());
+        for (const Pending& p : batch) {
+            rows.push_back(p.features);
+        }
+
+        try {
+            std::vector<MusicParameters> results = client_.predictBatch(rows);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i].result.set_value(results[i]);
+            }
+        } catch (...) {
+            std::exception_ptr error = std::current_exception();
+            for (Pending& p : batch) {
+                p.result.set_exception(error);
+            }
+        }
+    }
+}
@@ -0,0 +1,268 @@
+#include "Prefork.hpp"
+
+#include "Log.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// A worker that stayed up this long is healthy again: its next crash
+// restarts it at once
+static const std::chrono::seconds kHealthyUptime(10);
+
+static const std::chrono::milliseconds kMaxRestartDelay(30000);
+
+// After SIGTERM, how long workers get before SIGKILL
+static const std::chrono::seconds kStopGrace(10);
+
+// Supervisor wakeups while nothing happens (restart deadlines)
+static const long kPollNanos = 200 * 1000 * 1000;
+
+static long envLong(const char* key, long def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stol(v);
+    } catch (...) {
+        std::cerr << "[WARN] Invalid " << key << " value, using default " << def << std::endl;
+        return def;
+    }
+}
+
+PreforkOptions preforkOptionsFromEnv() {
+    PreforkOptions o;
+    o.workers = static_cast<size_t>(std::max(0L, envLong("SC_SERVE_WORKERS", 0)));
+    o.pinCpus = envLong("SC_PIN_WORKERS", 0) != 0;
+    o.sharedCache = envLong("SC_PREFORK_SHARED_CACHE", 0) != 0;
+    return o;
+}
+
+static std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        unsigned n = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < n; ++cpu) cpus.push_back(static_cast<int>(cpu));
+    }
+    return cpus;
+}
+
+size_t allowedCpuCount() {
+    return allowedCpus().size();
+}
+
+namespace {
+
+struct Worker {
+    pid_t pid = 0;                     // 0 while waiting to be (re)started
+    Clock::time_point started;
+    Clock::time_point restartAt;
+    std::chrono::milliseconds delay{0};
+};
+
+std::string describeExit(int status) {
+    if (WIFEXITED(status)) return "exit " + std::to_string(WEXITSTATUS(status));
+    if (WIFSIGNALED(status)) {
+        const char* name = strsignal(WTERMSIG(status));
+        return std::string("signal ") + (name ? name : std::to_string(WTERMSIG(status)));
+    }
+    return "status " + std::to_string(status);
+}
+
+// Fork one worker. In the child this never returns.
+pid_t spawnWorker(size_t index, const PreforkOptions& options, const std::vector<int>& cpus,
+                  const sigset_t& originalMask,
+                  const std::function<int(size_t)>& serveWorker) {
+    // Buffered output would otherwise be written by both processes
+    std::cout.flush();
+    std::fflush(nullptr);
+
+    pid_t supervisor = getpid();
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+#ifdef __linux__
+    // Don't outlive the supervisor, even after a SIGKILL. It may be PID 1
+    // (in a container), so compare against its actual pid.
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != supervisor) std::_Exit(0);
+#endif
+    sigprocmask(SIG_SETMASK, &originalMask, nullptr);
+    setenv("SC_SERVE_WORKER", std::to_string(index).c_str(), 1);
+
+    if (options.pinCpus) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[index % cpus.size()], &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            logWarn("Prefork", "could not pin worker", {{"worker", index}, {"error", std::strerror(errno)}});
+        }
+#endif
+    }
+
+    int code = 1;
+    try {
+        code = serveWorker(index);
+    } catch (const std::exception& ex) {
+        logError("Prefork", "worker failed", {{"worker", index}, {"error", ex.what()}});
+    }
+    std::exit(code);
+}
+
+}  // namespace
+
+int runPreforkServer(const PreforkOptions& options,
+                     const std::function<int(size_t worker)>& serveWorker) {
+    std::vector<int> cpus = allowedCpus();
+    size_t count = options.workers ? options.workers : cpus.size();
+
+    // Each worker's thread pools get its share of the CPUs
+    std::string share = std::to_string(std::max<size_t>(1, cpus.size() / count));
+    setenv("SC_WORKER_THREADS", share.c_str(), 0);
+    setenv("SC_JOB_WORKERS", share.c_str(), 0);
+
+    // Opt-in: disk cache tiers in shared memory, so workers share entries.
+    // Nothing bounds them, see Prefork.hpp.
+    fs::path sharedDir;
+    if (options.sharedCache && (!std::getenv("SC_CACHE_DIR") || !std::getenv("SC_COMPOSITION_CACHE_DIR"))) {
+        std::error_code ec;
+        if (fs::is_directory("/dev/shm", ec)) {
+            sharedDir = fs::path("/dev/shm") / ("soundcanvas-" + std::to_string(getpid()));
+            fs::create_directories(sharedDir / "features", ec);
+            fs::create_directories(sharedDir / "compositions", ec);
+            if (ec) {
+                logWarn("Prefork", "no shared cache directory", {{"path", sharedDir.string()},
+                                                                 {"error", ec.message()}});
+                sharedDir.clear();
+            } else {
+                setenv("SC_CACHE_DIR", (sharedDir / "features").c_str(), 0);
+                setenv("SC_COMPOSITION_CACHE_DIR", (sharedDir / "compositions").c_str(), 0);
+            }
+        }
+    }
+
+    logInfo("Prefork", "supervisor starting", {{"workers", count},
+                                               {"cpus", cpus.size()},
+                                               {"threads_per_worker", share},
+                                               {"pinned", options.pinCpus},
+                                               {"shared_cache", sharedDir.string()}});
+
+    // Signals are taken synchronously with sigtimedwait; workers get the
+    // original mask back
+    sigset_t mask, originalMask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigprocmask(SIG_BLOCK, &mask, &originalMask);
+
+    std::vector<Worker> workers(count);
+    Clock::time_point now = Clock::now();
+    for (Worker& w : workers) w.restartAt = now;
+
+    bool stopping = false;
+    Clock::time_point stopDeadline;
+    for (;;) {
+        now = Clock::now();
+
+        int status = 0;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            auto it = std::find_if(workers.begin(), workers.end(),
+                                   [pid](const Worker& w) { return w.pid == pid; });
+            if (it == workers.end()) continue;
+            Worker& w = *it;
+            size_t index = static_cast<size_t>(it - workers.begin());
+            w.pid = 0;
+            if (stopping) continue;
+
+            if (now - w.started >= kHealthyUptime) {
+                w.delay = std::chrono::milliseconds(0);
+            } else {
+                w.delay = w.delay.count() == 0 ? options.restartDelay
+                                               : std::min(w.delay * 2, kMaxRestartDelay);
+            }
+            w.restartAt = now + w.delay;
+            logWarn("Prefork", "worker exited, restarting",
+                    {{"worker", index}, {"pid", static_cast<long long>(pid)},
+                     {"status", describeExit(status)},
+                     {"restart_in_ms", static_cast<long long>(w.delay.count())}});
+        }
+
+        if (stopping) {
+            bool alive = std::any_of(workers.begin(), workers.end(),
+                                     [](const Worker& w) { return w.pid != 0; });
+            if (!alive) break;
+            if (now >= stopDeadline) {
+                for (const Worker& w : workers) {
+                    if (w.pid) kill(w.pid, SIGKILL);
+                }
+            }
+        } else {
+            for (size_t i = 0; i < workers.size(); ++i) {
+                Worker& w = workers[i];
+                if (w.pid != 0 || now < w.restartAt) continue;
+                pid_t child = spawnWorker(i, options, cpus, originalMask, serveWorker);
+                if (child < 0) {
+                    logError("Prefork", "fork failed", {{"worker", i}, {"error", std::strerror(errno)}});
+                    w.restartAt = now + kMaxRestartDelay;
+                    continue;
+                }
+                w.pid = child;
+                w.started = now;
+                logInfo("Prefork", "worker started", {{"worker", i}, {"pid", static_cast<long long>(child)}});
+            }
+        }
+
+        struct timespec timeout = {0, kPollNanos};
+        int sig = sigtimedwait(&mask, nullptr, &timeout);
+        if ((sig == SIGTERM || sig == SIGINT) && !stopping) {
+            logInfo("Prefork", "stopping workers", {{"signal", sig == SIGTERM ? "SIGTERM" : "SIGINT"}});
+            stopping = true;
+            stopDeadline = Clock::now() + kStopGrace;
+            for (const Worker& w : workers) {
+                if (w.pid) kill(w.pid, SIGTERM);
+            }
+        }
+    }
+
+    sigprocmask(SIG_SETMASK, &originalMask, nullptr);
+    if (!sharedDir.empty()) {
+        std::error_code ec;
+        fs::remove_all(sharedDir, ec);
+    }
+    logInfo("Prefork", "supervisor stopped");
+    return 0;
+}
@@ -0,0 +1,15 @@
+#include "RequestArena.hpp"
+
+RequestArena::RequestArena(size_t initialBytes)
+    : buffer_(initialBytes, std::pmr::new_delete_resource()) {}
+
+size_t RequestArena::bytesAllocated() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocated_;
+}
+
+void* RequestArena::do_allocate(size_t bytes, size_t alignment) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    allocated_ += bytes;
+    return buffer_.allocate(bytes, alignment);
+}
@@ -1,12 +1,15 @@
 #include "SectionPlanner.hpp"
+#include "MusicTheory.hpp"
 #include <algorithm>
-#include <cmath>
+#include <map>
+#include <string_view>
 
 SongPlan planSong(const ImageFeatures& features, 
                   const MusicParameters& params,
-                  const GenreTemplate& genreTemplate) {
+                  const GenreTemplate& genreTemplate,
+                  std::pmr::memory_resource* resource) {
     
-    SongPlan plan;
+    SongPlan plan(resource);
     plan.genre = genreTemplate.type;
     plan.tempoBpm = std::clamp(
         static_cast<int>(params.tempoBpm),
@@ -24,10 +27,11 @@ SongPlan planSong(const ImageFeatures& features,
     
     // Calculate root note from base frequency
     float freq = params.baseFrequency;
-    int midiNote = static_cast<int>(std::round(69.0 + 12.0 * std::log2(freq / 440.0)));
+    int midiNote = nearestMidiNote(freq);
     plan.rootNote = std::clamp(midiNote, 48, 72);  // C3 to C5
     
     // Build section timeline
+    plan.sections.reserve(genreTemplate.sectionPlan.size());
     int currentBar = 0;
     bool shouldAddDrop = params.energy >= genreTemplate.dropEnergyThreshold;
     
@@ -58,25 +62,25 @@ SongPlan planSong(const ImageFeatures& features,
     // Determine which instruments to include based on overall energy
     for (const auto& layer : genreTemplate.layers) {
         if (params.energy >= layer.minEnergy) {
-            plan.activeInstruments.push_back(layer.role);
+            plan.activeInstruments.emplace_back(layer.role);
         }
     }
     
     // Ensure minimum instruments (always have kick + bass + one melodic)
     if (std::find(plan.activeInstruments.begin(), plan.activeInstruments.end(), "kick") 
         == plan.activeInstruments.end()) {
-        plan.activeInstruments.push_back("kick");
+        plan.activeInstruments.emplace_back("kick");
     }
     if (std::find(plan.activeInstruments.begin(), plan.activeInstruments.end(), "bass") 
         == plan.activeInstruments.end()) {
-        plan.activeInstruments.push_back("bass");
+        plan.activeInstruments.emplace_back("bass");
     }
     
     return plan;
 }
 
-SongSpec songPlanToSpec(const SongPlan& plan) {
-    SongSpec spec;
+SongSpec songPlanToSpec(const SongPlan& plan, std::pmr::memory_resource* resource) {
+    SongSpec spec(resource);
     
     spec.tempoBpm = plan.tempoBpm;
     spec.scaleType = plan.scaleType;
@@ -98,6 +102,7 @@ SongSpec songPlanToSpec(const SongPlan& plan) {
     }
     
     // Convert planned sections to SongSpec sections
+    spec.sections.reserve(plan.sections.size());
     for (const auto& plannedSec : plan.sections) {
         SectionSpec sec;
         sec.name = sectionTypeName(plannedSec.type);
@@ -108,7 +113,7 @@ SongSpec songPlanToSpec(const SongPlan& plan) {
     
     // Create tracks from active instruments
     // Map instrument roles to MIDI programs and channels (simplified for now)
-    std::map<std::string, int> instrumentPrograms = {
+    static const std::map<std::string_view, int> instrumentPrograms = {
         {"kick", 36},
         {"snare", 38},
         {"hihat", 42},
@@ -126,7 +131,7 @@ SongSpec songPlanToSpec(const SongPlan& plan) {
     };
     
     // Map string role names to TrackRole enum
-    std::map<std::string, TrackRole> roleMap = {
+    static const std::map<std::string_view, TrackRole> roleMap = {
         {"kick", TrackRole::DRUMS},
         {"snare", TrackRole::DRUMS},
         {"hihat", TrackRole::DRUMS},
@@ -144,7 +149,8 @@ SongSpec songPlanToSpec(const SongPlan& plan) {
     };
     
     int nextChannel = 0;
-    for (const auto& instRole : plan.activeInstruments) {
+    spec.tracks.reserve(plan.activeInstruments.size());
+    for (std::string_view instRole : plan.activeInstruments) {
         TrackSpec track;
         
         // Convert string role to TrackRole enum
@@ -0,0 +1,66 @@
+#include "SimdDispatch.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+std::atomic<int> g_activeLevel{-1};  // -1 = not resolved yet
+
+SimdLevel parseSimdLevel(const std::string& name, SimdLevel fallback) {
+    if (name == "scalar") return SimdLevel::SCALAR;
+    if (name == "sse2") return SimdLevel::SSE2;
+    if (name == "avx2") return SimdLevel::AVX2;
+    if (name == "neon") return SimdLevel::NEON;
+    return fallback;
+}
+
+// SSE2 < AVX2 on x86, NEON stands alone on ARM; anything else falls back to scalar
+SimdLevel clampToDetected(SimdLevel requested) {
+    SimdLevel detected = detectSimdLevel();
+    if (requested == SimdLevel::SCALAR || requested == detected) return requested;
+    if (requested == SimdLevel::SSE2 && detected == SimdLevel::AVX2) return requested;
+    return SimdLevel::SCALAR;
+}
+
+}  // namespace
+
+SimdLevel detectSimdLevel() {
+#if defined(__aarch64__)
+    return SimdLevel::NEON;
+#elif defined(__x86_64__) && defined(__GNUC__)
+    static const SimdLevel level = __builtin_cpu_supports("avx2") ? SimdLevel::AVX2
+                                                                  : SimdLevel::SSE2;
+    return level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+SimdLevel activeSimdLevel() {
+    int level = g_activeLevel.load(std::memory_order_relaxed);
+    if (level < 0) {
+        SimdLevel resolved = detectSimdLevel();
+        if (const char* env = std::getenv("SC_SIMD")) {
+            resolved = clampToDetected(parseSimdLevel(env, resolved));
+        }
+        level = static_cast<int>(resolved);
+        g_activeLevel.store(level, std::memory_order_relaxed);
+    }
+    return static_cast<SimdLevel>(level);
+}
+
+void setSimdLevel(SimdLevel level) {
+    g_activeLevel.store(static_cast<int>(clampToDetected(level)), std::memory_order_relaxed);
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SCALAR: return "scalar";
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::NEON: return "neon";
+        default: return "unknown";
+    }
+}
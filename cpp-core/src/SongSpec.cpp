@@ -1,17 +1,20 @@
 #include "SongSpec.hpp"
 
+#include "MusicTheory.hpp"
+
 #include <algorithm>
 #include <cmath>
+#include <string_view>
 
 // MIDI note conversion: A4 = 440Hz = MIDI 69
 int freqToMidiNote(float freq) {
   if (freq <= 0.0f) return 60;  // Default to C4
-  float midi = 12.0f * std::log2(freq / 440.0f) + 69.0f;
-  return static_cast<int>(std::round(midi));
+  return nearestMidiNote(freq);
 }
 
-SongSpec makeSongSpec(const ImageFeatures& f, const MusicParameters& m) {
-  SongSpec spec;
+SongSpec makeSongSpec(const ImageFeatures& f, const MusicParameters& m,
+                      std::pmr::memory_resource* resource) {
+  SongSpec spec(resource);
 
   // ========== Phase 9: Genre Selection ==========
   spec.genreProfile = pickGenre(f, m);
@@ -432,7 +435,7 @@ SectionActivity getSectionActivity(const GenreProfile& genre,
                                     float moodScore) {
   SectionActivity activity = {false, false, false, false, false};
   
-  std::string sectionName = section.name;
+  std::string_view sectionName = section.name;
   float energy = section.targetEnergy;
   
   // Genre-specific section activity patterns
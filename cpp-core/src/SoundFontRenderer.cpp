@@ -0,0 +1,239 @@
+#include "SoundFontRenderer.hpp"
+
+#include "WavWriter.hpp"
+#include "WorkerPool.hpp"
+
+#ifdef SC_HAVE_FLUIDSYNTH
+#include <fluidsynth.h>
+#endif
+
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+static long envLong(const char* key, long def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stol(v);
+    } catch (...) {
+        return def;
+    }
+}
+
+SoundFontRenderer::Options SoundFontRenderer::optionsFromEnv() {
+    Options o;
+    if (const char* v = std::getenv("SC_SOUNDFONT")) {
+        o.soundFontPath = v;
+    }
+    o.sampleRate = static_cast<int>(
+        std::max(8000L, envLong("SC_RENDER_SAMPLE_RATE", o.sampleRate)));
+    if (const char* v = std::getenv("SC_RENDER_GAIN")) {
+        try {
+            o.gain = std::stof(v);
+        } catch (...) {
+        }
+    }
+    o.synths = static_cast<size_t>(
+        std::max(1L, envLong("SC_RENDER_SYNTHS", static_cast<long>(o.synths))));
+    return o;
+}
+
+#ifdef SC_HAVE_FLUIDSYNTH
+
+struct SoundFontRenderer::Synth {
+    fluid_settings_t* settings = nullptr;
+    fluid_synth_t* synth = nullptr;
+
+    ~Synth() {
+        if (synth) delete_fluid_synth(synth);
+        if (settings) delete_fluid_settings(settings);
+    }
+};
+
+bool SoundFontRenderer::available() { return true; }
+
+std::unique_ptr<SoundFontRenderer::Synth> SoundFontRenderer::createSynth() {
+    auto s = std::make_unique<Synth>();
+    s->settings = new_fluid_settings();
+    if (!s->settings) {
+        throw std::runtime_error("Failed to create FluidSynth settings");
+    }
+    fluid_settings_setnum(s->settings, "synth.sample-rate", options_.sampleRate);
+    fluid_settings_setnum(s->settings, "synth.gain", options_.gain);
+    // Each synth is only ever used by the thread that acquired it
+    fluid_settings_setint(s->settings, "synth.threadsafe-api", 0);
+
+    s->synth = new_fluid_synth(s->settings);
+    if (!s->synth) {
+        throw std::runtime_error("Failed to create FluidSynth synth");
+    }
+    // Later synths get the sample data from FluidSynth's sample cache
+    // rather than reading the file again
+    if (fluid_synth_sfload(s->synth, options_.soundFontPath.c_str(), 1) == FLUID_FAILED) {
+        throw std::runtime_error("Failed to load SoundFont: " + options_.soundFontPath);
+    }
+    return s;
+}
+
+// Play events into out (interleaved stereo), rendering the frames between
+// consecutive events in one call each
+static void play(fluid_synth_t* synth, const std::vector<MidiWriter::ChannelMessage>& events,
+                 double framesPerTick, std::vector<float>& out) {
+    const size_t totalFrames = out.size() / 2;
+    size_t frame = 0;
+    auto renderUntil = [&](size_t until) {
+        until = std::min(until, totalFrames);
+        while (frame < until) {
+            int n = static_cast<int>(std::min<size_t>(until - frame, 1 << 16));
+            fluid_synth_write_float(synth, n,
+                                    out.data(), static_cast<int>(frame * 2), 2,
+                                    out.data(), static_cast<int>(frame * 2 + 1), 2);
+            frame += n;
+        }
+    };
+
+    for (const MidiWriter::ChannelMessage& e : events) {
+        renderUntil(static_cast<size_t>(std::llround(e.tick * framesPerTick)));
+        int channel = e.status & 0x0F;
+        switch (e.status & 0xF0) {
+            case 0x90:
+                // Velocity 0 is a note-off, which fluid_synth_noteon handles
+                fluid_synth_noteon(synth, channel, e.data1, e.data2);
+                break;
+            case 0x80:
+                fluid_synth_noteoff(synth, channel, e.data1);
+                break;
+            case 0xC0:
+                fluid_synth_program_change(synth, channel, e.data1);
+                break;
+            default:
+                break;
+        }
+    }
+    renderUntil(totalFrames);
+}
+
+#else  // !SC_HAVE_FLUIDSYNTH
+
+struct SoundFontRenderer::Synth {};
+
+bool SoundFontRenderer::available() { return false; }
+
+std::unique_ptr<SoundFontRenderer::Synth> SoundFontRenderer::createSynth() {
+    throw std::runtime_error("Built without libfluidsynth; in-process rendering is unavailable");
+}
+
+#endif
+
+SoundFontRenderer::SoundFontRenderer(const Options& options) : options_(options) {
+    options_.synths = std::max<size_t>(options_.synths, 1);
+    // Load the SoundFont now, so a bad path fails here and not mid-request
+    release(acquire());
+}
+
+SoundFontRenderer::~SoundFontRenderer() = default;
+
+std::unique_ptr<SoundFontRenderer::Synth> SoundFontRenderer::acquire() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !idle_.empty() || created_ < options_.synths; });
+        if (!idle_.empty()) {
+            std::unique_ptr<Synth> synth = std::move(idle_.back());
+            idle_.pop_back();
+            return synth;
+        }
+        ++created_;
+    }
+    try {
+        return createSynth();
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --created_;
+        }
+        cv_.notify_one();
+        throw;
+    }
+}
+
+void SoundFontRenderer::release(std::unique_ptr<Synth> synth) {
+#ifdef SC_HAVE_FLUIDSYNTH
+    // Silence hanging voices and restore default programs for the next song
+    fluid_synth_system_reset(synth->synth);
+#endif
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(std::move(synth));
+    }
+    cv_.notify_one();
+}
+
+// Same timing a sequencer derives from the file's tempo meta event
+static double framesPerMidiTick(const MidiWriter& midi, int sampleRate) {
+    double secondsPerTick = midi.microsecondsPerQuarter() / 1e6 / midi.ticksPerQuarter();
+    return secondsPerTick * sampleRate;
+}
+
+std::vector<float> SoundFontRenderer::render(const MidiWriter& midi) {
+    std::vector<MidiWriter::ChannelMessage> events = midi.mergedEvents();
+
+    double perTick = framesPerMidiTick(midi, options_.sampleRate);
+    size_t lastFrame = events.empty()
+        ? 0
+        : static_cast<size_t>(std::llround(events.back().tick * perTick));
+    size_t totalFrames = lastFrame + static_cast<size_t>(options_.tailSeconds * options_.sampleRate);
+    return renderEvents(events, perTick, totalFrames);
+}
+
+std::vector<std::vector<float>> SoundFontRenderer::renderTracks(const MidiWriter& midi) {
+    size_t trackCount = midi.trackCount();
+    std::vector<std::vector<MidiWriter::ChannelMessage>> events(trackCount);
+    int lastTick = 0;
+    for (size_t i = 0; i < trackCount; ++i) {
+        events[i] = midi.trackMessages(static_cast<int>(i));
+        if (!events[i].empty()) lastTick = std::max(lastTick, events[i].back().tick);
+    }
+
+    double perTick = framesPerMidiTick(midi, options_.sampleRate);
+    size_t totalFrames = static_cast<size_t>(std::llround(lastTick * perTick)) +
+                         static_cast<size_t>(options_.tailSeconds * options_.sampleRate);
+
+    std::vector<std::vector<float>> tracks(trackCount);
+    sharedWorkerPool().parallelFor(trackCount, options_.synths, [&](size_t i) {
+        tracks[i] = renderEvents(events[i], perTick, totalFrames);
+    });
+    return tracks;
+}
+
+std::vector<float> SoundFontRenderer::renderEvents(
+    const std::vector<MidiWriter::ChannelMessage>& events, double framesPerTick,
+    size_t totalFrames) {
+    std::vector<float> out(totalFrames * 2, 0.0f);
+    std::unique_ptr<Synth> synth = acquire();
+#ifdef SC_HAVE_FLUIDSYNTH
+    try {
+        play(synth->synth, events, framesPerTick, out);
+    } catch (...) {
+        release(std::move(synth));
+        throw;
+    }
+#else
+    (void)events;
+    (void)framesPerTick;
+#endif
+    release(std::move(synth));
+    return out;
+}
+
+void SoundFontRenderer::renderToWav(const MidiWriter& midi, const std::string& wavPath) {
+    std::vector<float> samples = render(midi);
+    WavWriter wav(wavPath, options_.sampleRate, 2, static_cast<std::uint32_t>(samples.size() / 2));
+    wav.writeSamples(samples.data(), samples.size());
+    wav.finish();
+}
+
+SoundFontRenderer& sharedSoundFontRenderer() {
+    static SoundFontRenderer renderer(SoundFontRenderer::optionsFromEnv());
+    return renderer;
+}
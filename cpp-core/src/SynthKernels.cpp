@@ -0,0 +1,474 @@
+#define _USE_MATH_DEFINES
+#include "SynthKernels.hpp"
+#include "SimdDispatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SC_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SC_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// NOTE: this file is built with -ffp-contract=off (see CMakeLists.txt) so the
+// compiler never fuses a multiply and add in one path but not another.
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double HALF_PI = PI / 2.0;
+constexpr double TWO_OVER_PI = 2.0 / PI;
+
+// Taylor coefficients for sin(y) on [-pi/2, pi/2] (max error ~6e-8)
+constexpr double S3 = -1.0 / 6.0;
+constexpr double S5 = 1.0 / 120.0;
+constexpr double S7 = -1.0 / 5040.0;
+constexpr double S9 = 1.0 / 362880.0;
+constexpr double S11 = -1.0 / 39916800.0;
+
+// Fold phase in [0, 2pi] onto y in [-pi/2, pi/2] with sin(phase) = -sin(y).
+// asin(sin(phase)) is then exactly -y, which gives the triangle for free.
+inline double foldPhase(double phase) {
+    double x = phase - PI;
+    return std::fabs(x) > HALF_PI ? std::copysign(PI, x) - x : x;
+}
+
+inline double sinePoly(double y) {
+    double y2 = y * y;
+    double p = S11;
+    p = p * y2 + S9;
+    p = p * y2 + S7;
+    p = p * y2 + S5;
+    p = p * y2 + S3;
+    p = p * y2 + 1.0;
+    return y * p;
+}
+
+// Sine/triangle blend weights with the fold's sign flip baked in
+struct OscWeights {
+    double sine;
+    double triangle;
+};
+
+inline OscWeights oscWeights(double brightness) {
+    return {-(1.0 - brightness * 0.4), -(brightness * 0.4) * TWO_OVER_PI};
+}
+
+// --- Scalar reference paths ---
+
+void accumulateOscillatorScalar(const double* phase, const double* gain, double gainScale,
+                                OscWeights w, double* out, int begin, int frames) {
+    for (int i = begin; i < frames; ++i) {
+        double y = foldPhase(phase[i]);
+        double osc = sinePoly(y) * w.sine + y * w.triangle;
+        out[i] = out[i] + osc * gain[i] * gainScale;
+    }
+}
+
+// Powers of the feedback term used by the 4-frame scan
+struct OnePoleCoeffs {
+    double c;       // input weight (coeff)
+    double a;       // feedback weight (1 - coeff)
+    double a2;
+    double pw[4];   // a^1 .. a^4
+};
+
+inline OnePoleCoeffs onePoleCoeffs(double coeff) {
+    OnePoleCoeffs k;
+    k.c = coeff;
+    k.a = 1.0 - coeff;
+    k.a2 = k.a * k.a;
+    k.pw[0] = k.a;
+    k.pw[1] = k.a2;
+    k.pw[2] = k.a2 * k.a;
+    k.pw[3] = k.a2 * k.a2;
+    return k;
+}
+
+// One group of four frames solved as a two-step prefix scan. The "+ 0.0"
+// terms mirror the zero-filled lanes of the vector versions.
+inline void onePoleGroupScalar(double* s, const OnePoleCoeffs& k, double& state) {
+    double z0 = s[0] * k.c, z1 = s[1] * k.c, z2 = s[2] * k.c, z3 = s[3] * k.c;
+    double u0 = z0 + 0.0, u1 = z1 + k.a * z0, u2 = z2 + k.a * z1, u3 = z3 + k.a * z2;
+    double v0 = u0 + 0.0, v1 = u1 + 0.0, v2 = u2 + k.a2 * u0, v3 = u3 + k.a2 * u1;
+    s[0] = v0 + k.pw[0] * state;
+    s[1] = v1 + k.pw[1] * state;
+    s[2] = v2 + k.pw[2] * state;
+    s[3] = v3 + k.pw[3] * state;
+    state = s[3];
+}
+
+// Frames that do not fill a group run the plain recurrence on every path
+inline void onePoleTail(double* s, int begin, int frames, const OnePoleCoeffs& k, double& state) {
+    for (int i = begin; i < frames; ++i) {
+        state = state * k.a + s[i] * k.c;
+        s[i] = state;
+    }
+}
+
+void onePoleScalar(double* s, int frames, const OnePoleCoeffs& k, double& state) {
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) onePoleGroupScalar(s + i, k, state);
+    onePoleTail(s, i, frames, k, state);
+}
+
+void delayMixScalar(double* s, float* d, int begin, int frames, double feedback,
+                    double dryMix, double wetMix) {
+    for (int i = begin; i < frames; ++i) {
+        double x = s[i];
+        float wet = static_cast<float>(x + static_cast<double>(d[i]) * feedback);
+        d[i] = wet;
+        s[i] = x * dryMix + static_cast<double>(wet) * wetMix;
+    }
+}
+
+// --- x86: SSE2 (baseline) and AVX2 ---
+
+#if defined(SC_SIMD_X86)
+
+void accumulateOscillatorSse2(const double* phase, const double* gain, double gainScale,
+                              OscWeights w, double* out, int frames) {
+    const __m128d vPi = _mm_set1_pd(PI);
+    const __m128d vHalfPi = _mm_set1_pd(HALF_PI);
+    const __m128d vSign = _mm_set1_pd(-0.0);
+    const __m128d vWs = _mm_set1_pd(w.sine);
+    const __m128d vWt = _mm_set1_pd(w.triangle);
+    const __m128d vScale = _mm_set1_pd(gainScale);
+
+    int i = 0;
+    for (; i + 2 <= frames; i += 2) {
+        __m128d x = _mm_sub_pd(_mm_loadu_pd(phase + i), vPi);
+        __m128d mask = _mm_cmpgt_pd(_mm_andnot_pd(vSign, x), vHalfPi);
+        __m128d folded = _mm_sub_pd(_mm_or_pd(_mm_and_pd(x, vSign), vPi), x);
+        __m128d y = _mm_or_pd(_mm_and_pd(mask, folded), _mm_andnot_pd(mask, x));
+
+        __m128d y2 = _mm_mul_pd(y, y);
+        __m128d p = _mm_set1_pd(S11);
+        p = _mm_add_pd(_mm_mul_pd(p, y2), _mm_set1_pd(S9));
+        p = _mm_add_pd(_mm_mul_pd(p, y2), _mm_set1_pd(S7));
+        p = _mm_add_pd(_mm_mul_pd(p, y2), _mm_set1_pd(S5));
+        p = _mm_add_pd(_mm_mul_pd(p, y2), _mm_set1_pd(S3));
+        p = _mm_add_pd(_mm_mul_pd(p, y2), _mm_set1_pd(1.0));
+
+        __m128d osc = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(y, p), vWs), _mm_mul_pd(y, vWt));
+        __m128d contrib = _mm_mul_pd(_mm_mul_pd(osc, _mm_loadu_pd(gain + i)), vScale);
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(out + i), contrib));
+    }
+    accumulateOscillatorScalar(phase, gain, gainScale, w, out, i, frames);
+}
+
+__attribute__((target("avx2")))
+void accumulateOscillatorAvx2(const double* phase, const double* gain, double gainScale,
+                              OscWeights w, double* out, int frames) {
+    const __m256d vPi = _mm256_set1_pd(PI);
+    const __m256d vHalfPi = _mm256_set1_pd(HALF_PI);
+    const __m256d vSign = _mm256_set1_pd(-0.0);
+    const __m256d vWs = _mm256_set1_pd(w.sine);
+    const __m256d vWt = _mm256_set1_pd(w.triangle);
+    const __m256d vScale = _mm256_set1_pd(gainScale);
+
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m256d x = _mm256_sub_pd(_mm256_loadu_pd(phase + i), vPi);
+        __m256d mask = _mm256_cmp_pd(_mm256_andnot_pd(vSign, x), vHalfPi, _CMP_GT_OQ);
+        __m256d folded = _mm256_sub_pd(_mm256_or_pd(_mm256_and_pd(x, vSign), vPi), x);
+        __m256d y = _mm256_blendv_pd(x, folded, mask);
+
+        __m256d y2 = _mm256_mul_pd(y, y);
+        __m256d p = _mm256_set1_pd(S11);
+        p = _mm256_add_pd(_mm256_mul_pd(p, y2), _mm256_set1_pd(S9));
+        p = _mm256_add_pd(_mm256_mul_pd(p, y2), _mm256_set1_pd(S7));
+        p = _mm256_add_pd(_mm256_mul_pd(p, y2), _mm256_set1_pd(S5));
+        p = _mm256_add_pd(_mm256_mul_pd(p, y2), _mm256_set1_pd(S3));
+        p = _mm256_add_pd(_mm256_mul_pd(p, y2), _mm256_set1_pd(1.0));
+
+        __m256d osc = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(y, p), vWs),
+                                    _mm256_mul_pd(y, vWt));
+        __m256d contrib = _mm256_mul_pd(_mm256_mul_pd(osc, _mm256_loadu_pd(gain + i)), vScale);
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(out + i), contrib));
+    }
+    accumulateOscillatorScalar(phase, gain, gainScale, w, out, i, frames);
+}
+
+void onePoleSse2(double* s, int frames, const OnePoleCoeffs& k, double& state) {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d vc = _mm_set1_pd(k.c);
+    const __m128d va = _mm_set1_pd(k.a);
+    const __m128d va2 = _mm_set1_pd(k.a2);
+    const __m128d pwLo = _mm_set_pd(k.pw[1], k.pw[0]);
+    const __m128d pwHi = _mm_set_pd(k.pw[3], k.pw[2]);
+
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128d zLo = _mm_mul_pd(_mm_loadu_pd(s + i), vc);
+        __m128d zHi = _mm_mul_pd(_mm_loadu_pd(s + i + 2), vc);
+
+        // Lane k += a * lane k-1: [0, z0] and [z1, z2]
+        __m128d uLo = _mm_add_pd(zLo, _mm_mul_pd(va, _mm_shuffle_pd(zero, zLo, 0)));
+        __m128d uHi = _mm_add_pd(zHi, _mm_mul_pd(va, _mm_shuffle_pd(zLo, zHi, 1)));
+
+        // Lane k += a^2 * lane k-2: [0, 0] and [u0, u1]
+        __m128d vLo = _mm_add_pd(uLo, _mm_mul_pd(va2, zero));
+        __m128d vHi = _mm_add_pd(uHi, _mm_mul_pd(va2, uLo));
+
+        __m128d prev = _mm_set1_pd(state);
+        _mm_storeu_pd(s + i, _mm_add_pd(vLo, _mm_mul_pd(pwLo, prev)));
+        _mm_storeu_pd(s + i + 2, _mm_add_pd(vHi, _mm_mul_pd(pwHi, prev)));
+        state = s[i + 3];
+    }
+    onePoleTail(s, i, frames, k, state);
+}
+
+__attribute__((target("avx2")))
+void onePoleAvx2(double* s, int frames, const OnePoleCoeffs& k, double& state) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d vc = _mm256_set1_pd(k.c);
+    const __m256d va = _mm256_set1_pd(k.a);
+    const __m256d va2 = _mm256_set1_pd(k.a2);
+    const __m256d pw = _mm256_set_pd(k.pw[3], k.pw[2], k.pw[1], k.pw[0]);
+
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m256d z = _mm256_mul_pd(_mm256_loadu_pd(s + i), vc);
+
+        // Lane k += a * lane k-1: shift up one lane, zero into lane 0
+        __m256d sh1 = _mm256_blend_pd(_mm256_permute4x64_pd(z, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x1);
+        __m256d u = _mm256_add_pd(z, _mm256_mul_pd(va, sh1));
+
+        // Lane k += a^2 * lane k-2: low half moves up, zeros below
+        __m256d sh2 = _mm256_permute2f128_pd(u, u, 0x08);
+        __m256d v = _mm256_add_pd(u, _mm256_mul_pd(va2, sh2));
+
+        _mm256_storeu_pd(s + i, _mm256_add_pd(v, _mm256_mul_pd(pw, _mm256_set1_pd(state))));
+        state = s[i + 3];
+    }
+    onePoleTail(s, i, frames, k, state);
+}
+
+void delayMixSse2(double* s, float* d, int frames, double feedback, double dryMix,
+                  double wetMix) {
+    const __m128d vFb = _mm_set1_pd(feedback);
+    const __m128d vDry = _mm_set1_pd(dryMix);
+    const __m128d vWet = _mm_set1_pd(wetMix);
+
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 delayed = _mm_loadu_ps(d + i);
+        __m128d xLo = _mm_loadu_pd(s + i);
+        __m128d xHi = _mm_loadu_pd(s + i + 2);
+
+        __m128d wetLo = _mm_add_pd(xLo, _mm_mul_pd(_mm_cvtps_pd(delayed), vFb));
+        __m128d wetHi = _mm_add_pd(xHi, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(delayed, delayed)), vFb));
+        __m128 wet = _mm_movelh_ps(_mm_cvtpd_ps(wetLo), _mm_cvtpd_ps(wetHi));
+        _mm_storeu_ps(d + i, wet);
+
+        _mm_storeu_pd(s + i, _mm_add_pd(_mm_mul_pd(xLo, vDry),
+                                        _mm_mul_pd(_mm_cvtps_pd(wet), vWet)));
+        _mm_storeu_pd(s + i + 2, _mm_add_pd(_mm_mul_pd(xHi, vDry),
+                                            _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(wet, wet)), vWet)));
+    }
+    delayMixScalar(s, d, i, frames, feedback, dryMix, wetMix);
+}
+
+__attribute__((target("avx2")))
+void delayMixAvx2(double* s, float* d, int frames, double feedback, double dryMix,
+                  double wetMix) {
+    const __m256d vFb = _mm256_set1_pd(feedback);
+    const __m256d vDry = _mm256_set1_pd(dryMix);
+    const __m256d vWet = _mm256_set1_pd(wetMix);
+
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m256d x = _mm256_loadu_pd(s + i);
+        __m256d delayed = _mm256_cvtps_pd(_mm_loadu_ps(d + i));
+        __m128 wet = _mm256_cvtpd_ps(_mm256_add_pd(x, _mm256_mul_pd(delayed, vFb)));
+        _mm_storeu_ps(d + i, wet);
+        _mm256_storeu_pd(s + i, _mm256_add_pd(_mm256_mul_pd(x, vDry),
+                                              _mm256_mul_pd(_mm256_cvtps_pd(wet), vWet)));
+    }
+    delayMixScalar(s, d, i, frames, feedback, dryMix, wetMix);
+}
+
+#endif  // SC_SIMD_X86
+
+// --- ARM: NEON (aarch64 baseline) ---
+
+#if defined(SC_SIMD_NEON)
+
+void accumulateOscillatorNeon(const double* phase, const double* gain, double gainScale,
+                              OscWeights w, double* out, int frames) {
+    const float64x2_t vPi = vdupq_n_f64(PI);
+    const float64x2_t vHalfPi = vdupq_n_f64(HALF_PI);
+    const uint64x2_t vSign = vdupq_n_u64(0x8000000000000000ULL);
+    const float64x2_t vWs = vdupq_n_f64(w.sine);
+    const float64x2_t vWt = vdupq_n_f64(w.triangle);
+    const float64x2_t vScale = vdupq_n_f64(gainScale);
+
+    int i = 0;
+    for (; i + 2 <= frames; i += 2) {
+        float64x2_t x = vsubq_f64(vld1q_f64(phase + i), vPi);
+        uint64x2_t mask = vcgtq_f64(vabsq_f64(x), vHalfPi);
+        float64x2_t folded = vsubq_f64(vbslq_f64(vSign, x, vPi), x);
+        float64x2_t y = vbslq_f64(mask, folded, x);
+
+        float64x2_t y2 = vmulq_f64(y, y);
+        float64x2_t p = vdupq_n_f64(S11);
+        p = vaddq_f64(vmulq_f64(p, y2), vdupq_n_f64(S9));
+        p = vaddq_f64(vmulq_f64(p, y2), vdupq_n_f64(S7));
+        p = vaddq_f64(vmulq_f64(p, y2), vdupq_n_f64(S5));
+        p = vaddq_f64(vmulq_f64(p, y2), vdupq_n_f64(S3));
+        p = vaddq_f64(vmulq_f64(p, y2), vdupq_n_f64(1.0));
+
+        float64x2_t osc = vaddq_f64(vmulq_f64(vmulq_f64(y, p), vWs), vmulq_f64(y, vWt));
+        float64x2_t contrib = vmulq_f64(vmulq_f64(osc, vld1q_f64(gain + i)), vScale);
+        vst1q_f64(out + i, vaddq_f64(vld1q_f64(out + i), contrib));
+    }
+    accumulateOscillatorScalar(phase, gain, gainScale, w, out, i, frames);
+}
+
+void onePoleNeon(double* s, int frames, const OnePoleCoeffs& k, double& state) {
+    const float64x2_t zero = vdupq_n_f64(0.0);
+    const float64x2_t vc = vdupq_n_f64(k.c);
+    const float64x2_t va = vdupq_n_f64(k.a);
+    const float64x2_t va2 = vdupq_n_f64(k.a2);
+    const float64x2_t pwLo = vld1q_f64(k.pw);
+    const float64x2_t pwHi = vld1q_f64(k.pw + 2);
+
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float64x2_t zLo = vmulq_f64(vld1q_f64(s + i), vc);
+        float64x2_t zHi = vmulq_f64(vld1q_f64(s + i + 2), vc);
+
+        float64x2_t uLo = vaddq_f64(zLo, vmulq_f64(va, vextq_f64(zero, zLo, 1)));
+        float64x2_t uHi = vaddq_f64(zHi, vmulq_f64(va, vextq_f64(zLo, zHi, 1)));
+
+        float64x2_t vLo = vaddq_f64(uLo, vmulq_f64(va2, zero));
+        float64x2_t vHi = vaddq_f64(uHi, vmulq_f64(va2, uLo));
+
+        float64x2_t prev = vdupq_n_f64(state);
+        vst1q_f64(s + i, vaddq_f64(vLo, vmulq_f64(pwLo, prev)));
+        vst1q_f64(s + i + 2, vaddq_f64(vHi, vmulq_f64(pwHi, prev)));
+        state = s[i + 3];
+    }
+    onePoleTail(s, i, frames, k, state);
+}
+
+void delayMixNeon(double* s, float* d, int frames, double feedback, double dryMix,
+                  double wetMix) {
+    const float64x2_t vFb = vdupq_n_f64(feedback);
+    const float64x2_t vDry = vdupq_n_f64(dryMix);
+    const float64x2_t vWet = vdupq_n_f64(wetMix);
+
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4_t delayed = vld1q_f32(d + i);
+        float64x2_t xLo = vld1q_f64(s + i);
+        float64x2_t xHi = vld1q_f64(s + i + 2);
+
+        float64x2_t wetLo = vaddq_f64(xLo, vmulq_f64(vcvt_f64_f32(vget_low_f32(delayed)), vFb));
+        float64x2_t wetHi = vaddq_f64(xHi, vmulq_f64(vcvt_high_f64_f32(delayed), vFb));
+        float32x4_t wet = vcvt_high_f32_f64(vcvt_f32_f64(wetLo), wetHi);
+        vst1q_f32(d + i, wet);
+
+        vst1q_f64(s + i, vaddq_f64(vmulq_f64(xLo, vDry),
+                                   vmulq_f64(vcvt_f64_f32(vget_low_f32(wet)), vWet)));
+        vst1q_f64(s + i + 2, vaddq_f64(vmulq_f64(xHi, vDry),
+                                       vmulq_f64(vcvt_high_f64_f32(wet), vWet)));
+    }
+    delayMixScalar(s, d, i, frames, feedback, dryMix, wetMix);
+}
+
+#endif  // SC_SIMD_NEON
+
+}  // namespace
+
+double synthSine(double phase) {
+    return -sinePoly(foldPhase(phase));
+}
+
+double synthTriangle(double phase) {
+    return -foldPhase(phase) * TWO_OVER_PI;
+}
+
+void accumulateOscillator(const double* phase, const double* gain, double gainScale,
+                          double brightness, double* out, int frames) {
+    OscWeights w = oscWeights(brightness);
+    switch (activeSimdLevel()) {
+#if defined(SC_SIMD_X86)
+        case SimdLevel::AVX2:
+            accumulateOscillatorAvx2(phase, gain, gainScale, w, out, frames);
+            return;
+        case SimdLevel::SSE2:
+            accumulateOscillatorSse2(phase, gain, gainScale, w, out, frames);
+            return;
+#endif
+#if defined(SC_SIMD_NEON)
+        case SimdLevel::NEON:
+            accumulateOscillatorNeon(phase, gain, gainScale, w, out, frames);
+            return;
+#endif
+        default:
+            accumulateOscillatorScalar(phase, gain, gainScale, w, out, 0, frames);
+            return;
+    }
+}
+
+void onePoleLowpass(double* samples, int frames, double coeff, double& state) {
+    OnePoleCoeffs k = onePoleCoeffs(coeff);
+    switch (activeSimdLevel()) {
+#if defined(SC_SIMD_X86)
+        case SimdLevel::AVX2:
+            onePoleAvx2(samples, frames, k, state);
+            return;
+        case SimdLevel::SSE2:
+            onePoleSse2(samples, frames, k, state);
+            return;
+#endif
+#if defined(SC_SIMD_NEON)
+        case SimdLevel::NEON:
+            onePoleNeon(samples, frames, k, state);
+            return;
+#endif
+        default:
+            onePoleScalar(samples, frames, k, state);
+            return;
+    }
+}
+
+void feedbackDelayMix(double* samples, int frames, float* delayLine, int delayLength,
+                      int& delayIndex, double feedback, double dryMix, double wetMix) {
+    SimdLevel level = activeSimdLevel();
+
+    // Split at the ring buffer's wrap point so each run is contiguous
+    while (frames > 0) {
+        int run = std::min(frames, delayLength - delayIndex);
+        float* d = delayLine + delayIndex;
+
+        switch (level) {
+#if defined(SC_SIMD_X86)
+            case SimdLevel::AVX2:
+                delayMixAvx2(samples, d, run, feedback, dryMix, wetMix);
+                break;
+            case SimdLevel::SSE2:
+                delayMixSse2(samples, d, run, feedback, dryMix, wetMix);
+                break;
+#endif
+#if defined(SC_SIMD_NEON)
+            case SimdLevel::NEON:
+                delayMixNeon(samples, d, run, feedback, dryMix, wetMix);
+                break;
+#endif
+            default:
+                delayMixScalar(samples, d, 0, run, feedback, dryMix, wetMix);
+                break;
+        }
+
+        samples += run;
+        frames -= run;
+        delayIndex += run;
+        if (delayIndex == delayLength) delayIndex = 0;
+    }
+}
@@ -0,0 +1,172 @@
+#include "Warmup.hpp"
+
+#include "Composer.hpp"
+#include "CompositionCache.hpp"
+#include "Generation.hpp"
+#include "GenreTemplate.hpp"
+#include "ImageFeatures.hpp"
+#include "Log.hpp"
+#include "MusicMapping.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+using json = nlohmann::json;
+
+static long envLong(const char* key, long def) {
+    const char* v = std::getenv(key);
+    if (!v) return def;
+    try {
+        return std::stol(v);
+    } catch (...) {
+        std::cerr << "[WARN] Invalid " << key << " value, using default " << def << std::endl;
+        return def;
+    }
+}
+
+// A small binary PPM gradient: decodable by stb_image and colourful enough
+// that genre selection and planning take their ordinary paths
+static std::string syntheticImage() {
+    const int width = 64;
+    const int height = 64;
+    std::string bytes = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            bytes.push_back(static_cast<char>(x * 4));
+            bytes.push_back(static_cast<char>(y * 4));
+            bytes.push_back(static_cast<char>(255 - x * 2));
+        }
+    }
+    return bytes;
+}
+
+Warmup::Options Warmup::optionsFromEnv() {
+    Options o;
+    o.enabled = envLong("SC_WARMUP", 1) != 0;
+    o.synthetic = envLong("SC_WARMUP_SYNTHETIC", 0) != 0;
+    o.modelConnections = static_cast<size_t>(std::max(
+        0L, envLong("SC_WARMUP_MODEL_CONNECTIONS", static_cast<long>(o.modelConnections))));
+    return o;
+}
+
+Warmup::Warmup(const Options& options) : options_(options), start_(Clock::now()) {}
+
+void Warmup::record(StageResult result) {
+    std::vector<LogField> fields = {{"ms", result.ms}};
+    if (!result.detail.empty()) fields.emplace_back("detail", result.detail);
+    LogLevel level = result.ok ? LogLevel::INFO : LogLevel::WARN;
+    if (logger().enabled(level)) {
+        logger().log(level, "Warmup", result.name, fields.data(), fields.size());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages_.push_back(std::move(result));
+}
+
+void Warmup::stage(const char* name, const std::function<std::string()>& fn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_ = name;
+    }
+    Clock::time_point begin = Clock::now();
+    StageResult result{name, 0.0, true, ""};
+    try {
+        result.detail = fn();
+    } catch (const std::exception& ex) {
+        result.ok = false;
+        result.detail = ex.what();
+    }
+    result.ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    record(std::move(result));
+}
+
+void Warmup::run(const ModelClient* model) {
+    record({"init", std::chrono::duration<double, std::milli>(Clock::now() - start_).count(),
+            true, ""});
+
+    if (options_.enabled) {
+        stage("templates", [] {
+            for (GenreType type : {GenreType::EDM_CHILL, GenreType::EDM_DROP,
+                                   GenreType::RETROWAVE, GenreType::CINEMATIC}) {
+                getGenreTemplate(type);
+            }
+            warmComposer();
+            return std::string();
+        });
+
+        stage("workers", [] {
+            size_t threads = sharedWorkerPool().threadCount();
+            sharedCompositionCache();
+            return std::to_string(threads) + " threads";
+        });
+
+        bool modelUp = false;
+        if (model && model->embedded()) {
+            stage("model", [&] {
+                // Faults the mapped weights in
+                model->predict(ImageFeatures{});
+                modelUp = true;
+                return std::string("embedded");
+            });
+        } else if (model && options_.modelConnections > 0) {
+            stage("model", [&] {
+                size_t opened = model->warmup(options_.modelConnections);
+                modelUp = opened > 0;
+                if (!modelUp) {
+                    // Not fatal: model requests fall back until TF Serving is up
+                    return std::string("TF Serving not reachable");
+                }
+                return std::to_string(opened) + " connections";
+            });
+        }
+
+        if (options_.synthetic) {
+            stage("synthetic", [&] {
+                std::string image = syntheticImage();
+                CachedAnalysis analysis;
+                analysis.features = extractImageFeaturesFromMemory(
+                    reinterpret_cast<const unsigned char*>(image.data()), image.size());
+                // The first inference is often the slow one on the TF side too
+                analysis.params = modelUp ? model->predict(analysis.features)
+                                          : mapFeaturesToMusicHeuristic(analysis.features);
+                std::vector<uint8_t> midi;
+                json song = composeAnalysisToMemory(analysis, midi);
+                return song.value("decided_genre", std::string()) + ", " +
+                       std::to_string(midi.size()) + " MIDI bytes";
+            });
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.clear();
+    startupSeconds_ = std::chrono::duration<double>(Clock::now() - start_).count();
+    ready_.store(true, std::memory_order_release);
+    logInfo("Warmup", "ready", {{"startup_ms", startupSeconds_ * 1000.0}});
+}
+
+double Warmup::startupSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return startupSeconds_;
+}
+
+json Warmup::status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json stages = json::array();
+    for (const StageResult& s : stages_) {
+        json j = {{"name", s.name}, {"ms", s.ms}, {"ok", s.ok}};
+        if (!s.detail.empty()) j["detail"] = s.detail;
+        stages.push_back(std::move(j));
+    }
+
+    json resp = {{"ready", ready()}, {"stages", std::move(stages)}};
+    if (ready()) {
+        resp["startup_ms"] = startupSeconds_ * 1000.0;
+    } else {
+        resp["stage"] = current_.empty() ? "init" : current_;
+    }
+    return resp;
+}
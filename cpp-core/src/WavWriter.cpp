@@ -0,0 +1,219 @@
+#include "WavWriter.hpp"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+void putLE(char* out, std::uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    out[i] = static_cast<char>(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+// xorshift32: cheap, deterministic noise source for dither
+inline std::uint32_t nextRandom(std::uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+inline float uniform01(std::uint32_t& state) {
+  return static_cast<float>(nextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+}  // namespace
+
+WavWriter::WavWriter(const std::string& path, int sampleRate, int numChannels,
+                     std::uint32_t totalFrames, std::size_t bufferBytes)
+    : path_(path),
+      sampleRate_(sampleRate),
+      numChannels_(numChannels),
+      totalFrames_(totalFrames),
+      buffer_(std::max<std::size_t>(bufferBytes & ~std::size_t(1), 2)) {
+  fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    throw std::runtime_error("Failed to open output WAV: " + path);
+  }
+  buildHeader(header_, sampleRate_, numChannels_, totalFrames_);
+}
+
+WavWriter::WavWriter(ChunkSink sink, int sampleRate, int numChannels,
+                     std::uint32_t totalFrames, std::size_t bufferBytes)
+    : sink_(std::move(sink)),
+      sampleRate_(sampleRate),
+      numChannels_(numChannels),
+      totalFrames_(totalFrames),
+      buffer_(std::max<std::size_t>(bufferBytes & ~std::size_t(1), 2)) {
+  buildHeader(header_, sampleRate_, numChannels_, totalFrames_);
+}
+
+WavWriter::~WavWriter() {
+  if (!finished_) {
+    try {
+      finish();
+    } catch (...) {
+      // Destructors must not throw; callers that care call finish() themselves
+    }
+  }
+}
+
+void WavWriter::setDither(bool enabled, std::uint32_t seed) {
+  dither_ = enabled;
+  ditherState_ = seed ? seed : 1;  // xorshift state must be non-zero
+}
+
+void WavWriter::buildHeader(char* out, int sampleRate, int numChannels,
+                            std::uint32_t totalFrames) {
+  const int bitsPerSample = 16;
+  std::uint32_t byteRate = sampleRate * numChannels * bitsPerSample / 8;
+  std::uint32_t blockAlign = numChannels * bitsPerSample / 8;
+  std::uint32_t dataSize = totalFrames * blockAlign;
+
+  // RIFF header
+  std::memcpy(out + 0, "RIFF", 4);
+  putLE(out + 4, 36 + dataSize, 4);
+  std::memcpy(out + 8, "WAVE", 4);
+
+  // fmt subchunk
+  std::memcpy(out + 12, "fmt ", 4);
+  putLE(out + 16, 16, 4);              // Subchunk1Size
+  putLE(out + 20, 1, 2);               // AudioFormat (PCM)
+  putLE(out + 22, numChannels, 2);     // NumChannels
+  putLE(out + 24, sampleRate, 4);      // SampleRate
+  putLE(out + 28, byteRate, 4);        // ByteRate
+  putLE(out + 32, blockAlign, 2);      // BlockAlign
+  putLE(out + 34, bitsPerSample, 2);   // BitsPerSample
+
+  // data subchunk
+  std::memcpy(out + 36, "data", 4);
+  putLE(out + 40, dataSize, 4);
+}
+
+void WavWriter::convert(const float* samples, std::size_t count, char* out) {
+  if (!dither_) {
+    for (std::size_t i = 0; i < count; ++i) {
+      float s = std::max(-1.0f, std::min(1.0f, samples[i]));
+      auto v = static_cast<std::uint16_t>(static_cast<std::int16_t>(s * 32767.0f));
+      out[2 * i] = static_cast<char>(v & 0xFF);
+      out[2 * i + 1] = static_cast<char>(v >> 8);
+    }
+    return;
+  }
+
+  for (std::size_t i = 0; i < count; ++i) {
+    float s = std::max(-1.0f, std::min(1.0f, samples[i]));
+    // Difference of two uniforms = triangular PDF over +/-1 LSB
+    float noise = uniform01(ditherState_) - uniform01(ditherState_);
+    long q = std::lrint(s * 32767.0f + noise);
+    q = std::max(-32768L, std::min(32767L, q));
+    auto v = static_cast<std::uint16_t>(static_cast<std::int16_t>(q));
+    out[2 * i] = static_cast<char>(v & 0xFF);
+    out[2 * i + 1] = static_cast<char>(v >> 8);
+  }
+}
+
+void WavWriter::writeSamples(const float* samples, std::size_t count) {
+  if (finished_) {
+    throw std::runtime_error("WavWriter: write after finish()");
+  }
+
+  while (count > 0) {
+    std::size_t room = (buffer_.size() - used_) / 2;
+    std::size_t n = std::min(count, room);
+    convert(samples, n, buffer_.data() + used_);
+    used_ += n * 2;
+    samples += n;
+    count -= n;
+    samplesWritten_ += n;
+
+    if (used_ + 2 > buffer_.size()) flush();
+  }
+}
+
+void WavWriter::flush() {
+  if (!headerWritten_) {
+    writeAll(header_, HEADER_BYTES, buffer_.data(), used_);
+    headerWritten_ = true;
+  } else if (used_ > 0) {
+    writeAll(nullptr, 0, buffer_.data(), used_);
+  }
+  used_ = 0;
+}
+
+void WavWriter::writeAll(const char* header, std::size_t headerSize,
+                         const char* data, std::size_t dataSize) {
+  if (sink_) {
+    if ((headerSize > 0 && !sink_(header, headerSize)) ||
+        (dataSize > 0 && !sink_(data, dataSize))) {
+      throw std::runtime_error("WAV stream aborted by receiver");
+    }
+    return;
+  }
+
+  iovec iov[2];
+  int iovCount = 0;
+  if (headerSize > 0) iov[iovCount++] = {const_cast<char*>(header), headerSize};
+  if (dataSize > 0) iov[iovCount++] = {const_cast<char*>(data), dataSize};
+
+  // writev may write partially; advance the iovecs until everything is out
+  int first = 0;
+  while (first < iovCount) {
+    ssize_t written = ::writev(fd_, iov + first, iovCount - first);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error("Error while writing WAV file: " + path_);
+    }
+    auto remaining = static_cast<std::size_t>(written);
+    while (first < iovCount && remaining >= iov[first].iov_len) {
+      remaining -= iov[first].iov_len;
+      ++first;
+    }
+    if (first < iovCount) {
+      iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + remaining;
+      iov[first].iov_len -= remaining;
+    }
+  }
+}
+
+void WavWriter::finish() {
+  if (finished_) return;
+  finished_ = true;
+
+  if (fd_ < 0) {
+    flush();
+    return;
+  }
+
+  try {
+    flush();
+
+    // Files can be fixed up if fewer/more frames arrived than announced
+    auto frames = static_cast<std::uint32_t>(samplesWritten_ / numChannels_);
+    if (frames != totalFrames_) {
+      buildHeader(header_, sampleRate_, numChannels_, frames);
+      if (::pwrite(fd_, header_, HEADER_BYTES, 0) != static_cast<ssize_t>(HEADER_BYTES)) {
+        throw std::runtime_error("Error while writing WAV file: " + path_);
+      }
+    }
+  } catch (...) {
+    ::close(fd_);
+    fd_ = -1;
+    throw;
+  }
+
+  int rc = ::close(fd_);
+  fd_ = -1;
+  if (rc != 0) {
+    throw std::runtime_error("Error while writing WAV file: " + path_);
+  }
+}
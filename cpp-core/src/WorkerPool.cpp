@@ -0,0 +1,117 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <string>
+
+WorkerPool::WorkerPool(size_t numThreads) {
+    numThreads = std::max<size_t>(numThreads, 1);
+    workers_.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) {
+        t.join();
+    }
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void WorkerPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) return;  // stopping and drained
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        try {
+            task();
+        } catch (...) {
+            // Tasks report their own errors; never let one kill a worker
+        }
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, size_t maxParallelism,
+                             const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+
+    // Shared by the caller and the helpers; helpers that start late simply
+    // find no indices left, so they may outlive this call safely.
+    struct Range {
+        std::atomic<size_t> next{0};
+        size_t count = 0;
+        size_t done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto range = std::make_shared<Range>();
+    range->count = count;
+
+    // Only touches body for claimed indices, all of which finish before
+    // parallelFor returns, so capturing it by pointer is safe
+    const std::function<void(size_t)>* fn = &body;
+    auto drain = [range, fn] {
+        size_t completed = 0;
+        std::exception_ptr error;
+        for (size_t i; (i = range->next.fetch_add(1)) < range->count;) {
+            try {
+                (*fn)(i);
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+            ++completed;
+        }
+        if (completed == 0) return;
+        std::lock_guard<std::mutex> lock(range->mutex);
+        if (error && !range->error) range->error = error;
+        range->done += completed;
+        if (range->done == range->count) range->finished.notify_all();
+    };
+
+    size_t helpers = std::min({count, std::max<size_t>(maxParallelism, 1), threadCount() + 1}) - 1;
+    for (size_t i = 0; i < helpers; ++i) {
+        submit(drain);
+    }
+    drain();
+
+    std::unique_lock<std::mutex> lock(range->mutex);
+    range->finished.wait(lock, [&] { return range->done == range->count; });
+    if (range->error) std::rethrow_exception(range->error);
+}
+
+WorkerPool& sharedWorkerPool() {
+    static WorkerPool pool([] {
+        if (const char* env = std::getenv("SC_WORKER_THREADS")) {
+            try {
+                int n = std::stoi(env);
+                if (n > 0) return static_cast<size_t>(n);
+            } catch (...) {
+                // Fall through to the hardware default
+            }
+        }
+        return static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency()));
+    }());
+    return pool;
+}
@@ -1,20 +1,31 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdio>  // for std::remove
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "AudioEngine.hpp"
 #include "AudioProducerClient.hpp"  // Phase 8: Production service client
 #include "Composer.hpp"             // Phase 7: MIDI generation
+#include "Generation.hpp"           // Batch generation
 #include "GenreTemplate.hpp"        // Phase 8: Genre templates
 #include "HttpServer.hpp"
 #include "ImageFeatures.hpp"
+#include "Log.hpp"
+#include "MixEngine.hpp"  // In-process mixdown and mastering
 #include "ModelClient.hpp"
 #include "MusicMapping.hpp"
 #include "MusicalStyle.hpp"    // Phase 7: Extended style controls
+#include "Prefork.hpp"         // Multi-process serve mode
 #include "SectionPlanner.hpp"  // Phase 8: Structured composition
 #include "SongSpec.hpp"        // Phase 7: Song composition
+#include "SoundFontRenderer.hpp"  // In-process FluidSynth
+#include "WavWriter.hpp"
 
 enum class Mode { Heuristic, Model };
 
@@ -32,9 +43,95 @@ static std::string getEnvOrDefault(const char* key,
   return val ? std::string(val) : defaultValue;
 }
 
+// SC_MIXDOWN=auto (default) mixes and masters in-process whenever the
+// SoundFont renderer is built in; "native" insists on it. "producer" sends
+// --full-pipeline stems to the audio-producer service and leaves the CLI
+// render unmastered.
+static std::string mixdownMode() {
+  return getEnvOrDefault("SC_MIXDOWN", "auto");
+}
+
+static bool useNativeMixdown() {
+  std::string mode = mixdownMode();
+  return mode == "native" || (mode == "auto" && SoundFontRenderer::available());
+}
+
+// 16-bit stereo WAV of a mastered mix, dithered
+static void writeMixWav(const MixResult& mix, int sampleRate,
+                        const std::string& wavPath) {
+  WavWriter wav(wavPath, sampleRate, 2,
+                static_cast<std::uint32_t>(mix.samples.size() / 2));
+  wav.setDither(true);
+  wav.writeSamples(mix.samples.data(), mix.samples.size());
+  wav.finish();
+}
+
 int main(int argc, char** argv) {
+  // --fast-features may appear anywhere; strip it so the positional
+  // parsing below is unchanged
+  FeatureOptions featureOptions;
+  {
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+      if (std::string(argv[i]) == "--fast-features") {
+        featureOptions.fast = true;
+      } else {
+        argv[kept++] = argv[i];
+      }
+    }
+    argc = kept;
+  }
+
+  // The server logs asynchronously at INFO (per-request detail is DEBUG);
+  // the CLI writes every line as it happens, in order with its own output.
+  // SC_LOG_LEVEL, SC_LOG_FORMAT and SC_LOG_ASYNC override either.
+  bool serve = argc >= 2 && std::string(argv[1]) == "--serve";
+  Logger::Options serveLogOptions;
+  serveLogOptions.level = LogLevel::INFO;
+  serveLogOptions.async = true;
+  serveLogOptions.timestamps = true;
+
+  // --serve --workers=N [--pin-cpus]: prefork N server processes
+  PreforkOptions prefork = preforkOptionsFromEnv();
+  bool preforked = false;
+  if (serve) {
+    for (int i = 2; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg.rfind("--workers=", 0) == 0) {
+        try {
+          prefork.workers = static_cast<size_t>(std::max(0L, std::stol(arg.substr(10))));
+        } catch (...) {
+          std::cerr << "Invalid " << arg << ", expected --workers=N" << std::endl;
+          return 1;
+        }
+        preforked = true;
+      } else if (arg == "--pin-cpus") {
+        prefork.pinCpus = true;
+      }
+    }
+    preforked = preforked || std::getenv("SC_SERVE_WORKERS");
+    // One worker is the plain single-process server
+    if (preforked && (prefork.workers == 1 ||
+                      (prefork.workers == 0 && allowedCpuCount() == 1))) {
+      preforked = false;
+    }
+  }
+
+  // The supervisor must not start threads before forking; it logs
+  // synchronously and each worker configures its own async logger
+  Logger::Options logOptions;
+  if (preforked) {
+    logOptions.level = LogLevel::INFO;
+    logOptions.timestamps = true;
+  } else if (serve) {
+    logOptions = serveLogOptions;
+  }
+  logOptions = Logger::optionsFromEnv(logOptions);
+  if (preforked) logOptions.async = false;
+  logger().configure(logOptions);
+
   // Check for server mode first
-  if (argc >= 2 && std::string(argv[1]) == "--serve") {
+  if (serve) {
     // HTTP server mode
     std::string defaultMode = getEnvOrDefault("SC_DEFAULT_MODE", "model");
     std::string outputDir = getEnvOrDefault("SC_OUTPUT_DIR", "../examples");
@@ -55,11 +152,80 @@ int main(int argc, char** argv) {
     std::cout << "  Default mode: " << defaultMode << std::endl;
     std::cout << "  Output directory: " << outputDir << std::endl;
 
+    auto serveHttp = [&]() {
+      try {
+        runHttpServer(port, defaultMode, outputDir);
+        return 0;
+      } catch (const std::exception& ex) {
+        std::cerr << "Failed to start HTTP server: " << ex.what() << std::endl;
+        return 1;
+      }
+    };
+    if (!preforked) return serveHttp();
+
+    return runPreforkServer(prefork, [&](size_t /*worker*/) {
+      logger().configure(Logger::optionsFromEnv(serveLogOptions));
+      return serveHttp();
+    });
+  }
+
+  // Batch mode: one process for a whole manifest of images
+  // Usage: soundcanvas_core --batch <manifest> <results.ndjson> [output_dir]
+  // Manifest lines are image paths or JSON objects like /generate bodies;
+  // blank lines and lines starting with '#' are skipped.
+  if (argc >= 4 && std::string(argv[1]) == "--batch") {
+    std::string manifestPath = argv[2];
+    std::string resultsPath = argv[3];
+    std::string outputDir =
+        argc >= 5 ? argv[4] : getEnvOrDefault("SC_OUTPUT_DIR", ".");
+
     try {
-      runHttpServer(port, defaultMode, outputDir);
-      return 0;
+      BatchItem defaults;
+      defaults.mode = getEnvOrDefault("SC_DEFAULT_MODE", "model");
+      defaults.featureOptions = featureOptions;
+
+      std::ifstream manifest(manifestPath);
+      if (!manifest) {
+        throw std::runtime_error("Cannot read manifest: " + manifestPath);
+      }
+      std::vector<BatchItem> items;
+      std::string line;
+      for (int lineNo = 1; std::getline(manifest, line); ++lineNo) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        std::string entry = line.substr(start, end - start + 1);
+        try {
+          items.push_back(batchItemFromJson(
+              entry[0] == '{' ? nlohmann::json::parse(entry)
+                              : nlohmann::json(entry),
+              defaults));
+        } catch (const std::exception& ex) {
+          throw std::runtime_error(manifestPath + ":" + std::to_string(lineNo) +
+                                   ": " + ex.what());
+        }
+      }
+
+      std::ofstream results(resultsPath, std::ios::trunc);
+      if (!results) {
+        throw std::runtime_error("Cannot write results: " + resultsPath);
+      }
+
+      ModelClient client(getEnvOrDefault(
+          "SC_TF_SERVING_URL",
+          "http://localhost:8501/v1/models/soundcanvas:predict"));
+      BatchGenerator generator(outputDir, &client, nullptr);
+      size_t ok = generator.run(items, [&results](const nlohmann::json& r) {
+        results << r.dump() << '\n';
+        results.flush();
+        return static_cast<bool>(results);
+      });
+
+      std::cout << "Batch complete: " << ok << "/" << items.size()
+                << " succeeded, results in " << resultsPath << std::endl;
+      return ok == items.size() ? 0 : 1;
     } catch (const std::exception& ex) {
-      std::cerr << "Failed to start HTTP server: " << ex.what() << std::endl;
+      std::cerr << "Error: " << ex.what() << std::endl;
       return 1;
     }
   }
@@ -75,7 +241,7 @@ int main(int argc, char** argv) {
       std::cout << "Reading image: " << inputImage << std::endl;
 
       // Extract features
-      ImageFeatures features = extractImageFeatures(inputImage);
+      ImageFeatures features = extractImageFeatures(inputImage, featureOptions);
 
       // Get music parameters (use model if available, else heuristic)
       MusicParameters params;
@@ -159,7 +325,7 @@ int main(int argc, char** argv) {
 
       // Step 1: Extract features
       std::cout << "[1/4] Extracting image features...\n";
-      ImageFeatures features = extractImageFeatures(inputImage);
+      ImageFeatures features = extractImageFeatures(inputImage, featureOptions);
 
       // Step 2: Get music parameters
       std::cout << "[2/4] Generating musical parameters...\n";
@@ -183,16 +349,57 @@ int main(int argc, char** argv) {
       std::cout << "  Key: " << songSpec.rootMidiNote << "\n";
       std::cout << "  Mood: " << songSpec.moodScore << "\n";
 
-      // Step 3: Compose separate MIDI stems (Person A)
-      std::cout << "[3/4] Composing separate MIDI stems...\n";
-      auto stemFiles = composeSongToStems(songSpec, stemsDir);
+      // Step 3: Compose once, write the full mix and its stems (Person A)
+      std::cout << "[3/4] Composing MIDI mix and stems...\n";
+      std::string mixMidi = stemsDir + "/full_mix.mid";
+
+      // SC_PRODUCER_PARALLEL_STEMS=1: stems go to the producer as bytes and
+      // render concurrently, instead of as files rendered by one /produce
+      bool parallelStems =
+          getEnvOrDefault("SC_PRODUCER_PARALLEL_STEMS", "0") == "1";
+      MidiWriter midi = composeSong(songSpec);
+      midi.write(mixMidi);
+      std::map<std::string, std::string> stemFiles;
+      std::map<std::string, std::vector<uint8_t>> stemBytes;
+      if (parallelStems) {
+        stemBytes = midi.separateStemBytes();
+      } else {
+        stemFiles = midi.writeSeparateStems(stemsDir);
+      }
 
-      std::cout << "  Generated " << stemFiles.size() << " stem files:\n";
-      for (const auto& [name, path] : stemFiles) {
-        std::cout << "    " << name << ": " << path << "\n";
+      std::cout << "  Mix: " << mixMidi << "\n";
+      if (parallelStems) {
+        std::cout << "  Composed " << stemBytes.size() << " stems in memory:\n";
+        for (const auto& [name, bytes] : stemBytes) {
+          std::cout << "    " << name << ": " << bytes.size() << " bytes\n";
+        }
+      } else {
+        std::cout << "  Generated " << stemFiles.size() << " stem files:\n";
+        for (const auto& [name, path] : stemFiles) {
+          std::cout << "    " << name << ": " << path << "\n";
+        }
+      }
+
+      // Step 4: Mix and master in-process, or call the audio-producer
+      // service (Person B)
+      if (useNativeMixdown()) {
+        std::cout << "[4/4] Rendering stems, mixing & mastering in-process...\n";
+        SoundFontRenderer& renderer = sharedSoundFontRenderer();
+        std::vector<std::vector<float>> tracks = renderer.renderTracks(midi);
+        MixEngine::Options mixOptions = MixEngine::optionsFromEnv();
+        mixOptions.sampleRate = renderer.options().sampleRate;
+        MixResult mixed =
+            MixEngine(mixOptions).mix(specMixStems(songSpec, tracks));
+        writeMixWav(mixed, mixOptions.sampleRate, outputWav);
+
+        std::cout << "\n✅ Full pipeline complete!\n";
+        std::cout << "   Output: " << outputWav << "\n";
+        std::cout << "   Loudness: " << mixed.loudnessLufs << " LUFS, peak "
+                  << 20.0 * std::log10(std::max(mixed.peak, 1e-9f))
+                  << " dBFS\n";
+        return 0;
       }
 
-      // Step 4: Call audio-producer service (Person B)
       std::cout << "[4/4] Professional mixing & mastering...\n";
 
       std::string producerUrl =
@@ -200,7 +407,7 @@ int main(int argc, char** argv) {
 
       AudioProducerClient producer(producerUrl);
 
-      if (!producer.healthCheck()) {
+      auto reportUnavailable = [&producerUrl]() {
         std::cerr << "\n⚠️  Warning: audio-producer service not available at "
                   << producerUrl << "\n";
         std::cerr << "  Falling back to basic FluidSynth rendering...\n\n";
@@ -211,16 +418,41 @@ int main(int argc, char** argv) {
         std::cerr
             << "Using basic rendering instead of professional production.\n";
         return 1;
+      };
+
+      // Cached health, no probe: the first request finds out (and
+      // updates it) if the service is down
+      if (!producer.healthy()) {
+        return reportUnavailable();
       }
 
-      bool success = producer.produceTrack(
-          stemFiles, outputWav,
+      std::string producerGenre =
           "EDM_" + std::string(static_cast<int>(songSpec.groove) == 1
                                    ? "Drop"
-                                   : "Chill"),
-          true,  // apply mastering
-          true,  // apply sidechain
-          {"bass", "chords", "melody", "pad"});
+                                   : "Chill");
+      std::vector<std::string> sidechainTargets = {"bass", "chords", "melody",
+                                                   "pad"};
+      // Producers that stream NDJSON report mixing/mastering progress
+      auto progress = [](double fraction, const std::string& stage) {
+        std::cout << "  " << static_cast<int>(fraction * 100) << "% "
+                  << stage << "\n";
+      };
+      bool success;
+      if (parallelStems) {
+        size_t maxInFlight = static_cast<size_t>(std::max(
+            1, std::atoi(
+                   getEnvOrDefault("SC_PRODUCER_MAX_IN_FLIGHT", "6").c_str())));
+        success = producer.produceTrackParallel(
+            stemBytes, stemsDir, outputWav, producerGenre,
+            true,  // apply mastering
+            true,  // apply sidechain
+            sidechainTargets, maxInFlight, progress);
+      } else {
+        success = producer.produceTrack(stemFiles, outputWav, producerGenre,
+                                        true,  // apply mastering
+                                        true,  // apply sidechain
+                                        sidechainTargets, progress);
+      }
 
       if (success) {
         std::cout << "\n✅ Full pipeline complete!\n";
@@ -230,6 +462,8 @@ int main(int argc, char** argv) {
                      "limiting\n";
         std::cout << "\nPlay with: afplay " << outputWav << "\n";
         return 0;
+      } else if (!producer.healthy()) {
+        return reportUnavailable();
       } else {
         std::cerr << "Production failed.\n";
         return 1;
@@ -251,14 +485,20 @@ int main(int argc, char** argv) {
     std::cerr << "Usage:\n"
               << "  soundcanvas_core --serve                                   "
                  "           → HTTP server mode\n"
+              << "  soundcanvas_core --serve --workers=N [--pin-cpus]          "
+                 "           → N server processes (0 = per CPU)\n"
               << "  soundcanvas_core --compose-only <input_image> "
                  "<output_midi>           → MIDI composition only\n"
               << "  soundcanvas_core --full-pipeline <input_image> "
                  "<output_wav> [stems_dir] → Full production pipeline\n"
+              << "  soundcanvas_core --batch <manifest> <results.ndjson> "
+                 "[output_dir] → Many images, one process\n"
               << "  soundcanvas_core <input_image> <output_wav>                "
                  "           → CLI heuristic mode\n"
               << "  soundcanvas_core --mode=<heuristic|model> <input_image> "
-                 "<output_wav>  → CLI with mode\n";
+                 "<output_wav>  → CLI with mode\n"
+              << "  Add --fast-features to a CLI mode to estimate image features "
+                 "from a pixel sample\n";
     return 1;
   }
 
@@ -285,7 +525,7 @@ int main(int argc, char** argv) {
 
   try {
     std::cout << "Reading image: " << inputImage << std::endl;
-    ImageFeatures features = extractImageFeatures(inputImage);
+    ImageFeatures features = extractImageFeatures(inputImage, featureOptions);
 
     std::cout << "Image features (8-dim):\n"
               << "  avgR         = " << features.avgR << "\n"
@@ -379,27 +619,51 @@ int main(int argc, char** argv) {
       std::cout << std::endl;
     }
 
-    // Generate intermediate MIDI file
-    std::string tempMidi = outputWav + ".tmp.mid";
-    std::cout << "\nComposing MIDI to: " << tempMidi << std::endl;
-    composeGenreSongToMidi(plan, tempMidi);
-
-    // Render MIDI to WAV using FluidSynth
-    std::string soundfont = "/usr/share/sounds/sf2/FluidR3_GM.sf2";
-    std::cout << "Rendering MIDI to WAV using FluidSynth..." << std::endl;
-
-    std::string fluidCmd = "fluidsynth -ni -g 0.8 -F \"" + outputWav + "\" \"" +
-                           soundfont + "\" \"" + tempMidi + "\" 2>&1";
-    int result = std::system(fluidCmd.c_str());
+    SoundFontRenderer::Options renderOptions = SoundFontRenderer::optionsFromEnv();
+    if (SoundFontRenderer::available()) {
+      // Render in-process: no intermediate MIDI file, no fluidsynth process
+      std::cout << "\nComposing MIDI in memory" << std::endl;
+      MidiWriter midi = composeGenreSong(plan);
+      std::cout << "Rendering MIDI to WAV with " << renderOptions.soundFontPath
+                << "..." << std::endl;
+      SoundFontRenderer renderer(renderOptions);
+      if (!useNativeMixdown()) {
+        renderer.renderToWav(midi, outputWav);
+      } else {
+        // Per-track render, then sidechain, bus compression and limiting
+        // as the genre template asks
+        std::vector<std::vector<float>> tracks = renderer.renderTracks(midi);
+        MixEngine::Options mixOptions = MixEngine::optionsFromEnv();
+        mixOptions.sampleRate = renderOptions.sampleRate;
+        MixResult mixed = MixEngine(mixOptions).mix(
+            planMixStems(plan, songPlanToSpec(plan), tracks));
+        writeMixWav(mixed, mixOptions.sampleRate, outputWav);
+        std::cout << "Mastered to " << mixed.loudnessLufs << " LUFS"
+                  << std::endl;
+      }
+    } else {
+      // Generate intermediate MIDI file
+      std::string tempMidi = outputWav + ".tmp.mid";
+      std::cout << "\nComposing MIDI to: " << tempMidi << std::endl;
+      composeGenreSongToMidi(plan, tempMidi);
+
+      // Render MIDI to WAV using FluidSynth
+      std::cout << "Rendering MIDI to WAV using FluidSynth..." << std::endl;
+
+      std::string fluidCmd = "fluidsynth -ni -g 0.8 -F \"" + outputWav +
+                             "\" \"" + renderOptions.soundFontPath + "\" \"" +
+                             tempMidi + "\" 2>&1";
+      int result = std::system(fluidCmd.c_str());
+
+      if (result != 0) {
+        std::cerr << "Warning: FluidSynth returned non-zero exit code: "
+                  << result << std::endl;
+      }
 
-    if (result != 0) {
-      std::cerr << "Warning: FluidSynth returned non-zero exit code: " << result
-                << std::endl;
+      // Clean up temporary MIDI file
+      std::remove(tempMidi.c_str());
     }
 
-    // Clean up temporary MIDI file
-    std::remove(tempMidi.c_str());
-
     std::cout << "Wrote audio to: " << outputWav << std::endl;
 
     return 0;
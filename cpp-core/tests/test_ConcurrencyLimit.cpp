@@ -0,0 +1,61 @@
+#include "ConcurrencyLimit.hpp"
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static bool check(bool condition, const char* what) {
+    if (!condition) std::cout << "ConcurrencyLimit: " << what << "\n";
+    return condition;
+}
+
+// Slots up to the limit, refusal beyond it, release on the last copy
+static bool testLimit() {
+    ConcurrencyLimit limit(2);
+    ConcurrencyLimit::Slot a = limit.tryAcquire();
+    ConcurrencyLimit::Slot b = limit.tryAcquire();
+    ConcurrencyLimit::Slot refused = limit.tryAcquire();
+    bool ok = check(a && b && !refused, "wrong admission at the limit") &&
+              check(limit.active() == 2, "active() wrong");
+
+    ConcurrencyLimit::Slot copy = a;
+    a.reset();
+    ok = check(limit.active() == 2 && !limit.tryAcquire(), "slot released while a copy was alive") && ok;
+    copy.reset();
+    ok = check(limit.active() == 1, "slot not released by its last copy") && ok;
+    ConcurrencyLimit::Slot c = limit.tryAcquire();
+    ok = check(c && limit.active() == 2, "freed slot not reusable") && ok;
+
+    ConcurrencyLimit none(0);
+    return check(!none.tryAcquire() && none.active() == 0, "a zero limit admitted something") && ok;
+}
+
+// Concurrent callers never hold more than the limit at once
+static bool testConcurrent() {
+    ConcurrencyLimit limit(3);
+    std::atomic<size_t> holding{0}, worst{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 2000; ++i) {
+                ConcurrencyLimit::Slot slot = limit.tryAcquire();
+                if (!slot) continue;
+                size_t now = ++holding;
+                size_t seen = worst.load();
+                while (now > seen && !worst.compare_exchange_weak(seen, now)) {
+                }
+                --holding;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    return check(worst <= 3, "more slots held than the limit") &&
+           check(limit.active() == 0, "slots leaked");
+}
+
+int main() {
+    bool ok = testLimit();
+    ok = testConcurrent() && ok;
+    std::cout << (ok ? "ConcurrencyLimit test passed\n" : "ConcurrencyLimit test failed\n");
+    return ok ? 0 : 1;
+}
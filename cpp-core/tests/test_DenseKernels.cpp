@@ -0,0 +1,136 @@
+#include "DenseKernels.hpp"
+#include "SimdDispatch.hpp"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Vector levels this CPU can run, besides SCALAR
+static std::vector<SimdLevel> vectorLevels() {
+    SimdLevel best = detectSimdLevel();
+    if (best == SimdLevel::NEON) return {SimdLevel::NEON};
+    std::vector<SimdLevel> levels;
+    if (best >= SimdLevel::SSE2) levels.push_back(SimdLevel::SSE2);
+    if (best >= SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+    return levels;
+}
+
+static std::vector<float> randomFloats(size_t n, uint32_t& state) {
+    std::vector<float> v(n);
+    for (float& x : v) {
+        state = state * 1664525u + 1013904223u;
+        x = static_cast<float>(static_cast<int32_t>(state >> 8) - (1 << 23)) / (1 << 22);
+    }
+    return v;
+}
+
+static std::vector<int8_t> randomInt8(size_t n, uint32_t& state) {
+    std::vector<int8_t> v(n);
+    for (int8_t& x : v) {
+        state = state * 1664525u + 1013904223u;
+        x = static_cast<int8_t>(state >> 24);
+    }
+    // Both ends of the range, which the int8 loaders must sign-extend
+    if (n > 1) {
+        v[0] = -128;
+        v[n - 1] = 127;
+    }
+    return v;
+}
+
+// Every vector level must produce the scalar bits, for output widths that
+// aren't a multiple of the lane count (so the tails are covered too)
+static bool testVectorMatchesScalar() {
+    std::vector<SimdLevel> levels = vectorLevels();
+    if (levels.empty()) {
+        std::cout << "No vector dense kernel on this CPU, skipping SIMD check\n";
+        return true;
+    }
+
+    const size_t rows = 3;
+    const size_t inputSizes[] = {1, 7, 9};
+    const size_t outputSizes[] = {1, 3, 4, 5, 7, 8, 9, 13, 16, 17, 31};
+    uint32_t state = 4242;
+    bool ok = true;
+    for (size_t inputs : inputSizes) {
+        for (size_t outputs : outputSizes) {
+            std::vector<float> in = randomFloats(rows * inputs, state);
+            std::vector<float> weights = randomFloats(inputs * outputs, state);
+            std::vector<int8_t> weights8 = randomInt8(inputs * outputs, state);
+            std::vector<float> scales = randomFloats(outputs, state);
+            std::vector<float> bias = randomFloats(outputs, state);
+
+            for (bool relu : {false, true}) {
+                std::vector<float> scalar(rows * outputs), scalar8(rows * outputs);
+                setSimdLevel(SimdLevel::SCALAR);
+                denseLayer(in.data(), rows, inputs, weights.data(), bias.data(), outputs, relu,
+                           scalar.data());
+                denseLayerInt8(in.data(), rows, inputs, weights8.data(), scales.data(), bias.data(),
+                               outputs, relu, scalar8.data());
+
+                for (SimdLevel level : levels) {
+                    std::vector<float> simd(rows * outputs), simd8(rows * outputs);
+                    setSimdLevel(level);
+                    denseLayer(in.data(), rows, inputs, weights.data(), bias.data(), outputs, relu,
+                               simd.data());
+                    denseLayerInt8(in.data(), rows, inputs, weights8.data(), scales.data(),
+                                   bias.data(), outputs, relu, simd8.data());
+                    size_t bytes = simd.size() * sizeof(float);
+                    if (std::memcmp(simd.data(), scalar.data(), bytes) != 0) {
+                        std::cout << "SIMD (" << simdLevelName(level) << ") float32 layer "
+                                  << inputs << "x" << outputs << " differs from scalar\n";
+                        ok = false;
+                    }
+                    if (std::memcmp(simd8.data(), scalar8.data(), bytes) != 0) {
+                        std::cout << "SIMD (" << simdLevelName(level) << ") int8 layer "
+                                  << inputs << "x" << outputs << " differs from scalar\n";
+                        ok = false;
+                    }
+                }
+            }
+        }
+    }
+    setSimdLevel(detectSimdLevel());
+    if (ok) std::cout << "Vector dense kernels match scalar bit for bit\n";
+    return ok;
+}
+
+// The scalar path itself against a direct evaluation of the formula
+static bool testScalarMatchesFormula() {
+    const size_t rows = 2, inputs = 3, outputs = 5;
+    const float in[] = {1.0f, -2.0f, 0.5f, 0.0f, 3.0f, -1.0f};
+    const float weights[] = {1, 2, 3, 4, 5, -1, -2, -3, -4, -5, 0.5f, 0.25f, 0, -0.25f, -0.5f};
+    const int8_t weights8[] = {1, 2, 3, 4, 5, -1, -2, -3, -4, -5, 10, 20, 0, -20, -127};
+    const float scales[] = {1.0f, 0.5f, 0.25f, 2.0f, 0.125f};
+    const float bias[] = {0.5f, -0.5f, 1.0f, 0.0f, -8.0f};
+
+    setSimdLevel(SimdLevel::SCALAR);
+    float out[rows * outputs], out8[rows * outputs];
+    denseLayer(in, rows, inputs, weights, bias, outputs, true, out);
+    denseLayerInt8(in, rows, inputs, weights8, scales, bias, outputs, false, out8);
+    setSimdLevel(detectSimdLevel());
+
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t j = 0; j < outputs; ++j) {
+            double sum = bias[j], sum8 = bias[j];
+            for (size_t i = 0; i < inputs; ++i) {
+                sum += in[r * inputs + i] * weights[i * outputs + j];
+                sum8 += in[r * inputs + i] * weights8[i * outputs + j] * scales[j];
+            }
+            if (sum < 0.0) sum = 0.0;
+            if (out[r * outputs + j] != static_cast<float>(sum) ||
+                out8[r * outputs + j] != static_cast<float>(sum8)) {
+                std::cout << "Dense layer output " << r << "," << j << " is wrong\n";
+                return false;
+            }
+        }
+    }
+    std::cout << "Scalar dense kernels match the reference\n";
+    return true;
+}
+
+int main() {
+    bool ok = testScalarMatchesFormula();
+    ok = testVectorMatchesScalar() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "EmbeddedModel.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// A hand-written .scnn: 3 inputs -> 5 (relu, float32) -> 2 (linear, int8)
+namespace {
+
+const uint32_t kInputs = 3, kHidden = 5, kOutputs = 2;
+const float kInputMean[kInputs] = {0.5f, 0.0f, -1.0f};
+const float kInputScale[kInputs] = {2.0f, 1.0f, 0.5f};
+const float kOutputMean[kOutputs] = {100.0f, 0.0f};
+const float kOutputScale[kOutputs] = {10.0f, 0.5f};
+const float kW1[kInputs * kHidden] = {1, -1, 0.5f, 0, 2, -0.5f, 1, 1, -2, 0.25f, 0, 3, -1, 1, -1};
+const float kB1[kHidden] = {0.1f, 0.2f, -0.3f, 0.0f, 1.0f};
+const float kScales2[kOutputs] = {0.01f, 0.02f};
+const int8_t kW2[kHidden * kOutputs] = {50, -20, 127, -128, 0, 7, -64, 33, 12, 99};
+const float kB2[kOutputs] = {0.5f, -0.25f};
+
+template <typename T>
+void put(std::vector<unsigned char>& out, const T* values, size_t count) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(values);
+    out.insert(out.end(), p, p + count * sizeof(T));
+}
+
+void putU32(std::vector<unsigned char>& out, uint32_t value) {
+    put(out, &value, 1);
+}
+
+std::vector<unsigned char> modelBytes() {
+    std::vector<unsigned char> out;
+    out.insert(out.end(), {'S', 'C', 'N', 'N'});
+    putU32(out, EmbeddedModel::kVersion);
+    putU32(out, kInputs);
+    putU32(out, kOutputs);
+    putU32(out, 2);
+    putU32(out, 0);
+    put(out, kInputMean, kInputs);
+    put(out, kInputScale, kInputs);
+    put(out, kOutputMean, kOutputs);
+    put(out, kOutputScale, kOutputs);
+
+    putU32(out, kInputs);
+    putU32(out, kHidden);
+    putU32(out, 1);  // relu
+    putU32(out, 0);  // float32
+    put(out, kW1, kInputs * kHidden);
+    put(out, kB1, kHidden);
+
+    putU32(out, kHidden);
+    putU32(out, kOutputs);
+    putU32(out, 0);  // linear
+    putU32(out, 1);  // int8
+    put(out, kScales2, kOutputs);
+    put(out, kW2, kHidden * kOutputs);
+    out.insert(out.end(), 2, 0);  // 10 weight bytes, padded to 12
+    put(out, kB2, kOutputs);
+    return out;
+}
+
+void writeFile(const std::string& path, const std::vector<unsigned char>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+void reference(const float* x, float* y) {
+    double hidden[kHidden];
+    for (uint32_t j = 0; j < kHidden; ++j) {
+        double sum = kB1[j];
+        for (uint32_t i = 0; i < kInputs; ++i) {
+            sum += (x[i] - kInputMean[i]) * kInputScale[i] * kW1[i * kHidden + j];
+        }
+        hidden[j] = sum > 0.0 ? sum : 0.0;
+    }
+    for (uint32_t j = 0; j < kOutputs; ++j) {
+        double sum = kB2[j];
+        for (uint32_t i = 0; i < kHidden; ++i) {
+            sum += hidden[i] * kW2[i * kOutputs + j] * kScales2[j];
+        }
+        y[j] = static_cast<float>(sum * kOutputScale[j] + kOutputMean[j]);
+    }
+}
+
+bool rejects(const std::string& path, const std::vector<unsigned char>& bytes, const char* what) {
+    writeFile(path, bytes);
+    try {
+        EmbeddedModel model(path);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    std::cout << "EmbeddedModel accepted a " << what << " file\n";
+    return false;
+}
+
+}  // namespace
+
+int main() {
+    const std::string path = "test_embedded_model.scnn";
+    std::vector<unsigned char> bytes = modelBytes();
+    bool ok = true;
+
+    try {
+        writeFile(path, bytes);
+        EmbeddedModel model(path);
+        if (model.inputs() != kInputs || model.outputs() != kOutputs || model.layerCount() != 2 ||
+            !model.quantized()) {
+            std::cout << "EmbeddedModel read the wrong shape\n";
+            ok = false;
+        }
+
+        const float rows[2][kInputs] = {{1.0f, -0.5f, 2.0f}, {-3.0f, 4.0f, 0.0f}};
+        float out[2 * kOutputs];
+        model.evaluate(&rows[0][0], 2, out);
+        for (int r = 0; r < 2; ++r) {
+            float expected[kOutputs];
+            reference(rows[r], expected);
+            for (uint32_t j = 0; j < kOutputs; ++j) {
+                if (std::fabs(out[r * kOutputs + j] - expected[j]) > 1e-4f * std::fabs(expected[j]) + 1e-4f) {
+                    std::cout << "EmbeddedModel output " << r << "," << j << " = " << out[r * kOutputs + j]
+                              << ", expected " << expected[j] << "\n";
+                    ok = false;
+                }
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cout << "EmbeddedModel failed to load a valid file: " << ex.what() << "\n";
+        ok = false;
+    }
+
+    // Cut anywhere, including inside the int8 padding and the last bias
+    for (size_t size : {size_t(0), size_t(3), size_t(24), bytes.size() / 2, bytes.size() - 10,
+                        bytes.size() - 1}) {
+        std::vector<unsigned char> cut(bytes.begin(), bytes.begin() + size);
+        ok = rejects(path, cut, "truncated") && ok;
+    }
+    std::vector<unsigned char> trailing = bytes;
+    trailing.insert(trailing.end(), 4, 0);
+    ok = rejects(path, trailing, "too long") && ok;
+    std::vector<unsigned char> badMagic = bytes;
+    badMagic[0] = 'X';
+    ok = rejects(path, badMagic, "bad magic") && ok;
+
+    std::remove(path.c_str());
+    if (ok) std::cout << "EmbeddedModel test passed\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#include "HttpServer.hpp"
+#include "httplib.h"
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Runs the real server in-process. With no room in the job queue the
+// server is saturated: /generate/batch must be refused with 429 rather
+// than started outside the queue.
+static const int kPort = 18461;
+
+static bool check(bool condition, const std::string& what) {
+    if (!condition) std::cout << "HttpServer: " << what << "\n";
+    return condition;
+}
+
+int main() {
+    std::filesystem::path outputDir = std::filesystem::temp_directory_path() / "sc_test_http_server";
+    setenv("SC_JOB_QUEUE_DEPTH", "0", 1);
+    setenv("SC_WARMUP", "0", 1);
+    setenv("SC_DEFAULT_MODE", "heuristic", 1);
+
+    std::thread server([&] {
+        try {
+            runHttpServer(kPort, "heuristic", outputDir.string());
+        } catch (const std::exception& ex) {
+            std::cout << "HttpServer: " << ex.what() << "\n";
+        }
+    });
+
+    httplib::Client client("127.0.0.1", kPort);
+    client.set_connection_timeout(std::chrono::seconds(1));
+    bool up = false;
+    for (int i = 0; i < 100 && !up; ++i) {
+        up = static_cast<bool>(client.Get("/metrics"));
+        if (!up) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    bool ok = check(up, "server did not start");
+    if (up) {
+        const std::string batch = R"({"items": ["a.png", "b.png", "c.png"]})";
+        auto res = client.Post("/generate/batch", batch, "application/json");
+        ok = check(res && res->status == 429, "saturated server accepted a batch (status " +
+                                                  std::to_string(res ? res->status : -1) + ")") && ok;
+        ok = check(res && res->get_header_value("Retry-After") == "1", "429 without Retry-After") && ok;
+
+        // Validation still comes first
+        auto bad = client.Post("/generate/batch", "{}", "application/json");
+        ok = check(bad && bad->status == 400, "invalid batch not a 400") && ok;
+
+        auto metrics = client.Get("/metrics");
+        ok = check(metrics && metrics->body.find("soundcanvas_batches_running 0") != std::string::npos,
+                   "a refused batch holds a slot") && ok;
+    }
+
+    // runHttpServer stops on SIGTERM
+    std::raise(SIGTERM);
+    server.join();
+    std::filesystem::remove_all(outputDir);
+    std::cout << (ok ? "HttpServer test passed\n" : "HttpServer test failed\n");
+    return ok ? 0 : 1;
+}
@@ -1,8 +1,72 @@
 #include "ImageFeatures.hpp"
+#include "ImageKernels.hpp"
+#include "SimdDispatch.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <vector>
+
+// Relative comparison of accumulated sums (normalized by pixel count)
+static bool closeEnough(double simd, double scalar, double n) {
+    return std::fabs(simd - scalar) / n <= 1e-5 * std::max(1.0, std::fabs(scalar) / n);
+}
+
+// The vectorized kernel must agree with the scalar loop on every moment
+static bool testSimdMatchesScalar() {
+    SimdLevel best = detectSimdLevel();
+    if (best == SimdLevel::SCALAR || best == SimdLevel::SSE2) {
+        std::cout << "No vector image kernel on this CPU, skipping SIMD check\n";
+        return true;
+    }
+
+    // Odd pixel count exercises the scalar tail; include greys, primaries
+    // and channel ties so every hue sector and the delta == 0 case are hit
+    const size_t numPixels = 4099;
+    std::vector<unsigned char> rgb(numPixels * 3);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < rgb.size(); ++i) {
+        state = state * 1664525u + 1013904223u;
+        rgb[i] = static_cast<unsigned char>(state >> 24);
+    }
+    const unsigned char special[][3] = {
+        {0, 0, 0}, {255, 255, 255}, {128, 128, 128}, {255, 0, 0}, {0, 255, 0},
+        {0, 0, 255}, {200, 200, 10}, {10, 200, 200}, {200, 10, 200}, {255, 0, 1},
+    };
+    for (size_t k = 0; k < sizeof(special) / sizeof(special[0]); ++k) {
+        for (int c = 0; c < 3; ++c) rgb[3 * (k * 7) + c] = special[k][c];
+    }
+
+    PixelMoments scalar, simd;
+    setSimdLevel(SimdLevel::SCALAR);
+    accumulatePixels(rgb.data(), numPixels, scalar);
+    setSimdLevel(best);
+    accumulatePixels(rgb.data(), numPixels, simd);
+
+    const double n = static_cast<double>(numPixels);
+    bool ok = simd.sumR == scalar.sumR && simd.sumG == scalar.sumG && simd.sumB == scalar.sumB &&
+              closeEnough(simd.sumHue, scalar.sumHue, n) &&
+              closeEnough(simd.sumSat, scalar.sumSat, n) &&
+              closeEnough(simd.sumRG, scalar.sumRG, n) &&
+              closeEnough(simd.sumYB, scalar.sumYB, n) &&
+              closeEnough(simd.sumRG_sq, scalar.sumRG_sq, n) &&
+              closeEnough(simd.sumYB_sq, scalar.sumYB_sq, n) &&
+              closeEnough(simd.sumGray, scalar.sumGray, n) &&
+              closeEnough(simd.sumGray_sq, scalar.sumGray_sq, n);
+    if (!ok) {
+        std::cout << "SIMD (" << simdLevelName(best) << ") moments differ from scalar\n";
+        return false;
+    }
+    std::cout << "SIMD (" << simdLevelName(best) << ") image kernel matches scalar\n";
+    return true;
+}
 
 int main() {
+    if (!testSimdMatchesScalar()) {
+        return 1;
+    }
+
     // Use a tiny test image you create manually later
     try {
         ImageFeatures f = extractImageFeatures("test_data/solid_red.png");
@@ -0,0 +1,153 @@
+#include "JobQueue.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static bool check(bool condition, const char* what) {
+    if (!condition) std::cout << "JobQueue: " << what << "\n";
+    return condition;
+}
+
+// Waits until the job is DONE or FAILED
+static JobQueue::Snapshot finish(JobQueue& jobs, const std::string& id) {
+    JobQueue::Snapshot job;
+    while (jobs.waitFor(id, std::chrono::seconds(5), job) &&
+           (job.state == JobQueue::State::QUEUED || job.state == JobQueue::State::RUNNING)) {
+    }
+    return job;
+}
+
+static bool testResultsAndErrors() {
+    JobQueue::Options options;
+    options.workers = 2;
+    JobQueue jobs(options);
+
+    std::string done = jobs.submit([] { return nlohmann::json{{"answer", 42}}; });
+    std::string rejected = jobs.submit([]() -> nlohmann::json { throw RequestError(400, "bad body"); });
+    std::string crashed = jobs.submit([]() -> nlohmann::json { throw std::runtime_error("boom"); });
+
+    JobQueue::Snapshot a = finish(jobs, done);
+    JobQueue::Snapshot b = finish(jobs, rejected);
+    JobQueue::Snapshot c = finish(jobs, crashed);
+    JobQueue::Snapshot unknown;
+    return check(a.state == JobQueue::State::DONE && a.result["answer"] == 42, "result not returned") &&
+           check(b.state == JobQueue::State::FAILED && b.errorStatus == 400 && b.error == "bad body",
+                 "RequestError status not kept") &&
+           check(c.state == JobQueue::State::FAILED && c.errorStatus == 500, "exception not a 500") &&
+           check(!jobs.get("nope", unknown), "unknown id resolved");
+}
+
+// With the only worker busy, maxQueued jobs wait and the next is refused
+static bool testQueueFull() {
+    JobQueue::Options options;
+    options.workers = 1;
+    options.maxQueued = 2;
+    JobQueue jobs(options);
+
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    auto blocked = [gate] {
+        gate.wait();
+        return nlohmann::json();
+    };
+
+    std::string first = jobs.submit(blocked);
+    while (jobs.running() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::string second = jobs.submit(blocked);
+    std::string third = jobs.submit(blocked);
+    std::string refused = jobs.submit(blocked);
+
+    JobQueue::Snapshot running;
+    bool ok = check(!first.empty() && !second.empty() && !third.empty(), "job refused below the limit") &&
+              check(refused.empty(), "full queue accepted a job") &&
+              check(jobs.queued() == 2, "queued() wrong") &&
+              check(jobs.get(first, running) && running.state == JobQueue::State::RUNNING,
+                    "first job not running") &&
+              check(!jobs.erase(first), "erase() dropped a running job");
+
+    release.set_value();
+    finish(jobs, third);
+    ok = check(!jobs.submit(blocked).empty(), "queue still full after draining") && ok;
+    return ok;
+}
+
+// Finished jobs are dropped once retention expires, beyond maxRetained
+// (oldest first), or by erase()
+static bool testRetention() {
+    JobQueue::Options options;
+    options.workers = 1;
+    options.maxRetained = 2;
+    JobQueue jobs(options);
+
+    std::vector<std::string> ids;
+    for (int i = 0; i < 4; ++i) {
+        ids.push_back(jobs.submit([i] { return nlohmann::json(i); }));
+        finish(jobs, ids.back());
+    }
+    JobQueue::Snapshot job;
+    bool ok = check(jobs.retained() == 2, "more than maxRetained jobs kept") &&
+              check(!jobs.get(ids[0], job) && !jobs.get(ids[1], job), "oldest jobs not evicted") &&
+              check(jobs.get(ids[2], job) && jobs.get(ids[3], job), "newest jobs evicted");
+
+    ok = check(jobs.erase(ids[3]), "erase() refused a finished job") &&
+         check(!jobs.get(ids[3], job) && jobs.retained() == 1, "erased job still retained") &&
+         check(!jobs.erase(ids[3]), "erase() of a gone job succeeded") && ok;
+
+    JobQueue::Options expiring;
+    expiring.workers = 1;
+    expiring.retention = std::chrono::seconds(0);
+    JobQueue shortLived(expiring);
+    std::string id = shortLived.submit([] { return nlohmann::json(1); });
+    finish(shortLived, id);
+    ok = check(!shortLived.get(id, job) && shortLived.retained() == 0, "expired job still queryable") && ok;
+    return ok;
+}
+
+// A pinned job outlives zero retention and a zero cap until its waiter
+// erases it, so the waiter always sees the final state
+static bool testPinnedSurvivesPruning() {
+    JobQueue::Options options;
+    options.workers = 2;
+    options.retention = std::chrono::seconds(0);
+    options.maxRetained = 0;
+    JobQueue jobs(options);
+
+    bool ok = true;
+    for (int i = 0; i < 20; ++i) {
+        std::string id = jobs.submit([i] { return nlohmann::json(i); }, true);
+        // Unpinned churn finishing alongside, which prunes on every finish
+        jobs.submit([] { return nlohmann::json(0); });
+        JobQueue::Snapshot job;
+        bool found = jobs.waitFor(id, std::chrono::seconds(5), job);
+        ok = check(found && job.state == JobQueue::State::DONE && job.result == i,
+                   "waiting caller lost its pinned job") && ok;
+        ok = check(jobs.erase(id) && !jobs.get(id, job), "pinned job not erased") && ok;
+    }
+    return check(jobs.retained() == 0, "pinned or expired jobs retained") && ok;
+}
+
+// Zero retention or cap from the environment would drop jobs before any
+// poller could read them; both are raised to 1
+static bool testEnvironmentFloor() {
+    setenv("SC_JOB_RETENTION_SECONDS", "0", 1);
+    setenv("SC_JOB_MAX_RETAINED", "0", 1);
+    JobQueue::Options options = JobQueue::optionsFromEnv();
+    unsetenv("SC_JOB_RETENTION_SECONDS");
+    unsetenv("SC_JOB_MAX_RETAINED");
+    return check(options.retention.count() == 1 && options.maxRetained == 1,
+                 "zero retention accepted from the environment");
+}
+
+int main() {
+    bool ok = testResultsAndErrors();
+    ok = testQueueFull() && ok;
+    ok = testRetention() && ok;
+    ok = testPinnedSurvivesPruning() && ok;
+    ok = testEnvironmentFloor() && ok;
+    std::cout << (ok ? "JobQueue test passed\n" : "JobQueue test failed\n");
+    return ok ? 0 : 1;
+}
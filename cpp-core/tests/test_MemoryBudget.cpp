@@ -0,0 +1,123 @@
+#include "MemoryBudget.hpp"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+static bool check(bool condition, const char* what) {
+    if (!condition) std::cout << "MemoryBudget: " << what << "\n";
+    return condition;
+}
+
+static MemoryBudget::Options budgetOf(size_t bytes, long waitMs) {
+    MemoryBudget::Options options;
+    options.budgetBytes = bytes;
+    options.maxWait = std::chrono::milliseconds(waitMs);
+    return options;
+}
+
+static void waitForQueue(const MemoryBudget& budget, size_t waiting) {
+    while (budget.stats().waiting != waiting) std::this_thread::yield();
+}
+
+static bool testUnlimited() {
+    MemoryBudget budget(budgetOf(0, 0));
+    MemoryBudget::Reservation r = budget.acquire(size_t(1) << 40, "huge");
+    return check(!budget.enabled() && r.bytes() == 0 && budget.stats().reservedBytes == 0,
+                 "a zero budget reserved something");
+}
+
+// More than the whole budget can never fit: fits() is false, at once
+static bool testLargerThanBudget() {
+    MemoryBudget budget(budgetOf(100, 10000));
+    auto start = std::chrono::steady_clock::now();
+    try {
+        budget.acquire(101, "image");
+    } catch (const MemoryBudgetExceeded& ex) {
+        bool immediate = std::chrono::steady_clock::now() - start < std::chrono::seconds(1);
+        return check(!ex.fits(), "oversized request reported as fitting") &&
+               check(immediate, "oversized request waited") &&
+               check(budget.stats().rejected == 1, "rejection not counted");
+    }
+    return check(false, "oversized request admitted");
+}
+
+// A request that fits the budget but not the room left times out, fits() true
+static bool testTimeout() {
+    MemoryBudget budget(budgetOf(100, 50));
+    MemoryBudget::Reservation held = budget.acquire(80, "first");
+    try {
+        budget.acquire(50, "second");
+    } catch (const MemoryBudgetExceeded& ex) {
+        MemoryBudget::Stats s = budget.stats();
+        return check(ex.fits(), "timed-out request reported as never fitting") &&
+               check(s.timedOut == 1 && s.waited == 1 && s.waiting == 0, "timeout stats wrong") &&
+               check(s.reservedBytes == 80, "timed-out request kept bytes");
+    }
+    return check(false, "request admitted over the budget");
+}
+
+// Waiters are admitted oldest first: a small request that would fit
+// still queues behind a larger one that came earlier
+static bool testFifo() {
+    MemoryBudget budget(budgetOf(100, 10000));
+    MemoryBudget::Reservation held = budget.acquire(50, "held");
+
+    std::mutex admittedMutex;
+    std::vector<MemoryBudget::Reservation> admitted(2);
+    auto request = [&](size_t index, size_t bytes) {
+        return std::thread([&, index, bytes] {
+            MemoryBudget::Reservation r = budget.acquire(bytes, "request");
+            std::lock_guard<std::mutex> lock(admittedMutex);
+            admitted[index] = std::move(r);
+        });
+    };
+
+    std::thread large = request(0, 60);
+    waitForQueue(budget, 1);
+    std::thread small = request(1, 45);  // 50 + 45 fits, but large is first
+    waitForQueue(budget, 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    bool ok = check(budget.stats().waiting == 2, "small request jumped the queue");
+
+    // Room for large only: 60 + 45 > 100, so small keeps waiting
+    held = MemoryBudget::Reservation();
+    large.join();
+    waitForQueue(budget, 1);
+    ok = check(budget.stats().reservedBytes == 60, "large request not admitted first") && ok;
+
+    {
+        std::lock_guard<std::mutex> lock(admittedMutex);
+        admitted[0] = MemoryBudget::Reservation();
+    }
+    small.join();
+    ok = check(budget.stats().reservedBytes == 45, "small request not admitted after large") && ok;
+
+    admitted.clear();
+    return check(budget.stats().reservedBytes == 0, "reservations not released") && ok;
+}
+
+// A moved-from reservation releases nothing
+static bool testMove() {
+    MemoryBudget budget(budgetOf(100, 0));
+    MemoryBudget::Reservation a = budget.acquire(40, "a");
+    MemoryBudget::Reservation b = std::move(a);
+    bool ok = check(a.bytes() == 0 && b.bytes() == 40 && budget.stats().reservedBytes == 40,
+                    "move didn't transfer the reservation");
+    { MemoryBudget::Reservation gone = std::move(a); }
+    ok = check(budget.stats().reservedBytes == 40, "moved-from reservation released bytes") && ok;
+    b = budget.acquire(30, "replacement");
+    return check(budget.stats().reservedBytes == 30, "assignment didn't release the old bytes") && ok;
+}
+
+int main() {
+    bool ok = testUnlimited();
+    ok = testLargerThanBudget() && ok;
+    ok = testTimeout() && ok;
+    ok = testFifo() && ok;
+    ok = testMove() && ok;
+    std::cout << (ok ? "MemoryBudget test passed\n" : "MemoryBudget test failed\n");
+    return ok ? 0 : 1;
+}
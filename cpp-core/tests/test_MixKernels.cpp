@@ -0,0 +1,111 @@
+#include "MixKernels.hpp"
+#include "SimdDispatch.hpp"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Vector levels this CPU can run, besides SCALAR
+static std::vector<SimdLevel> vectorLevels() {
+    SimdLevel best = detectSimdLevel();
+    if (best == SimdLevel::NEON) return {SimdLevel::NEON};
+    std::vector<SimdLevel> levels;
+    if (best >= SimdLevel::SSE2) levels.push_back(SimdLevel::SSE2);
+    if (best >= SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+    return levels;
+}
+
+// Samples in [-1.5, 1.5), both signs, so framePeaks sees |left| < |right| and the reverse
+static std::vector<float> randomSamples(size_t n, uint32_t& state) {
+    std::vector<float> v(n);
+    for (float& x : v) {
+        state = state * 1664525u + 1013904223u;
+        x = static_cast<float>(static_cast<int32_t>(state >> 8) - (1 << 23)) / (1 << 23) * 1.5f;
+    }
+    return v;
+}
+
+// Runs kernel on a copy of out at SCALAR and at each vector level; the
+// results must be identical bit for bit
+static bool sameOnEveryLevel(const std::string& name, size_t frames, const std::vector<float>& out,
+                             const std::function<void(std::vector<float>&)>& kernel) {
+    std::vector<float> scalar = out;
+    setSimdLevel(SimdLevel::SCALAR);
+    kernel(scalar);
+    bool ok = true;
+    for (SimdLevel level : vectorLevels()) {
+        std::vector<float> simd = out;
+        setSimdLevel(level);
+        kernel(simd);
+        if (std::memcmp(simd.data(), scalar.data(), simd.size() * sizeof(float)) != 0) {
+            std::cout << "SIMD (" << simdLevelName(level) << ") " << name << " differs from scalar ("
+                      << frames << " frames)\n";
+            ok = false;
+        }
+    }
+    setSimdLevel(detectSimdLevel());
+    return ok;
+}
+
+static bool testVectorMatchesScalar() {
+    if (vectorLevels().empty()) {
+        std::cout << "No vector mix kernel on this CPU, skipping SIMD check\n";
+        return true;
+    }
+
+    // Frame counts that leave every possible tail after 2, 4 and 8 lanes
+    const size_t frameCounts[] = {1, 2, 3, 5, 7, 9, 15, 17, 1023};
+    uint32_t state = 777;
+    bool ok = true;
+    for (size_t frames : frameCounts) {
+        std::vector<float> in = randomSamples(frames * 2, state);
+        std::vector<float> out = randomSamples(frames * 2, state);
+        std::vector<float> gains = randomSamples(frames, state);
+
+        ok = sameOnEveryLevel("mixAccumulate", frames, out, [&](std::vector<float>& o) {
+            mixAccumulate(in.data(), 0.7f, o.data(), o.size());
+        }) && ok;
+        ok = sameOnEveryLevel("mixAccumulateFrameGain", frames, out, [&](std::vector<float>& o) {
+            mixAccumulateFrameGain(in.data(), gains.data(), o.data(), frames);
+        }) && ok;
+        ok = sameOnEveryLevel("applyFrameGain", frames, out, [&](std::vector<float>& o) {
+            applyFrameGain(o.data(), gains.data(), frames);
+        }) && ok;
+        ok = sameOnEveryLevel("framePeaks", frames, std::vector<float>(frames),
+                              [&](std::vector<float>& peaks) {
+            framePeaks(in.data(), peaks.data(), frames);
+        }) && ok;
+    }
+    if (ok) std::cout << "Vector mix kernels match scalar bit for bit\n";
+    return ok;
+}
+
+static bool testScalarResults() {
+    const float in[] = {0.5f, -1.0f, -0.25f, 0.125f, 2.0f, -2.0f};
+    const float gains[] = {2.0f, 0.5f, -1.0f};
+    float out[6] = {1, 1, 1, 1, 1, 1};
+    float peaks[3];
+
+    setSimdLevel(SimdLevel::SCALAR);
+    mixAccumulateFrameGain(in, gains, out, 3);
+    framePeaks(in, peaks, 3);
+    setSimdLevel(detectSimdLevel());
+
+    const float expectedOut[] = {2.0f, -1.0f, 0.875f, 1.0625f, -1.0f, 3.0f};
+    const float expectedPeaks[] = {1.0f, 0.25f, 2.0f};
+    if (std::memcmp(out, expectedOut, sizeof(out)) != 0 ||
+        std::memcmp(peaks, expectedPeaks, sizeof(peaks)) != 0) {
+        std::cout << "Scalar mix kernels give wrong results\n";
+        return false;
+    }
+    std::cout << "Scalar mix kernels match the reference\n";
+    return true;
+}
+
+int main() {
+    bool ok = testScalarResults();
+    ok = testVectorMatchesScalar() && ok;
+    return ok ? 0 : 1;
+}
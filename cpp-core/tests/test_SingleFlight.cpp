@@ -0,0 +1,114 @@
+#include "SingleFlight.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static bool check(bool condition, const char* what) {
+    if (!condition) std::cout << "SingleFlight: " << what << "\n";
+    return condition;
+}
+
+// Followers arriving while the leader runs get its result (or its
+// exception); the work runs once
+template <typename Work>
+static void runConcurrently(SingleFlight<int>& flight, const std::string& key, Work work,
+                            std::vector<int>& results, std::vector<std::string>& errors,
+                            int& joinedCount) {
+    const int callers = 6;
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    std::atomic<int> started{0};
+
+    results.assign(callers, -1);
+    errors.assign(callers, "");
+    std::vector<char> joined(callers, 0);  // not vector<bool>: one byte per thread
+    std::vector<std::thread> threads;
+    for (int i = 0; i < callers; ++i) {
+        threads.emplace_back([&, i] {
+            ++started;
+            try {
+                bool j = false;
+                results[i] = flight.run(key, [&] {
+                    gate.wait();
+                    return work();
+                }, &j);
+                joined[i] = j;
+            } catch (const std::exception& ex) {
+                errors[i] = ex.what();
+            }
+        });
+    }
+    // Let every caller reach run() (the leader parks on the gate) before
+    // finishing the work; the followers only have the map lookup left
+    while (started < callers || flight.inFlight() == 0) std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    release.set_value();
+    for (auto& t : threads) t.join();
+
+    joinedCount = 0;
+    for (int i = 0; i < callers; ++i) joinedCount += joined[i] ? 1 : 0;
+}
+
+static bool testSharedValue() {
+    SingleFlight<int> flight;
+    std::atomic<int> calls{0};
+    std::vector<int> results;
+    std::vector<std::string> errors;
+    int joined = 0;
+    runConcurrently(flight, "k", [&] { return 40 + ++calls; }, results, errors, joined);
+
+    bool same = true;
+    for (int r : results) same = same && r == 41;
+    for (const std::string& e : errors) same = same && e.empty();
+    return check(calls == 1, "work ran more than once") &&
+           check(same, "followers got a different value") &&
+           check(joined == static_cast<int>(results.size()) - 1, "joined flags wrong") &&
+           check(flight.inFlight() == 0, "key not retired after the call");
+}
+
+static bool testSharedException() {
+    SingleFlight<int> flight;
+    std::atomic<int> calls{0};
+    std::vector<int> results;
+    std::vector<std::string> errors;
+    int joined = 0;
+    runConcurrently(flight, "k", [&]() -> int {
+        ++calls;
+        throw std::runtime_error("leader failed");
+    }, results, errors, joined);
+
+    bool same = true;
+    for (const std::string& e : errors) same = same && e == "leader failed";
+    bool ok = check(calls == 1, "failing work ran more than once") &&
+              check(same, "followers didn't get the leader's exception") &&
+              check(flight.inFlight() == 0, "key not retired after a failure");
+
+    // A failure isn't remembered: the next call runs again
+    bool j = true;
+    int fresh = flight.run("k", [] { return 7; }, &j);
+    return check(fresh == 7 && !j, "failed key was not retired") && ok;
+}
+
+// Different keys don't coalesce; sequential calls for one key each run
+static bool testIndependentCalls() {
+    SingleFlight<int> flight;
+    int calls = 0;
+    bool j1 = true, j2 = true;
+    int a = flight.run("a", [&] { return ++calls; }, &j1);
+    int b = flight.run("a", [&] { return ++calls; }, &j2);
+    return check(a == 1 && b == 2 && !j1 && !j2, "finished call was reused") &&
+           check(flight.inFlight() == 0, "keys left in flight");
+}
+
+int main() {
+    bool ok = testSharedValue();
+    ok = testSharedException() && ok;
+    ok = testIndependentCalls() && ok;
+    std::cout << (ok ? "SingleFlight test passed\n" : "SingleFlight test failed\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+#include "SynthKernels.hpp"
+#include "SimdDispatch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const double kTwoPi = 6.283185307179586;
+
+// Vector levels this CPU can run, besides SCALAR
+static std::vector<SimdLevel> vectorLevels() {
+    SimdLevel best = detectSimdLevel();
+    if (best == SimdLevel::NEON) return {SimdLevel::NEON};
+    std::vector<SimdLevel> levels;
+    if (best >= SimdLevel::SSE2) levels.push_back(SimdLevel::SSE2);
+    if (best >= SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+    return levels;
+}
+
+static std::vector<double> randomDoubles(size_t n, double lo, double hi, uint32_t& state) {
+    std::vector<double> v(n);
+    for (double& x : v) {
+        state = state * 1664525u + 1013904223u;
+        x = lo + (hi - lo) * (state >> 8) / double(1 << 24);
+    }
+    return v;
+}
+
+// The oscillator approximations against the functions they stand in for
+static bool testOscillatorShapes() {
+    double worstSine = 0.0, worstTriangle = 0.0;
+    for (int i = 0; i <= 4096; ++i) {
+        double phase = kTwoPi * i / 4096;
+        worstSine = std::max(worstSine, std::fabs(synthSine(phase) - std::sin(phase)));
+        double triangle = std::asin(std::sin(phase)) * 2.0 / M_PI;
+        worstTriangle = std::max(worstTriangle, std::fabs(synthTriangle(phase) - triangle));
+    }
+    if (worstSine > 1e-3 || worstTriangle > 1e-9) {
+        std::cout << "Synth oscillator error too large: sine " << worstSine << ", triangle "
+                  << worstTriangle << "\n";
+        return false;
+    }
+    std::cout << "Synth oscillator shapes within tolerance\n";
+    return true;
+}
+
+// Everything the kernels write: the block, the delay line and both states
+struct KernelState {
+    std::vector<double> samples;
+    std::vector<float> delayLine;
+    int delayIndex = 0;
+    double filterState = 0.0;
+};
+
+// Runs kernel at SCALAR and at each vector level from the same starting
+// state; every output word must be identical
+static bool sameOnEveryLevel(const std::string& name, int frames, const KernelState& start,
+                             const std::function<void(KernelState&)>& kernel) {
+    KernelState scalar = start;
+    setSimdLevel(SimdLevel::SCALAR);
+    kernel(scalar);
+    bool ok = true;
+    for (SimdLevel level : vectorLevels()) {
+        KernelState simd = start;
+        setSimdLevel(level);
+        kernel(simd);
+        bool same =
+            std::memcmp(simd.samples.data(), scalar.samples.data(), simd.samples.size() * sizeof(double)) == 0 &&
+            std::memcmp(simd.delayLine.data(), scalar.delayLine.data(), simd.delayLine.size() * sizeof(float)) == 0 &&
+            simd.delayIndex == scalar.delayIndex &&
+            std::memcmp(&simd.filterState, &scalar.filterState, sizeof(double)) == 0;
+        if (!same) {
+            std::cout << "SIMD (" << simdLevelName(level) << ") " << name << " differs from scalar ("
+                      << frames << " frames)\n";
+            ok = false;
+        }
+    }
+    setSimdLevel(detectSimdLevel());
+    return ok;
+}
+
+static bool testVectorMatchesScalar() {
+    if (vectorLevels().empty()) {
+        std::cout << "No vector synth kernel on this CPU, skipping SIMD check\n";
+        return true;
+    }
+
+    const int frameCounts[] = {1, 2, 3, 5, 7, 9, 17, 255, 256};
+    const int delayLength = 300;
+    uint32_t state = 99;
+    bool ok = true;
+    for (int frames : frameCounts) {
+        std::vector<double> phase = randomDoubles(frames, 0.0, kTwoPi, state);
+        std::vector<double> gain = randomDoubles(frames, 0.0, 1.0, state);
+        // Exact quadrant edges, where the phase folding branches
+        const double edges[] = {0.0, kTwoPi / 4, kTwoPi / 2, 3 * kTwoPi / 4, kTwoPi};
+        for (int k = 0; k < frames && k < 5; ++k) phase[k] = edges[k];
+
+        KernelState start;
+        start.samples = randomDoubles(frames, -1.0, 1.0, state);
+        for (double d : randomDoubles(delayLength, -0.5, 0.5, state)) {
+            start.delayLine.push_back(static_cast<float>(d));
+        }
+        // Start near the end so the write position wraps inside the block
+        start.delayIndex = delayLength - frames / 2 - 1;
+        start.filterState = 0.3;
+
+        for (double brightness : {0.0, 0.35, 1.0}) {
+            ok = sameOnEveryLevel("accumulateOscillator", frames, start, [&](KernelState& s) {
+                accumulateOscillator(phase.data(), gain.data(), 0.8, brightness, s.samples.data(), frames);
+            }) && ok;
+        }
+        ok = sameOnEveryLevel("onePoleLowpass", frames, start, [&](KernelState& s) {
+            onePoleLowpass(s.samples.data(), frames, 0.85, s.filterState);
+        }) && ok;
+        ok = sameOnEveryLevel("feedbackDelayMix", frames, start, [&](KernelState& s) {
+            feedbackDelayMix(s.samples.data(), frames, s.delayLine.data(), delayLength, s.delayIndex,
+                             0.4, 0.7, 0.3);
+        }) && ok;
+    }
+    if (ok) std::cout << "Vector synth kernels match scalar bit for bit\n";
+    return ok;
+}
+
+int main() {
+    bool ok = testOscillatorShapes();
+    ok = testVectorMatchesScalar() && ok;
+    return ok ? 0 : 1;
+}
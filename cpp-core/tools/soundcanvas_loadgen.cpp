@@ -0,0 +1,492 @@
+// Load generator and request replay for `soundcanvas_core --serve`.
+//
+//   ./soundcanvas_loadgen --corpus bodies.ndjson --rps 50 --duration 60 --metrics
+//       --out run.json --baseline release.json
+//
+// Replays /generate bodies from an NDJSON corpus (one JSON object per line,
+// either the body itself or {"body": {...}}), cycling through it.
+//
+// --rps is open-loop: request k is due at start + k / rps whether or not
+// earlier ones have finished, and its latency is measured from when it was
+// due, so a stalled server shows up in the percentiles instead of silently
+// slowing the load (coordinated omission). --concurrency is closed-loop: N
+// clients back to back, latency from the actual send.
+//
+// Reports p50/p95/p99/max latency, throughput and error rates per mode
+// ("heuristic", "model", or "default" for bodies without one). --metrics
+// scrapes GET /metrics before and after and reports the per-stage means of
+// the run. --out writes the report as JSON; --baseline compares against a
+// stored report and exits 2 on a regression beyond --tolerance.
+
+#include "httplib.h"
+#include "json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Config {
+    std::string url = "http://localhost:8080";
+    std::string corpus;
+    double rps = 0.0;          // > 0: open loop
+    size_t concurrency = 0;    // closed loop (default 8 without --rps)
+    double duration = 30.0;    // seconds, unless --requests
+    size_t requests = 0;
+    size_t connections = 16;   // open-loop sender threads, one keep-alive connection each
+    std::string mode;          // overrides every body's "mode"
+    double timeout = 60.0;
+    bool metrics = false;
+    std::string out;
+    std::string baseline;
+    double tolerance = 0.10;
+};
+
+struct CorpusEntry {
+    std::string body;
+    std::string mode;
+};
+
+struct Sample {
+    size_t entry;
+    int status;            // 0: transport error
+    double latencyMs;
+};
+
+[[noreturn]] void usage(const std::string& error = "") {
+    if (!error.empty()) std::cerr << "soundcanvas_loadgen: " << error << "\n\n";
+    std::cerr <<
+        "usage: soundcanvas_loadgen --corpus FILE [options]\n"
+        "  --url URL            server (default http://localhost:8080)\n"
+        "  --rps N              open-loop arrival rate\n"
+        "  --concurrency N      closed-loop clients (default 8 without --rps)\n"
+        "  --duration SECONDS   run length (default 30)\n"
+        "  --requests N         send N requests instead of a duration\n"
+        "  --connections N      open-loop senders, one keep-alive connection each\n"
+        "                       (default 16; keep it under the server's HTTP threads)\n"
+        "  --mode MODE          set \"mode\" on every body (heuristic or model)\n"
+        "  --timeout SECONDS    per-request timeout (default 60)\n"
+        "  --metrics            scrape per-stage latency from GET /metrics\n"
+        "  --out FILE           write the report as JSON\n"
+        "  --baseline FILE      compare with a stored report, exit 2 on regression\n"
+        "  --tolerance F        allowed relative regression (default 0.10)\n";
+    std::exit(1);
+}
+
+Config parseArgs(int argc, char** argv) {
+    Config c;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) usage("missing value for " + arg);
+            return argv[++i];
+        };
+        try {
+            if (arg == "--url") c.url = value();
+            else if (arg == "--corpus") c.corpus = value();
+            else if (arg == "--rps") c.rps = std::stod(value());
+            else if (arg == "--concurrency") c.concurrency = std::stoul(value());
+            else if (arg == "--duration") c.duration = std::stod(value());
+            else if (arg == "--requests") c.requests = std::stoul(value());
+            else if (arg == "--connections") c.connections = std::stoul(value());
+            else if (arg == "--mode") c.mode = value();
+            else if (arg == "--timeout") c.timeout = std::stod(value());
+            else if (arg == "--metrics") c.metrics = true;
+            else if (arg == "--out") c.out = value();
+            else if (arg == "--baseline") c.baseline = value();
+            else if (arg == "--tolerance") c.tolerance = std::stod(value());
+            else if (arg == "--help" || arg == "-h") usage();
+            else usage("unknown option " + arg);
+        } catch (const std::exception&) {  // invalid_argument, out_of_range
+            usage("invalid value for " + arg);
+        }
+    }
+    if (c.corpus.empty()) usage("--corpus is required");
+    if (c.rps > 0.0 && c.concurrency > 0) usage("--rps and --concurrency are exclusive");
+    if (c.rps <= 0.0 && c.concurrency == 0) c.concurrency = 8;
+    if (c.connections == 0) c.connections = 1;
+    return c;
+}
+
+std::vector<CorpusEntry> loadCorpus(const Config& config) {
+    std::ifstream in(config.corpus);
+    if (!in) throw std::runtime_error("Cannot read corpus: " + config.corpus);
+
+    std::vector<CorpusEntry> corpus;
+    std::string line;
+    size_t lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        json body;
+        try {
+            body = json::parse(line);
+        } catch (const std::exception& ex) {
+            throw std::runtime_error(config.corpus + ":" + std::to_string(lineNo) + ": " + ex.what());
+        }
+        if (body.contains("body") && body["body"].is_object()) body = body["body"];
+        if (!body.is_object()) {
+            throw std::runtime_error(config.corpus + ":" + std::to_string(lineNo) + ": not an object");
+        }
+        if (!config.mode.empty()) body["mode"] = config.mode;
+
+        CorpusEntry entry;
+        entry.mode = body.contains("mode") && body["mode"].is_string()
+                         ? body["mode"].get<std::string>() : "default";
+        entry.body = body.dump();
+        corpus.push_back(std::move(entry));
+    }
+    if (corpus.empty()) throw std::runtime_error("Corpus is empty: " + config.corpus);
+    return corpus;
+}
+
+std::unique_ptr<httplib::Client> makeClient(const Config& config) {
+    auto cli = std::make_unique<httplib::Client>(config.url);
+    cli->set_keep_alive(true);
+    // Headers and body go out as separate writes; without this, Nagle and
+    // delayed ACKs add tens of milliseconds that aren't the server's
+    cli->set_tcp_nodelay(true);
+    auto timeout = std::chrono::milliseconds(static_cast<int64_t>(config.timeout * 1000));
+    cli->set_connection_timeout(timeout);
+    cli->set_read_timeout(timeout);
+    cli->set_write_timeout(timeout);
+    return cli;
+}
+
+int send(httplib::Client& cli, const CorpusEntry& entry) {
+    auto res = cli.Post("/generate", entry.body, "application/json");
+    return res ? res->status : 0;
+}
+
+double msSince(Clock::time_point t) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+}
+
+// ---------------------------------------------------------------------------
+// Load
+// ---------------------------------------------------------------------------
+
+struct Run {
+    std::vector<Sample> samples;
+    double elapsedSeconds = 0.0;
+    double maxSendLagMs = 0.0;  // open loop: how late the generator itself sent
+};
+
+// Open loop: a fixed schedule, senders pick up requests as they come due
+Run runOpenLoop(const Config& config, const std::vector<CorpusEntry>& corpus) {
+    size_t total = config.requests ? config.requests
+                                   : static_cast<size_t>(config.rps * config.duration);
+    std::vector<Sample> samples(total);
+    std::atomic<size_t> next{0};
+    std::mutex lagMutex;
+    double maxLag = 0.0;
+
+    Clock::time_point start = Clock::now();
+    auto dueAt = [&](size_t k) {
+        return start + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double>(k / config.rps));
+    };
+
+    std::vector<std::thread> senders;
+    size_t threads = std::min(config.connections, std::max<size_t>(total, 1));
+    for (size_t t = 0; t < threads; ++t) {
+        senders.emplace_back([&] {
+            auto cli = makeClient(config);
+            double localLag = 0.0;
+            for (size_t k; (k = next.fetch_add(1)) < total;) {
+                Clock::time_point due = dueAt(k);
+                std::this_thread::sleep_until(due);
+                localLag = std::max(localLag, msSince(due));
+                size_t entry = k % corpus.size();
+                int status = send(*cli, corpus[entry]);
+                samples[k] = {entry, status, msSince(due)};
+            }
+            std::lock_guard<std::mutex> lock(lagMutex);
+            maxLag = std::max(maxLag, localLag);
+        });
+    }
+    for (auto& t : senders) t.join();
+
+    Run run;
+    run.samples = std::move(samples);
+    run.elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    run.maxSendLagMs = maxLag;
+    return run;
+}
+
+// Closed loop: each client sends its next request when the last returns
+Run runClosedLoop(const Config& config, const std::vector<CorpusEntry>& corpus) {
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::vector<Sample> samples;
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double>(config.duration));
+
+    std::vector<std::thread> clients;
+    for (size_t t = 0; t < config.concurrency; ++t) {
+        clients.emplace_back([&] {
+            auto cli = makeClient(config);
+            std::vector<Sample> local;
+            for (;;) {
+                size_t k = next.fetch_add(1);
+                if (config.requests ? k >= config.requests : Clock::now() >= deadline) break;
+                size_t entry = k % corpus.size();
+                Clock::time_point sent = Clock::now();
+                int status = send(*cli, corpus[entry]);
+                local.push_back({entry, status, msSince(sent)});
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            samples.insert(samples.end(), local.begin(), local.end());
+        });
+    }
+    for (auto& t : clients) t.join();
+
+    Run run;
+    run.samples = std::move(samples);
+    run.elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return run;
+}
+
+// ---------------------------------------------------------------------------
+// Report
+// ---------------------------------------------------------------------------
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+json summarize(const std::vector<const Sample*>& samples, double elapsedSeconds) {
+    std::vector<double> latencies;
+    latencies.reserve(samples.size());
+    size_t ok = 0;
+    size_t transport = 0;
+    std::map<std::string, size_t> byStatus;
+    for (const Sample* s : samples) {
+        latencies.push_back(s->latencyMs);
+        if (s->status == 200) {
+            ++ok;
+        } else if (s->status == 0) {
+            ++transport;
+        } else {
+            ++byStatus[std::to_string(s->status)];
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    size_t errors = samples.size() - ok;
+    return {
+        {"requests", samples.size()},
+        {"ok", ok},
+        {"errors", errors},
+        {"error_rate", samples.empty() ? 0.0 : static_cast<double>(errors) / samples.size()},
+        {"transport_errors", transport},
+        {"http_errors", byStatus},
+        {"throughput_rps", elapsedSeconds > 0 ? ok / elapsedSeconds : 0.0},
+        {"latency_ms", {
+            {"p50", percentile(latencies, 0.50)},
+            {"p95", percentile(latencies, 0.95)},
+            {"p99", percentile(latencies, 0.99)},
+            {"max", latencies.empty() ? 0.0 : latencies.back()}
+        }}
+    };
+}
+
+// name{labels} value -> value, for the lines of a Prometheus scrape
+std::map<std::string, double> scrapeMetrics(const Config& config) {
+    std::map<std::string, double> values;
+    auto cli = makeClient(config);
+    auto res = cli->Get("/metrics");
+    if (!res || res->status != 200) {
+        std::cerr << "[loadgen] GET /metrics failed" << std::endl;
+        return values;
+    }
+    std::istringstream in(res->body);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        size_t space = line.rfind(' ');
+        if (space == std::string::npos) continue;
+        try {
+            values[line.substr(0, space)] = std::stod(line.substr(space + 1));
+        } catch (...) {
+            // Not a sample line
+        }
+    }
+    return values;
+}
+
+// Per-stage count and mean over the run, plus counter deltas
+json metricsDelta(const std::map<std::string, double>& before,
+                  const std::map<std::string, double>& after) {
+    static const std::string kSum = "soundcanvas_stage_duration_seconds_sum{stage=\"";
+    static const std::string kCount = "soundcanvas_stage_duration_seconds_count{stage=\"";
+    auto delta = [&](const std::string& key) {
+        auto a = after.find(key);
+        auto b = before.find(key);
+        return (a == after.end() ? 0.0 : a->second) - (b == before.end() ? 0.0 : b->second);
+    };
+
+    json stages = json::object();
+    json counters = json::object();
+    for (const auto& [key, value] : after) {
+        if (key.rfind(kSum, 0) == 0) {
+            std::string stage = key.substr(kSum.size(), key.size() - kSum.size() - 2);
+            double count = delta(kCount + stage + "\"}");
+            if (count <= 0) continue;
+            stages[stage] = {{"count", count}, {"mean_ms", delta(key) / count * 1000.0}};
+        } else if (key.size() > 6 && key.compare(key.size() - 6, 6, "_total") == 0) {
+            counters[key] = delta(key);
+        }
+    }
+    return {{"stages", stages}, {"counters", counters}};
+}
+
+void printSummary(const std::string& name, const json& s) {
+    const json& l = s["latency_ms"];
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+              << std::setprecision(1)
+              << std::setw(8) << s["requests"].get<size_t>()
+              << std::setw(8) << s["errors"].get<size_t>()
+              << std::setw(10) << s["throughput_rps"].get<double>()
+              << std::setw(10) << l["p50"].get<double>()
+              << std::setw(10) << l["p95"].get<double>()
+              << std::setw(10) << l["p99"].get<double>()
+              << std::setw(10) << l["max"].get<double>() << "\n";
+}
+
+// Regressions of report against baseline, one line each
+std::vector<std::string> compare(const json& report, const json& baseline, double tolerance) {
+    std::vector<std::string> failures;
+    for (const auto& [mode, base] : baseline["modes"].items()) {
+        if (!report["modes"].contains(mode)) continue;
+        const json& cur = report["modes"][mode];
+        for (const char* p : {"p50", "p99"}) {
+            double b = base["latency_ms"][p].get<double>();
+            double c = cur["latency_ms"][p].get<double>();
+            if (b > 0 && c > b * (1.0 + tolerance)) {
+                failures.push_back(mode + " " + p + " " + std::to_string(c) + " ms vs " +
+                                   std::to_string(b) + " ms");
+            }
+        }
+        double bt = base["throughput_rps"].get<double>();
+        double ct = cur["throughput_rps"].get<double>();
+        if (bt > 0 && ct < bt * (1.0 - tolerance)) {
+            failures.push_back(mode + " throughput " + std::to_string(ct) + " rps vs " +
+                               std::to_string(bt) + " rps");
+        }
+        double be = base["error_rate"].get<double>();
+        double ce = cur["error_rate"].get<double>();
+        if (ce > be + 0.01) {
+            failures.push_back(mode + " error rate " + std::to_string(ce) + " vs " + std::to_string(be));
+        }
+    }
+    return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Config config = parseArgs(argc, argv);
+    try {
+        std::vector<CorpusEntry> corpus = loadCorpus(config);
+        bool openLoop = config.rps > 0.0;
+        std::cout << "[loadgen] " << corpus.size() << " bodies against " << config.url << ", "
+                  << (openLoop ? "open loop at " + std::to_string(config.rps) + " rps"
+                               : "closed loop x" + std::to_string(config.concurrency))
+                  << ", " << (config.requests ? std::to_string(config.requests) + " requests"
+                                              : std::to_string(config.duration) + " s")
+                  << std::endl;
+
+        std::map<std::string, double> before;
+        if (config.metrics) before = scrapeMetrics(config);
+
+        Run run = openLoop ? runOpenLoop(config, corpus) : runClosedLoop(config, corpus);
+
+        std::map<std::string, std::vector<const Sample*>> byMode;
+        std::vector<const Sample*> all;
+        for (const Sample& s : run.samples) {
+            byMode[corpus[s.entry].mode].push_back(&s);
+            all.push_back(&s);
+        }
+
+        json report = {
+            {"url", config.url},
+            {"corpus", config.corpus},
+            {"loop", openLoop ? "open" : "closed"},
+            {"target_rps", config.rps},
+            {"concurrency", config.concurrency},
+            {"elapsed_seconds", run.elapsedSeconds},
+            {"modes", json::object()}
+        };
+        report["modes"]["all"] = summarize(all, run.elapsedSeconds);
+        for (const auto& [mode, samples] : byMode) {
+            report["modes"][mode] = summarize(samples, run.elapsedSeconds);
+        }
+        if (openLoop) report["max_send_lag_ms"] = run.maxSendLagMs;
+        if (config.metrics) report["server"] = metricsDelta(before, scrapeMetrics(config));
+
+        std::cout << "\n" << std::left << std::setw(10) << "mode" << std::right
+                  << std::setw(8) << "reqs" << std::setw(8) << "errors" << std::setw(10) << "rps"
+                  << std::setw(10) << "p50 ms" << std::setw(10) << "p95 ms"
+                  << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << "\n";
+        for (const auto& [mode, summary] : report["modes"].items()) printSummary(mode, summary);
+
+        if (openLoop && run.maxSendLagMs > 10.0) {
+            std::cout << "\n[loadgen] WARNING: sends ran up to " << run.maxSendLagMs
+                      << " ms late; raise --connections (latencies still count from the schedule)\n";
+        }
+        if (config.metrics) {
+            std::cout << "\nserver stage            count   mean ms\n";
+            for (const auto& [stage, s] : report["server"]["stages"].items()) {
+                std::cout << std::left << std::setw(20) << stage << std::right
+                          << std::setw(9) << static_cast<uint64_t>(s["count"].get<double>())
+                          << std::setw(10) << std::setprecision(2) << s["mean_ms"].get<double>() << "\n";
+            }
+        }
+        std::cout << std::flush;
+
+        if (!config.out.empty()) {
+            std::ofstream out(config.out);
+            out << report.dump(2) << "\n";
+            if (!out) throw std::runtime_error("Cannot write " + config.out);
+        }
+
+        if (!config.baseline.empty()) {
+            std::ifstream in(config.baseline);
+            if (!in) throw std::runtime_error("Cannot read baseline: " + config.baseline);
+            std::vector<std::string> failures = compare(report, json::parse(in), config.tolerance);
+            if (!failures.empty()) {
+                std::cout << "\nRegressions against " << config.baseline << ":\n";
+                for (const std::string& f : failures) std::cout << "  " << f << "\n";
+                return 2;
+            }
+            std::cout << "\nNo regressions against " << config.baseline << "\n";
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "soundcanvas_loadgen: " << ex.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,94 @@
+"""Export the trained parameter model for in-process inference.
+
+Writes the flat weight file cpp-core loads with SC_EMBEDDED_MODEL (format
+documented in cpp-core/include/EmbeddedModel.hpp). The model must be a
+stack of Dense layers with relu or linear activations, optionally preceded
+by a Normalization layer.
+
+    python export_embedded_model.py saved_model_dir soundcanvas.scnn [--int8]
+"""
+
+import argparse
+import struct
+
+import numpy as np
+import tensorflow as tf
+
+MAGIC = b"SCNN"
+VERSION = 1
+ACTIVATIONS = {"linear": 0, "relu": 1}
+
+
+def f32(values):
+    return np.asarray(values, dtype="<f4").tobytes()
+
+
+def dense_layers(model):
+    """(kernel, bias, activation) per Dense layer, and the input normalization."""
+    inputs = model.input_shape[-1]
+    mean = np.zeros(inputs, dtype=np.float32)
+    scale = np.ones(inputs, dtype=np.float32)
+    layers = []
+    for layer in model.layers:
+        if isinstance(layer, tf.keras.layers.InputLayer):
+            continue
+        if isinstance(layer, tf.keras.layers.Normalization):
+            mean = np.reshape(layer.mean, -1)
+            scale = 1.0 / np.sqrt(np.maximum(np.reshape(layer.variance, -1), 1e-12))
+            continue
+        if not isinstance(layer, tf.keras.layers.Dense):
+            raise ValueError(f"Unsupported layer {layer.name} ({type(layer).__name__})")
+        activation = layer.get_config()["activation"]
+        if activation not in ACTIVATIONS:
+            raise ValueError(f"Unsupported activation {activation} in {layer.name}")
+        kernel, bias = layer.get_weights()
+        layers.append((kernel, bias, ACTIVATIONS[activation]))
+    if not layers:
+        raise ValueError("Model has no Dense layers")
+    return mean, scale, layers
+
+
+def encode_layer(kernel, bias, activation, int8):
+    n_in, n_out = kernel.shape
+    out = struct.pack("<4I", n_in, n_out, activation, 1 if int8 else 0)
+    if int8:
+        # Symmetric per-output-channel scales
+        scales = np.max(np.abs(kernel), axis=0) / 127.0
+        scales[scales == 0] = 1.0
+        q = np.clip(np.round(kernel / scales), -127, 127).astype(np.int8)
+        out += f32(scales) + q.tobytes()
+        out += b"\0" * (-len(q.tobytes()) % 4)
+    else:
+        out += f32(kernel)
+    return out + f32(bias)
+
+
+def export(model, path, int8=False):
+    mean, scale, layers = dense_layers(model)
+    n_in = layers[0][0].shape[0]
+    n_out = layers[-1][0].shape[1]
+    data = MAGIC + struct.pack("<5I", VERSION, n_in, n_out, len(layers), 0)
+    data += f32(mean) + f32(scale)
+    # Outputs are already in parameter units
+    data += f32(np.zeros(n_out)) + f32(np.ones(n_out))
+    for kernel, bias, activation in layers:
+        data += encode_layer(kernel, bias, activation, int8)
+    with open(path, "wb") as f:
+        f.write(data)
+    return len(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("model", help="Keras model (SavedModel directory or .keras/.h5 file)")
+    parser.add_argument("output", help="weight file to write")
+    parser.add_argument("--int8", action="store_true", help="quantize weights to int8")
+    args = parser.parse_args()
+
+    model = tf.keras.models.load_model(args.model)
+    size = export(model, args.output, int8=args.int8)
+    print(f"Wrote {args.output} ({size} bytes{', int8' if args.int8 else ''})")
+
+
+if __name__ == "__main__":
+    main()